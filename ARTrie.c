@@ -22,6 +22,7 @@
 */
 
 #include "ARTrie.h"
+#include "FrozenTrie.h"
 
 /*  Creates new ARTrie  */
 ARTrie *createARTrie(){
@@ -30,6 +31,7 @@ ARTrie *createARTrie(){
 	if(root == NULL)
 		abort();
 	root->firstNode = NULL;
+	root->frozen = NULL;
 	return root;
 }
 
@@ -51,6 +53,12 @@ ARTNode *newARTNode(wchar_t a){
 int addToARTrie(ARTrie *art, wchar_t *string, int strLen, double value){
 	ARTNode *tmp;
 
+	/* the frozen form does not hold the new transformation */
+	if(art->frozen != NULL){
+		freeFrozenTrie(art->frozen);
+		art->frozen = NULL;
+	}
+
 	/* If trie is still empty ... */
 	if(art->firstNode == NULL){
 		art->firstNode = newARTNode(*string);
@@ -217,6 +225,9 @@ void freeARTrie(ARTrie *art){
    if (tmp != NULL){
       freeARTNode(tmp); 
    }
+   if (art->frozen != NULL){
+      freeFrozenTrie(art->frozen);
+   }
    free(art);
 }
 
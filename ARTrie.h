@@ -53,10 +53,13 @@ typedef struct ARTNode{
 
 /**
 *   Trie structure for storing generalized edit distance 'add' or 'remove'
-*   operations. Contains pointer to the first node in trie.
+*   operations. Contains pointer to the first node in trie, and the compact 
+*   read-only form of the trie used for searching ( \c FrozenTrie , \c NULL
+*   if it has not been built yet).
 */
 typedef struct ARTrie{
 	struct ARTNode *firstNode;
+	struct FrozenTrie *frozen;
 } ARTrie;
 
 /**
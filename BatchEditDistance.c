@@ -0,0 +1,453 @@
+/*
+*    Copyright (C) 2010 University of Tartu
+*    Authors: Reina Krik, Siim Orasmaa, Kristo Tammeoja, Jaak Vilo
+*    Contact:  siim . orasmaa {at} ut . ee
+*
+*    This file is part of Generalized Edit Distance Tool.
+*
+*    Generalized Edit Distance Tool is free software: you can redistribute 
+*    it and/or modify it under the terms of the GNU General Public License 
+*    as published by the Free Software Foundation, either version 3 of the
+*    License, or (at your option) any later version.
+*
+*    Generalized Edit Distance Tool is distributed in the hope that it will 
+*    be useful, but WITHOUT ANY WARRANTY; without even the implied warranty 
+*    of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*    GNU General Public License for more details.
+*
+*    You should have received a copy of the GNU General Public License
+*    along with Generalized Edit Distance Tool. 
+*    If not, see <http://www.gnu.org/licenses/>.
+*
+*/
+
+#include "BatchEditDistance.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define BATCH_X86
+#include <immintrin.h>
+#endif
+
+// Checks, whether all transformations in the tries are single-character ones
+int hasOnlySingleCharTransformations(GedEngine *e){
+    FrozenTrie *repF = frozenTrie(e->t);
+    EndNode *repl;
+    int node;
+
+    // all the strings are of a single character, if the tries have no nodes below the first level
+    if(repF->maxDepth > 1 || frozenARTrie(e->addT)->maxDepth > 1 || frozenARTrie(e->remT)->maxDepth > 1)
+        return 0;
+    for(node = 1; node < repF->nNodes; node++)
+        for(repl = repF->nodes[node].replacement; repl != NULL; repl = repl->nextEN)
+            if(repl->edit[0] == L'\0' || repl->edit[1] != L'\0')
+                return 0;
+    return 1;
+}
+
+static void batchColumnScalar(BatchProfile *p, BatchColumn *c);
+#ifdef BATCH_X86
+static void batchColumnSSE41(BatchProfile *p, BatchColumn *c);
+static void batchColumnAVX2(BatchProfile *p, BatchColumn *c);
+#endif
+
+// Compiles the search string for the batch calculation
+BatchProfile *createBatchProfile(GedQuery *q){
+    GedEngine *e = q->engine;
+    wchar_t *a = q->string;
+    int aLen = q->len;
+    BatchProfile *p;
+    FrozenTrie *repF, *addF, *remF;
+    EndNode *repl;
+    int node;
+    int i, s, rows, nChars;
+    size_t cells, k;
+
+    if(!hasOnlySingleCharTransformations(e))
+        return NULL;
+    // single-character transformations are children of the root
+    repF = frozenTrie(e->t);
+    addF = frozenARTrie(e->addT);
+    remF = frozenARTrie(e->remT);
+    p = (BatchProfile *)malloc(sizeof(BatchProfile));
+    if(p == NULL)
+        abort();
+    p->len = aLen;
+    p->rep = e->rep;
+    p->rem = e->rem;
+    p->add = e->add;
+    rows = aLen + 1;
+
+    // alphabet: characters of the search string and of the transformations
+    nChars = aLen + (addF->nNodes - 1) + (remF->nNodes - 1);
+    for(node = 1; node < repF->nNodes; node++){
+        nChars++;
+        for(repl = repF->nodes[node].replacement; repl != NULL; repl = repl->nextEN)
+            nChars++;
+    }
+    p->alphabet = createAlphabet(nChars);
+    for(i = 0; i < aLen; i++)
+        addAlphabetSymbol(p->alphabet, a[i]);
+    for(node = 1; node < repF->nNodes; node++){
+        addAlphabetSymbol(p->alphabet, repF->nodes[node].label);
+        for(repl = repF->nodes[node].replacement; repl != NULL; repl = repl->nextEN)
+            addAlphabetSymbol(p->alphabet, repl->edit[0]);
+    }
+    for(node = 1; node < addF->nNodes; node++)
+        addAlphabetSymbol(p->alphabet, addF->nodes[node].label);
+    for(node = 1; node < remF->nNodes; node++)
+        addAlphabetSymbol(p->alphabet, remF->nodes[node].label);
+
+    cells = (size_t)rows * BATCH_LANES * sizeof(double);
+    p->querySymbol = (double *)malloc(rows * sizeof(double));
+    p->repCost     = (double *)malloc((size_t)p->alphabet->nSymbols * rows * sizeof(double));
+    p->addCost     = (double *)malloc(p->alphabet->nSymbols * sizeof(double));
+    p->remCost     = (double *)malloc(rows * sizeof(double));
+    p->edPen       = (double *)malloc(rows * sizeof(double));
+    p->genPen      = (double *)malloc(rows * sizeof(double));
+    p->addEdPen    = (double *)malloc(rows * sizeof(double));
+    p->addGenPen   = (double *)malloc(rows * sizeof(double));
+    p->firstColumn = (double *)malloc(rows * sizeof(double));
+    p->prev        = (double *)aligned_alloc(32, cells);
+    p->cur         = (double *)aligned_alloc(32, cells);
+    if(p->querySymbol == NULL || p->repCost == NULL || p->addCost == NULL || p->remCost == NULL ||
+       p->edPen == NULL || p->genPen == NULL || p->addEdPen == NULL || p->addGenPen == NULL ||
+       p->firstColumn == NULL || p->prev == NULL || p->cur == NULL)
+        abort();
+
+    for(k = 0; k < (size_t)p->alphabet->nSymbols * rows; k++)
+        p->repCost[k] = INFINITY;
+    for(s = 0; s < p->alphabet->nSymbols; s++)
+        p->addCost[s] = INFINITY;
+    for(i = 0; i < rows; i++){
+        p->querySymbol[i] = (i > 0) ? alphabetSymbol(p->alphabet, a[i-1]) : 0;
+        p->remCost[i] = INFINITY;
+        p->edPen[i]     = (q->edPen != NULL && i > 0) ? q->edPen[i] : 0.0;
+        p->genPen[i]    = (q->genEdPen != NULL && i > 0) ? q->genEdPen[i] : 0.0;
+        p->addEdPen[i]  = (q->edPen != NULL) ? q->edPen[(i > 0) ? i + 1 : 0] : 0.0;
+        p->addGenPen[i] = (q->genEdPen != NULL) ? q->genEdPen[i + 1] : 0.0;
+    }
+    for(i = 1; i < rows; i++){
+        node = frozenChild(repF, 0, a[i-1]);
+        for(repl = (node >= 0) ? repF->nodes[node].replacement : NULL; repl != NULL; repl = repl->nextEN){
+            s = alphabetSymbol(p->alphabet, repl->edit[0]);
+            if(repl->value < p->repCost[s * rows + i])
+                p->repCost[s * rows + i] = repl->value;
+        }
+        node = frozenChild(remF, 0, a[i-1]);
+        if(node >= 0 && remF->nodes[node].value < p->remCost[i])
+            p->remCost[i] = remF->nodes[node].value;
+    }
+    for(node = 1; node < addF->nNodes; node++){
+        s = alphabetSymbol(p->alphabet, addF->nodes[node].label);
+        if(addF->nodes[node].value < p->addCost[s])
+            p->addCost[s] = addF->nodes[node].value;
+    }
+
+    // the first column does not depend on the text
+    p->firstColumn[0] = 0;
+    for(i = 1; i < rows; i++){
+        double value = DBL_MAX;
+        double x = (p->firstColumn[i-1] + p->rem) + p->edPen[i];
+        if(x < value) value = x;
+        x = (p->firstColumn[i-1] + p->genPen[i]) + p->remCost[i];
+        if(x < value) value = x;
+        p->firstColumn[i] = value;
+    }
+
+    p->column = batchColumnScalar;
+#ifdef BATCH_X86
+    __builtin_cpu_init();
+    if(__builtin_cpu_supports("avx2"))
+        p->column = batchColumnAVX2;
+    else if(__builtin_cpu_supports("sse4.1"))
+        p->column = batchColumnSSE41;
+#endif
+    return p;
+}
+
+// Releases memory under the profile
+void freeBatchProfile(BatchProfile *p){
+    if(p == NULL)
+        return;
+    freeAlphabet(p->alphabet);
+    free(p->querySymbol);
+    free(p->repCost);
+    free(p->addCost);
+    free(p->remCost);
+    free(p->edPen);
+    free(p->genPen);
+    free(p->addEdPen);
+    free(p->addGenPen);
+    free(p->firstColumn);
+    free(p->prev);
+    free(p->cur);
+    free(p);
+}
+
+// Returns the name of the kernel used by the profile
+const char *batchKernelName(BatchProfile *p){
+#ifdef BATCH_X86
+    if(p->column == batchColumnAVX2)
+        return "avx2";
+    if(p->column == batchColumnSSE41)
+        return "sse4.1";
+#endif
+    return "scalar";
+}
+
+/*
+*   Calculates the next column of the table for all lanes. All candidates of 
+*  a cell are computed with the same order of additions as in the scalar 
+*  calculation ( \a genEditDistance_mod() ), so the results are equal to it:
+*    (prev[i-1] + rep) + edPen[i]  or  prev[i-1]  (identity)
+*    (prev[i-1] + genPen[i]) + repCost
+*    (prev[i] + add) + addEdPen[i]
+*    (prev[i] + addGenPen[i]) + addCost
+*    (cur[i-1] + rem) + edPen[i]
+*    (cur[i-1] + genPen[i]) + remCost[i]
+*  Missing transformations have cost INFINITY and the result is capped to 
+*  DBL_MAX, which marks unreachable cells.
+*/
+static void batchColumnScalar(BatchProfile *p, BatchColumn *c){
+    double *prev = p->prev, *cur = p->cur;
+    double value, x;
+    int i, l;
+
+    for(l = 0; l < BATCH_LANES; l++){
+        value = c->start[l];
+        x = (prev[l] + p->add) + p->addEdPen[0];
+        if(x < value) value = x;
+        x = (prev[l] + p->addGenPen[0]) + c->addCost[l];
+        if(x < value) value = x;
+        cur[l] = value;
+    }
+    for(i = 1; i <= p->len; i++){
+        double *diag = prev + (i-1) * BATCH_LANES;
+        double *left = prev + i * BATCH_LANES;
+        double *up   = cur + (i-1) * BATCH_LANES;
+        double *cell = cur + i * BATCH_LANES;
+        for(l = 0; l < BATCH_LANES; l++){
+            value = DBL_MAX;
+            x = (p->querySymbol[i] == c->symbol[l]) ? diag[l] : (diag[l] + p->rep) + p->edPen[i];
+            if(x < value) value = x;
+            x = (diag[l] + p->genPen[i]) + c->repRow[l][i];
+            if(x < value) value = x;
+            x = (left[l] + p->add) + p->addEdPen[i];
+            if(x < value) value = x;
+            x = (left[l] + p->addGenPen[i]) + c->addCost[l];
+            if(x < value) value = x;
+            x = (up[l] + p->rem) + p->edPen[i];
+            if(x < value) value = x;
+            x = (up[l] + p->genPen[i]) + p->remCost[i];
+            if(x < value) value = x;
+            cell[l] = value;
+        }
+    }
+}
+
+#ifdef BATCH_X86
+
+// The same as batchColumnScalar(), two lanes per register
+__attribute__((target("sse4.1")))
+static void batchColumnSSE41(BatchProfile *p, BatchColumn *c){
+    double *prev = p->prev, *cur = p->cur;
+    __m128d vAdd = _mm_set1_pd(p->add), vRep = _mm_set1_pd(p->rep), vRem = _mm_set1_pd(p->rem);
+    __m128d vMax = _mm_set1_pd(DBL_MAX);
+    __m128d sym, qs, edPen, genPen, addEdPen, addGenPen, remCost;
+    __m128d diag, left, up, value, x;
+    int i, l;
+
+    addEdPen  = _mm_set1_pd(p->addEdPen[0]);
+    addGenPen = _mm_set1_pd(p->addGenPen[0]);
+    for(l = 0; l < BATCH_LANES; l += 2){
+        left  = _mm_load_pd(prev + l);
+        value = _mm_loadu_pd(c->start + l);
+        value = _mm_min_pd(value, _mm_add_pd(_mm_add_pd(left, vAdd), addEdPen));
+        value = _mm_min_pd(value, _mm_add_pd(_mm_add_pd(left, addGenPen), _mm_loadu_pd(c->addCost + l)));
+        _mm_store_pd(cur + l, value);
+    }
+    for(i = 1; i <= p->len; i++){
+        qs        = _mm_set1_pd(p->querySymbol[i]);
+        edPen     = _mm_set1_pd(p->edPen[i]);
+        genPen    = _mm_set1_pd(p->genPen[i]);
+        addEdPen  = _mm_set1_pd(p->addEdPen[i]);
+        addGenPen = _mm_set1_pd(p->addGenPen[i]);
+        remCost   = _mm_set1_pd(p->remCost[i]);
+        for(l = 0; l < BATCH_LANES; l += 2){
+            diag = _mm_load_pd(prev + (i-1) * BATCH_LANES + l);
+            left = _mm_load_pd(prev + i * BATCH_LANES + l);
+            up   = _mm_load_pd(cur + (i-1) * BATCH_LANES + l);
+            sym  = _mm_loadu_pd(c->symbol + l);
+            x = _mm_blendv_pd(_mm_add_pd(_mm_add_pd(diag, vRep), edPen), diag, _mm_cmpeq_pd(qs, sym));
+            value = _mm_min_pd(vMax, x);
+            x = _mm_add_pd(_mm_add_pd(diag, genPen), _mm_set_pd(c->repRow[l+1][i], c->repRow[l][i]));
+            value = _mm_min_pd(value, x);
+            value = _mm_min_pd(value, _mm_add_pd(_mm_add_pd(left, vAdd), addEdPen));
+            value = _mm_min_pd(value, _mm_add_pd(_mm_add_pd(left, addGenPen), _mm_loadu_pd(c->addCost + l)));
+            value = _mm_min_pd(value, _mm_add_pd(_mm_add_pd(up, vRem), edPen));
+            value = _mm_min_pd(value, _mm_add_pd(_mm_add_pd(up, genPen), remCost));
+            _mm_store_pd(cur + i * BATCH_LANES + l, value);
+        }
+    }
+}
+
+// The same as batchColumnScalar(), four lanes per register
+__attribute__((target("avx2")))
+static void batchColumnAVX2(BatchProfile *p, BatchColumn *c){
+    double *prev = p->prev, *cur = p->cur;
+    __m256d vAdd = _mm256_set1_pd(p->add), vRep = _mm256_set1_pd(p->rep), vRem = _mm256_set1_pd(p->rem);
+    __m256d vMax = _mm256_set1_pd(DBL_MAX);
+    __m256d sym[2], addCost[2];
+    __m128i repIndex[2];
+    __m256d qs, edPen, genPen, addEdPen, addGenPen, remCost;
+    __m256d diag, left, up, value, x;
+    int i, h;
+
+    for(h = 0; h < 2; h++){
+        sym[h]      = _mm256_loadu_pd(c->symbol + 4*h);
+        addCost[h]  = _mm256_loadu_pd(c->addCost + 4*h);
+        repIndex[h] = _mm_loadu_si128((__m128i *)(c->repIndex + 4*h));
+    }
+    addEdPen  = _mm256_set1_pd(p->addEdPen[0]);
+    addGenPen = _mm256_set1_pd(p->addGenPen[0]);
+    for(h = 0; h < 2; h++){
+        left  = _mm256_load_pd(prev + 4*h);
+        value = _mm256_loadu_pd(c->start + 4*h);
+        value = _mm256_min_pd(value, _mm256_add_pd(_mm256_add_pd(left, vAdd), addEdPen));
+        value = _mm256_min_pd(value, _mm256_add_pd(_mm256_add_pd(left, addGenPen), addCost[h]));
+        _mm256_store_pd(cur + 4*h, value);
+    }
+    for(i = 1; i <= p->len; i++){
+        qs        = _mm256_set1_pd(p->querySymbol[i]);
+        edPen     = _mm256_set1_pd(p->edPen[i]);
+        genPen    = _mm256_set1_pd(p->genPen[i]);
+        addEdPen  = _mm256_set1_pd(p->addEdPen[i]);
+        addGenPen = _mm256_set1_pd(p->addGenPen[i]);
+        remCost   = _mm256_set1_pd(p->remCost[i]);
+        for(h = 0; h < 2; h++){
+            diag = _mm256_load_pd(prev + (i-1) * BATCH_LANES + 4*h);
+            left = _mm256_load_pd(prev + i * BATCH_LANES + 4*h);
+            up   = _mm256_load_pd(cur + (i-1) * BATCH_LANES + 4*h);
+            x = _mm256_blendv_pd(_mm256_add_pd(_mm256_add_pd(diag, vRep), edPen), diag, 
+                                 _mm256_cmp_pd(qs, sym[h], _CMP_EQ_OQ));
+            value = _mm256_min_pd(vMax, x);
+            x = _mm256_add_pd(_mm256_add_pd(diag, genPen), _mm256_i32gather_pd(p->repCost + i, repIndex[h], 8));
+            value = _mm256_min_pd(value, x);
+            value = _mm256_min_pd(value, _mm256_add_pd(_mm256_add_pd(left, vAdd), addEdPen));
+            value = _mm256_min_pd(value, _mm256_add_pd(_mm256_add_pd(left, addGenPen), addCost[h]));
+            value = _mm256_min_pd(value, _mm256_add_pd(_mm256_add_pd(up, vRem), edPen));
+            value = _mm256_min_pd(value, _mm256_add_pd(_mm256_add_pd(up, genPen), remCost));
+            _mm256_store_pd(cur + i * BATCH_LANES + 4*h, value);
+        }
+    }
+}
+
+#endif
+
+// Calculates distances between the search string and at most BATCH_LANES texts at once; 
+// each lane has its own variant of the first row (isFree[l]) and is reduced in two ways
+static void batchLanes(BatchProfile *p, wchar_t **b, int *bLen, short *isFree, int n, 
+                       double *lastScores, double *bestScores){
+    BatchColumn c;
+    double *tmp;
+    int rows = p->len + 1;
+    int maxLen = 0;
+    int i, j, l, s;
+
+    for(l = 0; l < n; l++){
+        if(bLen[l] > maxLen)
+            maxLen = bLen[l];
+        lastScores[l] = (bLen[l] == 0) ? p->firstColumn[rows-1] : DBL_MAX;
+        bestScores[l] = DBL_MAX;
+    }
+    for(i = 0; i < rows; i++)
+        for(l = 0; l < BATCH_LANES; l++)
+            p->prev[i * BATCH_LANES + l] = p->firstColumn[i];
+
+    for(j = 1; j <= maxLen; j++){
+        for(l = 0; l < BATCH_LANES; l++){
+            s = (l < n && j <= bLen[l]) ? alphabetSymbol(p->alphabet, b[l][j-1]) : 0;
+            c.symbol[l]   = (l < n && j <= bLen[l]) ? s : -1;
+            c.addCost[l]  = p->addCost[s];
+            c.repIndex[l] = s * rows;
+            c.repRow[l]   = p->repCost + s * rows;
+            c.start[l]    = (l < n && isFree[l] && j < bLen[l]) ? 0.0 : DBL_MAX;
+        }
+        p->column(p, &c);
+        for(l = 0; l < n; l++){
+            if(j > bLen[l])
+                continue;
+            if(p->cur[(rows-1) * BATCH_LANES + l] < bestScores[l])
+                bestScores[l] = p->cur[(rows-1) * BATCH_LANES + l];
+            if(j == bLen[l])
+                lastScores[l] = p->cur[(rows-1) * BATCH_LANES + l];
+        }
+        tmp = p->prev;
+        p->prev = p->cur;
+        p->cur = tmp;
+    }
+}
+
+// Orders texts by their length
+static int compareByLength(const void *x, const void *y){
+    const int *u = (const int *)x, *v = (const int *)y;
+    if(u[0] != v[0])
+        return (u[0] < v[0]) ? -1 : 1;
+    return (u[1] < v[1]) ? -1 : (u[1] > v[1]);
+}
+
+// Calculates distances of several match types between the search string and n texts, BATCH_LANES lanes at once
+void batchEditDistances(BatchProfile *p, wchar_t **b, int *bLen, int n, 
+                        double *full, double *prefix, double *suffix, double *infix){
+    wchar_t *laneText[BATCH_LANES];
+    int laneLen[BATCH_LANES];
+    int laneWord[BATCH_LANES];
+    short isFree[BATCH_LANES];
+    double lastScores[BATCH_LANES];
+    double bestScores[BATCH_LANES];
+    short needAnchored = (full != NULL || prefix != NULL);
+    short needFree = (suffix != NULL || infix != NULL);
+    int *order;
+    int k, l, m, v, w;
+
+    if(!needAnchored && !needFree)
+        return;
+    // texts of similar length are put into the same batch, so that lanes are not left idle
+    order = (int *)malloc(2 * (n + 1) * sizeof(int));
+    if(order == NULL)
+        abort();
+    for(k = 0; k < n; k++){
+        order[2*k]   = bLen[k];
+        order[2*k+1] = k;
+    }
+    qsort(order, n, 2 * sizeof(int), compareByLength);
+    k = 0;
+    while(k < n){
+        // if both variants of the first row are needed, they take adjacent lanes
+        m = 0;
+        while(k < n && m + needAnchored + needFree <= BATCH_LANES){
+            for(v = 0; v < 2; v++){
+                if((v == 0 && !needAnchored) || (v == 1 && !needFree))
+                    continue;
+                laneWord[m] = order[2*k+1];
+                laneText[m] = b[order[2*k+1]];
+                laneLen[m]  = order[2*k];
+                isFree[m]   = v;
+                m++;
+            }
+            k++;
+        }
+        batchLanes(p, laneText, laneLen, isFree, m, lastScores, bestScores);
+        for(l = 0; l < m; l++){
+            w = laneWord[l];
+            if(!isFree[l]){
+                if(full != NULL)   full[w]   = lastScores[l];
+                if(prefix != NULL) prefix[w] = bestScores[l];
+            } else {
+                if(suffix != NULL) suffix[w] = lastScores[l];
+                if(infix != NULL)  infix[w]  = bestScores[l];
+            }
+        }
+    }
+    free(order);
+}
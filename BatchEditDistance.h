@@ -0,0 +1,158 @@
+/*
+*    Copyright (C) 2010 University of Tartu
+*    Authors: Reina Krik, Siim Orasmaa, Kristo Tammeoja, Jaak Vilo
+*    Contact:  siim . orasmaa {at} ut . ee
+*
+*    This file is part of Generalized Edit Distance Tool.
+*
+*    Generalized Edit Distance Tool is free software: you can redistribute 
+*    it and/or modify it under the terms of the GNU General Public License 
+*    as published by the Free Software Foundation, either version 3 of the
+*    License, or (at your option) any later version.
+*
+*    Generalized Edit Distance Tool is distributed in the hope that it will 
+*    be useful, but WITHOUT ANY WARRANTY; without even the implied warranty 
+*    of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*    GNU General Public License for more details.
+*
+*    You should have received a copy of the GNU General Public License
+*    along with Generalized Edit Distance Tool. 
+*    If not, see <http://www.gnu.org/licenses/>.
+*
+*/
+
+#ifndef BATCHEDITDISTANCE_H
+#define BATCHEDITDISTANCE_H
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <float.h>
+#include <math.h>
+#include <wchar.h>
+#include "Trie.h"
+#include "ARTrie.h"
+#include "FrozenTrie.h"
+#include "GedEngine.h"
+
+/**
+*   Number of texts (dictionary words) processed at once by the batch kernel.
+*/
+#define BATCH_LANES  8
+
+/**
+*   Data of a single column of the batch calculation: for each lane (text),
+*  the symbol of the text character at the column ( \a symbol , -1 if the 
+*  text has already ended), the cost of adding that character with a 
+*  generalized edit distance transformation ( \a addCost ), the value the 
+*  first row starts with ( \a start ), and the costs of replacing search 
+*  string characters with the text character ( \a repRow[l][i] for the 
+*  row \c i ; \a repIndex[l] is the offset of the same row in 
+*  \c BatchProfile.repCost ).
+*/
+typedef struct BatchColumn {
+    double symbol[BATCH_LANES];
+    double addCost[BATCH_LANES];
+    double start[BATCH_LANES];
+    double *repRow[BATCH_LANES];
+    int repIndex[BATCH_LANES];
+} BatchColumn;
+
+/**
+*   Search string compiled for calculating generalized edit distance against
+*  \c BATCH_LANES texts at once, in lockstep. Can be used only if all the
+*  generalized edit distance transformations are single-character ones.
+*
+*   Characters of the search string and of the transformations are mapped 
+*  into small integer symbols by \a alphabet (symbol 0 stands for all other
+*  characters).
+*
+*   Costs of regular edit distance operations are copied from the engine
+*  ( \a rep , \a rem , \a add ). Costs of transformations are stored 
+*  densely per row \c i of the table (row \c i corresponds to the search
+*  string character \c a[i-1] ):
+*  \a repCost[s*(len+1)+i] is the cost of replacing \c a[i-1] with symbol 
+*  \c s via a transformation (\c INFINITY if there is none), \a addCost[s] 
+*  is the cost of adding symbol \c s via a transformation, and \a remCost[i]
+*  is the cost of removing \c a[i-1] via a transformation. 
+*
+*   Penalties of changing the search string are copied from the masks
+*  \c edPen and \c genEdPen of the query (0.0 if there are no masks): 
+*  \a edPen[i] and \a genPen[i] apply to replacing or removing \c a[i-1], and \a addEdPen[i] and \a addGenPen[i] 
+*  apply to adding a character in row \c i .
+*
+*   The table is calculated column by column with the kernel \a column ,
+*  which is chosen according to the instruction sets supported by the 
+*  processor (AVX2, SSE4.1 or plain C). Cells of the previous and current
+*  column are held in \a prev and \a cur , \c BATCH_LANES values per row.
+*/
+typedef struct BatchProfile {
+    int len;
+    double rep;
+    double rem;
+    double add;
+    Alphabet *alphabet;
+    double *querySymbol;
+    double *repCost;
+    double *addCost;
+    double *remCost;
+    double *edPen;
+    double *genPen;
+    double *addEdPen;
+    double *addGenPen;
+    double *firstColumn;
+    double *prev;
+    double *cur;
+    void (*column)(struct BatchProfile *p, BatchColumn *c);
+} BatchProfile;
+
+/**
+*   Checks, whether all generalized edit distance transformations in the
+*   tries \a *t , \a *addT and \a *remT of the engine \a *e are 
+*   single-character ones, so that the batch calculation can be used.
+*/
+int hasOnlySingleCharTransformations(GedEngine *e);
+
+/**
+*   Compiles the search string of the query \a *q for the batch calculation, 
+*   using the transformations and default costs of its engine and its 
+*   penalty masks. 
+*   Returns NULL, if the batch calculation cannot be used (see 
+*   \a hasOnlySingleCharTransformations() ). Memory under the profile must be
+*   released with \a freeBatchProfile() .
+*/
+BatchProfile *createBatchProfile(GedQuery *q);
+
+/**
+*   Releases memory under \a *p .
+*/
+void freeBatchProfile(BatchProfile *p);
+
+/**
+*   Returns the name of the kernel used by \a *p ("avx2", "sse4.1" or "scalar").
+*/
+const char *batchKernelName(BatchProfile *p);
+
+/**
+*   Calculates generalized edit distances of several match types (full, prefix,
+*   suffix and infix, see \a genEditDistance_modes_limit() ) between the compiled
+*   search string \a *p and \a n texts \a b[0..n-1] (with lengths \a bLen[0..n-1] ).
+*   Texts are sorted by length and processed \c BATCH_LANES lanes at a time; if
+*   matches starting at the beginning of the text (full, prefix) and matches 
+*   starting anywhere (suffix, infix) are both needed, each text takes two
+*   adjacent lanes, one for each variant of the first row. Scores are stored 
+*   into the arrays of length \a n whose pointer is not NULL, and are equal to
+*   the ones from \a genEditDistance_mod() .
+*
+*  \param p compiled search string
+*  \param b texts
+*  \param bLen lengths of texts
+*  \param n number of texts
+*  \param full scores of full matches, or NULL
+*  \param prefix scores of prefix matches, or NULL
+*  \param suffix scores of suffix matches, or NULL
+*  \param infix scores of infix matches, or NULL
+*/
+void batchEditDistances(BatchProfile *p, wchar_t **b, int *bLen, int n, 
+                        double *full, double *prefix, double *suffix, double *infix);
+
+#endif
@@ -0,0 +1,583 @@
+/*
+*    Copyright (C) 2010 University of Tartu
+*    Authors: Reina Krik, Siim Orasmaa, Kristo Tammeoja, Jaak Vilo
+*    Contact:  siim . orasmaa {at} ut . ee
+*
+*    This file is part of Generalized Edit Distance Tool.
+*
+*    Generalized Edit Distance Tool is free software: you can redistribute 
+*    it and/or modify it under the terms of the GNU General Public License 
+*    as published by the Free Software Foundation, either version 3 of the
+*    License, or (at your option) any later version.
+*
+*    Generalized Edit Distance Tool is distributed in the hope that it will 
+*    be useful, but WITHOUT ANY WARRANTY; without even the implied warranty 
+*    of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*    GNU General Public License for more details.
+*
+*    You should have received a copy of the GNU General Public License
+*    along with Generalized Edit Distance Tool. 
+*    If not, see <http://www.gnu.org/licenses/>.
+*
+*/
+
+#include <langinfo.h>
+#include "Dictionary.h"
+
+#if defined(__SSE2__) && WCHAR_MAX > 0xFFFF
+#define DICT_SSE2
+#include <emmintrin.h>
+#endif
+
+// Tells whether the encoding of the locale is UTF-8
+int localeIsUtf8(void){
+    return strcmp(nl_langinfo(CODESET), "UTF-8") == 0;
+}
+
+// Makes room for at least n more characters in the buffer
+static inline void reserveChars(CharBuffer *buf, long long n){
+    if(buf->n + n <= buf->cap)
+        return;
+    buf->cap = (buf->n + n > 2 * buf->cap) ? buf->n + n : 2 * buf->cap;
+    buf->chars = (wchar_t *)realloc(buf->chars, buf->cap * sizeof(wchar_t));
+    if(buf->chars == NULL){
+        puts("Error: Could not allocate memory");
+        exit(1);
+    }
+}
+
+// Decodes a UTF-8 sequence (of more than one byte) at s, at most left bytes; returns its length, or -1 if it is invalid
+static inline int decodeUtf8(const unsigned char *s, int left, wchar_t *c){
+    unsigned int v, min;
+    int len, k;
+
+    // as mbstowcs() of the C library: forms up to 6 bytes, no overlong forms nor surrogates
+    if(s[0] < 0xC2)
+        return -1;
+    else if(s[0] < 0xE0){ len = 2; v = s[0] & 0x1F; min = 0x80; }
+    else if(s[0] < 0xF0){ len = 3; v = s[0] & 0x0F; min = 0x800; }
+    else if(s[0] < 0xF8){ len = 4; v = s[0] & 0x07; min = 0x10000; }
+    else if(s[0] < 0xFC){ len = 5; v = s[0] & 0x03; min = 0x200000; }
+    else if(s[0] < 0xFE){ len = 6; v = s[0] & 0x01; min = 0x4000000; }
+    else
+        return -1;
+    if(len > left)
+        return -1;
+    for(k = 1; k < len; k++){
+        if((s[k] & 0xC0) != 0x80)
+            return -1;
+        v = (v << 6) | (s[k] & 0x3F);
+    }
+    if(v < min || (v >= 0xD800 && v <= 0xDFFF))
+        return -1;
+    *c = (wchar_t)v;
+    return len;
+}
+
+// Decodes a line of the file straight into the buffer
+int decodeLine(GedEngine *e, char *file, int datalen, int i, int *end, CharBuffer *buf, int utf8){
+    const unsigned char *s = (const unsigned char *)file;
+    long long first = buf->n;
+    wchar_t *out;
+    mbstate_t state;
+    size_t mbLen;
+    int j = i;
+    int len;
+
+    memset(&state, 0, sizeof(state));
+    while(1){
+        // room for 16 characters and the L'\0'
+        reserveChars(buf, 17);
+        out = buf->chars + buf->n;
+#ifdef DICT_SSE2
+        if(j + 16 <= datalen){
+            __m128i zero = _mm_setzero_si128();
+            __m128i v = _mm_loadu_si128((const __m128i *)(s + j));
+            __m128i lo = _mm_unpacklo_epi8(v, zero);
+            __m128i hi = _mm_unpackhi_epi8(v, zero);
+            int stop = _mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8('\n')),
+                                                      _mm_cmpeq_epi8(v, _mm_set1_epi8('\r'))));
+            // all 16 bytes are widened, those before a line break or a non-ASCII byte are kept
+            _mm_storeu_si128((__m128i *)out,        _mm_unpacklo_epi16(lo, zero));
+            _mm_storeu_si128((__m128i *)(out + 4),  _mm_unpackhi_epi16(lo, zero));
+            _mm_storeu_si128((__m128i *)(out + 8),  _mm_unpacklo_epi16(hi, zero));
+            _mm_storeu_si128((__m128i *)(out + 12), _mm_unpackhi_epi16(hi, zero));
+            len = __builtin_ctz(stop | _mm_movemask_epi8(v) | 0x10000);
+            buf->n += len;
+            j += len;
+            if(len == 16)
+                continue;
+            out += len;
+        }
+#endif
+        if(j >= datalen || s[j] == '\n' || s[j] == '\r')
+            break;
+        if(s[j] < 0x80){
+            *out = s[j];
+            len = 1;
+        }
+        else if(utf8)
+            len = decodeUtf8(s + j, datalen - j, out);
+        else{
+            mbLen = mbrtowc(out, file + j, datalen - j, &state);
+            len = (mbLen == (size_t)-1 || mbLen == (size_t)-2 || mbLen == 0) ? -1 : (int)mbLen;
+        }
+        if(len < 0){
+            buf->n = first;
+            return -1;
+        }
+        buf->n++;
+        j += len;
+    }
+    *end = j;
+    len = buf->n - first;
+    buf->chars[buf->n++] = L'\0';
+    if(e->caseInsensitive)
+        makeStringToIgnoreCase(e, buf->chars + first, len);
+    return len;
+}
+
+// Sets up the block with no memory under it
+void initLineBlock(LineBlock *block){
+    block->n = 0;
+    block->text.chars = NULL;
+    block->text.n = 0;
+    block->text.cap = 0;
+}
+
+// Reads lines of the file into the block, until the block is full, the file ends or a line cannot be converted
+int readLineBlock(GedEngine *e, char *file, int datalen, int i, LineBlock *block){
+    long long offsets[LINE_BLOCK_SIZE];
+    int utf8 = localeIsUtf8();
+    int j, k, len;
+
+    block->n = 0;
+    block->text.n = 0;
+    while(i < datalen && block->n < LINE_BLOCK_SIZE){
+        offsets[block->n] = block->text.n;
+        len = decodeLine(e, file, datalen, i, &j, &block->text, utf8);
+        // a line that cannot be converted stops the program: lines before it are processed first
+        if(len < 0)
+            break;
+        block->lens[block->n]  = len;
+        block->start[block->n] = i;
+        block->end[block->n]   = j;
+        block->n++;
+
+        if(file[j] == '\r')
+            j +=2;
+        else j++;
+        i = j;
+    }
+    // the buffer may have moved while growing
+    for(k = 0; k < block->n; k++)
+        block->words[k] = block->text.chars + offsets[k];
+    return i;
+}
+
+// Stops the program with an error message about the line that cannot be converted
+void failOnLine(char *file, int datalen, int i){
+    int j = i;
+    char *str;
+
+    while(j < datalen && file[j] != '\n' && file[j] != '\r')
+        j++;
+    str = (char *)malloc(j-i+1);
+    if(str == NULL){
+       perror("Memory");
+       exit(1);
+    }
+    str[j-i] ='\0';
+    strncpy(str, (file+i), (j-i));
+    localeToWchar(str);
+    free(str);
+}
+
+// Releases memory under the strings in the block
+void freeLineBlock(LineBlock *block){
+    free(block->text.chars);
+    initLineBlock(block);
+}
+
+// Builds the length index of the dictionary: sorts the lines by the length of their strings
+static void buildLengthIndex(DecodedDictionary *dict){
+    int *next;
+    int k;
+
+    dict->maxLen = 0;
+    for(k = 0; k < dict->n; k++)
+        if(dict->lens[k] > dict->maxLen)
+            dict->maxLen = dict->lens[k];
+    dict->lengthStart = (int *)calloc(dict->maxLen + 2, sizeof(int));
+    dict->byLength    = (int *)malloc((dict->n + 1) * sizeof(int));
+    next              = (int *)malloc((dict->maxLen + 1) * sizeof(int));
+    if(dict->lengthStart == NULL || dict->byLength == NULL || next == NULL){
+        puts("Error: Could not allocate memory");
+        exit(1);
+    }
+    // counting sort: lines of equal length stay in the order of the file
+    for(k = 0; k < dict->n; k++)
+        dict->lengthStart[dict->lens[k] + 1]++;
+    for(k = 1; k <= dict->maxLen + 1; k++)
+        dict->lengthStart[k] += dict->lengthStart[k-1];
+    memcpy(next, dict->lengthStart, (dict->maxLen + 1) * sizeof(int));
+    for(k = 0; k < dict->n; k++)
+        dict->byLength[next[dict->lens[k]]++] = k;
+    free(next);
+}
+
+// Decodes all lines of the dictionary file into wide-character strings
+DecodedDictionary *decodeDictionary(GedEngine *e, char *file){
+    DecodedDictionary *dict;
+    CharBuffer text = { NULL, 0, 0 };
+    long long *offsets = NULL;  // positions of the strings in text
+    int utf8 = localeIsUtf8();
+    int datalen = strlen(file);
+    int i = 0;
+    int j, k, len, cap = 0;
+
+    dict = (DecodedDictionary *)calloc(1, sizeof(DecodedDictionary));
+    if(dict == NULL){
+        puts("Error: Could not allocate memory");
+        exit(1);
+    }
+    dict->bad = -1;
+    // all the strings are decoded into a single buffer
+    while(i < datalen){
+        if(dict->n == cap){
+            cap = (cap == 0) ? 1024 : 2 * cap;
+            dict->start = (int *)realloc(dict->start, cap * sizeof(int));
+            dict->end   = (int *)realloc(dict->end, cap * sizeof(int));
+            dict->lens  = (int *)realloc(dict->lens, cap * sizeof(int));
+            offsets     = (long long *)realloc(offsets, cap * sizeof(long long));
+            if(dict->start == NULL || dict->end == NULL || dict->lens == NULL || offsets == NULL){
+                perror("Memory");
+                exit(1);
+            }
+        }
+        offsets[dict->n] = text.n;
+        len = decodeLine(e, file, datalen, i, &j, &text, utf8);
+        if(len < 0){
+            dict->bad = i;
+            break;
+        }
+        dict->start[dict->n] = i;
+        dict->end[dict->n]   = j;
+        dict->lens[dict->n]  = len;
+        dict->n++;
+
+        if(file[j] == '\r')
+            j +=2;
+        else j++;
+        i = j;
+    }
+    dict->chars = text.chars;
+    dict->words = (wchar_t **)malloc((dict->n + 1) * sizeof(wchar_t *));
+    if(dict->words == NULL){
+        puts("Error: Could not allocate memory");
+        exit(1);
+    }
+    for(k = 0; k < dict->n; k++)
+        dict->words[k] = dict->chars + offsets[k];
+    free(offsets);
+    buildLengthIndex(dict);
+    dict->trie = buildDictionaryTrie(dict->words, dict->lens, dict->n, 0);
+    dict->reversedTrie = buildDictionaryTrie(dict->words, dict->lens, dict->n, 1);
+    return dict;
+}
+
+// Releases memory under the decoded dictionary and its strings
+void freeDecodedDictionary(DecodedDictionary *dict){
+    // other arrays of a dictionary loaded from an image belong to the image
+    if(!dict->image){
+        free(dict->chars);
+        free(dict->start);
+        free(dict->end);
+        free(dict->lens);
+        free(dict->byLength);
+        free(dict->lengthStart);
+    }
+    freeDictionaryTrie(dict->trie);
+    freeDictionaryTrie(dict->reversedTrie);
+    free(dict->words);
+    free(dict);
+}
+
+// Compares line numbers (for qsort)
+static int compareLines(const void *a, const void *b){
+    return *(int *)a - *(int *)b;
+}
+
+// Finds the lines with strings in the given range of lengths in the length index
+void lengthIndexRange(DecodedDictionary *dict, int minLen, int maxLen, int *from, int *to){
+    if(minLen < 0)
+        minLen = 0;
+    if(maxLen > dict->maxLen)
+        maxLen = dict->maxLen;
+    *from = *to = 0;
+    // only the buckets of the allowed lengths are visited
+    if(minLen <= maxLen){
+        *from = dict->lengthStart[minLen];
+        *to   = dict->lengthStart[maxLen + 1];
+    }
+}
+
+// Finds the lines with strings in the given range of lengths, in the order of the file
+int *linesOfLengths(DecodedDictionary *dict, int minLen, int maxLen, int *n){
+    int *lines;
+    int from, to;
+
+    lengthIndexRange(dict, minLen, maxLen, &from, &to);
+    if(to - from == dict->n)
+        return NULL;
+    *n = to - from;
+    lines = (int *)malloc((*n + 1) * sizeof(int));
+    if(lines == NULL){
+        puts("Error: Could not allocate memory");
+        exit(1);
+    }
+    memcpy(lines, dict->byLength + from, *n * sizeof(int));
+    qsort(lines, *n, sizeof(int), compareLines);
+    return lines;
+}
+
+// Tells whether the data is a dictionary image
+int isDictionaryImage(char *data, long long len){
+    return len >= 8 && strncmp(data, DICTIONARY_IMAGE_MAGIC, 8) == 0;
+}
+
+// Lays out the arrays of the trie in the image from the byte offset at; returns the offset following them
+static long long placeTrieImage(DictionaryTrieImage *ti, DictionaryTrie *t, long long at){
+    ti->nNodes    = t->nNodes;
+    ti->label     = at;
+    ti->size      = ti->label + alignFilePart((long long)t->nNodes * sizeof(wchar_t));
+    ti->lineStart = ti->size + alignFilePart((long long)t->nNodes * sizeof(int));
+    ti->lines     = ti->lineStart + alignFilePart((long long)(t->nNodes + 1) * sizeof(int));
+    return ti->lines + alignFilePart((long long)t->nLines * sizeof(int));
+}
+
+// Writes the arrays of the trie into the image; returns 0, or -1 on error
+static int writeTrieImage(FILE *f, DictionaryTrie *t){
+    if(writeFilePart(f, t->label, (long long)t->nNodes * sizeof(wchar_t)) == 0 &&
+       writeFilePart(f, t->size, (long long)t->nNodes * sizeof(int)) == 0 &&
+       writeFilePart(f, t->lineStart, (long long)(t->nNodes + 1) * sizeof(int)) == 0 &&
+       writeFilePart(f, t->lines, (long long)t->nLines * sizeof(int)) == 0)
+        return 0;
+    return -1;
+}
+
+// Creates a trie of n lines (longest of them maxLen characters), with the arrays in the image mapped into memory
+static DictionaryTrie *trieFromImage(char *data, DictionaryTrieImage *ti, int n, int maxLen){
+    DictionaryTrie *t = (DictionaryTrie *)calloc(1, sizeof(DictionaryTrie));
+    if(t == NULL){
+        puts("Error: Could not allocate memory");
+        exit(1);
+    }
+    t->image     = 1;
+    t->nNodes    = ti->nNodes;
+    t->nLines    = n;
+    t->maxDepth  = maxLen;
+    t->label     = (wchar_t *)(data + ti->label);
+    t->size      = (int *)(data + ti->size);
+    t->lineStart = (int *)(data + ti->lineStart);
+    t->lines     = (int *)(data + ti->lines);
+    return t;
+}
+
+// Writes the decoded dictionary into a dictionary image file
+int writeDictionaryImage(GedEngine *e, DecodedDictionary *dict, char *file, const char *path){
+    DictionaryImageHeader h;
+    FILE *f;
+    int *offsets;
+    long long nChars = 0;
+    int k, ok;
+
+    offsets = (int *)malloc((dict->n + 1) * sizeof(int));
+    if(offsets == NULL){
+        puts("Error: Could not allocate memory");
+        exit(1);
+    }
+    for(k = 0; k < dict->n; k++){
+        offsets[k] = (int)nChars;
+        nChars += dict->lens[k] + 1;
+    }
+
+    memset(&h, 0, sizeof(h));
+    memcpy(h.magic, DICTIONARY_IMAGE_MAGIC, 8);
+    h.version   = DICTIONARY_IMAGE_VERSION;
+    h.charSize  = sizeof(wchar_t);
+    h.caseTable = caseTableStamp(e);
+    h.n         = dict->n;
+    h.maxLen    = dict->maxLen;
+    h.textLen   = strlen(file);
+    h.text        = alignFilePart(sizeof(h));
+    h.start       = h.text + alignFilePart(h.textLen + 1);
+    h.end         = h.start + alignFilePart((long long)dict->n * sizeof(int));
+    h.lens        = h.end + alignFilePart((long long)dict->n * sizeof(int));
+    h.offsets     = h.lens + alignFilePart((long long)dict->n * sizeof(int));
+    h.chars       = h.offsets + alignFilePart((long long)dict->n * sizeof(int));
+    h.byLength    = h.chars + alignFilePart(nChars * sizeof(wchar_t));
+    h.lengthStart = h.byLength + alignFilePart((long long)dict->n * sizeof(int));
+    h.size = placeTrieImage(&h.trie, dict->trie, h.lengthStart + alignFilePart((long long)(dict->maxLen + 2) * sizeof(int)));
+    h.size = placeTrieImage(&h.reversedTrie, dict->reversedTrie, h.size);
+
+    if((f = fopen(path, "wb")) == NULL){
+        free(offsets);
+        return -1;
+    }
+    ok = writeFilePart(f, &h, sizeof(h)) == 0 &&
+         writeFilePart(f, file, h.textLen + 1) == 0 &&
+         writeFilePart(f, dict->start, (long long)dict->n * sizeof(int)) == 0 &&
+         writeFilePart(f, dict->end, (long long)dict->n * sizeof(int)) == 0 &&
+         writeFilePart(f, dict->lens, (long long)dict->n * sizeof(int)) == 0 &&
+         writeFilePart(f, offsets, (long long)dict->n * sizeof(int)) == 0;
+    // the strings are written one after another, each with its terminating L'\0'
+    for(k = 0; ok && k < dict->n; k++)
+        ok = fwrite(dict->words[k], sizeof(wchar_t), dict->lens[k] + 1, f) == (size_t)(dict->lens[k] + 1);
+    ok = ok && writeFilePart(f, NULL, nChars * sizeof(wchar_t)) == 0 &&
+         writeFilePart(f, dict->byLength, (long long)dict->n * sizeof(int)) == 0 &&
+         writeFilePart(f, dict->lengthStart, (long long)(dict->maxLen + 2) * sizeof(int)) == 0 &&
+         writeTrieImage(f, dict->trie) == 0 &&
+         writeTrieImage(f, dict->reversedTrie) == 0;
+    free(offsets);
+    if(fclose(f) != 0 || !ok)
+        return -1;
+    return 0;
+}
+
+// Tells whether count elements of given size at the byte offset lie within the image of len bytes, after its header
+static int isImagePart(long long offset, long long count, long long size, long long len){
+    return isFilePart(offset, count, size, sizeof(DictionaryImageHeader), len);
+}
+
+// Tells whether the parts of the image of len bytes lie within it, and its arrays are consistent with each other
+static int isDictionaryImageValid(DictionaryImageHeader *h, char *data, long long len){
+    DictionaryTrieImage *tries[2] = { &h->trie, &h->reversedTrie };
+    wchar_t *chars;
+    long long nChars;
+    int *start, *end, *lens, *offsets, *byLength, *lengthStart;
+    int k, maxLen = 0;
+
+    if(h->size != len || h->n < 0 || h->maxLen < 0 || h->textLen < 0 ||
+       !isImagePart(h->text, h->textLen + 1LL, 1, len) ||
+       !isImagePart(h->start, h->n, sizeof(int), len) || !isImagePart(h->end, h->n, sizeof(int), len) ||
+       !isImagePart(h->lens, h->n, sizeof(int), len) || !isImagePart(h->offsets, h->n, sizeof(int), len) ||
+       !isImagePart(h->chars, 0, sizeof(wchar_t), len) || !isImagePart(h->byLength, h->n, sizeof(int), len) ||
+       !isImagePart(h->lengthStart, h->maxLen + 2LL, sizeof(int), len) || data[h->text + h->textLen] != '\0')
+        return 0;
+    for(k = 0; k < 2; k++){
+        if(tries[k]->nNodes < 1 ||
+           !isImagePart(tries[k]->label, tries[k]->nNodes, sizeof(wchar_t), len) ||
+           !isImagePart(tries[k]->size, tries[k]->nNodes, sizeof(int), len) ||
+           !isImagePart(tries[k]->lineStart, tries[k]->nNodes + 1LL, sizeof(int), len) ||
+           !isImagePart(tries[k]->lines, h->n, sizeof(int), len))
+            return 0;
+    }
+    start   = (int *)(data + h->start);
+    end     = (int *)(data + h->end);
+    lens    = (int *)(data + h->lens);
+    offsets = (int *)(data + h->offsets);
+    chars   = (wchar_t *)(data + h->chars);
+    nChars  = (len - h->chars) / sizeof(wchar_t);
+    // every line lies within the text, and its string within the strings (ending with L'\0')
+    for(k = 0; k < h->n; k++){
+        if(start[k] < 0 || start[k] > end[k] || end[k] > h->textLen || lens[k] < 0 || 
+           offsets[k] < 0 || offsets[k] + (long long)lens[k] >= nChars || chars[offsets[k] + lens[k]] != L'\0')
+            return 0;
+        if(lens[k] > maxLen)
+            maxLen = lens[k];
+    }
+    // the length index holds all lines
+    byLength    = (int *)(data + h->byLength);
+    lengthStart = (int *)(data + h->lengthStart);
+    if(maxLen != h->maxLen || lengthStart[0] != 0 || lengthStart[h->maxLen + 1] != h->n)
+        return 0;
+    for(k = 0; k <= h->maxLen; k++)
+        if(lengthStart[k] > lengthStart[k+1])
+            return 0;
+    for(k = 0; k < h->n; k++)
+        if(byLength[k] < 0 || byLength[k] >= h->n)
+            return 0;
+    return 1;
+}
+
+// Creates a dictionary from the dictionary image mapped into memory
+DecodedDictionary *dictionaryFromImage(GedEngine *e, char *data, long long len, char **text){
+    DictionaryImageHeader *h = (DictionaryImageHeader *)data;
+    DecodedDictionary *dict;
+    wchar_t *chars;
+    int *offsets;
+    int k;
+
+    if(len < (long long)sizeof(DictionaryImageHeader) || !isDictionaryImage(data, len)){
+        fprintf(stderr, "The dictionary image is truncated or damaged\n");
+        return NULL;
+    }
+    if(h->version != DICTIONARY_IMAGE_VERSION || h->charSize != sizeof(wchar_t) || 
+       h->caseTable != caseTableStamp(e)){
+        fprintf(stderr, "The dictionary image was built on another platform or "
+                        "with a different ignore case file\n");
+        return NULL;
+    }
+    if(!isDictionaryImageValid(h, data, len)){
+        fprintf(stderr, "The dictionary image is truncated or damaged\n");
+        return NULL;
+    }
+    dict = (DecodedDictionary *)calloc(1, sizeof(DecodedDictionary));
+    if(dict == NULL){
+        puts("Error: Could not allocate memory");
+        exit(1);
+    }
+    dict->image       = 1;
+    dict->n           = h->n;
+    dict->bad         = -1;
+    dict->maxLen      = h->maxLen;
+    dict->start       = (int *)(data + h->start);
+    dict->end         = (int *)(data + h->end);
+    dict->lens        = (int *)(data + h->lens);
+    dict->byLength    = (int *)(data + h->byLength);
+    dict->lengthStart = (int *)(data + h->lengthStart);
+    dict->trie         = trieFromImage(data, &h->trie, h->n, h->maxLen);
+    dict->reversedTrie = trieFromImage(data, &h->reversedTrie, h->n, h->maxLen);
+    if(!isDictionaryTrieValid(dict->trie) || !isDictionaryTrieValid(dict->reversedTrie)){
+        fprintf(stderr, "The dictionary image is truncated or damaged\n");
+        freeDecodedDictionary(dict);
+        return NULL;
+    }
+    // only the pointers to the strings are set up: the strings are used as they are in the image
+    dict->words = (wchar_t **)malloc((h->n + 1) * sizeof(wchar_t *));
+    if(dict->words == NULL){
+        puts("Error: Could not allocate memory");
+        exit(1);
+    }
+    chars   = (wchar_t *)(data + h->chars);
+    offsets = (int *)(data + h->offsets);
+    for(k = 0; k < h->n; k++)
+        dict->words[k] = chars + offsets[k];
+    *text = data + h->text;
+    return dict;
+}
+
+// Finds generalized edit distances of several match types between the search string and each of the words
+void scoreWords(wchar_t **words, int *lens, int n, BatchProfile *batch, GedQuery *q, double limit,
+                double *full, double *prefix, double *suffix, double *infix){
+    int k;
+
+    if(batch != NULL){
+        batchEditDistances(batch, words, lens, n, full, prefix, suffix, infix);
+        return;
+    }
+    for(k = 0; k < n; k++){
+        genEditDistance_modes_limit(q, words[k], lens[k], limit,
+                                    (full != NULL)   ? &full[k]   : NULL,
+                                    (prefix != NULL) ? &prefix[k] : NULL,
+                                    (suffix != NULL) ? &suffix[k] : NULL,
+                                    (infix != NULL)  ? &infix[k]  : NULL);
+    }
+}
+
+// Finds generalized edit distances of several match types between the search string and each line in the block
+void scoreLineBlock(LineBlock *block, BatchProfile *batch, GedQuery *q, double limit,
+                    double *full, double *prefix, double *suffix, double *infix){
+    scoreWords(block->words, block->lens, block->n, batch, q, limit, full, prefix, suffix, infix);
+}
@@ -0,0 +1,299 @@
+/*
+*    Copyright (C) 2010 University of Tartu
+*    Authors: Reina Krik, Siim Orasmaa, Kristo Tammeoja, Jaak Vilo
+*    Contact:  siim . orasmaa {at} ut . ee
+*
+*    This file is part of Generalized Edit Distance Tool.
+*
+*    Generalized Edit Distance Tool is free software: you can redistribute 
+*    it and/or modify it under the terms of the GNU General Public License 
+*    as published by the Free Software Foundation, either version 3 of the
+*    License, or (at your option) any later version.
+*
+*    Generalized Edit Distance Tool is distributed in the hope that it will 
+*    be useful, but WITHOUT ANY WARRANTY; without even the implied warranty 
+*    of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*    GNU General Public License for more details.
+*
+*    You should have received a copy of the GNU General Public License
+*    along with Generalized Edit Distance Tool. 
+*    If not, see <http://www.gnu.org/licenses/>.
+*
+*/
+
+#ifndef DICTIONARY_H
+#define DICTIONARY_H
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <float.h>
+#include <wchar.h>
+#include "GedEngine.h"
+#include "FileToTrie.h"
+#include "FindEditDistanceMod.h"
+#include "BatchEditDistance.h"
+#include "DictionaryTrie.h"
+
+/**
+*   Number of dictionary lines that are read and scored at once (see \a LineBlock ).
+*/
+#define LINE_BLOCK_SIZE  256
+
+/**
+*   A buffer of wide characters, where lines of the dictionary are decoded one 
+*  after another (see \a decodeLine() ): \a n characters of \a chars are in 
+*  use, out of \a cap . The buffer grows when needed.
+*/
+typedef struct CharBuffer {
+    wchar_t *chars;
+    long long n;
+    long long cap;
+} CharBuffer;
+
+/**
+*   A block of consecutive lines of the dictionary file. For the k-th line in 
+*  the block, \a start[k] and \a end[k] are byte offsets of its beginning and 
+*  end in the file, \a words[k] is the line converted into a wide-character 
+*  string (and made case insensitive, if required) and \a lens[k] is the 
+*  length of the string. The strings are kept in \a text , which is reused 
+*  from a block of lines to the next one: the block is set up with 
+*  \a initLineBlock() and released with \a freeLineBlock() .
+*/
+typedef struct LineBlock {
+    int n;
+    int start[LINE_BLOCK_SIZE];
+    int end[LINE_BLOCK_SIZE];
+    wchar_t *words[LINE_BLOCK_SIZE];
+    int lens[LINE_BLOCK_SIZE];
+    CharBuffer text;
+} LineBlock;
+
+/**
+*  Tells whether the encoding of the current locale is UTF-8 (see \a decodeLine() ).
+*/
+int localeIsUtf8(void);
+
+/**
+*  Decodes the line of \a file starting at the byte offset \a i (up to the next line 
+*  break, or \a datalen ) straight from the file into a wide-character string at the 
+*  end of \a buf , followed by \c L'\\0' and made case insensitive, if the engine 
+*  \a e requires. Runs of ASCII characters are looked through (for the line break)
+*  and widened 16 bytes at a time; if \a utf8 is set (see \a localeIsUtf8() ), other
+*  characters are decoded as UTF-8 right away, otherwise with \c mbrtowc() . The
+*  result is the same as of \c mbstowcs() . Returns the length of the string and 
+*  sets \a *end to the byte offset of the line break, or returns \c -1 (leaving 
+*  \a buf as it was), if the line cannot be converted.
+*/
+int decodeLine(GedEngine *e, char *file, int datalen, int i, int *end, CharBuffer *buf, int utf8);
+
+/**
+*  Sets up \a block for reading lines (with no memory under it yet).
+*/
+void initLineBlock(LineBlock *block);
+
+/**
+*  Reads lines of \a file into \a block , starting from the byte offset \a i , until the
+*  block is full, the file ends (at \a datalen ) or a line that cannot be converted into
+*  a wide-character string is met. Returns the byte offset following the last line read;
+*  if no lines were read while the offset is below \a datalen , the line at the offset 
+*  cannot be converted (see \a failOnLine() ). The strings of the previous block read
+*  into \a block are dropped: no memory is allocated per line.
+*
+*  \param *e the engine (tells whether the lines are made case insensitive)
+*  \param *file the dictionary file
+*  \param datalen length of \a file (or end of the part of the file to be read)
+*  \param i byte offset of the first line to be read
+*  \param *block the block to be filled
+*/
+int readLineBlock(GedEngine *e, char *file, int datalen, int i, LineBlock *block);
+
+/**
+*  Stops the program with an error message, as the line of \a file starting at the 
+*  byte offset \a i cannot be converted into a wide-character string.
+*/
+void failOnLine(char *file, int datalen, int i);
+
+/**
+*  Releases memory under the strings in \a block (the block can be used again 
+*  after \a initLineBlock() ).
+*/
+void freeLineBlock(LineBlock *block);
+
+/**
+*   The dictionary file decoded into wide-character strings once, for running several
+*  queries against it (flag "-q", dictionaries of the library). For the k-th line of the file, \a start[k] and 
+*  \a end[k] are byte offsets of its beginning and end in the file, \a words[k] is the
+*  line converted into a wide-character string (and made case insensitive, if required)
+*  and \a lens[k] is the length of the string. \a n is the number of lines decoded; if 
+*  a line cannot be converted, decoding stops before it and \a bad holds its byte 
+*  offset ( \c -1 if all lines were converted).
+*   The lines are also indexed by the length of their strings: \a byLength holds 
+*  the numbers of the lines ordered by the length (lines of equal length in the order
+*  of the file), lines of length \c L are \c byLength[lengthStart[L]] .. 
+*  \c byLength[lengthStart[L+1]-1] and \a maxLen is the greatest length. \a trie 
+*  indexes the lines by their strings, for searching lines sharing a prefix together 
+*  (see \c DictionaryTrie ), \a reversedTrie by their strings read backwards, for 
+*  searching suffix matches of lines sharing a suffix together (see 
+*  \a createMirroredQuery() ). The strings are stored one after another in \a chars . 
+*  If the dictionary has been loaded from a dictionary image (see 
+*  \a dictionaryFromImage() ), \a image is set: all arrays except \a words are 
+*  parts of the image ( \a chars is \c NULL ).
+*/
+typedef struct DecodedDictionary {
+    int n;
+    int *start;
+    int *end;
+    wchar_t **words;
+    int *lens;
+    int bad;
+    int maxLen;
+    int *byLength;
+    int *lengthStart;
+    DictionaryTrie *trie;
+    DictionaryTrie *reversedTrie;
+    wchar_t *chars;
+    int image;
+} DecodedDictionary;
+
+/**
+*  Decodes all lines of \a file into wide-character strings (made case insensitive, if
+*  the engine \a e requires). Memory under the returned dictionary must be released 
+*  with \a freeDecodedDictionary() .
+*/
+DecodedDictionary *decodeDictionary(GedEngine *e, char *file);
+
+/**
+*  Releases memory under \a dict and its strings.
+*/
+void freeDecodedDictionary(DecodedDictionary *dict);
+
+/**
+*  Finds the lines of \a dict with strings of length \a minLen .. \a maxLen in the
+*  length index of the dictionary: they are \c byLength[*from] .. 
+*  \c byLength[*to-1] (ordered by length, see \c DecodedDictionary ).
+*/
+void lengthIndexRange(DecodedDictionary *dict, int minLen, int maxLen, int *from, int *to);
+
+/**
+*  Finds the lines of \a dict with strings of length \a minLen .. \a maxLen , using
+*  the length index of the dictionary. Returns the numbers of the lines in the order
+*  of the file ( \a *n of them), or NULL if no line falls outside of the range. 
+*  Memory under the returned array must be released afterwards.
+*/
+int *linesOfLengths(DecodedDictionary *dict, int minLen, int maxLen, int *n);
+
+/**
+*   Magic bytes at the beginning of a dictionary image file, and the version of
+*  the layout of the file.
+*/
+#define DICTIONARY_IMAGE_MAGIC    "\177GEDDICT"
+#define DICTIONARY_IMAGE_VERSION  3
+
+/**
+*   A \c DictionaryTrie stored in a dictionary image: the number of its nodes
+*  and the byte offsets of its arrays \a label , \a size , \a lineStart and 
+*  \a lines from the beginning of the image ( \a nNodes \c wchar_t -s, 
+*  \a nNodes and \a nNodes+1 \c int -s and an \c int per line).
+*/
+typedef struct DictionaryTrieImage {
+    int nNodes;
+    long long label;
+    long long size;
+    long long lineStart;
+    long long lines;
+} DictionaryTrieImage;
+
+/**
+*   Header of a dictionary image: the dictionary file decoded beforehand (flag 
+*  "--build-dict"), so that searches can use it right after mapping the image into
+*  memory. The image holds \a n lines of the dictionary file ( \a bad is always 
+*  \c -1 ), \a charSize is \c sizeof(wchar_t) of the platform that built it and 
+*  \a caseTable identifies the 'ignore case' list that the strings have been 
+*  made case insensitive with ( \c 0 if they have not been, see 
+*  \a caseTableStamp() ). Following parts of the image are given by their byte 
+*  offsets from the beginning of the image (each of them aligned to 8 bytes):
+*    -- \a text : the dictionary file as it is ( \a textLen bytes, followed by
+*       \c '\\0' ), for outputting the lines;
+*    -- \a start , \a end , \a lens : arrays of \a n \c int -s, as in 
+*       \c DecodedDictionary ;
+*    -- \a offsets : array of \a n \c int -s, position of the string of each
+*       line in \a chars ;
+*    -- \a chars : decoded strings of all lines (each ending with \c L'\\0' );
+*    -- \a byLength , \a lengthStart : the length index of the lines, as in 
+*       \c DecodedDictionary ( \a n and \a maxLen+2 \c int -s);
+*    -- \a trie , \a reversedTrie : the tries of the lines, as in 
+*       \c DecodedDictionary (see \c DictionaryTrieImage ).
+*  \a size is the size of the whole image in bytes.
+*/
+typedef struct DictionaryImageHeader {
+    char magic[8];
+    int version;
+    int charSize;
+    unsigned int caseTable;
+    int n;
+    int maxLen;
+    int textLen;
+    long long size;
+    long long text;
+    long long start;
+    long long end;
+    long long lens;
+    long long offsets;
+    long long chars;
+    long long byLength;
+    long long lengthStart;
+    DictionaryTrieImage trie;
+    DictionaryTrieImage reversedTrie;
+} DictionaryImageHeader;
+
+/**
+*  Tells whether \a data (the contents of a file, \a len bytes) is a dictionary 
+*  image.
+*/
+int isDictionaryImage(char *data, long long len);
+
+/**
+*  Writes the dictionary \a dict , decoded from the dictionary file \a file with the
+*  engine \a e , into the dictionary image file \a path . Returns \c 0 on success,
+*  \c -1 if the file cannot be written ( \a errno tells why).
+*/
+int writeDictionaryImage(GedEngine *e, DecodedDictionary *dict, char *file, const char *path);
+
+/**
+*  Creates a dictionary from the dictionary image \a data ( \a len bytes mapped 
+*  into memory, they must stay mapped until the dictionary is released); \a *text
+*  receives the dictionary file stored in the image. Returns NULL and prints the
+*  reason to \c stderr , if the image has been built on another platform, cannot
+*  be searched with the engine \a e (see \a caseTableStamp() ) or is damaged: 
+*  every part of the image must lie within the \a len bytes, and the line 
+*  offsets, strings, length index and tries must agree with each other. Memory
+*  under the dictionary must be released with \a freeDecodedDictionary() .
+*/
+DecodedDictionary *dictionaryFromImage(GedEngine *e, char *data, long long len, char **text);
+
+/**
+*  Finds generalized edit distances of several match types between the search string 
+*  of \a q and each of the \a n strings \a words (with lengths \a lens ): scores of full, prefix, suffix and infix matches are stored into 
+*  the arrays \a full , \a prefix , \a suffix and \a infix (NULL for match types that
+*  are not needed), all requested match types of a line are calculated in a single pass.
+*  If the search string has been compiled for the batch calculation ( \a batch \c != 
+*  \c NULL ), strings are scored \c BATCH_LANES lanes at a time and all scores are 
+*  exact; otherwise, strings are scored one by one, and scores exceeding \a limit are
+*  not calculated to the end (\c DBL_MAX is stored instead).
+*
+*  \param *batch the search string compiled for the batch calculation, or NULL
+*  \param *q the search string
+*  \param limit maximum score of interest
+*/
+void scoreWords(wchar_t **words, int *lens, int n, BatchProfile *batch, GedQuery *q, double limit,
+                double *full, double *prefix, double *suffix, double *infix);
+
+/**
+*  Finds generalized edit distances of several match types between the search string 
+*  of \a q and each line in \a block (see \a scoreWords() ).
+*/
+void scoreLineBlock(LineBlock *block, BatchProfile *batch, GedQuery *q, double limit,
+                    double *full, double *prefix, double *suffix, double *infix);
+
+#endif
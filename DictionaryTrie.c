@@ -0,0 +1,595 @@
+/*
+*    Copyright (C) 2010 University of Tartu
+*    Authors: Reina Krik, Siim Orasmaa, Kristo Tammeoja, Jaak Vilo
+*    Contact:  siim . orasmaa {at} ut . ee
+*
+*    This file is part of Generalized Edit Distance Tool.
+*
+*    Generalized Edit Distance Tool is free software: you can redistribute 
+*    it and/or modify it under the terms of the GNU General Public License 
+*    as published by the Free Software Foundation, either version 3 of the
+*    License, or (at your option) any later version.
+*
+*    Generalized Edit Distance Tool is distributed in the hope that it will 
+*    be useful, but WITHOUT ANY WARRANTY; without even the implied warranty 
+*    of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*    GNU General Public License for more details.
+*
+*    You should have received a copy of the GNU General Public License
+*    along with Generalized Edit Distance Tool. 
+*    If not, see <http://www.gnu.org/licenses/>.
+*
+*/
+
+#include <string.h>
+#include <math.h>
+#include "DictionaryTrie.h"
+
+/*
+*   Number of nodes visited between the checks, whether the search must be
+*  stopped (see searchDictionaryTrie()).
+*/
+#define TRIE_STOP_NODES  1024
+
+// A line of the dictionary, for sorting the lines by their strings
+typedef struct TrieEntry {
+    wchar_t *word;
+    int len;
+    int line;
+} TrieEntry;
+
+// Orders lines by their strings (a prefix before the longer strings), then by the line number
+static int compareTrieEntries(const void *a, const void *b){
+    const TrieEntry *x = (const TrieEntry *)a;
+    const TrieEntry *y = (const TrieEntry *)b;
+    int n = (x->len < y->len) ? x->len : y->len;
+    int c = wmemcmp(x->word, y->word, n);
+    if(c != 0)
+        return c;
+    if(x->len != y->len)
+        return (x->len < y->len) ? -1 : 1;
+    return (x->line > y->line) - (x->line < y->line);
+}
+
+// Builds the trie of the strings of the dictionary lines (read backwards, if required)
+DictionaryTrie *buildDictionaryTrie(wchar_t **words, int *lens, int n, int reversed){
+    DictionaryTrie *t;
+    TrieEntry *entries;
+    wchar_t *backwards = NULL;  // the strings reversed, one after another
+    int *path;  // nodes on the path to the current node, by depth
+    long long cap = 1;
+    long long at = 0;
+    int k, d, lcp, node;
+
+    t = (DictionaryTrie *)calloc(1, sizeof(DictionaryTrie));
+    entries = (TrieEntry *)malloc((n + 1) * sizeof(TrieEntry));
+    if(t == NULL || entries == NULL){
+        puts("Error: Could not allocate memory");
+        exit(1);
+    }
+    for(k = 0; k < n; k++){
+        entries[k].word = words[k];
+        entries[k].len  = lens[k];
+        entries[k].line = k;
+        cap += lens[k];
+        if(lens[k] > t->maxDepth)
+            t->maxDepth = lens[k];
+    }
+    if(reversed){
+        backwards = (wchar_t *)malloc(cap * sizeof(wchar_t));
+        if(backwards == NULL){
+            puts("Error: Could not allocate memory");
+            exit(1);
+        }
+        for(k = 0; k < n; k++){
+            entries[k].word = backwards + at;
+            for(d = 0; d < lens[k]; d++)
+                backwards[at++] = words[k][lens[k] - 1 - d];
+        }
+    }
+    qsort(entries, n, sizeof(TrieEntry), compareTrieEntries);
+
+    // there is at most a node per character, the root included
+    t->label     = (wchar_t *)malloc(cap * sizeof(wchar_t));
+    t->size      = (int *)malloc(cap * sizeof(int));
+    t->lineStart = (int *)malloc((cap + 1) * sizeof(int));
+    t->lines     = (int *)malloc((n + 1) * sizeof(int));
+    path         = (int *)malloc((t->maxDepth + 1) * sizeof(int));
+    if(t->label == NULL || t->size == NULL || t->lineStart == NULL || t->lines == NULL || path == NULL){
+        puts("Error: Could not allocate memory");
+        exit(1);
+    }
+    t->nLines = n;
+    t->nNodes = 1;
+    t->label[0] = L'\0';
+    t->lineStart[0] = 0;
+    path[0] = 0;
+    d = 0;
+    // sorted strings are inserted one after another: a string shares the path of its common prefix with the previous one
+    for(k = 0; k < n; k++){
+        lcp = 0;
+        if(k > 0)
+            while(lcp < entries[k-1].len && lcp < entries[k].len && entries[k-1].word[lcp] == entries[k].word[lcp])
+                lcp++;
+        // the subtrees below the common prefix are complete
+        for(; d > lcp; d--)
+            t->size[path[d]] = t->nNodes - path[d];
+        for(; d < entries[k].len; d++){
+            node = t->nNodes++;
+            t->label[node] = entries[k].word[d];
+            t->lineStart[node] = k;
+            path[d+1] = node;
+        }
+        t->lines[k] = entries[k].line;
+    }
+    for(; d >= 0; d--)
+        t->size[path[d]] = t->nNodes - path[d];
+    t->lineStart[t->nNodes] = n;
+    free(path);
+    free(entries);
+    free(backwards);
+
+    t->label     = (wchar_t *)realloc(t->label, t->nNodes * sizeof(wchar_t));
+    t->size      = (int *)realloc(t->size, t->nNodes * sizeof(int));
+    t->lineStart = (int *)realloc(t->lineStart, (t->nNodes + 1) * sizeof(int));
+    return t;
+}
+
+// Releases memory under the trie
+void freeDictionaryTrie(DictionaryTrie *t){
+    // arrays of a trie loaded from an image belong to the image
+    if(!t->image){
+        free(t->label);
+        free(t->size);
+        free(t->lineStart);
+        free(t->lines);
+    }
+    free(t);
+}
+
+// Tells whether the subtrees, lines and depth of the trie are consistent with each other
+int isDictionaryTrieValid(DictionaryTrie *t){
+    int *ends;
+    int k, d = 0, valid = 1;
+
+    if(t->nNodes < 1 || t->size[0] != t->nNodes || t->lineStart[0] != 0 || t->lineStart[t->nNodes] != t->nLines)
+        return 0;
+    for(k = 0; k < t->nNodes; k++)
+        if(t->lineStart[k] > t->lineStart[k+1])
+            return 0;
+    for(k = 0; k < t->nLines; k++)
+        if(t->lines[k] < 0 || t->lines[k] >= t->nLines)
+            return 0;
+    // ends[d] is the end of the subtree of the node at depth d on the path to node k
+    ends = (int *)malloc((t->maxDepth + 1) * sizeof(int));
+    if(ends == NULL){
+        puts("Error: Could not allocate memory");
+        exit(1);
+    }
+    ends[0] = t->nNodes;
+    for(k = 1; valid && k < t->nNodes; k++){
+        while(k >= ends[d])
+            d--;
+        valid = (d < t->maxDepth && t->size[k] >= 1 && t->size[k] <= ends[d] - k);
+        if(valid)
+            ends[++d] = k + t->size[k];
+    }
+    free(ends);
+    return valid;
+}
+
+// Splits the trie into ranges of whole subtrees of the root's children, with about equal numbers of lines
+void splitDictionaryTrie(DictionaryTrie *t, int n, int *bounds){
+    int k;
+    int node = 1;
+
+    bounds[0] = 0;
+    for(k = 1; k < n; k++){
+        // a range ends at the first child of the root with enough lines before it
+        while(node < t->nNodes && t->lineStart[node] < (int)((long long)t->nLines * k / n))
+            node += t->size[node];
+        bounds[k] = node;
+    }
+    bounds[n] = t->nNodes;
+}
+
+// Tells whether the search string can be searched for in a trie
+int isTrieSearchable(GedQuery *q){
+    QueryMatches *qm = q->matches;
+    QueryMatch *m;
+    int k;
+
+    if(q->engine->hasNegativeCost)
+        return 0;
+    for(m = qm->repMatches; m < qm->repMatches + qm->repStart[q->len]; m++)
+        for(k = 0; k < m->nRights; k++)
+            if(qm->rights[m->firstRight + k].len == 0)
+                return 0;
+    return 1;
+}
+
+/*
+*   The columns of the table along the current path of a trie search: column 
+*  \a d belongs to the node at depth \a d (the text is the path up to it), 
+*  \a rows cells each. For each column, \a last is its deepest row having a 
+*  value within the limit ( \c -1 if none), \a best is the best score of the
+*  last row up to it (the prefix score) and \a state the state of the 
+*  automaton of the engine after the path. Patterns ending at the current 
+*  depth are stamped with \a epoch in \a stamp (see \c TextMatches , 
+*  \a nStamps stamps).
+*/
+typedef struct TrieWalk {
+    GedQuery *q;
+    int rows;
+    double *cols;
+    int *last;
+    double *best;
+    int *state;
+    unsigned int *stamp;
+    int nStamps;
+    unsigned int epoch;
+    int addLists;
+    int remLists;
+    int repLists;
+} TrieWalk;
+
+// Returns a penalty from the mask for changing i-th char of the search string
+static inline double penaltyAt(double *pen, int i){
+    return (pen != NULL) ? pen[i + 1] : 0.0;
+}
+
+// Value of the cell with the penalty of a generalized edit distance operation at row k added
+static inline double withGenPenalty(double cell, double *genPen, int k){
+    return (genPen != NULL) ? cell + genPen[k] : cell;
+}
+
+// Stores the value into row i of the column, if it improves the cell and is within the limit (as values pushed into the window)
+static inline void improveCell(double *col, int i, double value, double limit, int *deep){
+    if(value <= limit && value < col[i]){
+        col[i] = value;
+        if(i > *deep) *deep = i;
+    }
+}
+
+// Stamps the patterns ending at the state of the automaton
+static void markTrieState(TrieWalk *w, int state){
+    TextMatcher *m = w->q->engine->matcher;
+    int k, s;
+
+    if(++w->epoch == 0){
+        // the stamps have wrapped around: start again
+        for(k = 0; k < w->nStamps; k++)
+            w->stamp[k] = 0;
+        w->epoch = 1;
+    }
+    for(s = (m->pattern[state] >= 0) ? state : m->outLink[state]; s >= 0; s = m->outLink[s])
+        w->stamp[m->pattern[s]] = w->epoch;
+}
+
+// Apply 'remove' operations matching the search string at position i from the cell at row i into the rows below it
+static void pushRemMatches(QueryMatches *qm, double *genPen, double *col, int i, double limit, int *deep){
+    QueryMatch *m   = qm->remMatches + qm->remStart[i];
+    QueryMatch *end = qm->remMatches + qm->remStart[i+1];
+    double value = col[i] + penaltyAt(genPen, i);
+    int r = 1;
+
+    for(; m < end; m++){
+        // penalties of the removed characters are added one by one, in the order of the trie walk
+        for(; r < m->span; r++)
+            value += penaltyAt(genPen, i+r);
+        improveCell(col, i + m->span, value + m->cost, limit, deep);
+    }
+}
+
+// Apply 'add' operations longer than a character, producing the text that ends at depth d, into column d
+static void pullAddMatches(TrieWalk *w, int d, double limit, int *deep){
+    TextMatcher *m = w->q->engine->matcher;
+    double *genPen = w->q->genEdPen;
+    double *cur = w->cols + d * w->rows;
+    double *src;
+    int s, id, i;
+
+    for(s = (m->pattern[w->state[d]] >= 0) ? w->state[d] : m->outLink[w->state[d]]; s >= 0; s = m->outLink[s]){
+        id = m->pattern[s];
+        if(m->addCost[id] == DBL_MAX || m->patternLen[id] < 2)
+            continue;
+        src = w->cols + (d - m->patternLen[id]) * w->rows;
+        for(i = 0; i <= w->last[d - m->patternLen[id]]; i++)
+            if(src[i] <= limit)
+                improveCell(cur, i, (src[i] + penaltyAt(genPen, i)) + m->addCost[id], limit, deep);
+    }
+}
+
+// Apply 'replace' operations, with right sides producing the text that ends at depth d (character c), into column d
+static void pullRepMatches(TrieWalk *w, int d, wchar_t c, double limit, int *deep){
+    QueryMatches *qm = w->q->matches;
+    double *genPen = w->q->genEdPen;
+    double *cur = w->cols + d * w->rows;
+    QueryMatch *m, *end;
+    QueryRight *right, *rightEnd;
+    double src, value;
+    int i, r, k;
+    int reach = -1;  // deepest row having a value within the limit in the columns the operations start from
+
+    for(k = d - 1; k >= 0 && k >= d - w->q->engine->maxSpan; k--)
+        if(w->last[k] > reach)
+            reach = w->last[k];
+    for(i = 0; i <= reach && i < w->rows - 1; i++){
+        end = qm->repMatches + qm->repStart[i+1];
+        for(m = qm->repMatches + qm->repStart[i]; m < end; m++){
+            rightEnd = qm->rights + m->firstRight + m->nRights;
+            for(right = qm->rights + m->firstRight; right < rightEnd; right++){
+                if(right->len > d)
+                    continue;
+                // the cell the operation starts from, before the right side in the text
+                src = w->cols[(d - right->len) * w->rows + i];
+                if(src > limit)
+                    continue;
+                if((right->len == 1) ? right->first != c : w->stamp[right->pattern] != w->epoch)
+                    continue;
+                // penalties of the replaced characters are added one by one, as in the window
+                value = src + penaltyAt(genPen, i);
+                for(r = 1; r < m->span; r++)
+                    value += penaltyAt(genPen, i+r);
+                improveCell(cur, i + m->span, value + right->cost, limit, deep);
+            }
+        }
+    }
+}
+
+
+// Calculates the column of the root (the empty text)
+static void trieFirstColumn(TrieWalk *w, double limit){
+    GedQuery *q = w->q;
+    QueryMatches *qm = q->matches;
+    double *cur = w->cols;
+    double value;
+    int last, i;
+    int deep = -1;  // deepest row that 'remove' operations have pushed a value into
+
+    cur[0] = 0;
+    for(i = 1; i < w->rows; i++)
+        cur[i] = DBL_MAX;
+    last = (cur[0] <= limit) ? 0 : -1;
+    for(i = 1; i < w->rows && (i <= last + 1 || i <= deep); i++){
+        if(w->remLists && qm->remStart[i-1] < qm->remStart[i] && cur[i-1] <= limit)
+            pushRemMatches(qm, q->genEdPen, cur, i-1, limit, &deep);
+        if(cur[i-1] <= limit){
+            value = cur[i-1] + q->engine->rem;                   // regular deletion at the search string pos i.
+            if(q->edPen != NULL) value += q->edPen[i];
+            if(value < cur[i]) cur[i] = value;
+            if(qm->singleRem){
+                value = withGenPenalty(cur[i-1], q->genEdPen, i) + qm->remCost[i];
+                if(value < cur[i]) cur[i] = value;
+            }
+        }
+        if(cur[i] <= limit) last = i;
+    }
+    w->last[0]  = last;
+    w->best[0]  = DBL_MAX;
+    w->state[0] = 0;
+}
+
+/*
+*   Calculates the column of the node at depth d, reached by the character c,
+*  from the columns of its ancestors: the same operations in the same order 
+*  as the window kernel (see WindowKernel.h), except that the values that the
+*  kernel pushes forward from the columns of the ancestors are pulled here.
+*  Rows below the reach of the cells within the limit are left out, as in the
+*  kernel (Ukkonen's cut-off).
+*/
+static void trieColumn(TrieWalk *w, int d, wchar_t c, double limit){
+    GedQuery *q = w->q;
+    GedEngine *e = q->engine;
+    QueryMatches *qm = q->matches;
+    wchar_t *a = q->string;
+    double *edPen = q->edPen;
+    double *genPen = q->genEdPen;
+    double *prev = w->cols + (d-1) * w->rows;
+    double *cur  = w->cols + d * w->rows;
+    double addCost = INFINITY;  // cost of adding the character
+    double *repRow = NULL;      // costs of replacing search string characters with it
+    double value;
+    int i, s, last;
+    int prevLast = w->last[d-1];
+    int deep = -1;  // deepest row that generalized edit distance operations have put a value into
+
+    for(i = 0; i < w->rows; i++)
+        cur[i] = DBL_MAX;
+    if(e->matcher->nPatterns > 0){
+        w->state[d] = textMatcherNext(e->matcher, w->state[d-1], c);
+        markTrieState(w, w->state[d]);
+        if(w->addLists)
+            pullAddMatches(w, d, limit, &deep);
+    }
+    if(w->repLists)
+        pullRepMatches(w, d, c, limit, &deep);
+    if(qm->singleAdd || qm->singleRep){
+        s = alphabetSymbol(qm->alphabet, c);
+        addCost = qm->addCost[s];
+        repRow  = qm->repCost + s * w->rows;
+    }
+
+    if(prev[0] <= limit){
+        value = prev[0] + e->add;                              // adding at the beginning of the search string
+        if(edPen != NULL) value += edPen[0];
+        if(value < cur[0]) cur[0] = value;
+        if(qm->singleAdd){
+            value = withGenPenalty(prev[0], genPen, 1) + addCost;
+            if(value < cur[0]) cur[0] = value;
+        }
+    }
+    last = (cur[0] <= limit) ? 0 : -1;
+    for(i = 1; i < w->rows && (i <= prevLast + 1 || i <= last + 1 || i <= deep); i++){
+        if(w->remLists && qm->remStart[i-1] < qm->remStart[i] && cur[i-1] <= limit)
+            pushRemMatches(qm, genPen, cur, i-1, limit, &deep);
+        if(cur[i-1] <= limit){
+            value = cur[i-1] + e->rem;                         // delete from search string pos i.
+            if(edPen != NULL) value += edPen[i];
+            if(value < cur[i]) cur[i] = value;
+            if(qm->singleRem){
+                value = withGenPenalty(cur[i-1], genPen, i) + qm->remCost[i];
+                if(value < cur[i]) cur[i] = value;
+            }
+        }
+        if(prev[i] <= limit){
+            value = prev[i] + e->add;                          // insert after search string pos i.
+            if(edPen != NULL) value += edPen[i+1];
+            if(value < cur[i]) cur[i] = value;
+            if(qm->singleAdd){
+                value = withGenPenalty(prev[i], genPen, i+1) + addCost;
+                if(value < cur[i]) cur[i] = value;
+            }
+        }
+        if(prev[i-1] <= limit){
+            if(a[i-1] == c)
+                value = prev[i-1];                             // identity at search string pos i.
+            else{
+                value = prev[i-1] + e->rep;                    // replace at search string pos i.
+                if(edPen != NULL) value += edPen[i];
+            }
+            if(value < cur[i]) cur[i] = value;
+            if(qm->singleRep){
+                value = withGenPenalty(prev[i-1], genPen, i) + repRow[i];
+                if(value < cur[i]) cur[i] = value;
+            }
+        }
+        if(cur[i] <= limit) last = i;
+    }
+    w->last[d] = last;
+    w->best[d] = w->best[d-1];
+    if(cur[w->rows - 1] < w->best[d])
+        w->best[d] = cur[w->rows - 1];
+}
+
+// Tells whether columns below depth d can have cells within the limit: the last maxSpan columns reach them
+static int trieColumnsReachOn(TrieWalk *w, int d){
+    int k;
+    for(k = d; k >= 0 && k > d - w->q->engine->maxSpan; k--)
+        if(w->last[k] >= 0)
+            return 1;
+    return 0;
+}
+
+// Sets up the workspace of trie searches
+void initTrieWorkspace(TrieWorkspace *ws){
+    memset(ws, 0, sizeof(TrieWorkspace));
+}
+
+// Releases memory under the buffers of the workspace
+void freeTrieWorkspace(TrieWorkspace *ws){
+    free(ws->cols);
+    free(ws->last);
+    free(ws->best);
+    free(ws->state);
+    free(ws->node);
+    free(ws->next);
+    free(ws->stamp);
+}
+
+// Makes room in the workspace for paths of depth nodes, columns of rows cells and nPatterns patterns
+static void prepareTrieWorkspace(TrieWorkspace *ws, int depth, int rows, int nPatterns){
+    size_t cells = (size_t)(depth + 1) * rows;
+
+    if(depth + 1 > ws->depthCap){
+        ws->depthCap = depth + 1;
+        ws->last  = (int *)realloc(ws->last, (depth + 1) * sizeof(int));
+        ws->best  = (double *)realloc(ws->best, (depth + 1) * sizeof(double));
+        ws->state = (int *)realloc(ws->state, (depth + 1) * sizeof(int));
+        ws->node  = (int *)realloc(ws->node, (depth + 1) * sizeof(int));
+        ws->next  = (int *)realloc(ws->next, (depth + 1) * sizeof(int));
+    }
+    if(cells > ws->colsCap){
+        ws->colsCap = cells;
+        ws->cols = (double *)realloc(ws->cols, cells * sizeof(double));
+    }
+    if(nPatterns + 1 > ws->stampCap){
+        // the stamps start again from zero
+        ws->stampCap = nPatterns + 1;
+        free(ws->stamp);
+        ws->stamp = (unsigned int *)calloc(ws->stampCap, sizeof(unsigned int));
+        ws->epoch = 0;
+    }
+    if(ws->cols == NULL || ws->last == NULL || ws->best == NULL || ws->state == NULL || ws->stamp == NULL || 
+       ws->node == NULL || ws->next == NULL){
+        puts("Error: Could not allocate memory");
+        exit(1);
+    }
+}
+
+// Finds full and prefix scores of the lines in a range of the trie, walking it depth-first
+int searchDictionaryTrie(DictionaryTrie *t, int from, int to, GedQuery *q, double *limit, int prefixes,
+                         TrieLineScores report, int (*stopped)(void *), void *arg, TrieWorkspace *ws){
+    QueryMatches *qm = q->matches;
+    TrieWalk w;
+    int *node;  // nodes on the current path, by depth
+    int *next;  // next child to visit of the node at each depth
+    int rows = q->len + 1;
+    long visited = 0;
+    int d, k, c, end;
+    int stop = 0;
+    double lim, full, prefix;
+
+    if(from >= to)
+        return 0;
+    // patterns stamped by earlier searches have smaller epochs than the ones of this search
+    prepareTrieWorkspace(ws, t->maxDepth, rows, q->engine->matcher->nPatterns);
+    w.q        = q;
+    w.rows     = rows;
+    w.epoch    = ws->epoch;
+    w.addLists = q->engine->matcher->maxAddLen > 1;
+    w.remLists = qm->remStart[q->len] > 0;
+    w.repLists = qm->repStart[q->len] > 0;
+    w.cols  = ws->cols;
+    w.last  = ws->last;
+    w.best  = ws->best;
+    w.state = ws->state;
+    w.stamp = ws->stamp;
+    w.nStamps = ws->stampCap;
+    node    = ws->node;
+    next    = ws->next;
+
+    lim = *limit;
+    trieFirstColumn(&w, lim);
+    // lines of the root have empty strings: no prefix matches
+    if(from == 0){
+        full = (w.cols[rows-1] <= lim) ? w.cols[rows-1] : DBL_MAX;
+        for(k = t->lineStart[0]; k < t->lineStart[1]; k++)
+            report(arg, t->lines[k], full, DBL_MAX);
+        from = 1;
+    }
+    d = 0;
+    node[0] = 0;
+    next[0] = from;
+    while(d >= 0){
+        end = (d == 0) ? to : node[d] + t->size[node[d]];
+        if(next[d] >= end){
+            d--;
+            continue;
+        }
+        if(stopped != NULL && ++visited % TRIE_STOP_NODES == 0 && (stop = stopped(arg)) != 0)
+            break;
+        c = next[d];
+        next[d] += t->size[c];
+        d++;
+        node[d] = c;
+        next[d] = c + 1;
+
+        lim = *limit;
+        trieColumn(&w, d, t->label[c], lim);
+        full   = (w.cols[d * rows + rows-1] <= lim) ? w.cols[d * rows + rows-1] : DBL_MAX;
+        prefix = (prefixes && w.best[d] <= lim) ? w.best[d] : DBL_MAX;
+        if(full != DBL_MAX || prefix != DBL_MAX || lim == DBL_MAX)
+            for(k = t->lineStart[c]; k < t->lineStart[c+1]; k++)
+                report(arg, t->lines[k], full, prefix);
+        if(!trieColumnsReachOn(&w, d)){
+            // the subtree is left out: only the prefix scores of its lines are known
+            if(prefix != DBL_MAX)
+                for(k = t->lineStart[c+1]; k < t->lineStart[c + t->size[c]]; k++)
+                    report(arg, t->lines[k], DBL_MAX, prefix);
+            next[d] = c + t->size[c];
+        }
+    }
+    ws->epoch = w.epoch;
+    return stop;
+}
@@ -0,0 +1,167 @@
+/*
+*    Copyright (C) 2010 University of Tartu
+*    Authors: Reina Krik, Siim Orasmaa, Kristo Tammeoja, Jaak Vilo
+*    Contact:  siim . orasmaa {at} ut . ee
+*
+*    This file is part of Generalized Edit Distance Tool.
+*
+*    Generalized Edit Distance Tool is free software: you can redistribute 
+*    it and/or modify it under the terms of the GNU General Public License 
+*    as published by the Free Software Foundation, either version 3 of the
+*    License, or (at your option) any later version.
+*
+*    Generalized Edit Distance Tool is distributed in the hope that it will 
+*    be useful, but WITHOUT ANY WARRANTY; without even the implied warranty 
+*    of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*    GNU General Public License for more details.
+*
+*    You should have received a copy of the GNU General Public License
+*    along with Generalized Edit Distance Tool. 
+*    If not, see <http://www.gnu.org/licenses/>.
+*
+*/
+
+#ifndef DICTIONARYTRIE_H
+#define DICTIONARYTRIE_H
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <float.h>
+#include <wchar.h>
+#include "GedEngine.h"
+
+/**
+*   Index of the lines of a dictionary by their strings: a trie of the 
+*  strings, where lines sharing a prefix share the path of the prefix. Nodes
+*  are numbered in depth-first order ( \c 0 is the root, children in the 
+*  order of their characters), so the subtree of node \c k is the nodes 
+*  \c k .. \c k+size[k]-1 and the next sibling of \c k is \c k+size[k] . 
+*  \a label[k] is the character leading to node \c k . The numbers of the 
+*  lines are kept in \a lines in the order of the nodes that their strings 
+*  end at (lines of a node in the order of the file): lines of node \c k are
+*  \c lines[lineStart[k]] .. \c lines[lineStart[k+1]-1] , lines of its 
+*  subtree end at \c lines[lineStart[k+size[k]]-1] . \a maxDepth is the 
+*  length of the longest string. If the trie has been built of the strings 
+*  read backwards, paths spell them from the end (lines sharing a suffix
+*  share its path). If the trie is a part of a dictionary image, \a image 
+*  is set: the arrays belong to the image.
+*/
+typedef struct DictionaryTrie {
+    int nNodes;
+    int nLines;
+    int maxDepth;
+    wchar_t *label;
+    int *size;
+    int *lineStart;
+    int *lines;
+    int image;
+} DictionaryTrie;
+
+/**
+*   Builds the trie of the \a n strings \a words (with lengths \a lens ), 
+*   the k-th string being the string of line \c k ; if \a reversed is set,
+*   of the strings read backwards. Memory under the trie must be released
+*   with \a freeDictionaryTrie() .
+*/
+DictionaryTrie *buildDictionaryTrie(wchar_t **words, int *lens, int n, int reversed);
+
+/**
+*   Releases memory under \a *t .
+*/
+void freeDictionaryTrie(DictionaryTrie *t);
+
+/**
+*   Tells whether the arrays of the trie \a *t (e.g. read from a dictionary 
+*   image) are consistent: subtrees nest within their parents no deeper than
+*   \a maxDepth , and the lines of the nodes are \a nLines lines of the 
+*   dictionary.
+*/
+int isDictionaryTrieValid(DictionaryTrie *t);
+
+/**
+*   Splits the trie \a *t into \a n ranges of nodes with about equal numbers
+*   of lines, for searching them in parallel: range \c k is the nodes 
+*   \c bounds[k] .. \c bounds[k+1]-1 ( \a bounds has \c n+1 elements). Each
+*   range consists of whole subtrees of the children of the root, the first
+*   one also holds the root. Some of the ranges can be empty.
+*/
+void splitDictionaryTrie(DictionaryTrie *t, int n, int *bounds);
+
+/**
+*   Tells whether the search string of \a q can be searched for in a trie: 
+*   'replace' operations with an empty right side, which would change the 
+*   column of the text they start at, are not supported, nor are negative 
+*   costs (see \a hasNegativeCost of \c GedEngine ): subtrees are skipped
+*   once no column is within the limit.
+*/
+int isTrieSearchable(GedQuery *q);
+
+/**
+*   Receives the scores of the line \a line found by \a searchDictionaryTrie() :
+*   \a full and \a prefix are the scores of the full and prefix match 
+*   ( \c DBL_MAX if above the limit or not calculated). \a arg is the 
+*   argument given to the search.
+*/
+typedef void (*TrieLineScores)(void *arg, int line, double full, double prefix);
+
+/**
+*   Work buffers of \a searchDictionaryTrie() : the columns of the table and
+*  the state of the walk along a path of the trie ( \a depthCap nodes, the
+*  root included, \a colsCap cells) and the stamps of the patterns of the 
+*  automaton of the engine ( \a stampCap of them, see \c TextMatches ), 
+*  stamped last with \a epoch . The buffers grow when a search needs more, so
+*  that the searches of a single thread can reuse them: the workspace is set
+*  up with \a initTrieWorkspace() and released with \a freeTrieWorkspace() .
+*/
+typedef struct TrieWorkspace {
+    int depthCap;
+    size_t colsCap;
+    int stampCap;
+    unsigned int epoch;
+    double *cols;
+    int *last;
+    double *best;
+    int *state;
+    int *node;
+    int *next;
+    unsigned int *stamp;
+} TrieWorkspace;
+
+/**
+*   Sets up \a ws for searches (with no memory under it yet).
+*/
+void initTrieWorkspace(TrieWorkspace *ws);
+
+/**
+*   Releases memory under the buffers of \a ws (the workspace can be used 
+*   again after \a initTrieWorkspace() ).
+*/
+void freeTrieWorkspace(TrieWorkspace *ws);
+
+/**
+*   Finds generalized edit distances of full and prefix matches between the
+*  search string of \a q and the strings of the lines in the nodes 
+*  \a from .. \a to-1 of the trie \a *t (whole subtrees of the children of 
+*  the root; the root itself, if \a from is \c 0 , see 
+*  \a splitDictionaryTrie() ). The trie is walked depth-first, and the column
+*  of the table of each node is calculated once from the columns of its 
+*  ancestors, for all the lines sharing the prefix. Cells exceeding the limit
+*  \a *limit are left out, as in the window of FindEditDistanceMod.c, so the 
+*  scores are the same as those of \a genEditDistance_modes_limit() . The 
+*  limit is read again at each node, so it can be lowered during the search
+*  (e.g. by \a report ); once the last \c maxSpan columns of a path (see 
+*  \c GedEngine ) have no cells within the limit, no transformation can 
+*  reach the limit below, and the subtree is left out.
+*   \a report receives the scores of the lines of the nodes visited that 
+*  score within the limit (of all the lines, while the limit is \c DBL_MAX ,
+*  and of the lines of the root in any case); the prefix scores are only 
+*  calculated, if \a prefixes is set, then the lines of the subtrees left out
+*  also receive their prefix scores, if these are within the limit. 
+*  \a stopped (if not NULL) is checked once in a while: the search stops, if
+*  it returns a nonzero value, which is then returned (otherwise \c 0 is 
+*  returned). The calculation is done in the buffers of \a ws .
+*/
+int searchDictionaryTrie(DictionaryTrie *t, int from, int to, GedQuery *q, double *limit, int prefixes,
+                         TrieLineScores report, int (*stopped)(void *), void *arg, TrieWorkspace *ws);
+
+#endif
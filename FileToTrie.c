@@ -23,227 +23,359 @@
 
 #include "FileToTrie.h"
 
-// Read file into memory
-char *readFile(char *filename){
+// Map file into memory, with given protection and sharing of the mapping; returns NULL on errors
+static char *mapFile(char *filename, int prot, int flags, long long *size){
     int fd;
     char *data;
     struct stat sbuf;
 
     if (filename == NULL) {
         fprintf(stderr, "Insert filename!\n");
-        exit(1);
+        return NULL;
     }
 
     if ((fd = open(filename, O_RDONLY)) == -1) {
         perror("Error on opening file");
-        exit(1);
+        return NULL;
     }
 
-    if (stat(filename, &sbuf) == -1) {
+    if (fstat(fd, &sbuf) == -1) {
         perror("Error on receiving stat");
-        exit(1);
+        close(fd);
+        return NULL;
     }
 
-    if ((data = mmap((caddr_t)0, sbuf.st_size, PROT_READ, MAP_SHARED, fd, 0)) == (caddr_t)(-1)) {
+    /* mmap() cannot map directories nor empty files */
+    if (!S_ISREG(sbuf.st_mode) || sbuf.st_size == 0) {
+        fprintf(stderr, "Could not map file: %s is %s\n", filename,
+                S_ISREG(sbuf.st_mode) ? "empty" : "not a regular file");
+        close(fd);
+        return NULL;
+    }
+
+    if ((data = mmap((caddr_t)0, sbuf.st_size, prot, flags, fd, 0)) == (caddr_t)(-1)) {
         perror("Could not map file");
-        exit(1);
+        close(fd);
+        return NULL;
     }
 
-    if (close(fd) == -1){
+    if (size != NULL)
+        *size = sbuf.st_size;
+
+    /* the mapping stays valid without the descriptor */
+    if (close(fd) == -1)
         perror("Error on closing file");
-        exit(1);
-    }
     return data;
 }
 
-// Read a snippet from data and convert into double
-double findValue(char *data, int i, int j){
-	char *value;
-	char *err;
-	double rep;
+// Read file into memory
+char *readFile(char *filename){
+    return mapFile(filename, PROT_READ, MAP_SHARED, NULL);
+}
 
-	value = malloc(j-i+1);
-	if(value == NULL){
-		perror("Memory");
-		exit(1);
+// Read file into memory, telling its size
+char *readFileSize(char *filename, long long *size){
+    return mapFile(filename, PROT_READ, MAP_SHARED, size);
+}
+
+// Read file into memory as a private copy, telling its size
+char *readFileCopy(char *filename, long long *size){
+    return mapFile(filename, PROT_READ | PROT_WRITE, MAP_PRIVATE, size);
+}
+
+// Round the size up to a multiple of 8 bytes
+long long alignFilePart(long long size){
+    return (size + 7) & ~7LL;
+}
+
+// Tell whether count elements of given size at the byte offset lie within bytes from .. to-1 of the file
+int isFilePart(long long offset, long long count, long long size, long long from, long long to){
+    return offset >= from && offset <= to && (offset & 7) == 0 &&
+           count >= 0 && count <= (to - offset) / size;
+}
+
+// Write the bytes into the file, followed by zeros up to a multiple of 8 bytes
+int writeFilePart(FILE *f, const void *data, long long size){
+    static const char zeros[8] = { 0 };
+    long long pad = alignFilePart(size) - size;
+    if (data != NULL && size > 0 && fwrite(data, 1, size, f) != (size_t)size)
+        return -1;
+    if (pad > 0 && fwrite(zeros, 1, pad, f) != (size_t)pad)
+        return -1;
+    return 0;
+}
+
+/* A transformation read from the transformations file: its sides are 
+   positions in the buffer of decoded characters */
+typedef struct ParsedRule {
+	long long left;
+	int leftLen;
+	long long right;
+	int rightLen;
+	double value;
+} ParsedRule;
+
+/* Kinds of transformations: each kind has a trie of its own */
+enum { REPLACEMENTS, ADDITIONS, REMOVALS };
+
+// Report a malformed line of the transformations file
+static int transformationError(long long line, long long column, char *message){
+	fprintf(stderr, "Error in transformations file, line %lld, column %lld: %s\n", line, column, message);
+	return -1;
+}
+
+// Decode the multibyte characters data[from .. to-1] into *out; returns their number, or -1 (*bad is set to the invalid byte)
+static int decodeField(GedEngine *e, char *data, long long from, long long to, wchar_t *out, long long *bad){
+	mbstate_t state;
+	size_t len;
+	int n = 0;
+
+	memset(&state, 0, sizeof(state));
+	while(from < to){
+		if((unsigned char)data[from] < 0x80){
+			out[n] = (wchar_t)data[from];
+			from++;
+		}
+		else{
+			len = mbrtowc(out + n, data + from, to - from, &state);
+			if(len == (size_t)-1 || len == (size_t)-2){
+				*bad = from;
+				return -1;
+			}
+			from += len;
+		}
+		if(e->caseInsensitive)
+			out[n] = makeToIgnoreCase(e, out[n]);
+		n++;
 	}
-	value[j-i] = '\0';
-	strncpy(value, (data +i), (j-i));
-	rep = strtod(value, &err);
-	free(value);
-	return rep;
+	out[n] = L'\0';
+	return n;
 }
 
-// Builds add, rep and rem tries from given content of transformations file
-int trieFromFile(char *data){
-	char *string1;
-	char *string2;
-	wchar_t *wstr1;
-	wchar_t *wstr2;
-	int w1;
-	int w2;
-	double v;
-	int datalen;
-	int i;
-	int j;
+// Read the cost data[from .. to-1] of a transformation; returns 0, or -1 if it is not a number
+static int readCost(char *data, long long from, long long to, double *value){
+	char buf[64];
+	char *err;
 
-	datalen = strlen(data);
-	string1 = malloc(2);
-	string2 = malloc(2);
+	if(to - from >= (long long)sizeof(buf))
+		return -1;
+	memcpy(buf, data + from, to - from);
+	buf[to - from] = '\0';
+	*value = strtod(buf, &err);
+	if(err == buf)
+		return -1;
+	while(*err == ' ' || *err == '\t')
+		err++;
+	return (*err == '\0') ? 0 : -1;
+}
 
-	i = 0;
-	j = 0;
+// Build the frozen form of a trie from the parsed transformations of one kind
+static FrozenTrie *buildTrieOfKind(ParsedRule *parsed, int nParsed, wchar_t *chars, FrozenRule *rules, int kind){
+	int k, n = 0;
+	for(k = 0; k < nParsed; k++){
+		if((kind == REPLACEMENTS && parsed[k].leftLen > 0 && parsed[k].rightLen > 0) ||
+		   (kind == ADDITIONS && parsed[k].leftLen == 0) || (kind == REMOVALS && parsed[k].rightLen == 0)){
+			/* an addition is stored by its right side */
+			rules[n].left  = chars + ((kind == ADDITIONS) ? parsed[k].right : parsed[k].left);
+			rules[n].len   = (kind == ADDITIONS) ? parsed[k].rightLen : parsed[k].leftLen;
+			rules[n].right = (kind == REPLACEMENTS) ? chars + parsed[k].right : NULL;
+			rules[n].value = parsed[k].value;
+			rules[n].seq   = k;
+			n++;
+		}
+	}
+	return buildFrozenTrie(rules, n, kind == REPLACEMENTS);
+}
+
+// Replace the frozen form of a trie
+static void setFrozen(FrozenTrie **frozen, FrozenTrie *f){
+	if(*frozen != NULL)
+		freeFrozenTrie(*frozen);
+	*frozen = f;
+}
 
-	while(i < datalen){
+// Read the transformations from data[0 .. datalen-1] into *parsed, decoding their sides into *chars
+static int readTransformations(GedEngine *e, char *data, long long datalen, ParsedRule **parsed, int *nParsed, wchar_t *chars, long long *nChars){
+	long long i, end, next, first, second, bad;
+	long long line = 1;
+	int cap = 1024;
+	int len;
+	double v;
+
+	*parsed = (ParsedRule *)malloc(cap * sizeof(ParsedRule));
+	if(*parsed == NULL){
+		puts("Error: Could not allocate memory");
+		exit(1);
+	}
+	for(i = 0; i < datalen; i = next, line++){
+		end = i;
+		while(end < datalen && data[end] != '\n' && data[end] != '\r')
+			end++;
+		next = end;
+		if(next < datalen && data[next] == '\r') /* In case we are under Windows */
+			next++;
+		if(next < datalen && data[next] == '\n')
+			next++;
+		if(end == i)
+			continue;
 		/*
 		*   Setting weights of default edit operations:
 		*   the line must begin with character '>', followed
 		*   by "add" for addition, "rep" for replacement and
-		*   "del" for deletion operation; after the operation
+		*   "rem" for removal operation; after the operation
 		*    marker, ':' is placed and finally comes the new
 		*    weight as double.
 		*/
 		if(data[i] == '>'){
-			i = i +1;
-			/* Change weight of default add operation */
-			if(strncmp((char *)(data+i), "add", 3) == 0){
-				i +=4;
-				j = i;
-				while(data[j] != '\n' && data[j] != '\r' && j < strlen(data))
-					j++;
-				add = findValue(data, i, j);
-				if(data[j] == '\r') /* In case we are under Windows */
-					j = j + 2;
-				else j = j+1;
-				i = j;
-			}
-			/* Change weight of default replace operation */
-			else if(strncmp((char *)(data+i), "rep", 3) == 0){
-				i +=4;
-				j = i;
-				while(j < strlen(data) && data[j] != '\n' && data[j] != '\r') j++;
-				rep = findValue(data, i, j);
-				if(data[j] == '\r') /* In case we are under Windows */
-					j = j + 2;
-				else j = j+1;
-				i = j;
-			}
-			/* Change weight of default remove operation */
-			else if(strncmp((char *)(data+i), "rem", 3) == 0){
-				i +=4;
-				j = i;
-				while(j < strlen(data) && data[j] != '\n' && data[j] != '\r') j++;
-				rem = findValue(data, i, j);
-				if(data[j] == '\r') /* In case we are under Windows */
-					j = j + 2;
-				else j = j+1;
-				i = j;
-			}
+			if(end - i < 5 || data[i+4] != ':' ||
+			   (strncmp(data+i+1, "add", 3) != 0 && strncmp(data+i+1, "rep", 3) != 0 && strncmp(data+i+1, "rem", 3) != 0))
+				return transformationError(line, 2, "expected '>add:', '>rep:' or '>rem:'");
+			if(readCost(data, i+5, end, &v) != 0)
+				return transformationError(line, 6, "the weight is not a number");
+			if(data[i+3] == 'd')
+				e->add = v;
+			else if(data[i+3] == 'p')
+				e->rep = v;
+			else
+				e->rem = v;
+			continue;
 		}
 		/*
 		*  Setting weights of generalized edit distance transformations; 
 		*/
-		else {
-			j = i;
-			/* Locate the left side string of transformation */
-			while(data[j] != ':') j++;
-			string1 = (char *)realloc(string1, (j-i+1));
-
-			if(string1 == NULL){
-				perror("Memory");
+		for(first = i; first < end && data[first] != ':'; first++);
+		for(second = first + 1; second < end && data[second] != ':'; second++);
+		if(second >= end)
+			return transformationError(line, end - i + 1, "expected 'left:right:weight'");
+		if(first == i && second == first + 1)
+			return transformationError(line, 1, "both sides of the transformation are empty");
+		if(readCost(data, second+1, end, &v) != 0)
+			return transformationError(line, second - i + 2, "the weight is not a number");
+		if(*nParsed == cap){
+			cap *= 2;
+			*parsed = (ParsedRule *)realloc(*parsed, cap * sizeof(ParsedRule));
+			if(*parsed == NULL){
+				puts("Error: Could not allocate memory");
 				exit(1);
 			}
-			string1[j-i] ='\0';
-			strncpy(string1, (data +i), (j-i));
-
-			/* Locate the right side string of transformation */
-			j++; i = j;
-			while(data[j] != ':') j++;
-			string2 = (char *)realloc(NULL, (j-i+1));
+		}
+		(*parsed)[*nParsed].left = *nChars;
+		if((len = decodeField(e, data, i, first, chars + *nChars, &bad)) < 0)
+			return transformationError(line, bad - i + 1, "invalid multibyte character");
+		(*parsed)[*nParsed].leftLen = len;
+		*nChars += len + 1;
+		(*parsed)[*nParsed].right = *nChars;
+		if((len = decodeField(e, data, first+1, second, chars + *nChars, &bad)) < 0)
+			return transformationError(line, bad - i + 1, "invalid multibyte character");
+		(*parsed)[*nParsed].rightLen = len;
+		*nChars += len + 1;
+		(*parsed)[*nParsed].value = v;
+		(*nParsed)++;
+	}
+	return 0;
+}
 
-			if(string2 == NULL){
-				perror("Memory");
-				exit(1);
-			}
-			string2[(j-i)]='\0';
-			strncpy(string2, (data +i), (j-i));
-			j++; i = j;
-			while(data[j] != '\n' && data[j] != '\r' && j < datalen) j++;
-            
-			/* Find the weight of transformation  */
-			v = findValue(data, i, j);
-            
-			/* According to the type of transformation, add into suitable trie */
-			if(strlen(string1) == 0){
-				/* Add to add-operations trie */
-				w2 = mbstowcs(NULL, string2, 0);
-				wstr2 = (wchar_t *)localeToWchar(string2);
-				if(caseInsensitiveMode)
-					wstr2 = makeStringToIgnoreCase(wstr2, w2);
-				addToARTrie(addT, wstr2, w2, v);
-				/* If corresponding tracing-trie also exists, reverse the string and 
-				   add it to the tracing tire. */
-				if (traceAddT != NULL){
-					wchar_t *reversedWstr2;
-					reversedWstr2 = reverseWchar(wstr2, w2);
-					addToARTrie(traceAddT, reversedWstr2, w2, v);
-					free(reversedWstr2);
-				}
-				free(wstr2);
-				free(string2);
-			} else if(strlen(string2) == 0) {
-				/* Add to remove-operations trie */
-				w1 = mbstowcs(NULL, string1, 0);
-				wstr1 = (wchar_t *)localeToWchar(string1);
-				if(caseInsensitiveMode)
-					wstr1 = makeStringToIgnoreCase(wstr1, w1);
-				addToARTrie(remT, wstr1, w1, v);
-				/* If corresponding tracing-trie also exists, reverse the string and 
-				   add it to the tracing tire. */
-				if (traceRemT != NULL){
-					wchar_t *reversedWstr1;
-					reversedWstr1 = reverseWchar(wstr1, w1);
-					addToARTrie(traceRemT, reversedWstr1, w1, v);
-					free(reversedWstr1);
-				}
-			}else{
-				/* Add to replace-operations trie */
-				wstr2 = (wchar_t *)localeToWchar(string2);
-				wstr1 = (wchar_t *)localeToWchar(string1);
-				w1 = mbstowcs(NULL, string1, 0);
-				w2 = mbstowcs(NULL, string2, 0);
-				if(caseInsensitiveMode){
-					wstr1 = makeStringToIgnoreCase(wstr1, w1);
-					wstr2 = makeStringToIgnoreCase(wstr2, w2);
-				}
-				addToTrie(t, wstr1, w1, wstr2, v);
-				/* If corresponding tracing-trie also exists, reverse the string and 
-				   add it to the tracing tire. */
-				if (traceT != NULL){
-					wchar_t *reversedWstr1;
-					reversedWstr1 = reverseWchar(wstr1, w1);
-					addToTrie(traceT, reversedWstr1, w1, wstr2, v);
-					free(reversedWstr1);
-				}
-				free(string2);
-				free(wstr1);
-			}
-			if(data[j] == '\r') /* In case we are under Windows */
-				j = j + 2;
-			else 
-				j = j + 1;
-			i = j;
+// Builds add, rep and rem tries of the engine from given content of transformations file
+int trieFromFile(GedEngine *e, char *data, long long size){
+	ParsedRule *parsed = NULL;
+	FrozenRule *rules;
+	wchar_t *chars;
+	wchar_t *reversed;
+	long long datalen;
+	long long nChars = 0;
+	int nParsed = 0;
+	int k, l;
+
+	/* the file may not end with a line break (nor with '\0'): every scan is bounded by datalen */
+	datalen = strnlen(data, size);
+	/* a line holds at least two separators more than characters, so the 
+	   decoded sides (with their '\0') fit in datalen+1 characters */
+	chars = (wchar_t *)malloc((datalen + 1) * sizeof(wchar_t));
+	if(chars == NULL){
+		puts("Error: Could not allocate memory");
+		exit(1);
+	}
+	if(readTransformations(e, data, datalen, &parsed, &nParsed, chars, &nChars) != 0){
+		free(parsed);
+		free(chars);
+		if(size > 0)
+			munmap(data, size);
+		return -1;
+	}
+	/* Release the memory under data (an empty file has not been mapped). */
+	if(size > 0)
+		munmap(data, size);
+
+	/* All transformations have been read: the tries are built in bulk, 
+	   straight into their compact forms for searching */
+	rules = (FrozenRule *)malloc((nParsed > 0 ? nParsed : 1) * sizeof(FrozenRule));
+	if(rules == NULL){
+		puts("Error: Could not allocate memory");
+		exit(1);
+	}
+	setFrozen(&e->t->frozen, buildTrieOfKind(parsed, nParsed, chars, rules, REPLACEMENTS));
+	setFrozen(&e->addT->frozen, buildTrieOfKind(parsed, nParsed, chars, rules, ADDITIONS));
+	setFrozen(&e->remT->frozen, buildTrieOfKind(parsed, nParsed, chars, rules, REMOVALS));
+	/* If tracing-tries also exist, the strings are reversed for them 
+	   (backtracing matches right sides backwards, too). */
+	if(e->traceT != NULL || e->traceAddT != NULL || e->traceRemT != NULL){
+		reversed = (wchar_t *)malloc((nChars > 0 ? nChars : 1) * sizeof(wchar_t));
+		if(reversed == NULL){
+			puts("Error: Could not allocate memory");
+			exit(1);
+		}
+		for(k = 0; k < nParsed; k++){
+			for(l = 0; l < parsed[k].leftLen; l++)
+				reversed[parsed[k].left + l] = chars[parsed[k].left + parsed[k].leftLen - 1 - l];
+			reversed[parsed[k].left + parsed[k].leftLen] = L'\0';
+			for(l = 0; l < parsed[k].rightLen; l++)
+				reversed[parsed[k].right + l] = chars[parsed[k].right + parsed[k].rightLen - 1 - l];
+			reversed[parsed[k].right + parsed[k].rightLen] = L'\0';
 		}
+		if(e->traceT != NULL)
+			setFrozen(&e->traceT->frozen, buildTrieOfKind(parsed, nParsed, reversed, rules, REPLACEMENTS));
+		if(e->traceAddT != NULL)
+			setFrozen(&e->traceAddT->frozen, buildTrieOfKind(parsed, nParsed, reversed, rules, ADDITIONS));
+		if(e->traceRemT != NULL)
+			setFrozen(&e->traceRemT->frozen, buildTrieOfKind(parsed, nParsed, reversed, rules, REMOVALS));
+		free(reversed);
 	}
-	free(string1);
-	/* Release the memory under data. */
-	munmap(data, strlen(data));
+	free(rules);
+	free(parsed);
+	free(chars);
+	compileGedEngine(e);
 	return 0;
 }
 
 
-// Builds ignore case list according to given file content
-int ignoreCaseListFromFile(char *data){
+// Loads the transformations of the engine from a transformations file or a compiled rule set
+int loadTransformations(GedEngine *e, char *filename){
+	char *data;
+	long long size;
+	struct stat sbuf;
+
+	/* An empty transformations file holds no transformations, only the default costs: mmap() cannot map it */
+	if(filename != NULL && stat(filename, &sbuf) == 0 && S_ISREG(sbuf.st_mode) && sbuf.st_size == 0)
+		return trieFromFile(e, "", 0);
+	data = readFileSize(filename, &size);
+	if(data == NULL)
+		return -1;
+	if(!isRuleImage(data, size))
+		return trieFromFile(e, data, size);
+	/* The compiled rule set is mapped again as a private copy, where its pointers can be set up */
+	munmap(data, size);
+	data = readFileCopy(filename, &size);
+	if(data == NULL)
+		return -1;
+	if(gedEngineFromImage(e, data, size) != 0){
+		munmap(data, size);
+		return -1;
+	}
+	return 0;
+}
+
+// Builds ignore case list of the engine according to given file content
+int ignoreCaseListFromFile(GedEngine *e, char *data){
 	char *string1;
 	char *string2;
 	wchar_t *wstr1;
@@ -252,16 +384,31 @@ int ignoreCaseListFromFile(char *data){
 	int datalen;
 	int i;
 	int j;
+	int line;
 
 	datalen = strlen(data);
 	i = 0;
 	j = 0;
+	line = 0;
 
   while(i < datalen){
         j = i;
+        line++;
 
-        /* Find left side of the transformation */
-        while(data[j] != ':') j++;
+        /* Skip empty lines */
+        if(data[j] == '\n' || data[j] == '\r'){
+           j += (data[j] == '\r' && data[j + 1] == '\n') ? 2 : 1;
+           i = j;
+           continue;
+        }
+
+        /* Find left side of the transformation (within the line) */
+        while(j < datalen && data[j] != ':' && data[j] != '\n' && data[j] != '\r') j++;
+        if(j == datalen || data[j] != ':'){
+           fprintf(stderr, "Error in ignore case file, line %i: ':' is missing\n", line);
+           munmap(data, datalen);
+           return -1;
+        }
 
         string1 = (char *)malloc(j-i+1);
         if(string1 == NULL){
@@ -274,7 +421,7 @@ int ignoreCaseListFromFile(char *data){
         /* Find right side of the transformation */
         j++; i = j;
 
-        while(data[j] != '\n' && data[j] != '\r' && j < datalen) j++;
+        while(j < datalen && data[j] != '\n' && data[j] != '\r') j++;
 
         string2 = (char *)malloc(j-i+1);
 
@@ -289,7 +436,7 @@ int ignoreCaseListFromFile(char *data){
         wstr2 = (wchar_t *)localeToWchar(string2);
         wstr1 = (wchar_t *)localeToWchar(string1);
 
-        insertIgnoreCaseElement(wstr1, wstr2);
+        insertIgnoreCaseElement(&e->ignoreCase, wstr1, wstr2);
         free(string1);
         free(string2);
         free(wstr1);
@@ -299,36 +446,40 @@ int ignoreCaseListFromFile(char *data){
         else j = j+1;
            i = j;
   }
+  /* Compile the list for look-ups */
+  freeCaseTable(e->caseTable);
+  e->caseTable = createCaseTable(e->ignoreCase);
   /* Release the file content */
   munmap(data, strlen(data));
   return 0;
 }
 
 // Normalizes a case of a single character
-wchar_t makeToIgnoreCase(wchar_t s){
-    IgnoreCaseListElement *caseList;
-
-    caseList = ignoreCase;
-    if(caseList == NULL){
+wchar_t makeToIgnoreCase(GedEngine *e, wchar_t s){
+    if(e->ignoreCase == NULL || e->caseTable == NULL){
         if(debug)
             puts("Ignore Case list was empty!");
         return s;
     }
-    while(caseList != NULL){
-        if(s == caseList->left[0]){ // selle the case saame ra muuta
-            return caseList->right[0];
-        }
-        caseList = caseList->next;
-    }
-    return s;
+    return caseTableLookup(e->caseTable, s);
 }
 
 // Normalizes case of a string
-wchar_t *makeStringToIgnoreCase(wchar_t *string, int len){
+wchar_t *makeStringToIgnoreCase(GedEngine *e, wchar_t *string, int len){
+    CaseTable *table = e->caseTable;
     int i;
+
+    if(e->ignoreCase == NULL || table == NULL){
+        if(debug)
+            puts("Ignore Case list was empty!");
+        return string;
+    }
     // Attempts to transform every letter/character of given string 
     for(i = 0; i < len; i++){
-        string[i] = makeToIgnoreCase(string[i]);
+        if((unsigned int)string[i] < 0x10000)
+            string[i] = table->bmp[string[i]];
+        else
+            string[i] = caseTableLookup(table, string[i]);
     }
     return string;
 }
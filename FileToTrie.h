@@ -36,78 +36,117 @@
 #include "List.h"
 #include <math.h>
 #include "ARTrie.h"
+#include "FrozenTrie.h"
+#include "GedEngine.h"
 #include <string.h>
 #include <locale.h>
 
 extern int debug;
 
-extern double add;
-extern double rep;
-extern double rem;
+/**
+*   Reads file \a *filename into memory, using \c mmap() function. Returns
+*   pointer to the memory-mapped file, which is read-only. On errors (also
+*   if the file is empty or not a regular file), a message is printed to 
+*   \c stderr and \c NULL is returned.
+*/
+char *readFile(char *filename);
 
-extern IgnoreCaseListElement *ignoreCase;
-extern int caseInsensitiveMode;
+/**
+*   Reads file \a *filename into memory as a private copy-on-write mapping:
+*   the memory can be modified without changing the file. The size of the 
+*   file is stored in \a *size . Returns \c NULL on errors, as \a readFile()
+*   does.
+*/
+char *readFileCopy(char *filename, long long *size);
 
-extern Trie *t;
-extern ARTrie *addT;
-extern ARTrie *remT;
+/**
+*   Reads file \a *filename into memory as \a readFile() does, also storing
+*   the size of the file in \a *size .
+*/
+char *readFileSize(char *filename, long long *size);
 
-extern Trie *traceT;
-extern ARTrie *traceAddT;
-extern ARTrie *traceRemT;
+/**
+*   Rounds \a size up to a multiple of 8 bytes (parts of binary files 
+*   written with \a writeFilePart() are aligned so).
+*/
+long long alignFilePart(long long size);
 
 /**
-*   Reads file \a *filename into memory, using \c mmap() function. Returns
-*   pointer to the memory-mapped file, which is read-only. Any errors on 
-*   reading will cause the program to abort.
+*   Tells whether a part of a binary file read into memory (e.g. an array of
+*   \a count elements of \a size bytes, at the byte offset \a offset ) lies 
+*   within the bytes \a from .. \a to-1 of the file, and is aligned as 
+*   \a writeFilePart() aligns it. Offsets and counts read from the file are
+*   checked with it before they are used.
 */
-char *readFile(char *filename);
+int isFilePart(long long offset, long long count, long long size, long long from, long long to);
 
+/**
+*   Writes \a size bytes of \a *data into the file \a *f , followed by zero
+*   bytes up to a multiple of 8 bytes (if \a data is NULL, only the zeros are
+*   written: the bytes have been written already). Returns \c 0 on success, 
+*   \c -1 on error.
+*/
+int writeFilePart(FILE *f, const void *data, long long size);
 
 
 /**
-*   Reads a string snippet ( at position \a i to \a j ) from \a *data and 
-*   converts into a double value. Returns found double.
+*   Reads transformations from file content \a *data ( \a size bytes) and 
+*  builds tries \a t, \a addT and \a remT of the engine \a *e (and its 
+*   tries for backtracing, if the engine has them). If the file also 
+*   specifies weights for default edit operations \a add, \a rep and 
+*   \a rem, these weights will also be set. The content is read in a single
+*   pass; the transformations are then sorted and the tries are built in 
+*   bulk, directly in their frozen forms (see \a buildFrozenTrie() ), so 
+*   the tries of the engine must be empty. At the end, the engine is 
+*   compiled for searching (see \c compileGedEngine() ). The 'ignore case'
+*   list of the engine must be read before. Empty lines are skipped; on a 
+*   malformed line, an error message with its line and column is printed to
+*   \c stderr and \c -1 is returned (\c 0 on success).
+*   At the end of work, the memory under \a *data is released via method 
+*  \c munmap() (unless \a size is \c 0 : empty files are not mapped).
 */
-double findValue(char *data, int i, int j);
+int trieFromFile(GedEngine *e, char *data, long long size);
 
 /**
-*   Reads transformations from file content \a *data and builds tries \a *t,
-*  \a *addT and \a *remT. If the file also specifies weights for default
-*   edit operations \a add, \a rep and \a rem, these weights will also be
-*   set.
-*   At the end of work, the memory under \a *data is released via method 
-*  \c munmap().
+*   Loads the transformations of the engine \a *e from the file \a *filename :
+*   either a transformations file (see \a trieFromFile() ) or a rule set
+*   compiled beforehand (see \a gedEngineFromImage() ). An empty file holds
+*   no transformations: only the default operations are used, with their 
+*   default costs. The 'ignore case' list of the engine must be read before.
+*   Returns \c 0 , or \c -1 if the file cannot be read, the transformations
+*   file is malformed or the compiled rule set cannot be used with the 
+*   engine (an error message is printed to \c stderr ).
 */
-int trieFromFile(char *data);
+int loadTransformations(GedEngine *e, char *filename);
 
 /**
 *   Reads 'ignore case' transformations from file content \a *data and 
-*  builds tries \a ignoreCase list.
+*  builds the \a ignoreCase list of the engine \a *e.
 *   At the end of work, the memory under \a *data is released via method 
-*  \c munmap().
+*  \c munmap(). Empty lines are skipped. Returns \c 0 , or \c -1 if a line 
+*  is not in the format \c A:B (an error message is printed to \c stderr ).
 */
-int ignoreCaseListFromFile(char *data);
+int ignoreCaseListFromFile(GedEngine *e, char *data);
 
 
 
 /**
 *   Normalizes a case of a single character via transforming it using
-*   a transformation from \a ignoreCase list. More precisely: if the
+*   a transformation from \a ignoreCase list of the engine \a *e. More precisely: if the
 *   input char matches one of the left side chars in \a ignoreCase 
 *   list, corresponding right side char from the list is returned;
 *   if no match is found, returns the input character.
 *   Only the first match is returned, as multiple matches are not 
 *   expected.
 */
-wchar_t makeToIgnoreCase(wchar_t s);
+wchar_t makeToIgnoreCase(GedEngine *e, wchar_t s);
 
 /**
 *   Makes \a *string case insensitive via transforming it with
 *   \a makeToIgnoreCase() method. Transformation is applied to
 *   a substring (0, \a len - 1).
 */
-wchar_t *makeStringToIgnoreCase(wchar_t *string, int len);
+wchar_t *makeStringToIgnoreCase(GedEngine *e, wchar_t *string, int len);
 
 /**
 *   Transforms given wchar string \a *str into multibyte char string.
@@ -31,155 +31,532 @@ int addValueToTable(int cols, double table[][cols], int row, int col, double val
 }
 
 // Search 'remove' operations from trie and apply if possible
-int searchFromRemTrie(int cols, double table[][cols], wchar_t *string, int i , int j){
-   ARTNode *tmp;
+int searchFromRemTrie(GedQuery *q, int cols, double table[][cols], wchar_t *string, int i , int j){
+   FrozenTrie *f = frozenARTrie(q->engine->remT);
+   FrozenNode *n;
    double value;
+   int node = 0;
    int r = 1;
 
-   tmp = remT->firstNode;
-   value = table[i][j] + getPenaltOfChangingPosWithGenEd(i);
-   while(tmp != NULL && string != L'\0'){
-     if(tmp->label == *string){
-        /* If given node in trie is an end node: */
-        if(tmp->value != DBL_MAX){
-            // Operation: at position i. in the search string, remove following r characters
-            addValueToTable(cols, table, (i+r), j, (value + tmp->value));
-        }
-        string = string + 1;
-        tmp = tmp->nextNode;
-        value += getPenaltOfChangingPosWithGenEd(i+r);
-        r++;
+   value = table[i][j] + getPenaltOfChangingPosWithGenEd(q, i);
+   while(*string != L'\0' && (node = frozenChild(f, node, *string)) >= 0){
+     n = f->nodes + node;
+     /* If given node in trie is an end node: */
+     if(n->value != DBL_MAX){
+         // Operation: at position i. in the search string, remove following r characters
+         addValueToTable(cols, table, (i+r), j, (value + n->value));
      }
-     else tmp = tmp->rightNode;
+     string = string + 1;
+     value += getPenaltOfChangingPosWithGenEd(q, i+r);
+     r++;
    }
    return 0;
 }
 
 // Search 'add' operations from trie and apply if possible
-int searchFromAddTrie(int cols, double table[][cols], wchar_t *string, int i , int j){
-  ARTNode *tmp;
+int searchFromAddTrie(GedQuery *q, int cols, double table[][cols], wchar_t *string, int i , int j){
+  FrozenTrie *f = frozenARTrie(q->engine->addT);
+  FrozenNode *n;
   double value;
+  int node = 0;
   int c = 1;
 
-  tmp = addT->firstNode;
-  value  = table[i][j] + getPenaltOfChangingPosWithGenEd(i);
-  while(tmp != NULL && string != L'\0'){
-    if(tmp->label == *string){
-       /* If given node in trie is an end node: */
-       if(tmp->value != DBL_MAX){
-           // Operation: at position i. in the search string, insert c characters
-           addValueToTable(cols, table, i, (j+c), (value + tmp->value));
-       }
-       string = string + 1;
-       tmp = tmp->nextNode;
-       c++;
+  value  = table[i][j] + getPenaltOfChangingPosWithGenEd(q, i);
+  while(*string != L'\0' && (node = frozenChild(f, node, *string)) >= 0){
+    n = f->nodes + node;
+    /* If given node in trie is an end node: */
+    if(n->value != DBL_MAX){
+        // Operation: at position i. in the search string, insert c characters
+        addValueToTable(cols, table, i, (j+c), (value + n->value));
     }
-    else tmp = tmp->rightNode;
+    string = string + 1;
+    c++;
   }
   return 0;
 }
 
-// Checks from EndNode list, whether there are replacements corresponding to string, and tries to apply them
-int findReplacement(int cols, EndNode *n, double table[][cols], wchar_t *string, int i, int j, double value){
-  wchar_t *repl;
-  int c;
-
-  while(n != NULL){
-     repl = n->edit;
-     c = 0;
-     // Check, whether given replacement can be made
-     while(1){
-        if(string[c] == repl[c] || repl[c] == L'\0'){
-            if(repl[c] == '\0'){   
-                 // End of replacement string
-                 addValueToTable(cols, table, i, (j + c), (value + n->value));
-                 goto nextRepl;
-            }
-            c++;
-        }
-        else break;
-     }
-     nextRepl: n = n->nextEN;
+// Walks the sub-trie of right sides along string, and applies the replacements found
+int findReplacement(int cols, FrozenTrie *f, int rights, double table[][cols], wchar_t *string, int i, int j, double value){
+  int node = rights;
+  int c = 0;
+
+  while(1){
+     // a replacement ends here: its right side matches c characters of the string
+     if(f->rights[node].value != DBL_MAX)
+        addValueToTable(cols, table, i, (j + c), (value + f->rights[node].value));
+     if(string[c] == L'\0' || (node = frozenRightChild(f, node, string[c])) < 0)
+        break;
+     c++;
   }
   return 0;
 }
 
 // Search 'replace' operations from trie and apply if possible
-int searchFromRepTrie(int cols, double table[][cols], wchar_t *string1, wchar_t *string2, int i, int j){
-    TrieNode *tmp;
-    EndNode *repl;
+int searchFromRepTrie(GedQuery *q, int cols, double table[][cols], wchar_t *string1, wchar_t *string2, int i, int j){
+    FrozenTrie *f = frozenTrie(q->engine->t);
+    FrozenNode *n;
     double value;
+    int node = 0;
     int r;
 
-    tmp = t->firstNode;
-    value = table[i][j] + getPenaltOfChangingPosWithGenEd(i);
+    value = table[i][j] + getPenaltOfChangingPosWithGenEd(q, i);
     r = 1;
-    while(tmp != NULL){
-      if(tmp->label == *string1){
-        /* If given node in trie is an end node: */
-        if(tmp->replacement != NULL){
-            // Operation: from position i. in the search string, replace next r characters (including i.)
-            repl = tmp->replacement;
-            findReplacement(cols, repl, table, string2, (i+r), j, value);
-        }
-        string1 = string1 + 1;
-        tmp = tmp->nextNode;
-        value += getPenaltOfChangingPosWithGenEd(i+r);
-        r++;
+    while(*string1 != L'\0' && (node = frozenChild(f, node, *string1)) >= 0){
+      n = f->nodes + node;
+      /* If given node in trie is an end node: */
+      if(n->replacement != NULL){
+          // Operation: from position i. in the search string, replace next r characters (including i.)
+          findReplacement(cols, f, n->rights, table, string2, (i+r), j, value);
       }
-      else tmp = tmp->rightNode;
+      string1 = string1 + 1;
+      value += getPenaltOfChangingPosWithGenEd(q, i+r);
+      r++;
    }
    return 0;
 }
 
 // Gets a penalty which applies for changing i-th char in the search string via edit distance
-double getPenaltOfChangingPos(int i){
-  if (changeSearchStringWithEd_pen != NULL){
-     return changeSearchStringWithEd_pen[ i + 1 ];
+double getPenaltOfChangingPos(GedQuery *q, int i){
+  if (q->edPen != NULL){
+     return q->edPen[ i + 1 ];
   }
   return 0.0;
 }
 
 // Gets a penalty which applies for changing i-th char in the search string via generalized edit distance
-double getPenaltOfChangingPosWithGenEd(int i){
-  if (changeSearchStringWithGenEd_pen != NULL){
-     return changeSearchStringWithGenEd_pen[ i + 1 ];
+double getPenaltOfChangingPosWithGenEd(GedQuery *q, int i){
+  if (q->genEdPen != NULL){
+     return q->genEdPen[ i + 1 ];
   }
   return 0.0;
 }
 
-// Finds regular edit distance between strings a and b.
+// Finds regular edit distance between strings a and b (bit-parallel).
 int editDistance(wchar_t* a, wchar_t* b, int aLen, int bLen){
-  int i, j;
-  int rows = aLen + 1;
-  int cols = bLen +1;
-  int table[rows][cols];
+  MyersPattern *p;
+  int d;
+
+  if(aLen == 0) return bLen;
+  if(bLen == 0) return aLen;
+  p = createMyersPattern(a, aLen);
+  d = myersDistance(p, b, bLen, 1, 1);
+  freeMyersPattern(p);
+  return d;
+}
 
-  // fill the first row
-  for(i = 0; i < rows; i++){
-     table[i][0] = i;
+// -----------------------------------------------------------------------------
+//    Rolling window of the table for score-only calculations
+// -----------------------------------------------------------------------------
+
+/* The default workspaces are kept per thread, so that the score-only methods
+   can be called from several threads at once; each thread releases its own
+   workspaces via freeDefaultWorkspaces(). */
+
+// Default workspace of the score-only methods
+static __thread DistWindow *defaultWindow = NULL;
+
+// Search string compiled for the bit-parallel calculation (if it can be used)
+static __thread MyersPattern *defaultPattern = NULL;
+
+// Matches of the strings produced by 'add' and 'replace' operations in the current text
+static __thread TextMatches *defaultTextMatches = NULL;
+
+// Creates a new window, deep enough for transformations of the engine
+DistWindow *createDistWindow(GedEngine *e){
+   DistWindow *w;
+
+   w = (DistWindow *)malloc(sizeof(DistWindow));
+   if(w == NULL)
+      abort();
+   w->maxSpan = e->maxSpan;
+   w->depth = w->maxSpan + 1;
+   w->rowCap = 0;
+   w->variants = 1;
+   w->cells = NULL;
+   w->zerosLen = 0;
+   w->zeros = NULL;
+   w->dirty    = (int *)malloc(w->depth * sizeof(int));
+   w->pushDeep = (int *)malloc(w->depth * sizeof(int));
+   if(w->dirty == NULL || w->pushDeep == NULL)
+      abort();
+   return w;
+}
+
+// Releases memory under the window
+void freeDistWindow(DistWindow *w){
+   if(w->cells != NULL)
+      free(w->cells);
+   if(w->zeros != NULL)
+      free(w->zeros);
+   free(w->dirty);
+   free(w->pushDeep);
+   free(w);
+}
+
+// Makes sure that the window can hold given number of cells per column
+static void ensureDistWindowRows(DistWindow *w, int rows){
+   int k, i;
+   if(rows <= w->rowCap)
+      return;
+   if(w->cells != NULL)
+      free(w->cells);
+   w->cells = (double *)malloc((size_t)w->depth * rows * sizeof(double));
+   if(w->cells == NULL){
+      puts("Error: Could not allocate memory");
+      exit(1);
+   }
+   w->rowCap = rows;
+   for(k = 0; k < w->depth; k++){
+      for(i = 0; i < rows; i++)
+         w->cells[k * rows + i] = DBL_MAX;
+      w->dirty[k]    = -1;
+      w->pushDeep[k] = -1;
+   }
+}
+
+// Returns the window column holding given column of the table
+static inline double *windowColumn(DistWindow *w, int col){
+   return w->cells + (col % w->depth) * w->rowCap;
+}
+
+// Makes the window column of given table column empty again (only the rows that have been written)
+static void clearWindowColumn(DistWindow *w, int col){
+   int k = col % w->depth;
+   double *c = w->cells + k * w->rowCap;
+   int i;
+   for(i = 0; i <= w->dirty[k]; i++)
+      c[i] = DBL_MAX;
+   w->dirty[k]    = -1;
+   w->pushDeep[k] = -1;
+}
+
+// Marks rows up to given row of the window column as written
+static inline void markWindowRows(DistWindow *w, int col, int row){
+   int k = col % w->depth;
+   if(row > w->dirty[k]) w->dirty[k] = row;
+}
+
+// Returns a penalty from the mask for changing i-th char of the search string
+static inline double penaltyAt(double *pen, int i){
+   return (pen != NULL) ? pen[i + 1] : 0.0;
+}
+
+// Insert value into the window at [row][col] (variant v of the table), if it improves the result and is within the limit
+static inline void pushToWindow(DistWindow *w, int row, int v, int col, double value){
+   double *c;
+   int k, slot;
+   if(value <= w->limit){
+      k = col % w->depth;
+      c = w->cells + k * w->rowCap;
+      slot = row * w->variants + v;
+      if(value < c[slot]){
+         c[slot] = value;
+         if(slot > w->dirty[k])    w->dirty[k] = slot;
+         if(slot > w->pushDeep[k]) w->pushDeep[k] = slot;
+         if(col > w->lastPushCol) w->lastPushCol = col;
+      }
+   }
+}
+
+// Apply 'remove' operations matching the search string at position i into the window (from all variants of the cell)
+static void windowFromRemMatches(DistWindow *w, QueryMatches *q, double *genPen, double *cell, int i, int j){
+   QueryMatch *m   = q->remMatches + q->remStart[i];
+   QueryMatch *end = q->remMatches + q->remStart[i+1];
+   double value[WINDOW_MAX_VARIANTS];
+   int r = 1;
+   int v;
+
+   for(v = 0; v < w->variants; v++)
+      value[v] = cell[v] + penaltyAt(genPen, i);
+   for(; m < end; m++){
+      // penalties of the removed characters are added one by one, in the order of the trie walk
+      for(; r < m->span; r++)
+         for(v = 0; v < w->variants; v++)
+            value[v] += penaltyAt(genPen, i+r);
+      for(v = 0; v < w->variants; v++)
+         if(cell[v] <= w->limit)
+            pushToWindow(w, (i + m->span), v, j, (value[v] + m->cost));
+   }
+}
+
+// Apply 'add' operations producing the text from position j into the window (from all variants of the cell)
+static void windowFromAddMatches(DistWindow *w, TextMatches *tm, double *genPen, double *cell, int i, int j){
+  TextMatcher *m = tm->matcher;
+  double value[WINDOW_MAX_VARIANTS];
+  int k, id, v;
+
+  for(v = 0; v < w->variants; v++)
+     value[v] = cell[v] + penaltyAt(genPen, i);
+  for(k = tm->addFirst[j]; k >= 0; k = tm->matchNext[k]){
+     id = tm->matchPattern[k];
+     for(v = 0; v < w->variants; v++)
+        if(cell[v] <= w->limit)
+           pushToWindow(w, i, v, (j + m->patternLen[id]), (value[v] + m->addCost[id]));
   }
-  for(j = 1; j < cols; j++){
-     table[0][j] = j;
-     for(i = 1; i < rows; i++){
-         if(*(a+(i-1)) == *(b+(j-1))){
-              table[i][j] = min(table[i-1][j-1],
-                   min(table[i][j-1]+1, table[i-1][j]+1));
-         } else
-              table[i][j] = min(table[i-1][j-1]+1,
-                   min(table[i][j-1]+1, table[i-1][j]+1));
+}
+
+// Apply 'replace' operations matching the search string at position i and the text at position j into the window
+static void windowFromRepMatches(DistWindow *w, QueryMatches *q, TextMatches *tm, double *genPen, double *cell, int i, int j){
+    QueryMatch *m   = q->repMatches + q->repStart[i];
+    QueryMatch *end = q->repMatches + q->repStart[i+1];
+    QueryRight *right, *rightEnd;
+    double value[WINDOW_MAX_VARIANTS];
+    int r = 1;
+    int v;
+
+    for(v = 0; v < w->variants; v++)
+       value[v] = cell[v] + penaltyAt(genPen, i);
+    for(; m < end; m++){
+        // penalties of the replaced characters are added one by one, in the order of the trie walk
+        for(; r < m->span; r++)
+           for(v = 0; v < w->variants; v++)
+              value[v] += penaltyAt(genPen, i+r);
+        // the right side must match the text at position j
+        rightEnd = q->rights + m->firstRight + m->nRights;
+        for(right = q->rights + m->firstRight; right < rightEnd; right++){
+            if(right->len == 0 || 
+               (right->first == tm->text[j] && (right->len == 1 || isPatternAt(tm, j, right->pattern)))){
+                for(v = 0; v < w->variants; v++)
+                   if(cell[v] <= w->limit)
+                      pushToWindow(w, (i + m->span), v, (j + right->len), (value[v] + right->cost));
+            }
+        }
+    }
+}
+
+// Flags of the specialized variants of the window kernel (see WindowKernel.h)
+#define WINDOW_KERNEL_ADD   1
+#define WINDOW_KERNEL_REM   2
+#define WINDOW_KERNEL_REP   4
+#define WINDOW_KERNEL_PEN   8
+#define WINDOW_KERNEL_PAIR 16
+
+#define WK_FLAGS 0
+#include "WindowKernel.h"
+#define WK_FLAGS 1
+#include "WindowKernel.h"
+#define WK_FLAGS 2
+#include "WindowKernel.h"
+#define WK_FLAGS 3
+#include "WindowKernel.h"
+#define WK_FLAGS 4
+#include "WindowKernel.h"
+#define WK_FLAGS 5
+#include "WindowKernel.h"
+#define WK_FLAGS 6
+#include "WindowKernel.h"
+#define WK_FLAGS 7
+#include "WindowKernel.h"
+#define WK_FLAGS 8
+#include "WindowKernel.h"
+#define WK_FLAGS 9
+#include "WindowKernel.h"
+#define WK_FLAGS 10
+#include "WindowKernel.h"
+#define WK_FLAGS 11
+#include "WindowKernel.h"
+#define WK_FLAGS 12
+#include "WindowKernel.h"
+#define WK_FLAGS 13
+#include "WindowKernel.h"
+#define WK_FLAGS 14
+#include "WindowKernel.h"
+#define WK_FLAGS 15
+#include "WindowKernel.h"
+#define WK_FLAGS 16
+#include "WindowKernel.h"
+#define WK_FLAGS 17
+#include "WindowKernel.h"
+#define WK_FLAGS 18
+#include "WindowKernel.h"
+#define WK_FLAGS 19
+#include "WindowKernel.h"
+#define WK_FLAGS 20
+#include "WindowKernel.h"
+#define WK_FLAGS 21
+#include "WindowKernel.h"
+#define WK_FLAGS 22
+#include "WindowKernel.h"
+#define WK_FLAGS 23
+#include "WindowKernel.h"
+#define WK_FLAGS 24
+#include "WindowKernel.h"
+#define WK_FLAGS 25
+#include "WindowKernel.h"
+#define WK_FLAGS 26
+#include "WindowKernel.h"
+#define WK_FLAGS 27
+#include "WindowKernel.h"
+#define WK_FLAGS 28
+#include "WindowKernel.h"
+#define WK_FLAGS 29
+#include "WindowKernel.h"
+#define WK_FLAGS 30
+#include "WindowKernel.h"
+#define WK_FLAGS 31
+#include "WindowKernel.h"
+
+typedef void (*WindowKernel)(DistWindow *w, GedQuery *q, wchar_t *b, int bLen,
+                             double **start_pen, double* end_pen, double *edPen, double *genPen, double limit,
+                             double *lastScores, double *endScores);
+
+// Variants of the window kernel, indexed by their flags
+static const WindowKernel windowKernels[32] = {
+  windowKernel0,  windowKernel1,  windowKernel2,  windowKernel3,  windowKernel4,  windowKernel5,  windowKernel6,  windowKernel7,
+  windowKernel8,  windowKernel9,  windowKernel10, windowKernel11, windowKernel12, windowKernel13, windowKernel14, windowKernel15,
+  windowKernel16, windowKernel17, windowKernel18, windowKernel19, windowKernel20, windowKernel21, windowKernel22, windowKernel23,
+  windowKernel24, windowKernel25, windowKernel26, windowKernel27, windowKernel28, windowKernel29, windowKernel30, windowKernel31
+};
+
+/*
+*   Calculates generalized edit distance in the window \a *w , keeping only the 
+*  columns that can still be reached by transformations. \a nv variants of the
+*  table, differing only in the first row ( \a start_pen[v] , NULL if the match 
+*  must start at the beginning of the text), are calculated side by side, so
+*  that transformations are looked up only once per cell. For each variant,
+*  \a lastScores[v] is the value of the last cell of the table, and if \a end_pen
+*  is not NULL, \a endScores[v] is the best value of the last row with \a end_pen 
+*  applied. The search string, its matches and the costs of operations are 
+*  taken from \a *q , penalties of changing the search string from the masks 
+*  \a edPen and \a genPen (NULL for none). Cells exceeding \a limit are left out 
+*  (see genEditDistance_pens_limit()), such scores are reported as DBL_MAX.
+*  If the engine has negative costs, a cell above the limit can still lead to a 
+*  score within it: then the whole table is calculated, and only the scores are
+*  compared with the limit.
+*   The calculation is done by the variant of the kernel (see WindowKernel.h) 
+*  specialized for the transformations matching the search string, the 
+*  penalties and the number of variants of the table.
+*/
+static void windowDistances(DistWindow *w, GedQuery *q, wchar_t *b, int bLen, int nv,
+                            double **start_pen, double* end_pen, double *edPen, double *genPen, double limit,
+                            double *lastScores, double *endScores){
+  QueryMatches *qm = q->matches;
+  double cutoff = (q->engine->hasNegativeCost) ? DBL_MAX : limit;
+  int flags = 0;
+  int v;
+
+  if(qm->singleAdd || q->engine->matcher->maxAddLen > 1)
+     flags |= WINDOW_KERNEL_ADD;
+  if(qm->singleRem || qm->remStart[q->len] > 0)
+     flags |= WINDOW_KERNEL_REM;
+  if(qm->singleRep || qm->repStart[q->len] > 0)
+     flags |= WINDOW_KERNEL_REP;
+  if(edPen != NULL)
+     flags |= WINDOW_KERNEL_PEN;
+  if(nv == 2)
+     flags |= WINDOW_KERNEL_PAIR;
+  windowKernels[flags](w, q, b, bLen, start_pen, end_pen, edPen, genPen, cutoff, lastScores, endScores);
+  if(cutoff != limit){
+     for(v = 0; v < nv; v++){
+        if(lastScores[v] > limit) lastScores[v] = DBL_MAX;
+        if(endScores[v] > limit)  endScores[v] = DBL_MAX;
      }
   }
-  return table[rows-1][cols-1];
+}
+
+/*
+*   Calculates generalized edit distance in the window \a *w for a single 
+*  variant of the table (see windowDistances()).
+*/
+static double windowDistance(DistWindow *w, GedQuery *q, wchar_t *b, int bLen, 
+                             double* start_pen, double* end_pen, double *edPen, double *genPen, double limit){
+  double lastScore, endScore;
+  windowDistances(w, q, b, bLen, 1, &start_pen, end_pen, edPen, genPen, limit, &lastScore, &endScore);
+  return (end_pen != NULL) ? endScore : lastScore;
+}
+
+// Returns an array of at least len 0.0 values (never NULL, even if len == 0)
+static double *windowZeros(DistWindow *w, int len){
+  int i;
+  if(len < 1)
+     len = 1;
+  if(len > w->zerosLen){
+     if(w->zeros != NULL)
+        free(w->zeros);
+     w->zeros = (double *)malloc(len * sizeof(double));
+     if(w->zeros == NULL){
+        puts("Error: Could not allocate memory");
+        exit(1);
+     }
+     for(i = 0; i < len; i++)
+        w->zeros[i] = 0.0;
+     w->zerosLen = len;
+  }
+  return w->zeros;
+}
+
+// Returns the default workspace of the score-only methods, (re)creating it if it does not fit the engine
+static DistWindow *getDefaultWindow(GedEngine *e){
+  if(defaultWindow != NULL && defaultWindow->maxSpan != e->maxSpan){
+     freeDistWindow(defaultWindow);
+     defaultWindow = NULL;
+  }
+  if(defaultWindow == NULL)
+     defaultWindow = createDistWindow(e);
+  return defaultWindow;
+}
+
+// Returns the search string compiled for the bit-parallel calculation, compiling it if necessary
+static MyersPattern *getDefaultPattern(wchar_t *a, int aLen){
+  if(defaultPattern != NULL && !isMyersPatternOf(defaultPattern, a, aLen)){
+     freeMyersPattern(defaultPattern);
+     defaultPattern = NULL;
+  }
+  if(defaultPattern == NULL)
+     defaultPattern = createMyersPattern(a, aLen);
+  return defaultPattern;
+}
+
+// Releases the default workspaces of the score-only methods
+void freeDefaultWorkspaces(){
+  if(defaultWindow != NULL){
+     freeDistWindow(defaultWindow);
+     defaultWindow = NULL;
+  }
+  if(defaultPattern != NULL){
+     freeMyersPattern(defaultPattern);
+     defaultPattern = NULL;
+  }
+  if(defaultTextMatches != NULL){
+     freeTextMatches(defaultTextMatches);
+     defaultTextMatches = NULL;
+  }
+}
+
+// Checks whether the distance is a regular edit distance with unit costs (no transformations, no penalties)
+int isUnitCostSearch(GedQuery *q, int bLen){
+  GedEngine *e = q->engine;
+  return q->len > 0 && bLen > 0 &&
+         e->rep == 1.0 && e->rem == 1.0 && e->add == 1.0 &&
+         isEmptyTrie(e->t) && isEmptyARTrie(e->addT) && isEmptyARTrie(e->remT) &&
+         q->edPen == NULL;
 }
 
 // Finds generalized edit distance between strings a and b, without applying any penalties
-double genEditDistance(wchar_t *a, wchar_t *b, int aLen, int bLen, Transformations *transF){
+double genEditDistance(GedQuery *q, wchar_t *b, int bLen, Transformations *transF){
+  GedEngine *e = q->engine;
+  wchar_t *a = q->string;
+  int aLen = q->len;
   int i, j;
   int rows = aLen +1;  // search string
   int cols = bLen +1;  // text
-  double table[rows][cols];
+  double (*table)[cols];
   double value;
+  double score;
+  int hasRem = !isEmptyARTrie(e->remT);
+  int hasAdd = !isEmptyARTrie(e->addT);
+  int hasRep = !isEmptyTrie(e->t);
+
+  // if transformations are not required, only the score is needed
+  if (transF == NULL){
+     return windowDistance(getDefaultWindow(e), q, b, bLen, NULL, NULL, NULL, NULL, DBL_MAX);
+  }
+  // full table is needed for backtracing: keep it on heap
+  table = malloc(sizeof(double) * rows * cols);
+  if(table == NULL){
+     puts("Error: Could not allocate memory");
+     exit(1);
+  }
 
   /*  Fill table with initial values (so we can check applicability of generalized 
   * edit distance transformations even if we haven't reached to the particular 
@@ -193,35 +570,35 @@ double genEditDistance(wchar_t *a, wchar_t *b, int aLen, int bLen, Transformatio
   table[0][0] = 0;
   // fill the first column
   for(i = 1; i < rows; i++){
-     if(remT->firstNode != NULL)
-        searchFromRemTrie(cols, table, (a + i-1), i-1 ,0);
-     value = table[i-1][0] + rem;
+     if(hasRem)
+        searchFromRemTrie(q, cols, table, (a + i-1), i-1 ,0);
+     value = table[i-1][0] + e->rem;
      if(value < table[i][0]) table[i][0] = value;
   }
 
   for(j = 1; j < cols; j++){
-     if(addT->firstNode != NULL)
-        searchFromAddTrie(cols, table, (b + j - 1), 0, j-1);
-     value = table[0][j-1] + add;
+     if(hasAdd)
+        searchFromAddTrie(q, cols, table, (b + j - 1), 0, j-1);
+     value = table[0][j-1] + e->add;
      if(value < table[0][j]) table[0][j] = value;
 
      for(i = 1; i < rows; i++){
-        if(remT->firstNode != NULL)
-           searchFromRemTrie(cols, table, (a + i-1), i-1 ,j);
-        if(addT->firstNode != NULL)
-           searchFromAddTrie(cols, table, (b + j - 1), i, j-1);
-        if(t->firstNode != NULL)
-           searchFromRepTrie(cols, table, (a + i-1 ), b + j-1 , i-1, j-1);
+        if(hasRem)
+           searchFromRemTrie(q, cols, table, (a + i-1), i-1 ,j);
+        if(hasAdd)
+           searchFromAddTrie(q, cols, table, (b + j - 1), i, j-1);
+        if(hasRep)
+           searchFromRepTrie(q, cols, table, (a + i-1 ), b + j-1 , i-1, j-1);
 
         if(a[i-1] == b[j-1]){
            value = min(table[i-1][j-1],
-                   min(table[i][j-1]+ add,
-                       table[i-1][j] + rem ));
+                   min(table[i][j-1]+ e->add,
+                       table[i-1][j] + e->rem ));
            if(value < table[i][j]) table[i][j] = value;
         } else {
-           value = min(table[i-1][j-1] + rep,
-                   min(table[i][j-1]+ add, 
-                       table[i-1][j] + rem ));
+           value = min(table[i-1][j-1] + e->rep,
+                   min(table[i][j-1]+ e->add, 
+                       table[i-1][j] + e->rem ));
            if(value < table[i][j]) table[i][j] = value;
         }
      }
@@ -240,141 +617,130 @@ double genEditDistance(wchar_t *a, wchar_t *b, int aLen, int bLen, Transformatio
    }
    puts("\n");
   */
-  if (transF != NULL){
-      // if required, backtrace the transformations
-      findBestPaths(cols, table, a, b, aLen, bLen, transF, traceRemT, traceAddT, traceT);
-  }
-  return table[rows-1][cols-1];
+  // backtrace the transformations
+  findBestPaths(e, cols, table, a, b, aLen, bLen, transF);
+  score = table[rows-1][cols-1];
+  free(table);
+  return score;
 }
 
 // Finds generalized edit distance between strings a and b, also applies penalties if possible
-double genEditDistance_pens(wchar_t *a, wchar_t *b, int aLen, int bLen, double* start_pen, double* end_pen){
-  int i, j;
-  int rows = aLen +1;  // search string
-  int cols = bLen +1;  // text
-  double table[rows][cols];
-  double value;
-
-  /*  Fill table with initial values (so we can check applicability of generalized 
-  * edit distance transformations even if we haven't reached to the particular 
-  * cell yet )
-  */
-  for(i = 0; i < rows; i++){
-     for(j = 0; j < cols; j++){
-        table[i][j] = DBL_MAX;
-     }
-  }
-
-  table[0][0] = 0;
-
-  // Fill the first row with start penalties (penalty of starting match at given pos in text)
-  if (start_pen != NULL){
-     for(j = 0; j < bLen; j++){
-        table[0][j] = start_pen[j];
-     }
-  }
+double genEditDistance_pens(GedQuery *q, wchar_t *b, int bLen, double* start_pen, double* end_pen){
+  //
+  // NB! The 'add penalty' { table[i][j-1] + add + getPenaltOfChangingPos(i) } is useful
+  // only when the position i+1 (following position i) is also penalized or if it is the end of word.
+  // If the position i+1 is free (unpenalized), the blocked adding can be still done by replacements
+  // at position i+1 and additions after i+1.
+  //
+  return windowDistance(getDefaultWindow(q->engine), q, b, bLen, start_pen, end_pen, 
+                        q->edPen, q->genEdPen, DBL_MAX);
+}
 
-  // fill the first column
-  for(i = 1; i < rows; i++){
-     if(remT->firstNode != NULL)
-         searchFromRemTrie(cols, table, (a + i-1), i-1 ,0);
-     value = table[i-1][0] + rem + getPenaltOfChangingPos(i-1);  // regular deletion at the search string pos i.
-     if(value < table[i][0]) table[i][0] = value;
-  }
+// Finds generalized edit distance between strings a and b, allowing only partial matches with b
+double genEditDistance_mod(GedQuery *q, wchar_t *b, int bLen, short isPrefix, short isSuffix){
+    if (isUnitCostSearch(q, bLen)){
+      return myersDistance(getDefaultPattern(q->string, q->len), b, bLen, isPrefix, isSuffix);
+    }
+    DistWindow *w = getDefaultWindow(q->engine);
+    // penalties of skipping a prefix or a suffix of the text are all 0.0
+    double *zeros = windowZeros(w, bLen);
 
-  for(j = 1; j < cols; j++){
-    if(addT->firstNode != NULL)
-      searchFromAddTrie(cols, table, (b + j - 1), 0, j-1);
-    value = table[0][j-1] + add + getPenaltOfChangingPos(-1);   // adding at the beginning of the search string
-    if(value < table[0][j]) table[0][j] = value;
-    for(i = 1; i < rows; i++){
-        if(remT->firstNode != NULL)
-          searchFromRemTrie(cols, table, (a + i-1), i-1 ,j);
-        if(addT->firstNode != NULL)
-          searchFromAddTrie(cols, table, (b + j - 1), i, j-1);
-        if(t->firstNode != NULL)
-          searchFromRepTrie(cols, table, (a + i-1 ), b + j-1 , i-1, j-1);
+    return windowDistance(w, q, b, bLen, 
+                          (isPrefix) ? NULL : zeros, (isSuffix) ? NULL : zeros,
+                          q->edPen, q->genEdPen, DBL_MAX);
+}
 
-        if(a[i-1] == b[j-1]){
-            value = min(table[i-1][j-1],                                      // identity at search string pos i. 
-                    min(table[i][j-1] + add + getPenaltOfChangingPos(i),      // insert after search string pos i. 
-                        table[i-1][j] + rem + getPenaltOfChangingPos(i-1) )); // delete from search string pos i. 
-            if(value < table[i][j]) table[i][j] = value;
-        } else {
-            value = min(table[i-1][j-1] + rep + getPenaltOfChangingPos(i-1),  // replace at search string pos i.
-                        min(table[i][j-1] + add + getPenaltOfChangingPos(i),  // insert after search string pos i. 
-                        table[i-1][j] + rem + getPenaltOfChangingPos(i-1) )); // delete from search string pos i. 
-            if(value < table[i][j]) table[i][j] = value;
-        }
+// Finds generalized edit distance between strings a and b, giving up on cells that exceed the limit
+double genEditDistance_pens_limit(GedQuery *q, wchar_t *b, int bLen, double* start_pen, double* end_pen, double limit){
+  return windowDistance(getDefaultWindow(q->engine), q, b, bLen, start_pen, end_pen, 
+                        q->edPen, q->genEdPen, limit);
+}
 
-        //
-        // NB! The 'add penalty' above { table[i][j-1] + add + getPenaltOfChangingPos(i) } is useful
-        // only when the position i+1 (following position i) is also penalized or if it is the end of word.
-        // If the position i+1 is free (unpenalized), the blocked adding can be still done by replacements
-        // at position i+1 and additions after i+1.
-        //
+// Finds generalized edit distance between strings a and b within the limit, allowing only partial matches with b
+double genEditDistance_mod_limit(GedQuery *q, wchar_t *b, int bLen, short isPrefix, short isSuffix, double limit){
+    if (isUnitCostSearch(q, bLen)){
+      double score = myersDistance(getDefaultPattern(q->string, q->len), b, bLen, isPrefix, isSuffix);
+      return (score <= limit) ? score : DBL_MAX;
     }
-  }
+    DistWindow *w = getDefaultWindow(q->engine);
+    // penalties of skipping a prefix or a suffix of the text are all 0.0
+    double *zeros = windowZeros(w, bLen);
 
-  double score = DBL_MAX;
-  if (end_pen == NULL){
-     score = table[rows-1][cols-1];
-  } else {
-      // Fill the last row with end penalties (penalty of ending match at given pos in text)
-      for(j = 0; j < bLen; j++){
-          double newScore = table[rows-1][j+1] + end_pen[j];
-          if (newScore < score){
-            score = newScore;
-          }
-      }
-  }
-  return score;
+    return windowDistance(w, q, b, bLen, 
+                          (isPrefix) ? NULL : zeros, (isSuffix) ? NULL : zeros,
+                          q->edPen, q->genEdPen, limit);
 }
 
-// Finds generalized edit distance between strings a and b, allowing only partial matches with b
-double genEditDistance_mod(wchar_t *a, wchar_t *b, int aLen, int bLen, short isPrefix, short isSuffix){
-    double prefix[bLen];
-    double suffix[bLen];
-
-    double* prefix_ptr = NULL;
-    double* suffix_ptr = NULL;
+// Finds generalized edit distances of several match types between strings a and b in a single pass
+void genEditDistance_modes_limit(GedQuery *q, wchar_t *b, int bLen, double limit,
+                                 double *full, double *prefix, double *suffix, double *infix){
+    double *start_pen[WINDOW_MAX_VARIANTS];
+    double lastScores[WINDOW_MAX_VARIANTS];
+    double endScores[WINDOW_MAX_VARIANTS];
+    int anchoredV = -1;  // variant of the table starting at the beginning of b
+    int freeV = -1;      // variant of the table starting anywhere in b
+    int nv = 0;
+
+    if (isUnitCostSearch(q, bLen)){
+      int score[FP_MAX_POSITIONS + 1];
+      myersDistances(getDefaultPattern(q->string, q->len), b, bLen, 
+                     (full != NULL)   ? &score[L_FULL]   : NULL,
+                     (prefix != NULL) ? &score[L_PREFIX] : NULL,
+                     (suffix != NULL) ? &score[L_SUFFIX] : NULL,
+                     (infix != NULL)  ? &score[L_INFIX]  : NULL);
+      if(full != NULL)   *full   = (score[L_FULL] <= limit)   ? score[L_FULL]   : DBL_MAX;
+      if(prefix != NULL) *prefix = (score[L_PREFIX] <= limit) ? score[L_PREFIX] : DBL_MAX;
+      if(suffix != NULL) *suffix = (score[L_SUFFIX] <= limit) ? score[L_SUFFIX] : DBL_MAX;
+      if(infix != NULL)  *infix  = (score[L_INFIX] <= limit)  ? score[L_INFIX]  : DBL_MAX;
+      return;
+    }
+    DistWindow *w = getDefaultWindow(q->engine);
+    // penalties of skipping a prefix or a suffix of the text are all 0.0
+    double *zeros = windowZeros(w, bLen);
 
-    int i;
-    if (!isPrefix){
-      for (i = 0; i < bLen; i++) prefix[i] = 0.0;
-      prefix_ptr = prefix;
+    if(full != NULL || prefix != NULL){
+      anchoredV = nv;
+      start_pen[nv++] = NULL;
     }
-    if (!isSuffix){
-      for (i = 0; i < bLen; i++) suffix[i] = 0.0;
-      suffix_ptr = suffix;
+    if(suffix != NULL || infix != NULL){
+      freeV = nv;
+      start_pen[nv++] = zeros;
     }
-
-    return genEditDistance_pens(a, b, aLen, bLen, prefix_ptr, suffix_ptr);
+    if(nv == 0)
+      return;
+    windowDistances(w, q, b, bLen, nv, start_pen, zeros, 
+                    q->edPen, q->genEdPen, limit, lastScores, endScores);
+    if(full != NULL)   *full   = lastScores[anchoredV];
+    if(prefix != NULL) *prefix = endScores[anchoredV];
+    if(suffix != NULL) *suffix = lastScores[freeV];
+    if(infix != NULL)  *infix  = endScores[freeV];
 }
 
 // Finds generalized edit distance between strings a and prefix of b, allows penalizing changes in search string
-double genEditDistance_prefix(wchar_t *a, wchar_t *b, int aLen, int bLen){
-  return genEditDistance_mod(a, b, aLen, bLen, 1, 0);
+double genEditDistance_prefix(GedQuery *q, wchar_t *b, int bLen){
+  return genEditDistance_mod(q, b, bLen, 1, 0);
 }
 
 // Finds generalized edit distance between strings a and suffix of b, allows penalizing changes in search string
-double genEditDistance_suffix(wchar_t *a, wchar_t *b, int aLen, int bLen){
-  return genEditDistance_mod(a, b, aLen, bLen, 0, 1);
+double genEditDistance_suffix(GedQuery *q, wchar_t *b, int bLen){
+  return genEditDistance_mod(q, b, bLen, 0, 1);
 }
 
 // Finds generalized edit distance between strings a and infix of b, allows penalizing changes in search string
-double genEditDistance_middle(wchar_t *a, wchar_t *b, int aLen, int bLen){
-  return genEditDistance_mod(a, b, aLen, bLen, 0, 0);
+double genEditDistance_middle(GedQuery *q, wchar_t *b, int bLen){
+  return genEditDistance_mod(q, b, bLen, 0, 0);
 }
 
 // Finds generalized edit distance between full strings a and b, allows penalizing changes in search string
-double genEditDistance_full(wchar_t *a, wchar_t *b, int aLen, int bLen){
-  return genEditDistance_mod(a, b, aLen, bLen, 1, 1);
+double genEditDistance_full(GedQuery *q, wchar_t *b, int bLen){
+  return genEditDistance_mod(q, b, bLen, 1, 1);
 }
 
 // Prints a view of debug table
 void printTableWithChangingPenalties(
-     wchar_t *a, wchar_t *b, int aLen, int bLen, int rows, int cols, double table[rows][cols]){
+     GedQuery *q, wchar_t *b, int bLen, int rows, int cols, double table[rows][cols]){
+    GedEngine *e = q->engine;
+    wchar_t *a = q->string;
     int i, j;
 
     puts("\n");
@@ -385,20 +751,20 @@ void printTableWithChangingPenalties(
         for(m = 0; m < 3; m++){
             for(j = 0; j < cols; j++){  // in text
               if (i > 0 && j == 0) {
-                  printf( "%5.1f  ", table[i-1][0] + rem + getPenaltOfChangingPos(i-1) );
+                  printf( "%5.1f  ", table[i-1][0] + e->rem + getPenaltOfChangingPos(q, i-1) );
               } else if (i > 0 && j > 0){
                   if (m==0){
                       if(a[i-1] == b[j-1]){
                           printf( "Sme: %5.1f  ",table[i-1][j-1] );
                       } else {
-                          printf( "Rep: %5.1f  ",table[i-1][j-1] + rep + getPenaltOfChangingPos(i-1) );
+                          printf( "Rep: %5.1f  ",table[i-1][j-1] + e->rep + getPenaltOfChangingPos(q, i-1) );
                       }
                   } 
                   else if (m==1){
-                      printf( "Add: %5.1f  ",table[i][j-1]+ add + getPenaltOfChangingPos(i) );
+                      printf( "Add: %5.1f  ",table[i][j-1]+ e->add + getPenaltOfChangingPos(q, i) );
                   } 
                   else if (m==2){
-                      printf( "Rem: %5.1f  ",table[i-1][j] + rem + getPenaltOfChangingPos(i-1) );
+                      printf( "Rem: %5.1f  ",table[i-1][j] + e->rem + getPenaltOfChangingPos(q, i-1) );
                   }
               } else {
                   printf( "%5.1f  ",table[i][j] );
@@ -26,9 +26,13 @@
 
 #include "Trie.h"
 #include "ARTrie.h"
+#include "FrozenTrie.h"
 #include "FileToTrie.h"
 #include "Transformation.h"
 #include "ShowTransformations.h"
+#include "MyersEditDistance.h"
+#include "RuleMatches.h"
+#include "GedEngine.h"
 
 #define min(x,y) (x > y ? y : x)
 
@@ -42,29 +46,90 @@
 #define  L_INFIX    3
 #define  L_SUFFIX   4
 
-// Default values for add, replace and remove operations
-extern double rep;
-extern double rem;
-extern double add;
-// Tries containing generalized edit distance transformations for search
-extern Trie *t;
-extern ARTrie *addT;
-extern ARTrie *remT;
-// Tries containing generalized edit distance transformations for backtracing
-extern Trie *traceT;
-extern ARTrie *traceAddT;
-extern ARTrie *traceRemT;
+// if debug == 1, then debug will be printed
+extern int debug;
 
-extern double lastBest;
+/**
+*   Maximum number of table variants calculated side by side in \c DistWindow .
+*/
+#define WINDOW_MAX_VARIANTS  2
 
-// Mask of penalties for regular edit distance
-extern double *changeSearchStringWithEd_pen;
+/**
+*   Reusable workspace for score-only calculations. Instead of the full 
+*   edit distance table, only a rolling window of its columns is kept: 
+*   the previous column, the current column and the columns that can be 
+*   reached from the previous one with a single transformation (as many as
+*   the longest 'add' transformation or the longest right side of a 'replace'
+*   transformation). 
+*
+*   Columns are stored one after another (column-major), so moving down a
+*   column reads consecutive memory. Column of table position \c [i][j] is
+*   \a cells \c + \c (j \c % \c depth) \c * \a rowCap . Cells that are not
+*   used hold \c DBL_MAX ; only the rows that have been written (up to 
+*   \a dirty[k] in column \c k ) are reset when a column is reused.
+*
+*   Up to \c WINDOW_MAX_VARIANTS variants of the table, which differ only in
+*   the first row, can be calculated side by side: then each row of a column
+*   holds \a variants cells (variant \c v of position \c [i][j] is at the 
+*   index \c i \c * \a variants \c + \c v of the column), and \a dirty and 
+*   \a pushDeep count such indexes instead of rows.
+*/
+typedef struct DistWindow {
+    /** Maximum number of columns a transformation can move forward. */
+    int maxSpan;
+    /** Number of columns in the window ( \a maxSpan \c + \c 1 ). */
+    int depth;
+    /** Number of cells each column can hold. */
+    int rowCap;
+    /** Number of variants of the table calculated side by side. */
+    int variants;
+    double *cells;
+    /** For each column: the last row that has been written. */
+    int *dirty;
+    /** For each column: the deepest row that has received a value within 
+        the \a limit from a generalized edit distance operation. */
+    int *pushDeep;
+    /** The rightmost column that has received a value within the \a limit. */
+    int lastPushCol;
+    /** Values greater than \a limit are not stored in the window. */
+    double limit;
+    /** Array of \a zerosLen 0.0 penalties, for matches that can skip a 
+        prefix or a suffix of the text. */
+    double *zeros;
+    int zerosLen;
+} DistWindow;
 
-// Mask of penalties for generalized edit distance
-extern double *changeSearchStringWithGenEd_pen;
+/**
+*   Creates a new \c DistWindow , deep enough for the transformations of the
+*   engine \a *e , which must be already compiled. Memory under the window 
+*   must be released with \a freeDistWindow() .
+*/
+DistWindow *createDistWindow(GedEngine *e);
 
-// if debug == 1, then debug will be printed
-extern int debug;
+/**
+*   Releases memory under \a *w .
+*/
+void freeDistWindow(DistWindow *w);
+
+/**
+*   Releases the workspaces that are used by default by the score-only methods
+*   ( \a genEditDistance_pens() and its shortcuts, \a genEditDistance() 
+*   with \a transF \c == \c NULL ): the rolling window of the table, the
+*   search string compiled for the bit-parallel calculation and the matches 
+*   of transformations in the text. The workspaces are kept per thread: 
+*   only the workspaces of the calling thread are released.
+*/
+void freeDefaultWorkspaces();
+
+/**
+*   Checks, whether the distance between the search string of \a *q and
+*   a text of length \a bLen is a regular edit distance: there are no generalized edit distance 
+*   transformations, costs of default operations are all 1.0 and no changes
+*   in the search string are penalized. Such distances are calculated by
+*   \a genEditDistance_mod() and its shortcuts with the bit-parallel method
+*   \a myersDistance() .
+*/
+int isUnitCostSearch(GedQuery *q, int bLen);
 
 /**
 *     Inserts \a value in \a table at position \a [row][col], but only
@@ -73,55 +138,59 @@ extern int debug;
 int addValueToTable(int cols, double table[][cols], int row, int col, double value);
 
 /**
-*     Searches for transformations in "remove" trie, which can be applied
+*     Searches for transformations in "remove" trie of the engine of \a *q , which can be applied
 *    from \a table position \c [i][j] onwards. Found transformations are 
 *    applied, if they improve the result: make existing values in table
 *    smaller.
 */
-int searchFromRemTrie(int cols, double table[][cols], wchar_t *string, int i, int j);
+int searchFromRemTrie(GedQuery *q, int cols, double table[][cols], wchar_t *string, int i, int j);
 
 /**
-*     Searches for transformations in "add" trie, which can be applied 
+*     Searches for transformations in "add" trie of the engine of \a *q , which can be applied 
 *    from \a table position \c [i][j] onwards. Found transformations are
 *    applied, if they improve the result: make existing values in table
 *    smaller.
 */
-int searchFromAddTrie(int cols, double table[][cols], wchar_t *string, int i , int j);
+int searchFromAddTrie(GedQuery *q, int cols, double table[][cols], wchar_t *string, int i , int j);
 
 /**
-*     Searches for transformations in "replace" trie, which can be applied
+*     Searches for transformations in "replace" trie of the engine of \a *q , which can be applied
 *    from \a table position \c [i][j] onwards. Found transformations are
 *    applied, if they improve the result: make existing values in table 
 *    smaller.
 */
-int searchFromRepTrie(int cols, double table[][cols], wchar_t *string1, wchar_t *string2, int i, int j);
+int searchFromRepTrie(GedQuery *q, int cols, double table[][cols], wchar_t *string1, wchar_t *string2, int i, int j);
 
 /**
-*    Searches a replacement from list \a *n, which matches a prefix of 
-*    \a *string. For each found match, the replacement is applied, if 
-*    it improves the result: makes existing values in table smaller.
+*    Walks the sub-trie of right sides \a rights of \a *f along \a *string,
+*    finding all the replacements matching a prefix of \a *string. For each 
+*    found match, the replacement is applied, if it improves the result: 
+*    makes existing values in table smaller.
 */
-int findReplacement(int cols, EndNode *n, double table[][cols], wchar_t *string, int i, int j, double value);
+int findReplacement(int cols, FrozenTrie *f, int rights, double table[][cols], wchar_t *string, int i, int j, double value);
 
 /**
 *   Returns a penalty value, which must be added to the cost of changing 
 *   i-th position in the search string with regular edit distance.
 *
+*  \param q compiled search string
 *  \param i position in search string
 */
-double getPenaltOfChangingPos(int i);
+double getPenaltOfChangingPos(GedQuery *q, int i);
 
 /**
 *   Returns a penalty value, which must be added to the cost of changing 
 *   i-th position in the search string with generalized edit distance.
 *
+*  \param q compiled search string
 *  \param i position in search string
 */
-double getPenaltOfChangingPosWithGenEd(int i);
+double getPenaltOfChangingPosWithGenEd(GedQuery *q, int i);
 
 /**
 *   Calculates regular edit distance between strings \a a and \a b.
-*   Cost of every operation is 1.0.
+*   Cost of every operation is 1.0. The bit-parallel method 
+*   \a myersDistance() is used.
 *
 *  \param a search string
 *  \param b text
@@ -131,75 +200,70 @@ double getPenaltOfChangingPosWithGenEd(int i);
 int editDistance(wchar_t* a, wchar_t* b,int aLen, int bLen);
 
 /**
-*   Calculates generalized edit distance between full strings \a a 
+*   Calculates generalized edit distance between full strings \a q->string 
 *   and \a b without applying any penalties.
 *
 *   If \a *transF \c != \c NULL , transformations are backtraced and
 *   stored into \a *transF .
 *
-*  \param a search string
+*  \param q compiled search string
 *  \param b text
-*  \param aLen length of a
 *  \param bLen length of b
 *  \param transF object for storing tracebacks of the transformations
 */
-double genEditDistance(wchar_t *a, wchar_t *b, int aLen, int bLen, Transformations *transF);
+double genEditDistance(GedQuery *q, wchar_t *b, int bLen, Transformations *transF);
 
 /**
 *   (A shortcut method)
-*   Calculates generalized edit distance between string \a a and 
+*   Calculates generalized edit distance between string \a q->string and 
 *   a prefix of string \a b. The method also considers penalties 
 *   of changing the search string.
 *
-*  \param a search string
+*  \param q compiled search string
 *  \param b text
-*  \param aLen length of a
 *  \param bLen length of b
 */
-double genEditDistance_prefix(wchar_t *a, wchar_t *b, int aLen, int bLen);
+double genEditDistance_prefix(GedQuery *q, wchar_t *b, int bLen);
 
 /**
 *   (A shortcut method)
-*   Calculates generalized edit distance between string \a a and 
+*   Calculates generalized edit distance between string \a q->string and 
 *   a suffix of string \a b. The method also considers penalties 
 *   of changing the search string.
 *
-*  \param a search string
+*  \param q compiled search string
 *  \param b text
-*  \param aLen length of a
 *  \param bLen length of b
 */
-double genEditDistance_suffix(wchar_t *a, wchar_t *b, int aLen, int bLen);
+double genEditDistance_suffix(GedQuery *q, wchar_t *b, int bLen);
 
 /**
 *   (A shortcut method)
-*   Calculates generalized edit distance between string \a a and 
+*   Calculates generalized edit distance between string \a q->string and 
 *   an infix of string \a b. The method also considers penalties 
 *   of changing the search string.
 *
-*  \param a search string
+*  \param q compiled search string
 *  \param b text
-*  \param aLen length of a
 *  \param bLen length of b
 */
-double genEditDistance_middle(wchar_t *a, wchar_t *b, int aLen, int bLen);
+double genEditDistance_middle(GedQuery *q, wchar_t *b, int bLen);
 
 /**
 *   (A shortcut method)
-*   Calculates generalized edit distance between full strings \a a and
+*   Calculates generalized edit distance between full strings \a q->string and
 *   \a b. The method is practically same as \a genEditDistance(), only
 *   difference is that penalties of changing the search string are also
 *   considered.
 *
-*  \param a search string
+*  \param q compiled search string
 *  \param b text
-*  \param aLen length of a
 *  \param bLen length of b
 */
-double genEditDistance_full(wchar_t *a, wchar_t *b, int aLen, int bLen);
+double genEditDistance_full(GedQuery *q, wchar_t *b, int bLen);
 
 /**
-*   Calculates generalized edit distance between strings \a a and \a b, 
+*   Calculates generalized edit distance between strings \a q->string and \a b, 
 *   allowing only a partial match with \a b (match can skip a prefix, 
 *   suffix or a circumfix of \a b). For example, if \a isPrefix==1 and 
 *   \a isSuffix==0, then match is calculated only with a prefix of
@@ -212,18 +276,17 @@ double genEditDistance_full(wchar_t *a, wchar_t *b, int aLen, int bLen);
 *   \a genEditDistance_middle(), \a genEditDistance_suffix(),
 *   \a genEditDistance_prefix().
 *
-*  \param a search string
+*  \param q compiled search string
 *  \param b text
-*  \param aLen length of a
 *  \param bLen length of b
 *  \param isPrefix 1 if prefix cannot be skipped, 0 if it can be skipped
 *  \param isSuffix 1 if suffix cannot be skipped, 0 if it can be skipped
 */
-double genEditDistance_mod(wchar_t *a, wchar_t *b, int aLen, int bLen, short isPrefix, short isSuffix);
+double genEditDistance_mod(GedQuery *q, wchar_t *b, int bLen, short isPrefix, short isSuffix);
 
 /**
 *
-*   Calculates generalized edit distance between strings \a a and \a b, 
+*   Calculates generalized edit distance between strings \a q->string and \a b, 
 *   cosidering also penalties. Considers two kinds of penalties: penalties
 *   of changing the text (\a start_pen and \a end_pen) and penalties of 
 *   changing the search string (see \a getPenaltOfChangingPos() and 
@@ -236,23 +299,85 @@ double genEditDistance_mod(wchar_t *a, wchar_t *b, int aLen, int bLen, short isP
 *   to skip a prefix or a suffix of text while matching.
 *   
 *
-*  \param a search string
+*  \param q compiled search string
+*  \param b text
+*  \param bLen length of b
+*  \param start_pen array of length bLen, start_pen[i] shows penalty
+*                   for starting from text b at position i
+*  \param end_pen array of length bLen, end_pen[i] shows penalty for 
+*                 ending in text b at position i
+*/
+double genEditDistance_pens(GedQuery *q, wchar_t *b, int bLen, double* start_pen, double* end_pen);
+
+
+/**
+*   Threshold-aware version of \a genEditDistance_pens(): calculates generalized 
+*   edit distance between strings \a q->string and \a b, but only as long as the result
+*   can still come in under \a limit. 
+*
+*   Cells are filled only down to the row below the deepest cell of the previous
+*   column that is within the limit (Ukkonen's cut-off), extended by removals 
+*   and by values pushed into the column by generalized edit distance operations.
+*   If the match must start at the beginning of the text (\a start_pen == NULL), 
+*   the calculation is abandoned as soon as a column with no value within the 
+*   limit is reached.
+*
+*   Returns the same score as \a genEditDistance_pens(), if the score is less 
+*   than or equal to \a limit, and \c DBL_MAX otherwise.
+*
+*  \param q compiled search string
 *  \param b text
-*  \param aLen length of a
 *  \param bLen length of b
 *  \param start_pen array of length bLen, start_pen[i] shows penalty
 *                   for starting from text b at position i
 *  \param end_pen array of length bLen, end_pen[i] shows penalty for 
 *                 ending in text b at position i
+*  \param limit maximum score of interest
 */
-double genEditDistance_pens(wchar_t *a, wchar_t *b, int aLen, int bLen, double* start_pen, double* end_pen);
+double genEditDistance_pens_limit(GedQuery *q, wchar_t *b, int bLen, double* start_pen, double* end_pen, double limit);
 
+/**
+*   Threshold-aware version of \a genEditDistance_mod(): returns the score, if 
+*   it is less than or equal to \a limit, and \c DBL_MAX otherwise. See also
+*   \a genEditDistance_pens_limit().
+*
+*  \param q compiled search string
+*  \param b text
+*  \param bLen length of b
+*  \param isPrefix 1 if prefix cannot be skipped, 0 if it can be skipped
+*  \param isSuffix 1 if suffix cannot be skipped, 0 if it can be skipped
+*  \param limit maximum score of interest
+*/
+double genEditDistance_mod_limit(GedQuery *q, wchar_t *b, int bLen, short isPrefix, short isSuffix, double limit);
+
+/**
+*   Finds generalized edit distances of several match types (full, prefix, 
+*   suffix and infix, see \a genEditDistance_mod() ) between strings \a q->string and 
+*   \a b in a single pass over the table. The match types differ only in the 
+*   first row (full and prefix matches start at the beginning of \a b ) and in
+*   the reduction of the last row (full and suffix matches end at the end of 
+*   \a b ), so the two variants of the first row are calculated side by side and
+*   both are reduced in two ways. Scores are stored only for match types whose
+*   pointer is not NULL; scores exceeding \a limit are stored as \c DBL_MAX 
+*   ( \a limit \c = \c DBL_MAX for exact scores).
+*
+*  \param q compiled search string
+*  \param b text
+*  \param bLen length of b
+*  \param limit maximum score of interest
+*  \param full score of the full match, or NULL
+*  \param prefix score of the prefix match, or NULL
+*  \param suffix score of the suffix match, or NULL
+*  \param infix score of the infix match, or NULL
+*/
+void genEditDistance_modes_limit(GedQuery *q, wchar_t *b, int bLen, double limit,
+                                 double *full, double *prefix, double *suffix, double *infix);
 
 /**
 *   A debug method for printing generalized edit distance table with some additional
 *   information.
 */
-void printTableWithChangingPenalties( wchar_t *a, wchar_t *b, int aLen, int bLen, 
+void printTableWithChangingPenalties( GedQuery *q, wchar_t *b, int bLen, 
                                       int rows, int cols, double table[rows][cols]);
 
 #endif // FINDEDITDISTMOD_H
@@ -0,0 +1,760 @@
+/*
+*    Copyright (C) 2010 University of Tartu
+*    Authors: Reina Krik, Siim Orasmaa, Kristo Tammeoja, Jaak Vilo
+*    Contact:  siim . orasmaa {at} ut . ee
+*
+*    This file is part of Generalized Edit Distance Tool.
+*
+*    Generalized Edit Distance Tool is free software: you can redistribute 
+*    it and/or modify it under the terms of the GNU General Public License 
+*    as published by the Free Software Foundation, either version 3 of the
+*    License, or (at your option) any later version.
+*
+*    Generalized Edit Distance Tool is distributed in the hope that it will 
+*    be useful, but WITHOUT ANY WARRANTY; without even the implied warranty 
+*    of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*    GNU General Public License for more details.
+*
+*    You should have received a copy of the GNU General Public License
+*    along with Generalized Edit Distance Tool. 
+*    If not, see <http://www.gnu.org/licenses/>.
+*
+*/
+
+#include <stdint.h>
+#include "FrozenTrie.h"
+#include "FileToTrie.h"
+
+// Creates a frozen trie with the root node only
+static FrozenTrie *newFrozenTrie(int nNodes){
+    FrozenTrie *f;
+    int k;
+
+    f = (FrozenTrie *)malloc(sizeof(FrozenTrie));
+    if(f == NULL)
+        abort();
+    f->nodes = (FrozenNode *)malloc(nNodes * sizeof(FrozenNode));
+    if(f->nodes == NULL){
+        puts("Error: Could not allocate memory");
+        exit(1);
+    }
+    f->nNodes = 1;
+    f->maxDepth = 0;
+    f->nRights = 0;
+    f->rights = NULL;
+    f->ends = NULL;
+    f->edits = NULL;
+    f->image = 0;
+    f->nodes[0].label = L'\0';
+    f->nodes[0].parent = -1;
+    f->nodes[0].depth = 0;
+    f->nodes[0].firstChild = 1;
+    f->nodes[0].endChild = 1;
+    f->nodes[0].value = DBL_MAX;
+    f->nodes[0].replacement = NULL;
+    f->nodes[0].rights = -1;
+    for(k = 0; k < FROZEN_ROOT_CHARS; k++)
+        f->rootChild[k] = -1;
+    return f;
+}
+
+// Appends a child to given node (children of a node must be appended one after another)
+static int appendFrozenNode(FrozenTrie *f, int parent, wchar_t label, double value, EndNode *replacement){
+    FrozenNode *n = f->nodes + f->nNodes;
+    n->label = label;
+    n->parent = parent;
+    n->depth = f->nodes[parent].depth + 1;
+    n->firstChild = 0;
+    n->endChild = 0;
+    n->value = value;
+    n->replacement = replacement;
+    n->rights = -1;
+    if(n->depth > f->maxDepth)
+        f->maxDepth = n->depth;
+    f->nodes[parent].endChild = f->nNodes + 1;
+    return f->nNodes++;
+}
+
+// Sorts the children of given node by label, keeping the order of equal labels (insertion sort)
+static void sortFrozenChildren(FrozenTrie *f, int node, void **origin){
+    FrozenNode tmpNode;
+    void *tmpOrigin;
+    int k, l;
+    for(k = f->nodes[node].firstChild + 1; k < f->nodes[node].endChild; k++){
+        tmpNode = f->nodes[k];
+        tmpOrigin = origin[k];
+        for(l = k; l > f->nodes[node].firstChild && f->nodes[l-1].label > tmpNode.label; l--){
+            f->nodes[l] = f->nodes[l-1];
+            origin[l] = origin[l-1];
+        }
+        f->nodes[l] = tmpNode;
+        origin[l] = tmpOrigin;
+    }
+}
+
+// Fills the dense root dispatch table (first of the children with equal labels wins)
+static void fillFrozenRoot(FrozenTrie *f){
+    int k;
+    for(k = f->nodes[0].endChild - 1; k >= f->nodes[0].firstChild; k--)
+        if(f->nodes[k].label >= 0 && f->nodes[k].label < FROZEN_ROOT_CHARS)
+            f->rootChild[f->nodes[k].label] = k;
+}
+
+// Compares right sides a and b of a replacement (by character codes)
+static int compareRights(wchar_t *a, wchar_t *b){
+    while(*a != L'\0' && *a == *b){
+        a++;
+        b++;
+    }
+    return (*a < *b) ? -1 : ((*a > *b) ? 1 : 0);
+}
+
+// Appends a node to the right side sub-tries
+static int appendFrozenRight(FrozenTrie *f, int *cap, int parent, wchar_t label){
+    FrozenRight *n;
+    if(f->nRights == *cap){
+        *cap = (*cap > 0) ? 2 * (*cap) : 64;
+        f->rights = (FrozenRight *)realloc(f->rights, *cap * sizeof(FrozenRight));
+        if(f->rights == NULL){
+            puts("Error: Could not allocate memory");
+            exit(1);
+        }
+    }
+    n = f->rights + f->nRights;
+    n->label = label;
+    n->parent = parent;
+    n->firstChild = 0;
+    n->endChild = 0;
+    n->value = DBL_MAX;
+    n->order = -1;
+    if(parent >= 0)
+        f->rights[parent].endChild = f->nRights + 1;
+    return f->nRights++;
+}
+
+/*
+*   Builds the sub-trie of the nList right sides sorted[0 .. nList-1] (sorted 
+*  by character codes; order[k] is the position of sorted[k] in its EndNode 
+*  list), returns its root. The right sides below each sub-trie node are 
+*  contiguous: those of node k are sorted[lo[k-root] .. hi[k-root]-1], sharing
+*  a prefix of depth[k-root] characters.
+*/
+static int freezeSortedRights(FrozenTrie *f, int *cap, EndNode **sorted, int *order, int nList){
+    int *lo, *hi, *depth;
+    int nNodes = 1;  // at most one node per character of the right sides, plus the root
+    int root, node, k, l, d, start;
+
+    for(k = 0; k < nList; k++)
+        nNodes += wchar_len(sorted[k]->edit);
+    lo     = (int *)malloc(nNodes * sizeof(int));
+    hi     = (int *)malloc(nNodes * sizeof(int));
+    depth  = (int *)malloc(nNodes * sizeof(int));
+    if(lo == NULL || hi == NULL || depth == NULL){
+        puts("Error: Could not allocate memory");
+        exit(1);
+    }
+
+    // breadth-first: children of the node are appended when the node is reached
+    root = appendFrozenRight(f, cap, -1, L'\0');
+    lo[0] = 0;
+    hi[0] = nList;
+    depth[0] = 0;
+    for(node = root; node < f->nRights; node++){
+        k = lo[node - root];
+        d = depth[node - root];
+        f->rights[node].firstChild = f->nRights;
+        f->rights[node].endChild = f->nRights;
+        // the right side ending at the node comes first in the sorted order
+        if(k < hi[node - root] && sorted[k]->edit[d] == L'\0'){
+            f->rights[node].value = sorted[k]->value;
+            f->rights[node].order = order[k];
+            k++;
+        }
+        while(k < hi[node - root]){
+            start = k;
+            while(k < hi[node - root] && sorted[k]->edit[d] == sorted[start]->edit[d])
+                k++;
+            l = appendFrozenRight(f, cap, node, sorted[start]->edit[d]);
+            lo[l - root] = start;
+            hi[l - root] = k;
+            depth[l - root] = d + 1;
+        }
+    }
+    free(lo);
+    free(hi);
+    free(depth);
+    return root;
+}
+
+// Builds the sub-trie of the right sides in the list starting with *list, returns its root
+static int freezeRights(FrozenTrie *f, int *cap, EndNode *list){
+    EndNode **sorted, *tmp;
+    int *order;
+    int nList = 0;
+    int root, k, l;
+
+    for(tmp = list; tmp != NULL; tmp = tmp->nextEN)
+        nList++;
+    sorted = (EndNode **)malloc(nList * sizeof(EndNode *));
+    order  = (int *)malloc(nList * sizeof(int));
+    if(sorted == NULL || order == NULL){
+        puts("Error: Could not allocate memory");
+        exit(1);
+    }
+    // insertion sort (lists are short), remembering positions in the list
+    for(k = 0, tmp = list; tmp != NULL; tmp = tmp->nextEN, k++){
+        for(l = k; l > 0 && compareRights(sorted[l-1]->edit, tmp->edit) > 0; l--){
+            sorted[l] = sorted[l-1];
+            order[l] = order[l-1];
+        }
+        sorted[l] = tmp;
+        order[l] = k;
+    }
+    root = freezeSortedRights(f, cap, sorted, order, nList);
+    free(sorted);
+    free(order);
+    return root;
+}
+
+// Counts nodes of a Trie below (and including) given node and its siblings
+static int countTrieNodes(TrieNode *node){
+    int n = 0;
+    for(; node != NULL; node = node->rightNode)
+        n += 1 + countTrieNodes(node->nextNode);
+    return n;
+}
+
+// Counts nodes of an ARTrie below (and including) given node and its siblings
+static int countARTNodes(ARTNode *node){
+    int n = 0;
+    for(; node != NULL; node = node->rightNode)
+        n += 1 + countARTNodes(node->nextNode);
+    return n;
+}
+
+// Builds the frozen form of a Trie
+void freezeTrie(Trie *trie){
+    FrozenTrie *f;
+    TrieNode **origin;  // original node of each frozen node
+    TrieNode *child;
+    int nNodes, node;
+    int rightCap = 0;
+
+    nNodes = 1 + countTrieNodes(trie->firstNode);
+    f = newFrozenTrie(nNodes);
+    origin = (TrieNode **)malloc(nNodes * sizeof(TrieNode *));
+    if(origin == NULL){
+        puts("Error: Could not allocate memory");
+        exit(1);
+    }
+    // breadth-first: children of the node are appended when the node is reached
+    origin[0] = NULL;
+    for(node = 0; node < f->nNodes; node++){
+        f->nodes[node].firstChild = f->nNodes;
+        f->nodes[node].endChild = f->nNodes;
+        child = (node == 0) ? trie->firstNode : origin[node]->nextNode;
+        for(; child != NULL; child = child->rightNode){
+            origin[f->nNodes] = child;
+            appendFrozenNode(f, node, child->label, DBL_MAX, child->replacement);
+        }
+        sortFrozenChildren(f, node, (void **)origin);
+    }
+    fillFrozenRoot(f);
+    free(origin);
+    for(node = 1; node < f->nNodes; node++)
+        if(f->nodes[node].replacement != NULL)
+            f->nodes[node].rights = freezeRights(f, &rightCap, f->nodes[node].replacement);
+    if(trie->frozen != NULL)
+        freeFrozenTrie(trie->frozen);
+    trie->frozen = f;
+}
+
+// Builds the frozen form of an ARTrie
+void freezeARTrie(ARTrie *art){
+    FrozenTrie *f;
+    ARTNode **origin;  // original node of each frozen node
+    ARTNode *child;
+    int nNodes, node;
+
+    nNodes = 1 + countARTNodes(art->firstNode);
+    f = newFrozenTrie(nNodes);
+    origin = (ARTNode **)malloc(nNodes * sizeof(ARTNode *));
+    if(origin == NULL){
+        puts("Error: Could not allocate memory");
+        exit(1);
+    }
+    // breadth-first: children of the node are appended when the node is reached
+    origin[0] = NULL;
+    for(node = 0; node < f->nNodes; node++){
+        f->nodes[node].firstChild = f->nNodes;
+        f->nodes[node].endChild = f->nNodes;
+        child = (node == 0) ? art->firstNode : origin[node]->nextNode;
+        for(; child != NULL; child = child->rightNode){
+            origin[f->nNodes] = child;
+            appendFrozenNode(f, node, child->label, child->value, NULL);
+        }
+        sortFrozenChildren(f, node, (void **)origin);
+    }
+    fillFrozenRoot(f);
+    free(origin);
+    if(art->frozen != NULL)
+        freeFrozenTrie(art->frozen);
+    art->frozen = f;
+}
+
+/*
+*   Character of the sort key of a transformation at position d: the key is 
+*  the left side, followed by -2 and the right side (for replacements), and
+*  it ends with -1 (below any character, so that prefixes come first).
+*/
+static inline long frozenRuleKey(FrozenRule *r, int d){
+    wchar_t c;
+    if(d < r->len)
+        return r->left[d];
+    if(r->right == NULL)
+        return -1;
+    if(d == r->len)
+        return -2;
+    c = r->right[d - r->len - 1];
+    return (c == L'\0') ? -1 : c;
+}
+
+// Orders transformations sharing the first d characters of their keys, then by position
+static int compareFrozenRulesFrom(FrozenRule *x, FrozenRule *y, int d){
+    long cx, cy;
+    for(;; d++){
+        cx = frozenRuleKey(x, d);
+        cy = frozenRuleKey(y, d);
+        if(cx != cy)
+            return (cx < cy) ? -1 : 1;
+        if(cx == -1)
+            break;
+    }
+    return (x->seq < y->seq) ? -1 : ((x->seq > y->seq) ? 1 : 0);
+}
+
+// Orders transformations by position
+static int compareFrozenRuleSeqs(const void *a, const void *b){
+    int x = (*(FrozenRule * const *)a)->seq;
+    int y = (*(FrozenRule * const *)b)->seq;
+    return (x < y) ? -1 : ((x > y) ? 1 : 0);
+}
+
+/*
+*   Sorts transformations a[0 .. n-1] sharing the first d characters of their
+*  keys: by left side, then by right side, then by position (multikey 
+*  quicksort: the characters at position d are partitioned around a pivot, 
+*  only the equal part moves on to the next position).
+*/
+static void sortFrozenRules(FrozenRule **a, int n, int d){
+    FrozenRule *tmp;
+    long pivot, c, x, y, z;
+    int lt, gt, k, l;
+
+    while(n > 1){
+        if(n < 16){
+            for(k = 1; k < n; k++){
+                tmp = a[k];
+                for(l = k; l > 0 && compareFrozenRulesFrom(a[l-1], tmp, d) > 0; l--)
+                    a[l] = a[l-1];
+                a[l] = tmp;
+            }
+            return;
+        }
+        // median of the first, middle and last character as the pivot
+        x = frozenRuleKey(a[0], d);
+        y = frozenRuleKey(a[n/2], d);
+        z = frozenRuleKey(a[n-1], d);
+        if(x < y)
+            pivot = (y < z) ? y : ((x < z) ? z : x);
+        else
+            pivot = (x < z) ? x : ((y < z) ? z : y);
+        // a[0 .. lt-1] < pivot, a[lt .. gt] == pivot, a[gt+1 .. n-1] > pivot
+        lt = 0;
+        gt = n - 1;
+        k = 0;
+        while(k <= gt){
+            // (the characters of the left sides are fetched directly, this loop is the hot spot)
+            c = (d < a[k]->len) ? a[k]->left[d] : frozenRuleKey(a[k], d);
+            if(c < pivot){
+                tmp = a[k]; a[k] = a[lt]; a[lt] = tmp;
+                lt++;
+                k++;
+            }
+            else if(c > pivot){
+                tmp = a[k]; a[k] = a[gt]; a[gt] = tmp;
+                gt--;
+            }
+            else
+                k++;
+        }
+        sortFrozenRules(a, lt, d);
+        sortFrozenRules(a + gt + 1, n - gt - 1, d);
+        a += lt;
+        n = gt - lt + 1;
+        // equal keys: only the positions are left to order
+        if(pivot == -1){
+            qsort(a, n, sizeof(FrozenRule *), compareFrozenRuleSeqs);
+            return;
+        }
+        d++;
+    }
+}
+
+// Tells whether two replacements have the same left side and the same right side
+static int sameFrozenRule(FrozenRule *x, FrozenRule *y){
+    return x->len == y->len && wmemcmp(x->left, y->left, x->len) == 0 &&
+           compareRights(x->right, y->right) == 0;
+}
+
+// Builds a frozen trie directly from the transformations
+FrozenTrie *buildFrozenTrie(FrozenRule *rules, int n, int replace){
+    FrozenTrie *f;
+    FrozenRule **r;      // the transformations in sorted order
+    FrozenRule *gathered;
+    wchar_t *chars;
+    long long nChars = 0;
+    FrozenRule **first;  // first occurrences of the right sides of a left side, by right side ...
+    FrozenRule **bySeq;  // ... and by position
+    EndNode **sorted;    // their EndNodes, by right side
+    int *order;
+    int *lo, *hi;        // transformations below node k are r[lo[k] .. hi[k]-1]
+    int nNodes = 1;
+    int nEnds = 0;
+    long long nEditChars = 0;
+    int node, depth, k, l, start, nFirst, common;
+    int rightCap = 0;
+    wchar_t *edit;
+
+    // sorted, the left sides sharing a prefix become contiguous
+    r = (FrozenRule **)malloc((n > 0 ? n : 1) * sizeof(FrozenRule *));
+    if(r == NULL){
+        puts("Error: Could not allocate memory");
+        exit(1);
+    }
+    for(k = 0; k < n; k++)
+        r[k] = rules + k;
+    sortFrozenRules(r, n, 0);
+
+    // the transformations (and their strings) are gathered in the sorted 
+    // order, so that the passes below read the memory sequentially
+    for(k = 0; k < n; k++)
+        nChars += rules[k].len + (replace ? wchar_len(rules[k].right) + 1 : 0);
+    gathered = (FrozenRule *)malloc((n > 0 ? n : 1) * sizeof(FrozenRule));
+    chars = (wchar_t *)malloc((nChars > 0 ? nChars : 1) * sizeof(wchar_t));
+    if(gathered == NULL || chars == NULL){
+        puts("Error: Could not allocate memory");
+        exit(1);
+    }
+    nChars = 0;
+    for(k = 0; k < n; k++){
+        gathered[k] = *r[k];
+        gathered[k].left = chars + nChars;
+        wmemcpy(gathered[k].left, r[k]->left, r[k]->len);
+        nChars += r[k]->len;
+        if(replace){
+            gathered[k].right = chars + nChars;
+            wcscpy(gathered[k].right, r[k]->right);
+            nChars += wchar_len(r[k]->right) + 1;
+        }
+        r[k] = gathered + k;
+    }
+
+    // the nodes are counted from the prefixes shared by neighbours
+    for(k = 0; k < n; k++){
+        common = 0;
+        if(k > 0){
+            while(common < r[k]->len && common < r[k-1]->len &&
+                  r[k]->left[common] == r[k-1]->left[common])
+                common++;
+        }
+        nNodes += r[k]->len - common;
+        if(replace && (k == 0 || !sameFrozenRule(r[k-1], r[k]))){
+            nEnds++;
+            nEditChars += wchar_len(r[k]->right) + 1;
+        }
+    }
+    f = newFrozenTrie(nNodes);
+    lo    = (int *)malloc(nNodes * sizeof(int));
+    hi    = (int *)malloc(nNodes * sizeof(int));
+    first  = (FrozenRule **)malloc((n > 0 ? n : 1) * sizeof(FrozenRule *));
+    bySeq  = (FrozenRule **)malloc((n > 0 ? n : 1) * sizeof(FrozenRule *));
+    sorted = (EndNode **)malloc((n > 0 ? n : 1) * sizeof(EndNode *));
+    order  = (int *)malloc((n > 0 ? n : 1) * sizeof(int));
+    if(lo == NULL || hi == NULL || first == NULL || bySeq == NULL || sorted == NULL || order == NULL){
+        puts("Error: Could not allocate memory");
+        exit(1);
+    }
+    if(replace){
+        f->ends  = (EndNode *)malloc((nEnds > 0 ? nEnds : 1) * sizeof(EndNode));
+        f->edits = (wchar_t *)malloc((nEditChars > 0 ? nEditChars : 1) * sizeof(wchar_t));
+        if(f->ends == NULL || f->edits == NULL){
+            puts("Error: Could not allocate memory");
+            exit(1);
+        }
+    }
+    nEnds = 0;
+    edit = f->edits;
+
+    // breadth-first: children of the node are appended when the node is reached
+    lo[0] = 0;
+    hi[0] = n;
+    for(node = 0; node < f->nNodes; node++){
+        k = lo[node];
+        depth = f->nodes[node].depth;
+        f->nodes[node].firstChild = f->nNodes;
+        f->nodes[node].endChild = f->nNodes;
+        // the left sides ending at the node come first in the sorted order
+        start = k;
+        while(k < hi[node] && r[k]->len == depth)
+            k++;
+        if(node > 0 && k > start && !replace){
+            for(l = start; l < k; l++)
+                if(r[l]->value < f->nodes[node].value)
+                    f->nodes[node].value = r[l]->value;
+        }
+        else if(node > 0 && k > start){
+            // duplicates of a right side are neighbours, the first one has the lowest position
+            nFirst = 0;
+            for(l = start; l < k; l++){
+                if(l > start && sameFrozenRule(r[l-1], r[l])){
+                    if(r[l]->value < first[nFirst-1]->value)
+                        first[nFirst-1]->value = r[l]->value;
+                }
+                else
+                    first[nFirst++] = r[l];
+            }
+            memcpy(bySeq, first, nFirst * sizeof(FrozenRule *));
+            qsort(bySeq, nFirst, sizeof(FrozenRule *), compareFrozenRuleSeqs);
+            f->nodes[node].replacement = f->ends + nEnds;
+            for(l = 0; l < nFirst; l++){
+                f->ends[nEnds + l].edit = edit;
+                f->ends[nEnds + l].value = bySeq[l]->value;
+                f->ends[nEnds + l].nextEN = (l + 1 < nFirst) ? f->ends + nEnds + l + 1 : NULL;
+                wcscpy(edit, bySeq[l]->right);
+                edit += wchar_len(bySeq[l]->right) + 1;
+                bySeq[l]->seq = l;  // the position is needed no more, it becomes the position in the list
+            }
+            // the right sides are sorted already, the sub-trie is built right away
+            for(l = 0; l < nFirst; l++){
+                order[l] = first[l]->seq;
+                sorted[l] = f->ends + nEnds + order[l];
+            }
+            f->nodes[node].rights = freezeSortedRights(f, &rightCap, sorted, order, nFirst);
+            nEnds += nFirst;
+        }
+        while(k < hi[node]){
+            start = k;
+            while(k < hi[node] && r[k]->left[depth] == r[start]->left[depth])
+                k++;
+            l = appendFrozenNode(f, node, r[start]->left[depth], DBL_MAX, NULL);
+            lo[l] = start;
+            hi[l] = k;
+        }
+    }
+    fillFrozenRoot(f);
+    free(r);
+    free(gathered);
+    free(chars);
+    free(lo);
+    free(hi);
+    free(first);
+    free(bySeq);
+    free(sorted);
+    free(order);
+    return f;
+}
+
+// Releases memory under the frozen trie
+void freeFrozenTrie(FrozenTrie *f){
+    if(!f->image){
+        free(f->nodes);
+        free(f->rights);
+        free(f->ends);
+        free(f->edits);
+    }
+    free(f);
+}
+
+// Writes the frozen trie into the compiled rule set file
+long long writeFrozenTrie(FILE *out, FrozenTrie *f){
+    FrozenTrieImage h;
+    FrozenNode node;
+    EndNode end, *n;
+    long long at = ftello(out);
+    long long nEditChars = 0;
+    int k, nEnds = 0;
+
+    for(k = 0; k < f->nNodes; k++){
+        for(n = f->nodes[k].replacement; n != NULL; n = n->nextEN){
+            nEnds++;
+            nEditChars += wchar_len(n->edit) + 1;
+        }
+    }
+    memset(&h, 0, sizeof(h));
+    h.nNodes     = f->nNodes;
+    h.maxDepth   = f->maxDepth;
+    h.nRights    = f->nRights;
+    h.nEnds      = nEnds;
+    h.nEditChars = nEditChars;
+    memcpy(h.rootChild, f->rootChild, sizeof(h.rootChild));
+    h.nodes  = at + alignFilePart(sizeof(h));
+    h.rights = h.nodes + alignFilePart((long long)f->nNodes * sizeof(FrozenNode));
+    h.ends   = h.rights + alignFilePart((long long)f->nRights * sizeof(FrozenRight));
+    h.edits  = h.ends + alignFilePart((long long)nEnds * sizeof(EndNode));
+    if(writeFilePart(out, &h, sizeof(h)) != 0)
+        return -1;
+
+    // the lists of the nodes are numbered one after another, in the order of the nodes
+    nEnds = 0;
+    for(k = 0; k < f->nNodes; k++){
+        node = f->nodes[k];
+        if(node.replacement != NULL){
+            node.replacement = (EndNode *)(intptr_t)(nEnds + 1);
+            for(n = f->nodes[k].replacement; n != NULL; n = n->nextEN)
+                nEnds++;
+        }
+        if(fwrite(&node, sizeof(FrozenNode), 1, out) != 1)
+            return -1;
+    }
+    if(writeFilePart(out, NULL, (long long)f->nNodes * sizeof(FrozenNode)) != 0 ||
+       writeFilePart(out, f->rights, (long long)f->nRights * sizeof(FrozenRight)) != 0)
+        return -1;
+    nEnds = 0;
+    nEditChars = 0;
+    for(k = 0; k < f->nNodes; k++){
+        for(n = f->nodes[k].replacement; n != NULL; n = n->nextEN){
+            memset(&end, 0, sizeof(end));
+            end.edit  = (wchar_t *)(intptr_t)nEditChars;
+            end.value = n->value;
+            end.nextEN = (n->nextEN != NULL) ? (EndNode *)(intptr_t)(nEnds + 2) : NULL;
+            if(fwrite(&end, sizeof(EndNode), 1, out) != 1)
+                return -1;
+            nEnds++;
+            nEditChars += wchar_len(n->edit) + 1;
+        }
+    }
+    if(writeFilePart(out, NULL, (long long)nEnds * sizeof(EndNode)) != 0)
+        return -1;
+    for(k = 0; k < f->nNodes; k++)
+        for(n = f->nodes[k].replacement; n != NULL; n = n->nextEN)
+            if(fwrite(n->edit, sizeof(wchar_t), wchar_len(n->edit) + 1, out) != (size_t)(wchar_len(n->edit) + 1))
+                return -1;
+    if(writeFilePart(out, NULL, nEditChars * sizeof(wchar_t)) != 0)
+        return -1;
+    return at;
+}
+
+// Tells whether the arrays of the frozen trie in the compiled rule set are consistent with each other
+static int isFrozenTrieImageValid(FrozenTrieImage *h, char *data){
+    FrozenNode *nodes = (FrozenNode *)(data + h->nodes);
+    FrozenRight *rights = (FrozenRight *)(data + h->rights);
+    EndNode *ends = (EndNode *)(data + h->ends);
+    wchar_t *edits = (wchar_t *)(data + h->edits);
+    intptr_t end;
+    int k, c, maxDepth = 0;
+
+    // nodes: parents come before their children, and the children of a node have it as the parent
+    if(nodes[0].parent != -1 || nodes[0].depth != 0)
+        return 0;
+    for(k = 0; k < h->nNodes; k++){
+        if(k > 0 && (nodes[k].parent < 0 || nodes[k].parent >= k || nodes[k].depth != nodes[nodes[k].parent].depth + 1))
+            return 0;
+        if(nodes[k].firstChild < nodes[k].endChild && (nodes[k].firstChild < 1 || nodes[k].endChild > h->nNodes))
+            return 0;
+        for(c = nodes[k].firstChild; c < nodes[k].endChild; c++)
+            if(nodes[c].parent != k)
+                return 0;
+        if(nodes[k].depth > maxDepth)
+            maxDepth = nodes[k].depth;
+    }
+    if(maxDepth != h->maxDepth)
+        return 0;
+    for(c = 0; c < FROZEN_ROOT_CHARS; c++)
+        if(h->rootChild[c] != -1 && (h->rootChild[c] < 1 || h->rootChild[c] >= h->nNodes || nodes[h->rootChild[c]].parent != 0))
+            return 0;
+    // right side sub-tries: the same for their nodes (roots have no parent), the nodes refer to the roots
+    for(k = 0; k < h->nRights; k++){
+        if(rights[k].parent < -1 || rights[k].parent >= k)
+            return 0;
+        if(rights[k].firstChild < rights[k].endChild && (rights[k].firstChild < 1 || rights[k].endChild > h->nRights))
+            return 0;
+        for(c = rights[k].firstChild; c < rights[k].endChild; c++)
+            if(rights[c].parent != k)
+                return 0;
+    }
+    for(k = 0; k < h->nNodes; k++){
+        if(nodes[k].rights != -1 && (nodes[k].rights < 0 || nodes[k].rights >= h->nRights || rights[nodes[k].rights].parent != -1))
+            return 0;
+        end = (intptr_t)nodes[k].replacement;
+        if(end < 0 || end > h->nEnds)
+            return 0;
+    }
+    // EndNode lists: each element is followed by the next one, and the right sides end with L'\0'
+    for(k = 0; k < h->nEnds; k++){
+        end = (intptr_t)ends[k].nextEN;
+        if((intptr_t)ends[k].edit < 0 || (intptr_t)ends[k].edit >= h->nEditChars || (end != 0 && end != k + 2) || end > h->nEnds)
+            return 0;
+    }
+    return h->nEditChars == 0 || edits[h->nEditChars - 1] == L'\0';
+}
+
+// Creates a frozen trie from the compiled rule set
+FrozenTrie *frozenTrieFromImage(char *data, long long at, long long *from, long long size){
+    FrozenTrieImage *h = (FrozenTrieImage *)(data + at);
+    EndNode *ends;
+    wchar_t *edits;
+    FrozenTrie *f;
+    int k;
+
+    // the parts follow one another, after the ones checked before
+    if(!isFilePart(at, 1, sizeof(FrozenTrieImage), *from, size) || h->nNodes < 1 || h->nRights < 0 || h->nEnds < 0 ||
+       !isFilePart(h->nodes, h->nNodes, sizeof(FrozenNode), at + sizeof(FrozenTrieImage), size) ||
+       !isFilePart(h->rights, h->nRights, sizeof(FrozenRight), h->nodes + (long long)h->nNodes * sizeof(FrozenNode), size) ||
+       !isFilePart(h->ends, h->nEnds, sizeof(EndNode), h->rights + (long long)h->nRights * sizeof(FrozenRight), size) ||
+       !isFilePart(h->edits, h->nEditChars, sizeof(wchar_t), h->ends + (long long)h->nEnds * sizeof(EndNode), size) ||
+       !isFrozenTrieImageValid(h, data))
+        return NULL;
+    *from = h->edits + h->nEditChars * (long long)sizeof(wchar_t);
+    ends  = (EndNode *)(data + h->ends);
+    edits = (wchar_t *)(data + h->edits);
+
+    f = (FrozenTrie *)malloc(sizeof(FrozenTrie));
+    if(f == NULL)
+        abort();
+    f->image    = 1;
+    f->ends     = NULL;
+    f->edits    = NULL;
+    f->nNodes   = h->nNodes;
+    f->maxDepth = h->maxDepth;
+    f->nRights  = h->nRights;
+    f->nodes    = (FrozenNode *)(data + h->nodes);
+    f->rights   = (h->nRights > 0) ? (FrozenRight *)(data + h->rights) : NULL;
+    memcpy(f->rootChild, h->rootChild, sizeof(f->rootChild));
+    // positions are turned into pointers
+    for(k = 0; k < h->nNodes; k++)
+        if(f->nodes[k].replacement != NULL)
+            f->nodes[k].replacement = ends + ((intptr_t)f->nodes[k].replacement - 1);
+    for(k = 0; k < h->nEnds; k++){
+        ends[k].edit = edits + (intptr_t)ends[k].edit;
+        if(ends[k].nextEN != NULL)
+            ends[k].nextEN = ends + ((intptr_t)ends[k].nextEN - 1);
+    }
+    return f;
+}
+
+// Writes the string leading to the node in reversed order
+int frozenReversedString(FrozenTrie *f, int node, wchar_t *s){
+    int len = 0;
+    for(; node > 0; node = f->nodes[node].parent)
+        s[len++] = f->nodes[node].label;
+    return len;
+}
+
+// Writes the right side ending at the sub-trie node in reversed order
+int frozenReversedRight(FrozenTrie *f, int node, wchar_t *s){
+    int len = 0;
+    for(; f->rights[node].parent >= 0; node = f->rights[node].parent)
+        s[len++] = f->rights[node].label;
+    return len;
+}
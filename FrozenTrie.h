@@ -0,0 +1,287 @@
+/*
+*    Copyright (C) 2010 University of Tartu
+*    Authors: Reina Krik, Siim Orasmaa, Kristo Tammeoja, Jaak Vilo
+*    Contact:  siim . orasmaa {at} ut . ee
+*
+*    This file is part of Generalized Edit Distance Tool.
+*
+*    Generalized Edit Distance Tool is free software: you can redistribute 
+*    it and/or modify it under the terms of the GNU General Public License 
+*    as published by the Free Software Foundation, either version 3 of the
+*    License, or (at your option) any later version.
+*
+*    Generalized Edit Distance Tool is distributed in the hope that it will 
+*    be useful, but WITHOUT ANY WARRANTY; without even the implied warranty 
+*    of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*    GNU General Public License for more details.
+*
+*    You should have received a copy of the GNU General Public License
+*    along with Generalized Edit Distance Tool. 
+*    If not, see <http://www.gnu.org/licenses/>.
+*
+*/
+
+#ifndef FROZENTRIE_H
+#define FROZENTRIE_H
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <float.h>
+#include <wchar.h>
+#include "Trie.h"
+#include "ARTrie.h"
+
+/**
+*   Number of characters, for which children of the root of \c FrozenTrie 
+*  are also kept in a plain array (dense root dispatch).
+*/
+#define FROZEN_ROOT_CHARS 256
+
+/**
+*   Node of a right side sub-trie of \c FrozenTrie. All right sides of a 
+*  left side are in a sub-trie of their own, so that a single walk along 
+*  the text finds all the right sides matching it. Children of the node are
+*  nodes \a firstChild .. \a endChild-1 (in the same array), sorted by 
+*  \a label ; \a parent is \c -1 for the root of the sub-trie (which has no
+*  label; it holds the empty right side). If a right side ends at the node,
+*  \a value is the cost of the replacement and \a order is the position of
+*  the right side in the \c EndNode list; otherwise \a value is \c DBL_MAX .
+*/
+typedef struct FrozenRight {
+    wchar_t label;
+    int parent;
+    int firstChild;
+    int endChild;
+    double value;
+    int order;
+} FrozenRight;
+
+/**
+*   Node of \c FrozenTrie. Children of the node are nodes \a firstChild .. 
+*  \a endChild-1 , sorted by \a label ; \a parent and \a depth allow to move 
+*  backwards to the root (as \a prevNode in \c TrieNode and \c ARTNode ). 
+*  Payload of the node is stored next to its label: \a value of an \c ARTrie
+*  node ( \c DBL_MAX if no transformation ends there) and \a replacement of a 
+*  \c Trie node ( \c NULL if no left side ends there). If a left side ends
+*  there, \a rights is the root of the sub-trie of its right sides in 
+*  \c FrozenTrie ( \c -1 otherwise).
+*/
+typedef struct FrozenNode {
+    wchar_t label;
+    int parent;
+    int depth;
+    int firstChild;
+    int endChild;
+    double value;
+    struct EndNode *replacement;
+    int rights;
+} FrozenNode;
+
+/**
+*   Compact, read-only form of \c Trie or \c ARTrie, built after all the 
+*  transformations have been added. All nodes are in a single array in 
+*  breadth-first order, so that children of every node are contiguous; node 
+*  \c 0 is the root (it has no label, first level of the trie are its 
+*  children). For characters below \c FROZEN_ROOT_CHARS , \a rootChild[c] 
+*  is the child of the root with label \c c ( \c -1 if none). \a maxDepth is 
+*  the length of the longest string in the trie. Right side sub-tries of 
+*  all nodes are stored in \a rights ( \a nRights nodes). If the trie has 
+*  been loaded from a compiled rule set, \a image is set: the arrays and 
+*  the \c EndNode lists are parts of the rule set. If the trie has been 
+*  built directly from the transformations (see \a buildFrozenTrie() ), its 
+*  \c EndNode lists are in \a ends and their right sides in \a edits , 
+*  owned by the frozen trie ( \c NULL otherwise: the lists belong to the 
+*  original trie).
+*
+*   Among siblings with equal labels, the one that comes first in the 
+*  original trie is found first, so walks give the same results as in the
+*  original trie.
+*/
+typedef struct FrozenTrie {
+    int nNodes;
+    FrozenNode *nodes;
+    int rootChild[FROZEN_ROOT_CHARS];
+    int maxDepth;
+    int nRights;
+    FrozenRight *rights;
+    struct EndNode *ends;
+    wchar_t *edits;
+    int image;
+} FrozenTrie;
+
+/**
+*   A transformation given to \a buildFrozenTrie() : left side \a *left 
+*  ( \a len characters), right side \a *right ( \c L'\\0' terminated; 
+*  \c NULL for add and remove transformations) and cost \a value . \a seq
+*  is the position of the transformation among the others (the order in 
+*  which they would be added to a trie).
+*/
+typedef struct FrozenRule {
+    wchar_t *left;
+    int len;
+    wchar_t *right;
+    double value;
+    int seq;
+} FrozenRule;
+
+/**
+*   A \c FrozenTrie stored in a compiled rule set file: its sizes and byte 
+*  offsets of its arrays from the beginning of the file (see 
+*  \a writeFrozenTrie() ). The \c EndNode lists of the nodes are stored one
+*  after another in \a ends ( \a nEnds elements), their right sides in 
+*  \a edits ( \a nEditChars characters, each string ending with 
+*  \c L'\\0' ). Pointers are stored as positions: \a replacement of a node 
+*  and \a nextEN of an \c EndNode as the position in \a ends plus \c 1 
+*  ( \c 0 for NULL), \a edit as the position in \a edits .
+*/
+typedef struct FrozenTrieImage {
+    int nNodes;
+    int maxDepth;
+    int nRights;
+    int nEnds;
+    long long nEditChars;
+    int rootChild[FROZEN_ROOT_CHARS];
+    long long nodes;
+    long long rights;
+    long long ends;
+    long long edits;
+} FrozenTrieImage;
+
+/**
+*   Builds the frozen form of \a *trie (replacing the previous one). 
+*   The frozen form is released with the trie and dropped, if new 
+*   transformations are added to the trie.
+*/
+void freezeTrie(Trie *trie);
+
+/**
+*   Builds the frozen form of \a *art (replacing the previous one). 
+*   The frozen form is released with the trie and dropped, if new 
+*   transformations are added to the trie.
+*/
+void freezeARTrie(ARTrie *art);
+
+/**
+*   Builds a frozen trie directly from \a n transformations \a *rules , 
+*   without the linked form: the transformations are sorted and the nodes 
+*   are laid out level by level from the sorted ranges. If \a replace is set, the result is the frozen form of a \c Trie
+*   (right sides are kept in \c EndNode lists), otherwise of an \c ARTrie .
+*   The result is the same as freezing a trie, where the transformations 
+*   have been added one by one in the order of \a seq : the lowest cost of
+*   duplicates is kept and \c EndNode lists are in the order of first 
+*   occurrence. Transformations with an empty left side are left out.
+*/
+FrozenTrie *buildFrozenTrie(FrozenRule *rules, int n, int replace);
+
+/**
+*   Releases memory under \a *f .
+*/
+void freeFrozenTrie(FrozenTrie *f);
+
+/**
+*   Writes \a *f into the compiled rule set file \a *out at its current 
+*   position: a \c FrozenTrieImage followed by the arrays. Returns the byte 
+*   offset of the \c FrozenTrieImage in the file, or \c -1 on error.
+*/
+long long writeFrozenTrie(FILE *out, FrozenTrie *f);
+
+/**
+*   Creates a \c FrozenTrie from the compiled rule set \a *data ( \a size 
+*   bytes mapped into memory as a private copy), where its \c FrozenTrieImage
+*   is at the byte offset \a at . The arrays are used as they are in 
+*   \a *data , only the pointers are set up, so \a *data must stay mapped 
+*   until the trie is released. The trie and its arrays must lie within the
+*   bytes \a *from .. \a size-1 , one after another, and the nodes, right
+*   side sub-tries and \c EndNode lists must refer to each other within 
+*   their arrays: otherwise (e.g. the file has been truncated), \c NULL is
+*   returned. On success, \a *from is set to the end of the arrays.
+*/
+FrozenTrie *frozenTrieFromImage(char *data, long long at, long long *from, long long size);
+
+/**
+*   Returns the frozen form of \a *trie , building it if necessary.
+*/
+static inline FrozenTrie *frozenTrie(Trie *trie){
+    if(trie->frozen == NULL)
+        freezeTrie(trie);
+    return trie->frozen;
+}
+
+/**
+*   Returns the frozen form of \a *art , building it if necessary.
+*/
+static inline FrozenTrie *frozenARTrie(ARTrie *art){
+    if(art->frozen == NULL)
+        freezeARTrie(art);
+    return art->frozen;
+}
+
+/**
+*   Tells whether \a *trie holds no transformations.
+*/
+static inline int isEmptyTrie(Trie *trie){
+    return frozenTrie(trie)->nNodes <= 1;
+}
+
+/**
+*   Tells whether \a *art holds no transformations.
+*/
+static inline int isEmptyARTrie(ARTrie *art){
+    return frozenARTrie(art)->nNodes <= 1;
+}
+
+/**
+*   Returns the child of \a node with label \a c , or -1 if there is none.
+*/
+static inline int frozenChild(FrozenTrie *f, int node, wchar_t c){
+    FrozenNode *n = f->nodes;
+    int lo, hi, mid;
+    if(node == 0 && c >= 0 && c < FROZEN_ROOT_CHARS)
+        return f->rootChild[c];
+    lo = n[node].firstChild;
+    hi = n[node].endChild;
+    while(lo < hi){
+        mid = (lo + hi) / 2;
+        if(n[mid].label < c)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    return (lo < n[node].endChild && n[lo].label == c) ? lo : -1;
+}
+
+/**
+*   Returns the child of right side sub-trie node \a node with label \a c ,
+*   or -1 if there is none.
+*/
+static inline int frozenRightChild(FrozenTrie *f, int node, wchar_t c){
+    FrozenRight *n = f->rights;
+    int lo, hi, mid;
+    lo = n[node].firstChild;
+    hi = n[node].endChild;
+    while(lo < hi){
+        mid = (lo + hi) / 2;
+        if(n[mid].label < c)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    return (lo < n[node].endChild && n[lo].label == c) ? lo : -1;
+}
+
+/**
+*   Writes the right side ending at sub-trie node \a node into \a *s in 
+*   reversed order (starting with the label of \a node ). Returns the length
+*   of the right side.
+*/
+int frozenReversedRight(FrozenTrie *f, int node, wchar_t *s);
+
+/**
+*   Writes the string leading from the root to \a node into \a *s in 
+*   reversed order (starting with the label of \a node ), \a *s must have 
+*   room for \a f->nodes[node].depth characters. Returns the length of the 
+*   string.
+*/
+int frozenReversedString(FrozenTrie *f, int node, wchar_t *s);
+
+#endif
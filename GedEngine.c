@@ -0,0 +1,641 @@
+/*
+*    Copyright (C) 2010 University of Tartu
+*    Authors: Reina Krik, Siim Orasmaa, Kristo Tammeoja, Jaak Vilo
+*    Contact:  siim . orasmaa {at} ut . ee
+*
+*    This file is part of Generalized Edit Distance Tool.
+*
+*    Generalized Edit Distance Tool is free software: you can redistribute 
+*    it and/or modify it under the terms of the GNU General Public License 
+*    as published by the Free Software Foundation, either version 3 of the
+*    License, or (at your option) any later version.
+*
+*    Generalized Edit Distance Tool is distributed in the hope that it will 
+*    be useful, but WITHOUT ANY WARRANTY; without even the implied warranty 
+*    of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*    GNU General Public License for more details.
+*
+*    You should have received a copy of the GNU General Public License
+*    along with Generalized Edit Distance Tool. 
+*    If not, see <http://www.gnu.org/licenses/>.
+*
+*/
+
+#include "GedEngine.h"
+#include "FileToTrie.h"
+
+/**
+*   Indicates, whether debug information will be printed in system output.
+*   If value is 1, then debug information will be printed.
+*/
+int debug = 0;
+
+// Creates a new engine with default costs and empty tries
+GedEngine *createGedEngine(int withTrace){
+    GedEngine *e;
+    e = (GedEngine *)malloc(sizeof(GedEngine));
+    if(e == NULL)
+        abort();
+    e->rep = e->rem = e->add = 1.0;
+    e->t    = createTrie();
+    e->addT = createARTrie();
+    e->remT = createARTrie();
+    e->traceT    = (withTrace) ? createTrie() : NULL;
+    e->traceAddT = (withTrace) ? createARTrie() : NULL;
+    e->traceRemT = (withTrace) ? createARTrie() : NULL;
+    e->caseInsensitive = 0;
+    e->ignoreCase = NULL;
+    e->caseTable = NULL;
+    e->matcher = NULL;
+    e->maxSpan = 1;
+    e->growCost = e->shrinkCost = 0.0;
+    e->hasNegativeCost = 0;
+    e->image = NULL;
+    e->imageSize = 0;
+    e->mirror = NULL;
+    pthread_mutex_init(&e->mirrorLock, NULL);
+    return e;
+}
+
+// Finds the longest right side of replacements stored in the Trie
+static int longestReplacementString(FrozenTrie *f){
+    int longest = 0;
+    int len, node;
+    EndNode *n;
+    for(node = 1; node < f->nNodes; node++){
+        for(n = f->nodes[node].replacement; n != NULL; n = n->nextEN){
+            len = wchar_len(n->edit);
+            if(len > longest) longest = len;
+        }
+    }
+    return longest;
+}
+
+// Finds the maximum number of characters of the text that a single transformation produces (at least 1)
+static int longestSpan(FrozenTrie *t, FrozenTrie *addT){
+    int span = 1;
+    if(addT->maxDepth > span) span = addT->maxDepth;
+    if(longestReplacementString(t) > span) span = longestReplacementString(t);
+    return span;
+}
+
+/*
+*   Finds the smallest costs per character of making the text longer 
+*  ( \a *grow ) and shorter ( \a *shrink ) than the search string, taking
+*  the regular operations as the starting point.
+*/
+static void lengthChangeCosts(GedEngine *e, double *grow, double *shrink){
+    FrozenTrie *f;
+    EndNode *n;
+    int node, diff;
+
+    *grow   = e->add;
+    *shrink = e->rem;
+    f = frozenARTrie(e->addT);
+    for(node = 1; node < f->nNodes; node++)
+        if(f->nodes[node].value != DBL_MAX && f->nodes[node].value / f->nodes[node].depth < *grow)
+            *grow = f->nodes[node].value / f->nodes[node].depth;
+    f = frozenARTrie(e->remT);
+    for(node = 1; node < f->nNodes; node++)
+        if(f->nodes[node].value != DBL_MAX && f->nodes[node].value / f->nodes[node].depth < *shrink)
+            *shrink = f->nodes[node].value / f->nodes[node].depth;
+    f = frozenTrie(e->t);
+    for(node = 1; node < f->nNodes; node++){
+        for(n = f->nodes[node].replacement; n != NULL; n = n->nextEN){
+            diff = wchar_len(n->edit) - f->nodes[node].depth;
+            if(diff > 0 && n->value / diff < *grow)
+                *grow = n->value / diff;
+            if(diff < 0 && n->value / -diff < *shrink)
+                *shrink = n->value / -diff;
+        }
+    }
+    // negative costs give no lower bound
+    if(*grow < 0.0)   *grow = 0.0;
+    if(*shrink < 0.0) *shrink = 0.0;
+}
+
+// Tells whether some operation of the engine (its tries frozen) has a negative cost
+static int hasNegativeCosts(GedEngine *e){
+    FrozenTrie *f;
+    EndNode *n;
+    int node;
+
+    if(e->rep < 0.0 || e->rem < 0.0 || e->add < 0.0)
+        return 1;
+    f = frozenARTrie(e->addT);
+    for(node = 1; node < f->nNodes; node++)
+        if(f->nodes[node].value != DBL_MAX && f->nodes[node].value < 0.0)
+            return 1;
+    f = frozenARTrie(e->remT);
+    for(node = 1; node < f->nNodes; node++)
+        if(f->nodes[node].value != DBL_MAX && f->nodes[node].value < 0.0)
+            return 1;
+    f = frozenTrie(e->t);
+    for(node = 1; node < f->nNodes; node++)
+        for(n = f->nodes[node].replacement; n != NULL; n = n->nextEN)
+            if(n->value < 0.0)
+                return 1;
+    return 0;
+}
+
+// Freezes the tries and builds the parts of the engine depending on all transformations
+void compileGedEngine(GedEngine *e){
+    // a compiled rule set is in its final form already
+    if (e->image != NULL)
+        return;
+
+    // tries built in bulk (see trieFromFile()) are frozen already
+    frozenTrie(e->t);
+    frozenARTrie(e->addT);
+    frozenARTrie(e->remT);
+    if (e->traceT != NULL)
+        frozenTrie(e->traceT);
+    if (e->traceAddT != NULL)
+        frozenARTrie(e->traceAddT);
+    if (e->traceRemT != NULL)
+        frozenARTrie(e->traceRemT);
+
+    if (e->matcher != NULL)
+        freeTextMatcher(e->matcher);
+    e->matcher = createTextMatcher(e->t, e->addT);
+    e->maxSpan = longestSpan(frozenTrie(e->t), frozenARTrie(e->addT));
+    lengthChangeCosts(e, &e->growCost, &e->shrinkCost);
+    e->hasNegativeCost = hasNegativeCosts(e);
+}
+
+// Releases memory under the engine
+void freeGedEngine(GedEngine *e){
+    freeTrie(e->t);
+    freeARTrie(e->addT);
+    freeARTrie(e->remT);
+    if (e->traceT != NULL)
+        freeTrie(e->traceT);
+    if (e->traceAddT != NULL)
+        freeARTrie(e->traceAddT);
+    if (e->traceRemT != NULL)
+        freeARTrie(e->traceRemT);
+    freeCaseTable(e->caseTable);
+    freeIgnoreCaseList(e->ignoreCase);
+    if (e->matcher != NULL)
+        freeTextMatcher(e->matcher);
+    if (e->image != NULL)
+        munmap(e->image, e->imageSize);
+    if (e->mirror != NULL)
+        freeGedEngine(e->mirror);
+    pthread_mutex_destroy(&e->mirrorLock);
+    free(e);
+}
+
+// Tells whether the data is a compiled rule set
+int isRuleImage(char *data, long long size){
+    return size >= 8 && strncmp(data, RULE_IMAGE_MAGIC, 8) == 0;
+}
+
+// Writes the engine into a compiled rule set file
+int writeGedEngineImage(GedEngine *e, const char *path){
+    RuleImageHeader h;
+    FILE *f;
+    int ok;
+
+    if (e->matcher == NULL)
+        compileGedEngine(e);
+    memset(&h, 0, sizeof(h));
+    memcpy(h.magic, RULE_IMAGE_MAGIC, 8);
+    h.version    = RULE_IMAGE_VERSION;
+    h.charSize   = sizeof(wchar_t);
+    h.caseTable  = caseTableStamp(e);
+    h.maxSpan    = e->maxSpan;
+    h.rep        = e->rep;
+    h.rem        = e->rem;
+    h.add        = e->add;
+    h.growCost   = e->growCost;
+    h.shrinkCost = e->shrinkCost;
+
+    if ((f = fopen(path, "wb")) == NULL)
+        return -1;
+    // the header is written again, when the positions of the parts are known
+    ok = writeFilePart(f, &h, sizeof(h)) == 0 &&
+         (h.t = writeFrozenTrie(f, frozenTrie(e->t))) >= 0 &&
+         (h.addT = writeFrozenTrie(f, frozenARTrie(e->addT))) >= 0 &&
+         (h.remT = writeFrozenTrie(f, frozenARTrie(e->remT))) >= 0 &&
+         (e->traceT == NULL || (h.traceT = writeFrozenTrie(f, frozenTrie(e->traceT))) >= 0) &&
+         (e->traceAddT == NULL || (h.traceAddT = writeFrozenTrie(f, frozenARTrie(e->traceAddT))) >= 0) &&
+         (e->traceRemT == NULL || (h.traceRemT = writeFrozenTrie(f, frozenARTrie(e->traceRemT))) >= 0) &&
+         (h.matcher = writeTextMatcher(f, e->matcher)) >= 0;
+    if (ok){
+        h.size = ftello(f);
+        ok = fseeko(f, 0, SEEK_SET) == 0 && fwrite(&h, sizeof(h), 1, f) == 1;
+    }
+    if (fclose(f) != 0 || !ok)
+        return -1;
+    return 0;
+}
+
+// Replaces the frozen form of the trie with one from the compiled rule set
+static void attachFrozenTrie(FrozenTrie **frozen, FrozenTrie *f){
+    if (*frozen != NULL)
+        freeFrozenTrie(*frozen);
+    *frozen = f;
+}
+
+// Tells whether the right sides of the replacements are patterns of the automaton, if they are longer than one character
+static int hasReplacementPatterns(FrozenTrie *f, TextMatcher *m){
+    EndNode *n;
+    int node;
+    for (node = 1; node < f->nNodes; node++)
+        for (n = f->nodes[node].replacement; n != NULL; n = n->nextEN)
+            if (n->edit[0] != L'\0' && n->edit[1] != L'\0' && findTextPattern(m, n->edit) < 0)
+                return 0;
+    return 1;
+}
+
+// Loads the transformations of the engine from the compiled rule set
+int gedEngineFromImage(GedEngine *e, char *data, long long size){
+    RuleImageHeader *h = (RuleImageHeader *)data;
+    int needed[6] = { 1, 1, 1, e->traceT != NULL, e->traceAddT != NULL, e->traceRemT != NULL };
+    FrozenTrie *tries[6] = { NULL };
+    TextMatcher *matcher = NULL;
+    long long from = sizeof(RuleImageHeader);
+    int k, valid;
+
+    if (size < (long long)sizeof(RuleImageHeader) || !isRuleImage(data, size)){
+        fprintf(stderr, "The compiled rule set is truncated or damaged\n");
+        return -1;
+    }
+    // tries for backtracing are needed only if the engine has them
+    if (h->version != RULE_IMAGE_VERSION || h->charSize != sizeof(wchar_t) || h->caseTable != caseTableStamp(e) ||
+        (e->traceT != NULL && h->traceT == 0) || (e->traceAddT != NULL && h->traceAddT == 0) ||
+        (e->traceRemT != NULL && h->traceRemT == 0)){
+        fprintf(stderr, "The compiled rule set was built on another platform or "
+                        "with a different ignore case file\n");
+        return -1;
+    }
+    // the parts follow one another in the order of the header; all of them are checked before the engine uses them
+    long long offsets[6] = { h->t, h->addT, h->remT, h->traceT, h->traceAddT, h->traceRemT };
+    valid = (h->size == size);
+    for (k = 0; valid && k < 6; k++)
+        if (needed[k])
+            valid = (tries[k] = frozenTrieFromImage(data, offsets[k], &from, size)) != NULL;
+    valid = valid && (matcher = textMatcherFromImage(data, h->matcher, from, size)) != NULL &&
+            hasReplacementPatterns(tries[0], matcher) && h->maxSpan == longestSpan(tries[0], tries[1]);
+    if (!valid){
+        for (k = 0; k < 6; k++)
+            if (tries[k] != NULL)
+                freeFrozenTrie(tries[k]);
+        if (matcher != NULL)
+            freeTextMatcher(matcher);
+        fprintf(stderr, "The compiled rule set is truncated or damaged\n");
+        return -1;
+    }
+    e->rep = h->rep;
+    e->rem = h->rem;
+    e->add = h->add;
+    e->maxSpan    = h->maxSpan;
+    e->growCost   = h->growCost;
+    e->shrinkCost = h->shrinkCost;
+    attachFrozenTrie(&e->t->frozen, tries[0]);
+    attachFrozenTrie(&e->addT->frozen, tries[1]);
+    attachFrozenTrie(&e->remT->frozen, tries[2]);
+    if (e->traceT != NULL)
+        attachFrozenTrie(&e->traceT->frozen, tries[3]);
+    if (e->traceAddT != NULL)
+        attachFrozenTrie(&e->traceAddT->frozen, tries[4]);
+    if (e->traceRemT != NULL)
+        attachFrozenTrie(&e->traceRemT->frozen, tries[5]);
+    if (e->matcher != NULL)
+        freeTextMatcher(e->matcher);
+    e->matcher = matcher;
+    e->image = data;
+    e->imageSize = size;
+    e->hasNegativeCost = hasNegativeCosts(e);
+    return 0;
+}
+
+/* 
+*   Extracts blocked regions from given search string, fills masks 
+*  \a q->edPen and \a q->genEdPen with penalty information and removes 
+*  blocked region symbols from the search string. Returns a pointer to the
+*  search string, where blocked region symbols are already removed (the 
+*  given string is released, if it was changed).
+*
+*  \param *q the query receiving the masks of penalties
+*  \param *searchString pointer to the search string. The search string 
+*                       can contain blocked regions;
+*  \param *searchStringLen length of the \a searchString (including symbols
+*                          indicating blocked regions);
+*  \return pointer to the modified search string (blocked regions removed);
+*/
+static wchar_t *extractBlockedRegions(GedQuery *q, wchar_t *searchString, int *searchStringLen){
+    int i;
+    // =============================================================
+    //    Find actual length of the search string
+    //    (do not count blocked region symbols)
+    // =============================================================
+    int wlen = 0;  // real string length
+    for (i = 0; i < *searchStringLen; i++){
+        if (searchString[i] != '(' && searchString[i] != ')' &&
+            searchString[i] != '<' && searchString[i] != '>'){
+            wlen++;
+        }
+    }
+    // Proceed only if there were any blocked regions ...
+    if (0 < wlen && wlen < *searchStringLen){
+        // Create arrays (masks) for penalties
+        q->edPen    = malloc((wlen + 2) * sizeof(double));
+        q->genEdPen = malloc((wlen + 2) * sizeof(double));
+        if (q->edPen != NULL && q->genEdPen != NULL){
+            /* Initialize masks with null penalty at each position */
+            for (i = 0; i < wlen+2; i++){
+                q->edPen[i]    = 0.0;
+                q->genEdPen[i] = 0.0;
+            }
+            // =============================================================
+            //  Mark down unchangable/blocked regions of the search string
+            // =============================================================
+            int no_eDist_allowed     = 0;
+            int no_genEdDist_allowed = 0;
+            int penVectorPos     = 1;
+            for (i = 0; i < *searchStringLen; i++){
+                if (searchString[i] == '(' || searchString[i] == '<'){
+                    // beginning of a region
+                    if (i == 1 && (no_eDist_allowed == 1 || no_genEdDist_allowed == 1)){
+                        // double symbols at the beginning of the string: block changes
+                        // (addings) to the beginning
+                        q->edPen[0] = CHANGE_PENALT;
+                        if (searchString[i] == '<'){
+                            q->genEdPen[0] = CHANGE_PENALT;
+                        }
+                    } else {
+                        // Start a new region
+                        if (searchString[i] == '('){
+                           no_eDist_allowed = 1;
+                        }
+                        if (searchString[i] == '<'){
+                           no_genEdDist_allowed = 1;
+                        }
+                    }
+                } else if (searchString[i] == ')' || searchString[i] == '>'){
+                    // ending of a region
+                    if (i == (*searchStringLen - 1)){
+                        if (i - 1 >= 0 && (searchString[i-1] == ')' || searchString[i-1] == '>')){
+                            // double symbols at the end of the string: block changes
+                            // (addings) to the end
+                            q->edPen[wlen + 1] = CHANGE_PENALT;
+                            if (searchString[i] == '>'){
+                                q->genEdPen[wlen + 1] = CHANGE_PENALT;
+                            }
+                        }
+                    } else {
+                        // end a region
+                        if (searchString[i] == ')'){
+                            no_eDist_allowed     = 0;
+                        }
+                        if (searchString[i] == '>'){
+                            no_genEdDist_allowed = 0;
+                        }
+                    }
+                } else {
+                    // in the middle of a region: make "unchangable"
+                    if (no_eDist_allowed == 1){
+                        q->edPen[penVectorPos] = CHANGE_PENALT;
+                    }
+                    if (no_genEdDist_allowed == 1){
+                        q->edPen[penVectorPos]    = CHANGE_PENALT;
+                        q->genEdPen[penVectorPos] = CHANGE_PENALT;
+                    }
+                    penVectorPos++;
+                }
+            }
+            // =============================================================
+            //    Remove region symbols from the search string
+            // =============================================================
+            wchar_t *newSearchString;
+            /* malloc the necessary space */
+            if ((newSearchString = (wchar_t *)malloc((wlen + 1) * sizeof(wchar_t))) == NULL){
+                puts("Error: Could not allocate memory");
+                exit(1);
+            }
+            /* copy values from the old string */
+            int searchStringPos = 0;
+            for (i = 0; i < *searchStringLen; i++){
+               if (searchString[i] != '(' && searchString[i] != ')' &&
+                   searchString[i] != '<' && searchString[i] != '>'){
+                   newSearchString[searchStringPos] = searchString[i];
+                   searchStringPos++;
+               }
+            }
+            /* ensure NULL-termination */
+            newSearchString[wlen] = L'\0';
+            /* replace old string, update length variable */
+            free(searchString);
+            searchString = newSearchString;
+            *searchStringLen = wlen;
+        } else {
+            puts("Error: Could not allocate memory");
+            exit(1);
+        }
+    }
+    //for (i = 0; i < *searchStringLen+2; i++){
+    //   printf("--- %f %f \n", q->edPen[i], q->genEdPen[i]);
+    //}
+    return searchString;
+}
+
+// Finds an identifier of the 'ignore case' list of the engine
+unsigned int caseTableStamp(GedEngine *e){
+    IgnoreCaseListElement *el;
+    unsigned int stamp = 2166136261u;
+    wchar_t *c;
+
+    if(!e->caseInsensitive)
+        return 0;
+    // FNV-1a hash of the transformations of the list, each string ending with 0
+    for(el = e->ignoreCase; el != NULL; el = el->next){
+        for(c = el->left; ; c++){
+            stamp = (stamp ^ (unsigned int)*c) * 16777619u;
+            if(*c == L'\0') break;
+        }
+        for(c = el->right; ; c++){
+            stamp = (stamp ^ (unsigned int)*c) * 16777619u;
+            if(*c == L'\0') break;
+        }
+    }
+    return (stamp == 0) ? 1 : stamp;
+}
+
+// Compiles the search string for the engine
+GedQuery *createGedQuery(GedEngine *e, wchar_t *string, int len, int blockChanges){
+    GedQuery *q;
+
+    q = (GedQuery *)malloc(sizeof(GedQuery));
+    if(q == NULL)
+        abort();
+    q->engine = e;
+    q->edPen = NULL;
+    q->genEdPen = NULL;
+    q->string = copy_wchar_t(string, len);
+    q->len = len;
+
+    /* extract blocked regions and create mask of penalties */
+    if (blockChanges == 1  &&  q->len > 0)
+        q->string = extractBlockedRegions(q, q->string, &q->len);
+    if (e->caseInsensitive)
+        makeStringToIgnoreCase(e, q->string, q->len);
+    if (e->matcher == NULL)
+        compileGedEngine(e);
+    q->matches = createQueryMatches(q->string, q->len, e->t, e->addT, e->remT, e->matcher);
+    return q;
+}
+
+// Releases memory under the query
+void freeGedQuery(GedQuery *q){
+    free(q->string);
+    if (q->edPen != NULL)
+        free(q->edPen);
+    if (q->genEdPen != NULL)
+        free(q->genEdPen);
+    freeQueryMatches(q->matches);
+    free(q);
+}
+
+// Finds the range of text lengths, outside of which full matches score above the limit
+void fullMatchLengths(GedQuery *q, double limit, int *minLen, int *maxLen){
+    GedEngine *e = q->engine;
+    // leave room for rounding errors of the scores
+    double slack = (limit < 0.0) ? 0.0 : limit + 1e-9 * (1.0 + limit);
+    double chars;
+
+    *minLen = 0;
+    *maxLen = INT_MAX;
+    // a negative cost can make up for any change of the length
+    if(e->hasNegativeCost)
+        return;
+    // the number of characters, by which the length can change within the limit
+    if(e->growCost > 0.0){
+        chars = slack / e->growCost;
+        if(chars < (double)(INT_MAX - q->len))
+            *maxLen = q->len + (int)chars;
+    }
+    if(e->shrinkCost > 0.0){
+        chars = slack / e->shrinkCost;
+        if(chars < (double)q->len)
+            *minLen = q->len - (int)chars;
+    }
+}
+
+/*
+*   Stores the transformation ending at \a node of \a f (with the right side 
+*  \a n , if it is a 'replace' transformation) into \a r , both sides reversed
+*  into \a at . Returns the position following the strings in \a at .
+*/
+static wchar_t *mirrorRule(FrozenTrie *f, int node, EndNode *n, FrozenRule *r, wchar_t *at){
+    int k, p;
+
+    // going up from the node, the labels spell the left side reversed
+    r->left = at;
+    r->len  = f->nodes[node].depth;
+    for (p = node; p > 0; p = f->nodes[p].parent)
+        *at++ = f->nodes[p].label;
+    *at++ = L'\0';
+    r->right = NULL;
+    r->value = f->nodes[node].value;
+    if (n != NULL){
+        r->right = at;
+        for (k = wchar_len(n->edit) - 1; k >= 0; k--)
+            *at++ = n->edit[k];
+        *at++ = L'\0';
+        r->value = n->value;
+    }
+    return at;
+}
+
+// Builds a frozen trie of the transformations of the frozen trie f, with both sides reversed
+static FrozenTrie *mirrorFrozenTrie(FrozenTrie *f, int replace){
+    FrozenRule *rules;
+    FrozenTrie *m;
+    EndNode *n;
+    wchar_t *chars, *at;
+    long long nChars = 0;
+    int nRules = 0;
+    int node;
+
+    // a transformation per right side of a 'replace' node, or per node ending an 'add' or 'remove' transformation
+    for (node = 1; node < f->nNodes; node++){
+        if (replace){
+            for (n = f->nodes[node].replacement; n != NULL; n = n->nextEN){
+                nRules++;
+                nChars += f->nodes[node].depth + wchar_len(n->edit) + 2;
+            }
+        } else if (f->nodes[node].value != DBL_MAX){
+            nRules++;
+            nChars += f->nodes[node].depth + 1;
+        }
+    }
+    rules = (FrozenRule *)malloc((nRules > 0 ? nRules : 1) * sizeof(FrozenRule));
+    chars = (wchar_t *)malloc((nChars > 0 ? nChars : 1) * sizeof(wchar_t));
+    if (rules == NULL || chars == NULL){
+        puts("Error: Could not allocate memory");
+        exit(1);
+    }
+    at = chars;
+    nRules = 0;
+    for (node = 1; node < f->nNodes; node++){
+        if (replace){
+            for (n = f->nodes[node].replacement; n != NULL; n = n->nextEN){
+                at = mirrorRule(f, node, n, &rules[nRules], at);
+                rules[nRules].seq = nRules;
+                nRules++;
+            }
+        } else if (f->nodes[node].value != DBL_MAX){
+            at = mirrorRule(f, node, NULL, &rules[nRules], at);
+            rules[nRules].seq = nRules;
+            nRules++;
+        }
+    }
+    m = buildFrozenTrie(rules, nRules, replace);
+    free(rules);
+    free(chars);
+    return m;
+}
+
+// Returns the engine with the transformations mirrored, building it on first use
+GedEngine *mirroredGedEngine(GedEngine *e){
+    GedEngine *m;
+
+    pthread_mutex_lock(&e->mirrorLock);
+    if (e->mirror == NULL){
+        if (e->matcher == NULL)
+            compileGedEngine(e);
+        m = createGedEngine(0);
+        m->rep = e->rep;
+        m->rem = e->rem;
+        m->add = e->add;
+        m->t->frozen    = mirrorFrozenTrie(frozenTrie(e->t), 1);
+        m->addT->frozen = mirrorFrozenTrie(frozenARTrie(e->addT), 0);
+        m->remT->frozen = mirrorFrozenTrie(frozenARTrie(e->remT), 0);
+        compileGedEngine(m);
+        e->mirror = m;
+    }
+    pthread_mutex_unlock(&e->mirrorLock);
+    return e->mirror;
+}
+
+// Compiles the search string reversed, for the mirrored engine
+GedQuery *createMirroredQuery(GedQuery *q){
+    GedQuery *m;
+    wchar_t *reversed;
+
+    if (q->edPen != NULL || q->engine->hasNegativeCost)
+        return NULL;
+    reversed = reverseWchar(q->string, q->len);
+    m = createGedQuery(mirroredGedEngine(q->engine), reversed, q->len, 0);
+    free(reversed);
+    return m;
+}
+
+// Raises the limit by room for rounding errors of the scores of a mirrored query
+double mirroredLimit(double limit){
+    if (limit == DBL_MAX)
+        return DBL_MAX;
+    return limit + 1e-9 * (1.0 + ((limit < 0.0) ? -limit : limit));
+}
@@ -0,0 +1,287 @@
+/*
+*    Copyright (C) 2010 University of Tartu
+*    Authors: Reina Krik, Siim Orasmaa, Kristo Tammeoja, Jaak Vilo
+*    Contact:  siim . orasmaa {at} ut . ee
+*
+*    This file is part of Generalized Edit Distance Tool.
+*
+*    Generalized Edit Distance Tool is free software: you can redistribute 
+*    it and/or modify it under the terms of the GNU General Public License 
+*    as published by the Free Software Foundation, either version 3 of the
+*    License, or (at your option) any later version.
+*
+*    Generalized Edit Distance Tool is distributed in the hope that it will 
+*    be useful, but WITHOUT ANY WARRANTY; without even the implied warranty 
+*    of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*    GNU General Public License for more details.
+*
+*    You should have received a copy of the GNU General Public License
+*    along with Generalized Edit Distance Tool. 
+*    If not, see <http://www.gnu.org/licenses/>.
+*
+*/
+
+#ifndef GEDENGINE_H
+#define GEDENGINE_H
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <float.h>
+#include <limits.h>
+#include <wchar.h>
+#include <pthread.h>
+#include "Trie.h"
+#include "ARTrie.h"
+#include "FrozenTrie.h"
+#include "List.h"
+#include "RuleMatches.h"
+
+/** 
+ *   A penalty value that is used in the masks of penalties of \c GedQuery 
+ *  ( \a edPen and \a genEdPen ) to block changes. 
+ */
+#define CHANGE_PENALT  3000.0 
+
+/**
+*   Everything a generalized edit distance search needs to know about the
+*  transformations, independent of the search string:
+*    -- \a rep , \a rem , \a add : costs of regular edit distance operations;
+*    -- \a t , \a addT , \a remT : tries containing generalized edit distance 
+*       'replace', 'add' and 'remove' transformations for search. Separate 
+*       tries for 'add' and 'remove' make look-up more efficient: no need to
+*       browse through the 'replace' tree in order to find suitable ones;
+*    -- \a traceT , \a traceAddT , \a traceRemT : tries containing the same 
+*       transformations for backtracing, so strings (both sides of 'replace'
+*       transformations) are reversed in them ( \c NULL , if alignments are 
+*       not required);
+*    -- \a caseInsensitive , \a ignoreCase : whether the search is case 
+*       insensitive, and the list of upper-case to lower-case transformations
+*       used to make it so. If some element is inserted into the list 
+*       several times, only the first one will be ever used during the search;
+*       \a caseTable : the list compiled for look-ups (see \a CaseTable ,
+*       \c NULL if the list has not been read);
+*    -- \a matcher : automaton of the strings produced by 'add' and 'replace' 
+*       operations, and \a maxSpan : the maximum number of characters of the
+*       text that a single transformation produces (at least 1); both are 
+*       built by \a compileGedEngine() ;
+*    -- \a growCost , \a shrinkCost : the smallest cost per character of 
+*       making the text longer or shorter than the search string (by 'add' 
+*       operations and longer right sides of 'replace' operations, or by 
+*       'remove' operations and shorter right sides; \c 0 if there is no 
+*       lower bound), also built by \a compileGedEngine() ;
+*    -- \a hasNegativeCost : whether some operation has a negative cost, so
+*       that scores can decrease along the table: cells above a limit can 
+*       still lead to scores within it, and nothing can be left out by the 
+*       limit (set by \a compileGedEngine() and \a gedEngineFromImage() );
+*    -- \a image , \a imageSize : the compiled rule set that the engine has 
+*       been loaded from (see \a gedEngineFromImage() ), NULL otherwise;
+*    -- \a mirror : the engine with the transformations mirrored (see 
+*       \a mirroredGedEngine() ), built on first use under \a mirrorLock 
+*       ( \c NULL until then).
+*   The engine is read-only once the transformations have been loaded, so
+*  several searches can use the same engine at once.
+*/
+typedef struct GedEngine {
+    double rep;
+    double rem;
+    double add;
+    Trie *t;
+    ARTrie *addT;
+    ARTrie *remT;
+    Trie *traceT;
+    ARTrie *traceAddT;
+    ARTrie *traceRemT;
+    int caseInsensitive;
+    IgnoreCaseListElement *ignoreCase;
+    CaseTable *caseTable;
+    TextMatcher *matcher;
+    int maxSpan;
+    double growCost;
+    double shrinkCost;
+    int hasNegativeCost;
+    char *image;
+    long long imageSize;
+    struct GedEngine *mirror;
+    pthread_mutex_t mirrorLock;
+} GedEngine;
+
+/**
+*   A search string compiled for a \c GedEngine : the string \a string of 
+*  length \a len (blocked region symbols removed, made case insensitive, if
+*  required), the matches of the transformations in it ( \a matches ) and the
+*  masks of penalties for changing it (both \c NULL , if no changes are 
+*  blocked). The size of a mask is \c len+2 and positions of the mask indicate
+*  following penalties:
+*  <br>
+*  \c edPen[i] - a penalty for changing char at position \c (i-1) in the 
+*                search string;<br>
+*  \c edPen[0] - a penalty for adding a character at the beginning of the 
+*                search string;<br>
+*  \c edPen last element - a penalty for adding a character at the end of 
+*                the search string;<br>
+*  \a edPen holds penalties of regular edit distance operations, \a genEdPen
+*  penalties of generalized edit distance operations. The query is read-only
+*  once created.
+*/
+typedef struct GedQuery {
+    GedEngine *engine;
+    wchar_t *string;
+    int len;
+    double *edPen;
+    double *genEdPen;
+    QueryMatches *matches;
+} GedQuery;
+
+/**
+*   Creates a new engine with default costs 1.0 and empty tries (also tries 
+*   for backtracing, if \a withTrace is set). Transformations are loaded via 
+*   \a trieFromFile() . Memory under the engine must be released with 
+*   \a freeGedEngine() .
+*/
+GedEngine *createGedEngine(int withTrace);
+
+/**
+*   Freezes the tries of \a e and builds the parts of the engine that depend
+*   on all of the transformations ( \a matcher , \a maxSpan ). Must be called
+*   after the transformations have been loaded.
+*/
+void compileGedEngine(GedEngine *e);
+
+/**
+*   Releases memory under \a e , its tries and its 'ignore case' list.
+*/
+void freeGedEngine(GedEngine *e);
+
+/**
+*   Magic bytes at the beginning of a compiled rule set file, and the version
+*  of the layout of the file.
+*/
+#define RULE_IMAGE_MAGIC    "\177GEDRULE"
+#define RULE_IMAGE_VERSION  1
+
+/**
+*   Header of a compiled rule set: a \c GedEngine stored into a file (flag
+*  "--compile-rules"), so that it can be used right after mapping the file 
+*  into memory, without parsing the transformations and building the tries.
+*  \a charSize is \c sizeof(wchar_t) of the platform that built it and
+*  \a caseTable identifies the 'ignore case' list that the transformations
+*  have been made case insensitive with (see \a caseTableStamp() ). The costs
+*  and \a maxSpan , \a growCost and \a shrinkCost are those of \c GedEngine .
+*  Frozen tries \a t , \a addT , \a remT (and the ones for backtracing) and 
+*  the \a matcher are given by byte offsets of their images from the 
+*  beginning of the file (see \c FrozenTrieImage , \c TextMatcherImage ).
+*  \a size is the size of the whole file in bytes.
+*/
+typedef struct RuleImageHeader {
+    char magic[8];
+    int version;
+    int charSize;
+    unsigned int caseTable;
+    int maxSpan;
+    double rep;
+    double rem;
+    double add;
+    double growCost;
+    double shrinkCost;
+    long long size;
+    long long t;
+    long long addT;
+    long long remT;
+    long long traceT;
+    long long traceAddT;
+    long long traceRemT;
+    long long matcher;
+} RuleImageHeader;
+
+/**
+*   Tells whether \a data (the contents of a file, \a size bytes) is a 
+*   compiled rule set.
+*/
+int isRuleImage(char *data, long long size);
+
+/**
+*   Writes the engine \a e (compiled, with tries for backtracing) into the 
+*   compiled rule set file \a path . Returns \c 0 on success, \c -1 if the
+*   file cannot be written ( \a errno tells why).
+*/
+int writeGedEngineImage(GedEngine *e, const char *path);
+
+/**
+*   Loads the transformations of the engine \a e (created with empty tries,
+*   its 'ignore case' list read already) from the compiled rule set \a data ,
+*   ( \a size bytes mapped into memory as a private copy): the engine uses 
+*   the tries and the automaton as they are in \a data , and releases the 
+*   mapping with itself. Returns \c 0 , or \c -1 and prints the reason to
+*   \c stderr , if the rule set has been compiled on another platform or 
+*   with a different 'ignore case' list (see \a caseTableStamp() ), or it is
+*   damaged: the header must tell the size of the file, and the tries and the
+*   automaton must lie within the file and be consistent (see 
+*   \a frozenTrieFromImage() and \a textMatcherFromImage() ). The engine is
+*   left unchanged in that case.
+*/
+int gedEngineFromImage(GedEngine *e, char *data, long long size);
+
+/**
+*   Returns an identifier of the 'ignore case' list of \a e ( \c 0 if the 
+*   search is not case insensitive). Strings of dictionary images and compiled
+*   rule sets are made case insensitive beforehand, so they cannot be used 
+*   with an engine with a different list.
+*/
+unsigned int caseTableStamp(GedEngine *e);
+
+/**
+*   Compiles the search string \a string of length \a len for the engine
+*   \a e . If \a blockChanges is set (flag "-e"), characters '(', ')', '<' 
+*   and '>' surround blocked regions of the string: they are removed, and 
+*   the masks of penalties are created. Contents of \a string is copied. 
+*   Memory under the query must be released with \a freeGedQuery() .
+*/
+GedQuery *createGedQuery(GedEngine *e, wchar_t *string, int len, int blockChanges);
+
+/**
+*   Releases memory under \a q .
+*/
+void freeGedQuery(GedQuery *q);
+
+/**
+*   Finds the range of text lengths \a *minLen .. \a *maxLen , outside of
+*   which a full match with the search string of \a q always scores above
+*   \a limit (the length of the text differs from the length of the search
+*   string by too many characters, see \a growCost and \a shrinkCost of 
+*   \c GedEngine ). Penalties of blocked regions only add to the scores, so
+*   the range holds for them too. \a *maxLen is \c INT_MAX , if longer 
+*   texts are never ruled out. If some operation has a negative cost (see 
+*   \a hasNegativeCost ), no length is ruled out.
+*/
+void fullMatchLengths(GedQuery *q, double limit, int *minLen, int *maxLen);
+
+/**
+*   Returns the engine with the transformations of \a e mirrored: both sides
+*   of each transformation reversed (as in the tries for backtracing), so
+*   that reversed strings score with it as the strings themselves score with
+*   \a e . The mirrored engine is built on first use and released with 
+*   \a e ; its strings are not made case insensitive again.
+*/
+GedEngine *mirroredGedEngine(GedEngine *e);
+
+/**
+*   Compiles the search string of \a q reversed, for the mirrored engine of
+*   its engine (see \a mirroredGedEngine() ): a suffix match of \a q in a 
+*   text is a prefix match of the mirrored query in the reversed text. 
+*   Returns \c NULL , if \a q has blocked regions (the masks of penalties 
+*   cannot be mirrored: an addition is penalized as a change of the 
+*   character following it), or if its engine has negative costs (the 
+*   mirrored query is for searching the trie of the reversed lines, see
+*   \a isTrieSearchable() ; the mirrored engine is not built then). Memory
+*   under the query must be released with \a freeGedQuery() .
+*/
+GedQuery *createMirroredQuery(GedQuery *q);
+
+/**
+*   Returns \a limit raised by room for rounding errors: scores of a mirrored
+*   query sum the same costs in the reverse order, so they can differ from
+*   the scores of the query in the last bits. \c DBL_MAX is kept as it is.
+*/
+double mirroredLimit(double limit);
+
+#endif
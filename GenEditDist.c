@@ -28,305 +28,529 @@
 #include <locale.h>
 #include <wctype.h>
 #include <unistd.h>  /* For parsing command line args. */
+#include <getopt.h>  /* For parsing long options. */
+#include <pthread.h> /* For scanning the dictionary in several threads. */
 
 #include "FindEditDistanceMod.h"  /* Methods for calculating generalized edit distance. */
 #include "ShowTransformations.h"  /* Methods for backtracing and printing transformations. */
+#include "BatchEditDistance.h"    /* Calculating generalized edit distances for several words at once. */
+#include "Dictionary.h"           /* Reading and decoding lines of the dictionary file. */
+#include "SearchServer.h"         /* Serving searches over a Unix domain socket. */
 
 /**
-*  Default cost for the 'replace' operation in regular edit distance.
+*   Maximum number of threads scanning the dictionary (flag '-t'). The limit
+*   is fixed (not taken from the number of processors), so that the same
+*   command line is accepted on every machine.
 */
-double rep = 1;
-/**
-*   Default cost for the 'remove' operation in regular edit distance.
-*/
-double rem = 1;
+#define MAX_THREADS 256
+
 /**
-*   Default cost for the 'add' operation in regular edit distance.
+*   Indicates, whether line number of every found match will be printed.
+*   It can be used only in the maximum edit distance search mode (flag '-m').
+*   The line number will be match's line number in the input dictionary, 
+*   starting count from 0.
 */
-double add = 1;
+int printLineNumbers = 0;
 
+/** 
+*  Indicates, whether changes in some substrings of the search string should
+*  be blocked. If value == 1 (flag '-e' set), then blocking is on and 
+*  characters '(', ')', '<'  and '>' have special meaning in the search string:
+*  they surround blocked substrings. Blocking is applied via assigning high 
+*  edit distance penalties for changes inside given regions 
+*  (see \a edPen and \a genEdPen of \c GedQuery );
+*/
+int blockChangesInSearchString = 0;
 
 /**
-*    Trie for 'replace' operations in generalized edit distance; 
-*
-*    Used for search;
+*   Indicates, whether alignments with the search string should be printed
+*   for each found match ( \a printAlignments=1 for printing the alignments ).
+*   With the current implementation, the alignments are printed only under the 
+*   following conditions:
+*      -- the mode is the maximum edit distance search (flag '-m' set);
+*      -- blocked regions are disabled (flad '-e' not set);
+*      -- only full-extent match is used (flags '-p', '-i', '-s' not set);
 */
-Trie *t;
+int printAlignments = 0;
+
 /**
-*    Trie for 'add' operations in generalized edit distance; Separate 
-*    tries for 'add' and 'remove' make look-up more efficient: no need
-*    to browse through the 'replace' tree in order to find suitable 
-*    transformations.
-*
-*    Used for search;
-*/
-ARTrie *addT;
-/** 
-*    Trie for 'remove' operations in generalized edit distance; Separate 
-*    tries for 'add' and 'remove' make look-up more efficient: no need 
-*    to browse through the 'replace' tree in order to find suitable 
-*    transformations.
-*
-*    Used for search;
+*   Indicates, whether transformation weights should be output while printing 
+*   the alignments ( \a printAlignments=1 ). If \a printAlignTransfWeights=1 ,
+*   then transformation weights are also printed.
 */
-ARTrie *remT;
+int printAlignTransfWeights = 0;
 
+/**
+*   Indicates, whether pretty-printing mode should be used while printing 
+*   the alignments ( \a printAlignments=1 ). If \a printAlignmentsPretty=1 ,
+*   then pretty-printing mode is used ( strings are padded with spaces in 
+    order to better visualise the alignment ).
+*/
+int printAlignmentsPretty = 0;
 
 /**
-*    Trie for 'replace' operations in generalized edit distance;
-*
-*    Used for backtracing the transformations, so, compared to \a *t ,
-*    'left'-sides of the transformations are reversed in this trie.
+*   A match of the maximum edit distance search: the line number \a line 
+*  (counted from the beginning of the \a DictChunk , or from the beginning of 
+*  the file, if the dictionary has been decoded already), byte offsets \a start 
+*  and \a end of the line in the file, and scores of the line for each match
+*  type (indexed by the type, \c DBL_MAX for types that are not calculated).
 */
-Trie *traceT = NULL;
+typedef struct DictMatch {
+    long line;
+    int start;
+    int end;
+    double scores[FP_MAX_POSITIONS + 1];
+} DictMatch;
+
 /**
-*    Trie for 'add' operations in generalized edit distance;
-*
-*    Used for backtracing the transformations, so, compared to \a *addT ,
-*    strings are reversed in this trie.
+*   A part of the dictionary file, from the byte offset \a from up to \a to (or, 
+*  if the dictionary has been decoded already into \a dict , from the line \a from 
+*  up to \a to ; if only some lines of \a dict are scanned, \a from and \a to are 
+*  positions in the list of their numbers \a lines ; if the lines are searched in 
+*  the trie \a trie of \a dict , \a from and \a to are nodes of the trie, see 
+*  \a splitDictionaryTrie() ), scanned by a single thread with \a scan . The settings of the search are given in 
+*  \a query , and either \a editD and \a flagsInPositions 
+*  (the maximum edit distance search, \a flag is the match type searched in the
+*  trie) or \a best and \a flag (the TOP N search). Suffix matches are searched in 
+*  the trie of the reversed lines as prefix matches of \a mirrored (the query 
+*  mirrored, see \a createMirroredQuery() ) within \a mirrorLimit , and scored 
+*  again with \a query . The results of the scan are:
+*    -- \a nLines : number of the lines scanned;
+*    -- \a bad : byte offset of the line that could not be converted into a 
+*       wide-character string ( \c -1 if all lines were converted), the 
+*       scan stops before that line;
+*    -- \a matches ( \a nMatches elements) : matches of the maximum edit 
+*       distance search, in the order of the file;
+*    -- \a top : best matches of the TOP N search;
 */
-ARTrie *traceAddT = NULL;
+typedef struct DictChunk {
+    char *file;
+    DecodedDictionary *dict;
+    int *lines;
+    DictionaryTrie *trie;
+    void *(*scan)(void *);
+    int from;
+    int to;
+    GedQuery *query;
+    GedQuery *mirrored;
+    double mirrorLimit;
+    double editD;
+    char *flagsInPositions;
+    int best;
+    char flag;
+    long nLines;
+    int bad;
+    DictMatch *matches;
+    int nMatches;
+    int matchCap;
+    TopList *top;
+} DictChunk;
+
 /**
-*    Trie for 'replace' operations in generalized edit distance;
-*
-*    Used for backtracing the transformations, so, compared to \a *remT ,
-*    strings are reversed in this trie.
+*  Splits the first \a datalen bytes of \a file into \a n parts of about equal 
+*  size, starting each part at the beginning of a line; if \a dict \c != \c NULL ,
+*  splits the lines of \a dict into \a n parts of about equal number of lines
+*  instead (only the \a nLines lines listed in \a lines , if \a lines \c != 
+*  \c NULL ). Returns an array of \a n chunks (some of them can be empty), memory 
+*  under the array must be released afterwards.
 */
-ARTrie *traceRemT = NULL;
+DictChunk *splitDictionary(char *file, int datalen, DecodedDictionary *dict, int *lines, int nLines, int n){
+    DictChunk *chunks;
+    int k, from, to;
 
+    if(dict != NULL && lines == NULL)
+        nLines = dict->n;
+
+    chunks = (DictChunk *)calloc(n, sizeof(DictChunk));
+    if(chunks == NULL){
+        puts("Error: Could not allocate memory");
+        exit(1);
+    }
+    from = 0;
+    for(k = 0; k < n; k++){
+        chunks[k].file = file;
+        chunks[k].dict = dict;
+        chunks[k].lines = lines;
+        chunks[k].bad  = -1;
+        if(dict != NULL){
+            // lines following the last decoded one are never scanned
+            chunks[k].from = (int)((long long)nLines * k / n);
+            chunks[k].to   = (int)((long long)nLines * (k+1) / n);
+            if(k == n-1)
+                chunks[k].bad = dict->bad;
+            continue;
+        }
+        to = (k == n-1) ? datalen : (int)((long long)datalen * (k+1) / n);
+        if(to < from)
+            to = from;
+        while(to < datalen && to > 0 && file[to-1] != '\n')
+            to++;
+        chunks[k].from = from;
+        chunks[k].to   = to;
+        from = to;
+    }
+    return chunks;
+}
 
 /**
-*   First element of the ignore case list. The list contains upper-case
-*  to lower-case transformations that are used to make the search case 
-*  insensitive. One should note the following: if some element already 
-*  exists in the list, but it is reinserted into the list, the reinserted 
-*  one is added to the end of list, however, only the first element will 
-*  be ever used during the search.
+*  Scans the chunk \a arg ( \a DictChunk ) in a thread of its own, and releases the
+*  default workspaces of the thread afterwards.
 */
-IgnoreCaseListElement *ignoreCase;
+void *scanChunkThread(void *arg){
+    DictChunk *chunk = (DictChunk *)arg;
+    chunk->scan(chunk);
+    freeDefaultWorkspaces();
+    return NULL;
+}
 
 /**
-*   Indicates, whether case insensitive search mode is used or not. If
-*   value is 1, then case insensitive search is used. Transformations 
-*   between lower-case and upper-case characters are given in a separate 
-*   file.
+*  Runs \a scan on each of the \a n chunks, the chunks are scanned in parallel
+*  threads. The first chunk is scanned by the calling thread, which keeps its
+*  default workspaces for the next scans.
 */
-int caseInsensitiveMode = 0;
+void scanChunks(DictChunk *chunks, int n, void *(*scan)(void *)){
+    pthread_t *ids;
+    int k;
+
+    for(k = 0; k < n; k++)
+        chunks[k].scan = scan;
+
+    ids = (pthread_t *)malloc(n * sizeof(pthread_t));
+    if(ids == NULL){
+        puts("Error: Could not allocate memory");
+        exit(1);
+    }
+    for(k = 1; k < n; k++){
+        if(pthread_create(&ids[k], NULL, scanChunkThread, &chunks[k]) != 0){
+            puts("Error: Could not create a thread");
+            exit(1);
+        }
+    }
+    scan(&chunks[0]);
+    for(k = 1; k < n; k++)
+        pthread_join(ids[k], NULL);
+    free(ids);
+}
 
 /**
-*   Generalized edit distance of the last best match. Used only in Top N 
-*   search mode (flag "-b") for memorizing the last best result in the list 
-*   of best results.
+*  Returns the number of the line of the decoded dictionary at the position \a i 
+*  of \a chunk .
 */
-double lastBest;
+static inline int chunkLine(DictChunk *chunk, int i){
+    return (chunk->lines != NULL) ? chunk->lines[i] : i;
+}
 
 /**
-*   Indicates, whether debug information will be printed in system output.
-*   If value is 1, then debug information will be printed.
+*  Reads the next block of lines of \a chunk , starting from the position \a i , into 
+*  \a block (see \a readLineBlock() ). Returns the position following the last line
+*  read. If the dictionary of the chunk is decoded already, the strings of \a block 
+*  belong to the dictionary, otherwise they are decoded into the buffer of \a block .
 */
-int debug = 0;
+int readChunkBlock(DictChunk *chunk, int i, LineBlock *block){
+    DecodedDictionary *dict = chunk->dict;
+    int line;
+
+    if(dict == NULL)
+        return readLineBlock(chunk->query->engine, chunk->file, chunk->to, i, block);
+    block->n = 0;
+    while(i < chunk->to && block->n < LINE_BLOCK_SIZE){
+        line = chunkLine(chunk, i);
+        block->start[block->n] = dict->start[line];
+        block->end[block->n]   = dict->end[line];
+        block->words[block->n] = dict->words[line];
+        block->lens[block->n]  = dict->lens[line];
+        block->n++;
+        i++;
+    }
+    return i;
+}
 
 /**
-*   Indicates, whether line number of every found match will be printed.
-*   It can be used only in the maximum edit distance search mode (flag '-m').
-*   The line number will be match's line number in the input dictionary, 
-*   starting count from 0.
+*  Stores the line \a line of \a chunk (see \c DictMatch ), with the string \a text
+*  of length \a wLen at the byte offsets \a start .. \a end of the file, into 
+*  \a matches of the chunk, if at least one of its match types scores within 
+*  \c editD . \a scores holds the scores of the line found by the scan, indexed by the
+*  type ( \c DBL_MAX for the types that were left out, see \a scanDistances() ); 
+*  the types set in \a exact have exact scores, the others only if they are within
+*  \c editD : the scores of the line that are not exact are calculated in full.
 */
-int printLineNumbers = 0;
+static void collectDistanceMatch(DictChunk *chunk, long line, int start, int end, wchar_t *text, int wLen,
+                                 double scores[FP_MAX_POSITIONS + 1], char exact[FP_MAX_POSITIONS + 1]){
+    char *flagsInPositions = chunk->flagsInPositions;
+    GedQuery *q = chunk->query;
+    double editD = chunk->editD;
+    double fullED = scores[L_FULL];
+    double prefED = scores[L_PREFIX];
+    double suffED = scores[L_SUFFIX];
+    double infxED = scores[L_INFIX];
+    DictMatch *match;
+    int pos;
+    char flag;
+
+    // an empty line has no prefix nor infix matches, so its full and suffix scores are
+    // not bounded by them: the scores that were left out are calculated in any case
+    if(!(fullED <= editD || prefED <= editD || suffED <= editD || infxED <= editD) && wLen > 0)
+        return;
+
+    // the match will be output with all of its scores: calculate the scores 
+    // that were left out or exceeded editD in full (unless they are exact already)
+    pos = 0;
+    while ((pos < FP_MAX_POSITIONS) && (flagsInPositions[pos] != L_EMPTY)){
+        flag = flagsInPositions[pos++];
+        if (exact[(int)flag])
+            continue;
+        switch (flag){
+            case L_FULL:
+                 if (fullED > editD)
+                     fullED = genEditDistance_full(q, text, wLen);
+                 break;
+            case L_PREFIX:
+                 if (prefED > editD)
+                     prefED = genEditDistance_prefix(q, text, wLen);
+                 break;
+            case L_SUFFIX:
+                 if (suffED > editD)
+                     suffED = genEditDistance_suffix(q, text, wLen);
+                 break;
+            case L_INFIX:
+                 if (infxED > editD)
+                     infxED = genEditDistance_middle(q, text, wLen);
+                 break;
+        }
+    }
+    if(!(fullED <= editD || prefED <= editD || suffED <= editD || infxED <= editD))
+        return;
+
+    if(chunk->nMatches == chunk->matchCap){
+        chunk->matchCap = (chunk->matchCap == 0) ? 64 : 2 * chunk->matchCap;
+        chunk->matches = (DictMatch *)realloc(chunk->matches, chunk->matchCap * sizeof(DictMatch));
+        if(chunk->matches == NULL){
+            perror("Memory");
+            exit(1);
+        }
+    }
+    match = &chunk->matches[chunk->nMatches++];
+    match->line  = line;
+    match->start = start;
+    match->end   = end;
+    match->scores[L_EMPTY]  = DBL_MAX;
+    match->scores[L_FULL]   = fullED;
+    match->scores[L_PREFIX] = prefED;
+    match->scores[L_SUFFIX] = suffED;
+    match->scores[L_INFIX]  = infxED;
+}
 
-/** 
-*  Indicates, whether changes in some substrings of the search string should
-*  be blocked. If value == 1 (flag '-e' set), then blocking is on and 
-*  characters '(', ')', '<'  and '>' have special meaning in the search string:
-*  they surround blocked substrings. Blocking is applied via assigning high 
-*  edit distance penalties for changes inside given regions 
-*  (see \a changeSearchStringWithEd_pen and \a changeSearchStringWithGenEd_pen );
+/**
+*  Scans the lines of the chunk \a arg ( \a DictChunk ) for the maximum edit 
+*  distance search: finds all the scores of the lines that have at least one
+*  match type scoring <i>less than or equal to</i> \c editD , and stores them
+*  into \a matches of the chunk. A score of an infix match is never greater 
+*  than the scores of prefix and suffix matches, and these are never greater
+*  than the score of the full match, so only the least restricted match types
+*  are scored for each line; the others are calculated for matching lines only.
 */
-int blockChangesInSearchString = 0;
+void *scanDistances(void *arg){
+    DictChunk *chunk = (DictChunk *)arg;
+    char *flagsInPositions = chunk->flagsInPositions;
+    GedQuery *q = chunk->query;
+    double editD = chunk->editD;
+    int i = chunk->from;
+    int first, k, pos, t;
+    LineBlock block;
+    BatchProfile *batch = NULL;
+    // scores of the lines in the block, for each match type (indexed by the type)
+    double scores[FP_MAX_POSITIONS + 1][LINE_BLOCK_SIZE];
+    double *typeScores[FP_MAX_POSITIONS + 1] = { NULL };
+    double lineScores[FP_MAX_POSITIONS + 1];
+    // the batch calculation gives exact scores of the types it scans
+    char exact[FP_MAX_POSITIONS + 1] = { 0 };
+
+    initLineBlock(&block);
+    if(!isUnitCostSearch(q, 1))
+        batch = createBatchProfile(q);
+    pos = 0;
+    while ((pos < FP_MAX_POSITIONS) && (flagsInPositions[pos] != L_EMPTY)){
+        typeScores[(int)flagsInPositions[pos]] = scores[(int)flagsInPositions[pos]];
+        pos++;
+    }
+    // match types bounded from below by another required type are left out of the scan
+    if(typeScores[L_INFIX] != NULL)
+        typeScores[L_PREFIX] = typeScores[L_SUFFIX] = NULL;
+    if(typeScores[L_PREFIX] != NULL || typeScores[L_SUFFIX] != NULL || typeScores[L_INFIX] != NULL)
+        typeScores[L_FULL] = NULL;
+    for(t = L_FULL; t <= FP_MAX_POSITIONS; t++)
+        exact[t] = batch != NULL && typeScores[t] != NULL;
+
+    while(i < chunk->to){
+        first = i;
+        i = readChunkBlock(chunk, i, &block);
+        if(block.n == 0){
+            chunk->bad = i;
+            break;
+        }
 
-/** 
-*   Array of penalties that will be applied on changing the search string with 
-*  regular edit distance operations. The size of array is \c |searchString|+2 
-*  and positions of the array indicate following penalties:
-*  <br>
-*  \c changeSearchStringWithEd_pen[i] - a penalty for changing char at position 
-*                                       \c (i-1) in the search string;<br>
-*  \c changeSearchStringWithEd_pen[0] - a penalty for adding a character at the 
-*                                       beginning of the search string;<br>
-*  \c changeSearchStringWithEd_pen last element - a penalty for adding a character 
-*                                                 at the end of the search string;<br>
- */
-double *changeSearchStringWithEd_pen = NULL;
+        // find the least restricted types of matches, according to flagsInPositions, all in a single pass
+        scoreLineBlock(&block, batch, q, editD, 
+                       typeScores[L_FULL], typeScores[L_PREFIX], typeScores[L_SUFFIX], typeScores[L_INFIX]);
 
-/** 
-*   Array of penalties that will be applied on changing the search string 
-*  with generalized edit distance operations. The size of array and penalty
-*  positions are as same as described in \a changeSearchStringWithEd_pen .
+        for(k = 0; k < block.n; k++, chunk->nLines++){
+            for(t = L_FULL; t <= FP_MAX_POSITIONS; t++)
+                lineScores[t] = (typeScores[t] != NULL) ? typeScores[t][k] : DBL_MAX;
+            collectDistanceMatch(chunk, (chunk->dict != NULL) ? chunkLine(chunk, first + k) : chunk->nLines,
+                                 block.start[k], block.end[k], block.words[k], block.lens[k], lineScores, exact);
+        }
+    }
+    freeLineBlock(&block);
+    freeBatchProfile(batch);
+    return NULL;
+}
+
+/**
+*  Splits the trie \a trie of the dictionary \a dict (of the file \a file ) into \a n 
+*  chunks with about equal numbers of lines (see \a splitDictionaryTrie() ). Returns
+*  an array of \a n chunks, memory under the array must be released afterwards.
 */
-double *changeSearchStringWithGenEd_pen = NULL;
+DictChunk *splitTrieChunks(char *file, DecodedDictionary *dict, DictionaryTrie *trie, int n){
+    DictChunk *chunks;
+    int *bounds;
+    int k;
+
+    chunks = (DictChunk *)calloc(n, sizeof(DictChunk));
+    bounds = (int *)malloc((n + 1) * sizeof(int));
+    if(chunks == NULL || bounds == NULL){
+        puts("Error: Could not allocate memory");
+        exit(1);
+    }
+    splitDictionaryTrie(trie, n, bounds);
+    for(k = 0; k < n; k++){
+        chunks[k].file = file;
+        chunks[k].dict = dict;
+        chunks[k].trie = trie;
+        chunks[k].from = bounds[k];
+        chunks[k].to   = bounds[k+1];
+        chunks[k].bad  = -1;
+    }
+    // lines following the last decoded one are never searched
+    chunks[n-1].bad = dict->bad;
+    free(bounds);
+    return chunks;
+}
 
+/**
+*  Receives the scores of a line of the dictionary found in its trie, for the maximum
+*  edit distance search of the chunk \a arg ( \a DictChunk ): only the score of the 
+*  match type \a flag of the chunk has been calculated.
+*/
+static void trieDistanceScores(void *arg, int line, double full, double prefix){
+    DictChunk *chunk = (DictChunk *)arg;
+    DecodedDictionary *dict = chunk->dict;
+    double scores[FP_MAX_POSITIONS + 1] = { DBL_MAX, DBL_MAX, DBL_MAX, DBL_MAX, DBL_MAX };
+    char exact[FP_MAX_POSITIONS + 1] = { 0 };
+
+    scores[(int)chunk->flag] = (chunk->flag == L_PREFIX) ? prefix : full;
+    collectDistanceMatch(chunk, line, dict->start[line], dict->end[line], dict->words[line], dict->lens[line],
+                         scores, exact);
+}
 
-/** 
- *   A penalty value that is used in arrays \a changeSearchStringWithEd_pen and 
- *  \a changeSearchStringWithGenEd_pen to block changes. 
- */
-#define CHANGE_PENALT  3000.0 
+/**
+*  Searches the nodes of the chunk \a arg ( \a DictChunk ) in the trie of the dictionary
+*  for the maximum edit distance search: as \a scanDistances() , but the least restricted
+*  match type (full or prefix, \a flag of the chunk) is scored for the lines sharing a 
+*  prefix together. The matches are stored in the order of the trie.
+*/
+void *searchTrieDistances(void *arg){
+    DictChunk *chunk = (DictChunk *)arg;
+    TrieWorkspace ws;
+
+    initTrieWorkspace(&ws);
+    searchDictionaryTrie(chunk->trie, chunk->from, chunk->to, chunk->query, &chunk->editD, 
+                         chunk->flag == L_PREFIX, trieDistanceScores, NULL, chunk, &ws);
+    freeTrieWorkspace(&ws);
+    return NULL;
+}
 
 /**
-*   Indicates, whether alignments with the search string should be printed
-*   for each found match ( \a printAlignments=1 for printing the alignments ).
-*   With the current implementation, the alignments are printed only under the 
-*   following conditions:
-*      -- the mode is the maximum edit distance search (flag '-m' set);
-*      -- blocked regions are disabled (flad '-e' not set);
-*      -- only full-extent match is used (flags '-p', '-i', '-s' not set);
+*  Finds the exact suffix score of the line \a line of the dictionary of \a chunk ,
+*  found in the trie of the reversed lines with the scores \a full and \a prefix
+*  of the mirrored query (see \a createMirroredQuery() ), if it can be within 
+*  \a limit : the prefix score of the reversed line is the suffix score, up to 
+*  rounding (an empty line has its full score only). Returns \c DBL_MAX otherwise.
 */
-int printAlignments = 0;
+static double mirroredSuffixScore(DictChunk *chunk, int line, double full, double prefix, double limit){
+    DecodedDictionary *dict = chunk->dict;
+    double score = DBL_MAX;
+
+    if(((dict->lens[line] == 0) ? full : prefix) <= chunk->mirrorLimit)
+        genEditDistance_modes_limit(chunk->query, dict->words[line], dict->lens[line], limit, 
+                                    NULL, NULL, &score, NULL);
+    return score;
+}
 
 /**
-*   Indicates, whether transformation weights should be output while printing 
-*   the alignments ( \a printAlignments=1 ). If \a printAlignTransfWeights=1 ,
-*   then transformation weights are also printed.
+*  Receives the scores of a line of the dictionary found in the trie of the reversed
+*  lines, for the maximum edit distance search of suffix matches of the chunk \a arg
+*  ( \a DictChunk ).
 */
-int printAlignTransfWeights = 0;
+static void mirroredDistanceScores(void *arg, int line, double full, double prefix){
+    DictChunk *chunk = (DictChunk *)arg;
+    DecodedDictionary *dict = chunk->dict;
+    double scores[FP_MAX_POSITIONS + 1] = { DBL_MAX, DBL_MAX, DBL_MAX, DBL_MAX, DBL_MAX };
+    char exact[FP_MAX_POSITIONS + 1] = { 0 };
+
+    scores[L_SUFFIX] = mirroredSuffixScore(chunk, line, full, prefix, chunk->editD);
+    collectDistanceMatch(chunk, line, dict->start[line], dict->end[line], dict->words[line], dict->lens[line],
+                         scores, exact);
+}
 
 /**
-*   Indicates, whether pretty-printing mode should be used while printing 
-*   the alignments ( \a printAlignments=1 ). If \a printAlignmentsPretty=1 ,
-*   then pretty-printing mode is used ( strings are padded with spaces in 
-    order to better visualise the alignment ).
+*  Searches the nodes of the chunk \a arg ( \a DictChunk ) in the trie of the reversed
+*  lines for the maximum edit distance search with suffix matches: as \a scanDistances() ,
+*  but the suffix matches of the lines sharing a suffix are scored together. The 
+*  matches are stored in the order of the trie.
 */
-int printAlignmentsPretty = 0;
+void *searchMirroredDistances(void *arg){
+    DictChunk *chunk = (DictChunk *)arg;
+    TrieWorkspace ws;
+
+    initTrieWorkspace(&ws);
+    chunk->mirrorLimit = mirroredLimit(chunk->editD);
+    searchDictionaryTrie(chunk->trie, chunk->from, chunk->to, chunk->mirrored, &chunk->mirrorLimit, 1,
+                         mirroredDistanceScores, NULL, chunk, &ws);
+    freeTrieWorkspace(&ws);
+    return NULL;
+}
 
-/** 
-*   Extracts blocked regions from given search string, fills arrays 
-*  \a changeSearchStringWithEd_pen and \a changeSearchStringWithGenEd_pen 
-*  with penalty information and removes blocked region symbols from 
-*  the search string. Returns a pointer to the search string, where 
-*  blocked region symbols are already removed. NB! After usage, memory
-*  under the returned string and also under \a changeSearchStringWithEd_pen 
-*  and \a changeSearchStringWithGenEd_pen must be released!
-*
-*  \param *searchString pointer to the search string. The search string 
-*                       can contain blocked regions;
-*  \param *searchStringLen length of the \a searchString (including symbols
-*                          indicating blocked regions);
-*  \return pointer to the modified search string (blocked regions removed);
-*/
-wchar_t *extractBlockedRegions(wchar_t *searchString, int *searchStringLen){
-    int i;
-    // =============================================================
-    //    Find actual length of the search string
-    //    (do not count blocked region symbols)
-    // =============================================================
-    int wlen = 0;  // real string length
-    for (i = 0; i < *searchStringLen; i++){
-        if (searchString[i] != '(' && searchString[i] != ')' &&
-            searchString[i] != '<' && searchString[i] != '>'){
-            wlen++;
-        }
-    }
-    // Proceed only if there were any blocked regions ...
-    if (0 < wlen && wlen < *searchStringLen){
-        // Create arrays (masks) for penalties
-        changeSearchStringWithEd_pen    = malloc((wlen + 2) * sizeof(double));
-        changeSearchStringWithGenEd_pen = malloc((wlen + 2) * sizeof(double));
-        if (changeSearchStringWithEd_pen != NULL && changeSearchStringWithGenEd_pen != NULL){
-            /* Initialize masks with null penalty at each position */
-            for (i = 0; i < wlen+2; i++){
-                changeSearchStringWithEd_pen[i]    = 0.0;
-                changeSearchStringWithGenEd_pen[i] = 0.0;
-            }
-            // =============================================================
-            //  Mark down unchangable/blocked regions of the search string
-            // =============================================================
-            int no_eDist_allowed     = 0;
-            int no_genEdDist_allowed = 0;
-            int penVectorPos     = 1;
-            for (i = 0; i < *searchStringLen; i++){
-                if (searchString[i] == '(' || searchString[i] == '<'){
-                    // beginning of a region
-                    if (i == 1 && (no_eDist_allowed == 1 || no_genEdDist_allowed == 1)){
-                        // double symbols at the beginning of the string: block changes
-                        // (addings) to the beginning
-                        changeSearchStringWithEd_pen[0] = CHANGE_PENALT;
-                        if (searchString[i] == '<'){
-                            changeSearchStringWithGenEd_pen[0] = CHANGE_PENALT;
-                        }
-                    } else {
-                        // Start a new region
-                        if (searchString[i] == '('){
-                           no_eDist_allowed = 1;
-                        }
-                        if (searchString[i] == '<'){
-                           no_genEdDist_allowed = 1;
-                        }
-                    }
-                } else if (searchString[i] == ')' || searchString[i] == '>'){
-                    // ending of a region
-                    if (i == (*searchStringLen - 1)){
-                        if (i - 1 >= 0 && (searchString[i-1] == ')' || searchString[i-1] == '>')){
-                            // double symbols at the end of the string: block changes
-                            // (addings) to the end
-                            changeSearchStringWithEd_pen[wlen + 1] = CHANGE_PENALT;
-                            if (searchString[i] == '>'){
-                                changeSearchStringWithGenEd_pen[wlen + 1] = CHANGE_PENALT;
-                            }
-                        }
-                    } else {
-                        // end a region
-                        if (searchString[i] == ')'){
-                            no_eDist_allowed     = 0;
-                        }
-                        if (searchString[i] == '>'){
-                            no_genEdDist_allowed = 0;
-                        }
-                    }
-                } else {
-                    // in the middle of a region: make "unchangable"
-                    if (no_eDist_allowed == 1){
-                        changeSearchStringWithEd_pen[penVectorPos] = CHANGE_PENALT;
-                    }
-                    if (no_genEdDist_allowed == 1){
-                        changeSearchStringWithEd_pen[penVectorPos]    = CHANGE_PENALT;
-                        changeSearchStringWithGenEd_pen[penVectorPos] = CHANGE_PENALT;
-                    }
-                    penVectorPos++;
-                }
-            }
-            // =============================================================
-            //    Remove region symbols from the search string
-            // =============================================================
-            wchar_t *newSearchString;
-            /* malloc the necessary space */
-            if ((newSearchString = (wchar_t *)malloc((wlen + 1) * sizeof(wchar_t))) == NULL){
-                puts("Error: Could not allocate memory");
+// Compares matches by their line numbers (for qsort)
+static int compareMatchLines(const void *a, const void *b){
+    long x = ((DictMatch *)a)->line;
+    long y = ((DictMatch *)b)->line;
+    return (x > y) - (x < y);
+}
+
+/**
+*  Gathers the matches of the \a n chunks into the first chunk, in the order of the file.
+*/
+void gatherMatchesInOrder(DictChunk *chunks, int n){
+    int k;
+
+    for(k = 1; k < n; k++){
+        if(chunks[k].nMatches == 0)
+            continue;
+        if(chunks[0].nMatches + chunks[k].nMatches > chunks[0].matchCap){
+            chunks[0].matchCap = chunks[0].nMatches + chunks[k].nMatches;
+            chunks[0].matches = (DictMatch *)realloc(chunks[0].matches, chunks[0].matchCap * sizeof(DictMatch));
+            if(chunks[0].matches == NULL){
+                perror("Memory");
                 exit(1);
             }
-            /* copy values from the old string */
-            int searchStringPos = 0;
-            for (i = 0; i < *searchStringLen; i++){
-               if (searchString[i] != '(' && searchString[i] != ')' &&
-                   searchString[i] != '<' && searchString[i] != '>'){
-                   newSearchString[searchStringPos] = searchString[i];
-                   searchStringPos++;
-               }
-            }
-            /* ensure NULL-termination */
-            newSearchString[wlen] = L'\0';
-            /* replace old string, update length variable */
-            free(searchString);
-            searchString = newSearchString;
-            *searchStringLen = wlen;
-        } else {
-            puts("Error: Could not allocate memory");
-            exit(1);
         }
+        memcpy(chunks[0].matches + chunks[0].nMatches, chunks[k].matches, chunks[k].nMatches * sizeof(DictMatch));
+        chunks[0].nMatches += chunks[k].nMatches;
+        free(chunks[k].matches);
+        chunks[k].matches = NULL;
+        chunks[k].nMatches = 0;
     }
-    //for (i = 0; i < *searchStringLen+2; i++){
-    //   printf("--- %f %f \n", changeSearchStringWithEd_pen[i], changeSearchStringWithGenEd_pen[i]);
-    //}
-    return searchString;
+    qsort(chunks[0].matches, chunks[0].nMatches, sizeof(DictMatch), compareMatchLines);
 }
 
 /**
@@ -335,151 +559,252 @@ wchar_t *extractBlockedRegions(wchar_t *searchString, int *searchStringLen){
 *  \a flagsInPositions , up to four different matches (full, prefix, suffix, infix matches)
 *  can be calculated for every word in \a file - if at least one match has a score 
 *  <i>less than or equal to</i> \c editD , the word will appear in the output as a match.
+*  The file is scanned in \a nThreads parallel threads, matches are output in the order 
+*  of the file. If \a file has been decoded already and no suffix nor infix matches are 
+*  required, the lines are searched in the trie of the dictionary (see 
+*  \a searchDictionaryTrie() ), so that the lines sharing a prefix share its part of
+*  the calculation; if suffix matches are required, but no prefix nor infix matches,
+*  the lines are searched backwards in the trie of the reversed lines. Otherwise, if 
+*  only full matches are required, lines of too different length from the search 
+*  string are not scanned at all (see \a fullMatchLengths() ).
 *
 *  \param *file a dictionary file where the search will be conducted. Words in the file 
 *               should be separated with line breaks;
-*  \param *string the search string
-*  \param stringLen length of the search string
+*  \param *q the search string
 *  \param editD maximum generalized edit distance score. All matches exceeding the score will
 *               be discarded
 *  \param flagsInPositions indicates, which of the 4 different match types should be calculated
+*  \param *dict lines of \a file decoded already, or NULL
+*  \param nThreads number of threads scanning the file
 */
-int findDistances(char *file, wchar_t *string, int stringLen, double editD, char flagsInPositions[FP_MAX_POSITIONS]){
+int findDistances(char *file, GedQuery *q, double editD, char flagsInPositions[FP_MAX_POSITIONS], 
+                  DecodedDictionary *dict, int nThreads){
     long lineNR = 0;
-    int i = 0;
-    int j = 0;
+    int k, m, pos;
     int datalen;
-    char* str;
-    wchar_t* wstr     = NULL;
-    wchar_t* wstr_new = NULL;
-    int wLen;
+    int minLen, maxLen;
+    int *lines = NULL;
+    int nLines = 0;
+    int onlyFull = 1;
+    char trieFlag = L_FULL;  // the least restricted match type, if it can be searched in a trie
+    char required[FP_MAX_POSITIONS + 1] = { 0 };
+    GedQuery *mirrored = NULL;
+    DictChunk *chunks;
 
     datalen = strlen(file);
-    str = malloc(2);
-
-    if(caseInsensitiveMode)
-        string = makeStringToIgnoreCase(string, stringLen);
-
-    while(i < datalen){
-        while(j < datalen && file[j] != '\n' && file[j] != '\r')
-            j++;
 
-        str = (char *)realloc(str, (j-i+1));
-        if(str == NULL){
-           perror("Memory");
-           exit(1);
+    for(pos = 0; pos < FP_MAX_POSITIONS && flagsInPositions[pos] != L_EMPTY; pos++){
+        if(flagsInPositions[pos] != L_FULL)
+            onlyFull = 0;
+        required[(int)flagsInPositions[pos]] = 1;
+    }
+    if(required[L_INFIX] || (required[L_PREFIX] && required[L_SUFFIX]))
+        trieFlag = L_EMPTY;
+    else if(required[L_PREFIX])
+        trieFlag = L_PREFIX;
+    else if(required[L_SUFFIX])
+        trieFlag = L_SUFFIX;
+    // suffix matches are prefix matches of the mirrored query in the reversed lines
+    if(dict != NULL && trieFlag == L_SUFFIX && (mirrored = createMirroredQuery(q)) != NULL && 
+       isTrieSearchable(mirrored)){
+        chunks = splitTrieChunks(file, dict, dict->reversedTrie, nThreads);
+        for(k = 0; k < nThreads; k++){
+            chunks[k].query = q;
+            chunks[k].mirrored = mirrored;
+            chunks[k].editD = editD;
+            chunks[k].flagsInPositions = flagsInPositions;
+            chunks[k].flag  = trieFlag;
         }
-        str[j-i] ='\0';
-        strncpy(str, (file+i), (j-i));
-
-        wstr = (wchar_t *)localeToWchar(str);
-        wLen = mbstowcs(NULL, str, 0);
-
-        double fullED = DBL_MAX;
-        double prefED = DBL_MAX;
-        double suffED = DBL_MAX;
-        double infxED = DBL_MAX;
-
-        // make string to ignore case
-        if(caseInsensitiveMode){
-            wstr_new = copy_wchar_t(wstr, wLen);
-            wstr_new = makeStringToIgnoreCase(wstr_new, wLen);
+        scanChunks(chunks, nThreads, searchMirroredDistances);
+        gatherMatchesInOrder(chunks, nThreads);
+    } else if(dict != NULL && (trieFlag == L_FULL || trieFlag == L_PREFIX) && isTrieSearchable(q)){
+        chunks = splitTrieChunks(file, dict, dict->trie, nThreads);
+        for(k = 0; k < nThreads; k++){
+            chunks[k].query = q;
+            chunks[k].editD = editD;
+            chunks[k].flagsInPositions = flagsInPositions;
+            chunks[k].flag  = trieFlag;
         }
-
-        // find different types of matches, according to flagsInPositions
-        int pos = 0;
-        while ((pos < FP_MAX_POSITIONS) && (flagsInPositions[pos] != L_EMPTY)){
-            switch (flagsInPositions[pos++]){
-                case L_FULL:
-                     fullED = genEditDistance_full(string, 
-                                                   ((caseInsensitiveMode)?(wstr_new):(wstr)),
-                                                   stringLen, 
-                                                   wLen);
-                     break;
-                case L_PREFIX:
-                     prefED = genEditDistance_prefix(string, 
-                                                     ((caseInsensitiveMode)?(wstr_new):(wstr)),
-                                                     stringLen, 
-                                                     wLen); 
-                     break;
-                case L_SUFFIX:
-                     suffED = genEditDistance_suffix(string, 
-                                                     ((caseInsensitiveMode)?(wstr_new):(wstr)),
-                                                     stringLen, 
-                                                     wLen); 
-                     break;
-                case L_INFIX:
-                     infxED = genEditDistance_middle(string, 
-                                                     ((caseInsensitiveMode)?(wstr_new):(wstr)),
-                                                     stringLen, 
-                                                     wLen); 
-                     break;
-            }
+        scanChunks(chunks, nThreads, searchTrieDistances);
+        gatherMatchesInOrder(chunks, nThreads);
+    } else {
+        // with full matches only, the length index of the dictionary tells which lines can match
+        if(dict != NULL && onlyFull){
+            fullMatchLengths(q, editD, &minLen, &maxLen);
+            lines = linesOfLengths(dict, minLen, maxLen, &nLines);
+        }
+        chunks = splitDictionary(file, datalen, dict, lines, nLines, nThreads);
+        for(k = 0; k < nThreads; k++){
+            chunks[k].query = q;
+            chunks[k].editD = editD;
+            chunks[k].flagsInPositions = flagsInPositions;
         }
+        scanChunks(chunks, nThreads, scanDistances);
+    }
+
+    for(k = 0; k < nThreads; k++){
+        for(m = 0; m < chunks[k].nMatches; m++){
+            DictMatch *match = &chunks[k].matches[m];
 
-        if(fullED <= editD || prefED <= editD || suffED <= editD || infxED <= editD){
             puts("------------------------");
             if (printLineNumbers){
-                printf("%ld\n", lineNR);
+                printf("%ld\n", (dict != NULL) ? match->line : lineNR + match->line);
             }
-            puts(str);
+            printf("%.*s\n", match->end - match->start, file + match->start);
             // print different scores, according to flagsInPositions
             pos = 0;
             int flagsUsed = 0;
             while ((pos < FP_MAX_POSITIONS) && (flagsInPositions[pos] != L_EMPTY)){
-               switch (flagsInPositions[pos++]){
-                 case L_FULL:
-                              printf("%f", fullED);
-                              flagsUsed++;
-                              break;
-                 case L_PREFIX:
-                              printf("%f", prefED);
-                              flagsUsed++;
-                              break;
-                 case L_SUFFIX:
-                              printf("%f", suffED);
-                              flagsUsed++;
-                              break;
-                 case L_INFIX:
-                              printf("%f", infxED);
-                              flagsUsed++;
-                              break;
-              }
-              printf(" ");
+               printf("%f", match->scores[(int)flagsInPositions[pos++]]);
+               flagsUsed++;
+               printf(" ");
             }
             printf("\n");
             
             // if required, trace and print transformations
-            if(printAlignments > 0 && fullED <= editD && 
+            if(printAlignments > 0 && match->scores[L_FULL] <= editD && 
                blockChangesInSearchString == 0 && flagsUsed == 1){
+                char *str = NULL;
+                wchar_t *text;
+                // a decoded dictionary has the string case insensitive already
+                if(dict != NULL)
+                    text = dict->words[match->line];
+                else{
+                    str = (char *)malloc(match->end - match->start + 1);
+                    if(str == NULL){
+                        perror("Memory");
+                        exit(1);
+                    }
+                    str[match->end - match->start] = '\0';
+                    strncpy(str, file + match->start, match->end - match->start);
+                    text = (wchar_t *)localeToWchar(str);
+                    if(q->engine->caseInsensitive)
+                        makeStringToIgnoreCase(q->engine, text, wchar_len(text));
+                }
+
                 Transformations *transF = createTransformations();
-                genEditDistance(string, 
-                                ((caseInsensitiveMode)?(wstr_new):(wstr)),
-                                stringLen,
-                                wLen, transF);
-                printTransformations(string, ((caseInsensitiveMode)?(wstr_new):(wstr)), 
-                                     transF, caseInsensitiveMode, 
+                genEditDistance(q, text, wchar_len(text), transF);
+                printTransformations(q->string, text, 
+                                     transF, q->engine->caseInsensitive, 
                                      printAlignments, 
                                      printAlignTransfWeights, 
                                      printAlignmentsPretty);
                 //printf("  Removal list: %i ",debugRemovalListLen(transF));
                 removeTransformations(transF);
+                if(dict == NULL)
+                    free(text);
+                free(str);
             }
-            
         }
+        lineNR += chunks[k].nLines;
+        free(chunks[k].matches);
+        // the chunk has stopped at a line that cannot be converted
+        if(chunks[k].bad >= 0)
+            failOnLine(file, datalen, chunks[k].bad);
+    }
+    free(chunks);
+    free(lines);
+    if(mirrored != NULL)
+        freeGedQuery(mirrored);
+    return 0;
+}
 
-        free(wstr);
-        if(caseInsensitiveMode)
-            free(wstr_new);
+/**
+*  Scans the lines of the chunk \a arg ( \a DictChunk ) for the TOP N search:
+*  collects the \c best matches of the chunk into \a top of the chunk.
+*/
+void *scanBest(void *arg){
+    DictChunk *chunk = (DictChunk *)arg;
+    char flag = chunk->flag;
+    int i = chunk->from;
+    int k;
+    LineBlock block;
+    BatchProfile *batch = NULL;
+    double scores[LINE_BLOCK_SIZE];
+
+    initLineBlock(&block);
+    chunk->top = createTopList(chunk->best);
+    if(!isUnitCostSearch(chunk->query, 1))
+        batch = createBatchProfile(chunk->query);
+
+    while(i < chunk->to){
+        i = readChunkBlock(chunk, i, &block);
+        if(block.n == 0){
+            chunk->bad = i;
+            break;
+        }
 
-        lineNR++;
-        if(file[j] == '\r')
-            j +=2;
-        else j++;
-        i = j;
+        // find match according to type indicated in flag
+        scoreLineBlock(&block, batch, chunk->query, chunk->top->cutoff, 
+                       (flag != L_PREFIX && flag != L_SUFFIX && flag != L_INFIX) ? scores : NULL,
+                       (flag == L_PREFIX) ? scores : NULL, 
+                       (flag == L_SUFFIX) ? scores : NULL, 
+                       (flag == L_INFIX)  ? scores : NULL);
+
+        for(k = 0; k < block.n; k++)
+            insertTopItem(chunk->top, scores[k], block.start[k], block.end[k]);
+        chunk->nLines += block.n;
     }
-    free(str);
-    return 0;
+    freeLineBlock(&block);
+    freeBatchProfile(batch);
+    return NULL;
+}
+
+/**
+*  Receives the scores of a line of the dictionary found in its trie, for the TOP N 
+*  search of the chunk \a arg ( \a DictChunk ).
+*/
+static void trieBestScores(void *arg, int line, double full, double prefix){
+    DictChunk *chunk = (DictChunk *)arg;
+    insertTopItem(chunk->top, (chunk->flag == L_PREFIX) ? prefix : full, 
+                  chunk->dict->start[line], chunk->dict->end[line]);
+}
+
+/**
+*  Searches the nodes of the chunk \a arg ( \a DictChunk ) in the trie of the dictionary
+*  for the TOP N search of full or prefix matches: as \a scanBest() , but the cutoff of
+*  \a top of the chunk limits the search from node to node.
+*/
+void *searchTrieBest(void *arg){
+    DictChunk *chunk = (DictChunk *)arg;
+    TrieWorkspace ws;
+
+    initTrieWorkspace(&ws);
+    chunk->top = createTopList(chunk->best);
+    searchDictionaryTrie(chunk->trie, chunk->from, chunk->to, chunk->query, &chunk->top->cutoff,
+                         chunk->flag == L_PREFIX, trieBestScores, NULL, chunk, &ws);
+    freeTrieWorkspace(&ws);
+    return NULL;
+}
+
+/**
+*  Receives the scores of a line of the dictionary found in the trie of the reversed
+*  lines, for the TOP N search of suffix matches of the chunk \a arg ( \a DictChunk ).
+*/
+static void mirroredBestScores(void *arg, int line, double full, double prefix){
+    DictChunk *chunk = (DictChunk *)arg;
+
+    insertTopItem(chunk->top, mirroredSuffixScore(chunk, line, full, prefix, chunk->top->cutoff),
+                  chunk->dict->start[line], chunk->dict->end[line]);
+    chunk->mirrorLimit = mirroredLimit(chunk->top->cutoff);
+}
+
+/**
+*  Searches the nodes of the chunk \a arg ( \a DictChunk ) in the trie of the reversed
+*  lines for the TOP N search of suffix matches: as \a searchTrieBest() , with the 
+*  mirrored query.
+*/
+void *searchMirroredBest(void *arg){
+    DictChunk *chunk = (DictChunk *)arg;
+    TrieWorkspace ws;
+
+    initTrieWorkspace(&ws);
+    chunk->top = createTopList(chunk->best);
+    chunk->mirrorLimit = DBL_MAX;
+    searchDictionaryTrie(chunk->trie, chunk->from, chunk->to, chunk->mirrored, &chunk->mirrorLimit, 1,
+                         mirroredBestScores, NULL, chunk, &ws);
+    freeTrieWorkspace(&ws);
+    return NULL;
 }
 
 /**
@@ -487,130 +812,234 @@ int findDistances(char *file, wchar_t *string, int stringLen, double editD, char
 *  first \a best matches. \a flag indicates, which of the four different match types
 *  (full, prefix, suffix, infix) is calculated. Note that the number \a best is allowed
 *  to be exceeded, if there are multiple equal-score matches for the last position;
+*  The file is scanned in \a nThreads parallel threads, best matches of the threads are 
+*  merged. Full and prefix matches of a decoded dictionary are searched in its trie,
+*  suffix matches in the trie of its reversed lines.
 *
 *  \param *file a dictionary file where the search will be conducted. Words in the file 
 *               should be separated with line breaks;
-*  \param *string the search string
-*  \param stringLen length of the search string
+*  \param *q the search string
 *  \param best maximum number of best matches allowed in output. 
 *  \param flag indicates, which of the 4 different match types should be calculated
+*  \param *dict lines of \a file decoded already, or NULL
+*  \param nThreads number of threads scanning the file
 */
-int findBest(char *file, wchar_t *string, int stringLen, int best, char flag){
+int findBest(char *file, GedQuery *q, int best, char flag, DecodedDictionary *dict, int nThreads){
     /*
      * Maximum number of best matches allowed in output. Note that the number is 
      * allowed to be exceeded, if there are multiple equal-score matches for the 
      * last position in top;
      */
-    int nrOfBestStrings = best;
+    TopList *top = createTopList(best);
 
-    int i = 0;
-    List *l = createList();
-    int j = 0;
-    ListItem *item;
-    Index *index;
+    int k, m;
+    TopItem *item;
 
     int datalen;
     char* str;
-    wchar_t* wstr;
-    int wLen;
+    DictChunk *chunks;
+    void *(*scan)(void *) = scanBest;
+    GedQuery *mirrored = NULL;
 
     datalen = strlen(file);
     str = malloc(2);
 
-    while(i < datalen){
-        while(j < datalen && file[j] != '\n' && file[j] != '\r')
-            j++;
-
-        str = (char *)realloc(str, (j-i+1));
-
-        if(str == NULL){
-          perror("Memory");
-          exit(1);
-        }
-
-        str[j-i] ='\0';
-        strncpy(str, (file+i), (j-i));
-
-        wstr = (wchar_t *)localeToWchar(str);
-        wLen = mbstowcs(NULL, str, 0);
-
-        if(caseInsensitiveMode){
-            string = makeStringToIgnoreCase(string, stringLen);
-            wstr = makeStringToIgnoreCase(wstr, wLen);
-        }
-
-        double ed;
-        // find match according to type indicated in flag
-        switch (flag){
-           case L_PREFIX:
-                ed = genEditDistance_prefix(string, wstr, stringLen, wLen);
-                break;
-           case L_INFIX:
-                ed = genEditDistance_middle(string, wstr, stringLen, wLen);
-                break;
-           case L_SUFFIX:
-                ed = genEditDistance_suffix(string, wstr, stringLen, wLen);
-                break;
-           case L_FULL:
-           default:
-                ed = genEditDistance_full(string, wstr, stringLen, wLen);
-                break;
-        }
-        
-        // there's room in the list
-        if(best > 0){
-           best = insertListItem(l, ed, i, j, 0, best);
-           // printList(l);
+    // full and prefix matches of a decoded dictionary are searched in its trie, suffix matches backwards
+    if(dict != NULL && flag == L_SUFFIX && (mirrored = createMirroredQuery(q)) != NULL && isTrieSearchable(mirrored)){
+        chunks = splitTrieChunks(file, dict, dict->reversedTrie, nThreads);
+        scan = searchMirroredBest;
+    } else if(dict != NULL && flag != L_SUFFIX && flag != L_INFIX && isTrieSearchable(q)){
+        chunks = splitTrieChunks(file, dict, dict->trie, nThreads);
+        scan = searchTrieBest;
+    } else
+        chunks = splitDictionary(file, datalen, dict, NULL, 0, nThreads);
+    for(k = 0; k < nThreads; k++){
+        chunks[k].query = q;
+        chunks[k].mirrored = mirrored;
+        chunks[k].best = best;
+        chunks[k].flag = flag;
+    }
+    scanChunks(chunks, nThreads, scan);
+
+    /* merging best matches of the chunks: the merged collector holds the 
+       best matches of the whole file, as each chunk holds its own best ones */
+    for(k = 0; k < nThreads; k++){
+        // the chunk has stopped at a line that cannot be converted
+        if(chunks[k].bad >= 0)
+            failOnLine(file, datalen, chunks[k].bad);
+        for(m = 0; m < chunks[k].top->n; m++){
+            item = &chunks[k].top->items[m];
+            insertTopItem(top, item->value, item->i, item->j);
         }
-        else if(best == 0 && ed <= lastBest){
-           insertListItem(l, ed, i, j, 1, 0);
+        for(m = 0; m < chunks[k].top->nTies; m++){
+            item = &chunks[k].top->ties[m];
+            insertTopItem(top, item->value, item->i, item->j);
         }
-
-        free(wstr);
-
-        if(file[j] == '\r')
-            j +=2;
-        else j++;
-            i = j;
+        freeTopList(chunks[k].top);
     }
+    free(chunks);
+    if(mirrored != NULL)
+        freeGedQuery(mirrored);
 
     /* printing the result */
-    item = l->firstItem;
+    sortTopList(top);
     /*
-    *  Output best results by counting matches from the beginning. If 
-    *  there are multiple equal-score matches for the last position, 
-    *  the number of best results can be exceeded.
+    *  The collector holds exactly the matches to be output: if there 
+    *  are multiple equal-score matches for the last position, the number
+    *  of best results is exceeded.
     */
-    long countBest = 0; 
-    while(item != NULL){
-        puts("------------------------");
-        printf("%f \n", item->value);
-        index = item->index;
-        while(index != NULL){
-            str = (char *)realloc(str, (index->j - index->i + 1));
-            if(str == NULL){
-                perror("Memory");
-                exit(1);
-            }
-
-            str[index->j - index->i] ='\0';
-            strncpy(str, (file + index->i), (index->j - index->i));
-            puts(str);
-
-            index = index->nextIndex;
-            countBest++;
+    for(k = 0; k < top->n; k++){
+        item = &top->items[k];
+        if(k == 0 || item->value != top->items[k-1].value){
+            puts("------------------------");
+            printf("%f \n", item->value);
         }
-        // Is it enough already?
-        if (countBest >= nrOfBestStrings){
-           break;
+        str = (char *)realloc(str, (item->j - item->i + 1));
+        if(str == NULL){
+            perror("Memory");
+            exit(1);
         }
-        item = item->nextItem;
+
+        str[item->j - item->i] ='\0';
+        strncpy(str, (file + item->i), (item->j - item->i));
+        puts(str);
     }
-    freeList(l);
+    freeTopList(top);
     free(str);
     return 0;
 }
 
+/**
+*  Searches the dictionary \a words for the search string \a wSearch (length \a wlen ) 
+*  with the engine \a e : outputs top \a best matches, if \a best \c >= \c 0 , otherwise 
+*  outputs matches within the maximum edit distance \a max (see \a findBest() and 
+*  \a findDistances() ). If required (flag "-e"), blocked regions are extracted from the
+*  search string while compiling the query. Memory under \a wSearch is released 
+*  afterwards.
+*/
+int searchDictionary(GedEngine *e, char *words, wchar_t *wSearch, int wlen, int best, double max, 
+                     char flagsInPositions[FP_MAX_POSITIONS], DecodedDictionary *dict, int nThreads){
+  GedQuery *q = createGedQuery(e, wSearch, wlen, blockChangesInSearchString);
+
+  if (best >= 0.0){
+     // ***************
+     //  Output matches on best distances
+     // ***************
+     // Find position of the last non-empty flag
+     int lastPos = 0; 
+     while ((lastPos < FP_MAX_POSITIONS) && (flagsInPositions[lastPos] != L_EMPTY)) lastPos++;
+     findBest(words, q, best, 
+              flagsInPositions[lastPos-1], // match type: according to flag in last position
+              dict, nThreads
+             );
+  } else {
+     // ***************
+     //  Output matches that are inside given maximum edit distance threshold
+     // ***************
+     findDistances(words, q, max, 
+                   flagsInPositions, // for every match: output all scores of different types
+                   dict, nThreads
+                  );
+  }
+
+  freeGedQuery(q);
+  if (wSearch != NULL){
+     free(wSearch);
+  }
+  return 0;
+}
+
+/**
+*  Runs each query of the file \a queries against the dictionary \a words (flag "-q"),
+*  the dictionary is decoded only once (unless it has been decoded already into 
+*  \a dict , e.g. loaded from a dictionary image). Each line of \a queries is a search string, 
+*  optionally preceded by an identifier of the query and a tab character; empty lines
+*  are skipped. Results of each query are preceded by a line of "=" characters and the
+*  identifier of the query (the line number of the query, counted from 0, if the line 
+*  has no identifier). Other parameters are as in \a searchDictionary() .
+*/
+int runQueries(GedEngine *e, char *words, DecodedDictionary *dict, char *queries, int best, double max, 
+               char flagsInPositions[FP_MAX_POSITIONS], int nThreads){
+  DecodedDictionary *decoded = NULL;
+  int datalen = strlen(queries);
+  long lineNR = 0;
+  int i = 0;
+  int j;
+  char *line;
+  char *query;
+  wchar_t *wSearch;
+
+  if (dict == NULL)
+     dict = decoded = decodeDictionary(e, words);
+  while (i < datalen){
+      j = i;
+      while (j < datalen && queries[j] != '\n' && queries[j] != '\r')
+          j++;
+      if (j > i){
+          line = (char *)malloc(j-i+1);
+          if (line == NULL){
+              perror("Memory");
+              exit(1);
+          }
+          line[j-i] = '\0';
+          strncpy(line, (queries+i), (j-i));
+
+          puts("========================");
+          query = strchr(line, '\t');
+          if (query != NULL){
+              *query = '\0';
+              query++;
+              puts(line);
+          } else {
+              query = line;
+              printf("%ld\n", lineNR);
+          }
+          wSearch = (wchar_t*)localeToWchar(query);
+          searchDictionary(e, words, wSearch, mbstowcs(NULL, query, 0), best, max, 
+                           flagsInPositions, dict, nThreads);
+          free(line);
+      }
+      lineNR++;
+      if (j + 1 < datalen && queries[j] == '\r' && queries[j+1] == '\n')
+          j++;
+      i = j + 1;
+  }
+  if (decoded != NULL)
+     freeDecodedDictionary(decoded);
+  return 0;
+}
+
+/**
+*  Decodes the dictionary \a words (made case insensitive, if the engine \a e 
+*  requires) and writes it into the dictionary image file \a imageFile (flag 
+*  "--build-dict"), see \c DictionaryImageHeader .
+*/
+int buildDictionaryImage(GedEngine *e, char *words, char *imageFile){
+  DecodedDictionary *dict;
+
+  dict = decodeDictionary(e, words);
+  if (dict->bad >= 0)
+     failOnLine(words, strlen(words), dict->bad);
+  if (writeDictionaryImage(e, dict, words, imageFile) != 0){
+     perror("Error on writing file");
+     exit(1);
+  }
+  freeDecodedDictionary(dict);
+  return 0;
+}
+
+/**
+*  Reads the file \a filename into memory (see \a readFileSize() ; \a size can
+*  be NULL): the program exits, if the file cannot be read (the reason has been 
+*  printed to \c stderr ).
+*/
+char *readFileOrExit(char *filename, long long *size){
+  char *data = readFileSize(filename, size);
+  if (data == NULL)
+     exit(1);
+  return data;
+}
+
 /**
 *  Outputs help information about the program.
 *
@@ -618,7 +1047,7 @@ int findBest(char *file, wchar_t *string, int stringLen, int best, char flag){
 */
 int helpInfo(char *prog){
    puts("Usage:");
-   printf("1) %s -m maxED [-lepsfi] [-awy] file_A  string  file_B  [file_C]\n", prog);
+   printf("1) %s -m maxED [-lepsfi] [-awy] [-t N] file_A  string  file_B  [file_C]\n", prog);
    puts("   ");
    puts("   Computes generalized edit distances between <string> and strings in");
    puts("   <file_B>. Outputs all strings which have distance <= maxED;");
@@ -629,7 +1058,7 @@ int helpInfo(char *prog){
    puts("  file_B         - file from where to search for matches with given string;");
    puts("  file_C         - file containing upper-to-lower case translations, to ignore");
    puts("                   case during match finding (Non-mandatory argument);\n");
-   printf("2) %s -b N [-p|s|f|i] [-e] file_A  string  file_B  [file_C]\n", prog);
+   printf("2) %s -b N [-p|s|f|i] [-e] [-t N] file_A  string  file_B  [file_C]\n", prog);
    puts("   ");
    puts("   Computes generalized edit distances between <string> and strings in");
    puts("   <file_B>. Outputs top N strings closest to the search string. The number");
@@ -642,12 +1071,48 @@ int helpInfo(char *prog){
    puts("  file_B         - file from where to search for matches with given string;");
    puts("  file_C         - file containing upper-to-lower case translations, to ignore");
    puts("                   case during match finding (Non-mandatory argument);\n");
+   printf("3) %s -d socket  file_A  file_B  [file_C]\n", prog);
+   puts("   ");
+   puts("   Loads <file_A> and <file_B> once and serves searches to clients over the");
+   puts("   Unix domain socket <socket>. A request is a line of tab-separated fields:");
+   puts("   ");
+   puts("     id  op  value  deadline  query");
+   puts("   ");
+   puts("   op is 'm' (distance <= value) or 'b' (value best matches), followed by");
+   puts("   the match type 'f', 'p', 'i' or 's' and optionally by 'e' (blocked regions");
+   puts("   are marked in the query); deadline is the time limit in milliseconds (0 for");
+   puts("   none). The response is the line 'id  n', followed by n lines 'line  distance");
+   puts("   word', or a line 'id  ERR  message', 'id  TIMEOUT' or 'id  CANCELLED'.");
+   puts("   The request 'id  c  target' cancels running searches with the id <target>;\n");
+   printf("4) %s --build-dict file_D  file_B  [file_C]\n", prog);
+   puts("   ");
+   puts("   Decodes <file_B> (and makes it case insensitive with <file_C>) beforehand");
+   puts("   into the dictionary image <file_D>. The image can be given instead of");
+   puts("   <file_B> in the usages above: searches start without decoding the");
+   puts("   dictionary, and full and prefix matches are searched in the trie of the");
+   puts("   strings stored in the image, so strings sharing a prefix share its part");
+   puts("   of the calculation (suffix matches in the trie of the reversed strings).");
+   puts("   The search must use the same <file_C> as the image (or none at all);\n");
+   printf("5) %s --compile-rules file_R  file_A  [file_C]\n", prog);
+   puts("   ");
+   puts("   Builds the search structures of the transformations in <file_A> (made case");
+   puts("   insensitive with <file_C>) beforehand into the compiled rule set <file_R>.");
+   puts("   The rule set can be given instead of <file_A> in the usages above: it is");
+   puts("   loaded without parsing the transformations. The search must use the same");
+   puts("   <file_C> as the rule set (or none at all);\n");
    printf("Optional flags:\n");
    puts("  -f  finds edit distance between full extent strings (default);");
    puts("  -s  finds edit distance between search string and some suffix of text;");
    puts("  -p  finds edit distance between search string and some prefix of text;");
    puts("  -i  finds edit distance between search string and some infix of text;");
    puts("  -l  prints line number before found match (can be used only with '-m');");
+   puts("  -q file_Q  runs each line of <file_Q> as a search string, instead of <string>;");
+   puts("        a line can start with an identifier of the query and a tab character.");
+   puts("        Results of each query start with a line of '=' and the identifier");
+   puts("        (or the line number of the query). <string> is left out of the");
+   puts("        arguments: file_A  file_B  [file_C];");
+   puts("  -t N  scans <file_B> in N parallel threads (default 1); the output is the");
+   puts("        same as with a single thread. N can be at most 256;");
    puts("  -e  allows to mark unchangable areas in <string>. Example markings:");
    puts("");
    puts("    (ab)cde(f)) = the prefix 'ab' can't be modified by regular edit dist");
@@ -679,8 +1144,15 @@ int main(int argc, char* argv[]){
   char *searchString;
   char *wordsFile;
   char *ignoreCaseFile;
-  char *data;
+  char *queriesFile = NULL;
+  char *socketPath = NULL;
+  char *imageFile = NULL;
+  char *rulesImageFile = NULL;
   char *words;
+  long long wordsSize;
+  char *image = NULL;
+  char *queries;
+  DecodedDictionary *dict = NULL;
 
   /* set locale */
   if (!setlocale(LC_CTYPE, "")) {
@@ -689,8 +1161,8 @@ int main(int argc, char* argv[]){
     return 1;
   }
 
-  // Default costs for regular edit distance operations
-  add = rep = rem = 1.0;
+  // Transformations, costs and the case table of the search
+  GedEngine *engine;
   char *err;
   wchar_t *wSearch;
   int wlen;
@@ -717,11 +1189,26 @@ int main(int argc, char* argv[]){
   // If the value is >= 0, all matches having distance >= max will be output;
   double max = -1.0;
 
+  // Number of threads scanning the dictionary file
+  int nThreads = 1;
+  long threads;
+
   // Parse flags from the command line
   int c;
   char *argForOpt;
-  while ((c = getopt(argc, argv, "b:m:elpisf?awy")) != -1){
+  static struct option longOptions[] = {
+     {"build-dict", required_argument, NULL, 'D'},
+     {"compile-rules", required_argument, NULL, 'R'},
+     {0, 0, 0, 0}
+  };
+  while ((c = getopt_long(argc, argv, "b:m:t:q:d:elpisf?awy", longOptions, NULL)) != -1){
     switch (c){
+      case 'D':
+         imageFile = optarg;
+         break;
+      case 'R':
+         rulesImageFile = optarg;
+         break;
       case 'f':
          if (curInFlags < FP_MAX_POSITIONS) flagsInPositions[curInFlags++] = L_FULL;
          break;
@@ -739,6 +1226,27 @@ int main(int argc, char* argv[]){
          // Number of best results (costs)
          best = strtoul(argForOpt, &err, 10);
          break;
+      case 't':
+         argForOpt = optarg;
+         // Number of threads
+         threads = strtol(argForOpt, &err, 10);
+         if (*err != '\0' || threads < 1){
+            printf("The number of threads must be a positive integer; \n");
+            helpInfo(argv[0]);
+            return 1;
+         }
+         if (threads > MAX_THREADS){
+            printf("The number of threads must be at most %i; \n", MAX_THREADS);
+            return 1;
+         }
+         nThreads = (int)threads;
+         break;
+      case 'q':
+         queriesFile = optarg;
+         break;
+      case 'd':
+         socketPath = optarg;
+         break;
       case 'l':
          printLineNumbers = 1;
          break;
@@ -765,8 +1273,65 @@ int main(int argc, char* argv[]){
     }
   }
 
-  // There must be at least 3 arguments left: transformations file, search string and dictionary file
-  if (argc - optind < 3){
+  // Daemon mode: transformations file, dictionary file and optionally the ignore case file
+  if (socketPath != NULL){
+     if (argc - optind < 2){
+        printf("Wrong number of arguments: %i \n",argc-1);
+        helpInfo(argv[0]);
+        return 1;
+     }
+     return serveSearches(socketPath, argv[optind], argv[optind + 1], 
+                          (argc - optind > 2) ? argv[optind + 2] : NULL);
+  }
+
+  // Building a dictionary image: dictionary file and optionally the ignore case file
+  if (imageFile != NULL){
+     if (argc - optind < 1){
+        printf("Wrong number of arguments: %i \n",argc-1);
+        helpInfo(argv[0]);
+        return 1;
+     }
+     engine = createGedEngine(0);
+     if (argc - optind > 1){
+        engine->caseInsensitive = 1;
+        if (ignoreCaseListFromFile(engine, readFileOrExit(argv[optind + 1], NULL)) != 0)
+           return 1;
+     }
+     words = readFileOrExit(argv[optind], NULL);
+     buildDictionaryImage(engine, words, imageFile);
+     munmap(words, strlen(words));
+     freeGedEngine(engine);
+     return 0;
+  }
+
+  // Compiling a rule set: transformations file and optionally the ignore case file
+  if (rulesImageFile != NULL){
+     if (argc - optind < 1){
+        printf("Wrong number of arguments: %i \n",argc-1);
+        helpInfo(argv[0]);
+        return 1;
+     }
+     // the rule set can also be used for printing the alignments
+     engine = createGedEngine(1);
+     if (argc - optind > 1){
+        engine->caseInsensitive = 1;
+        if (ignoreCaseListFromFile(engine, readFileOrExit(argv[optind + 1], NULL)) != 0)
+           return 1;
+     }
+     if (loadTransformations(engine, argv[optind]) != 0)
+        return 1;
+     if (writeGedEngineImage(engine, rulesImageFile) != 0){
+        perror("Error on writing file");
+        return 1;
+     }
+     freeGedEngine(engine);
+     return 0;
+  }
+
+  // There must be 3 or 4 arguments left: transformations file, search string, dictionary file
+  // and optionally the ignore case file (the search string is not given with the flag '-q', so
+  // a search string given with it would be taken for the dictionary file)
+  if (argc - optind < ((queriesFile != NULL) ? 2 : 3) || argc - optind > ((queriesFile != NULL) ? 3 : 4)){
      printf("Wrong number of arguments: %i \n",argc-1);
      helpInfo(argv[0]);
      return 1;
@@ -779,112 +1344,68 @@ int main(int argc, char* argv[]){
      return 1;
   }
 
+  /* creating the engine with empty tries; if printing alignments is required,
+     create also tries for backtracing */
+  engine = createGedEngine(printAlignments > 0);
+
   // Parse remaining arguments
   int i;
   for (i = 0; optind + i < argc; i++){
-      switch (i){
+      switch ((queriesFile != NULL && i > 0) ? i + 1 : i){
           case 0: filename     = argv[optind + i]; break;
           case 1: searchString = argv[optind + i]; break;
           case 2: wordsFile    = argv[optind + i]; break;
           case 3:{
-                    caseInsensitiveMode = 1;
+                    engine->caseInsensitive = 1;
                     // ignore case file
-                    ignoreCaseFile = (char *)readFile(argv[optind + i]);
-                    ignoreCaseListFromFile(ignoreCaseFile);
+                    ignoreCaseFile = readFileOrExit(argv[optind + i], NULL);
+                    if (ignoreCaseListFromFile(engine, ignoreCaseFile) != 0)
+                       return 1;
                  }
                  break;
       }
   }
 
-  /* creating tries */
-  t = createTrie();
-  addT = createARTrie();
-  remT = createARTrie();
-  
-  /* if printing alignments is required, create also tries for backtracing */
-  if (printAlignments > 0){
-      traceT    = createTrie();
-      traceAddT = createARTrie();
-      traceRemT = createARTrie();
-  }
-
-  /* read transformations file and build trie-structures */
-  data = (char *)readFile(filename);
-  trieFromFile(data);
-
-  /* the search word */
-  wSearch = (wchar_t*)localeToWchar(searchString);
-  wlen = mbstowcs(NULL, searchString, 0);
+  /* read transformations file and build trie-structures (or load the compiled rule set) */
+  if (loadTransformations(engine, filename) != 0)
+     return 1;
 
-  /* extract blocked regions and create mask of penalties */
-  if ( blockChangesInSearchString == 1  &&  wlen > 0 ){
-      wSearch = extractBlockedRegions(wSearch, &wlen);
-      //printf(" (%ls) (%i) \n", wSearch, wlen);
+  if (queriesFile == NULL){
+     /* the search word */
+     wSearch = (wchar_t*)localeToWchar(searchString);
+     wlen = mbstowcs(NULL, searchString, 0);
   }
 
-  /* read dictionary file */
-  words = (char *)readFile(wordsFile);
+  /* read dictionary file; a dictionary image holds the file and its decoded lines */
+  words = readFileOrExit(wordsFile, &wordsSize);
+  if (isDictionaryImage(words, wordsSize)){
+     image = words;
+     dict = dictionaryFromImage(engine, image, wordsSize, &words);
+     if (dict == NULL)
+        return 1;
+  }
 
-  if (best >= 0.0){
-     // ***************
-     //  Output matches on best distances
-     // ***************
-     // Find position of the last non-empty flag
-     int lastPos = 0; 
-     while ((lastPos < FP_MAX_POSITIONS) && (flagsInPositions[lastPos] != L_EMPTY)) lastPos++;
-     findBest(words, wSearch, wlen, best, 
-              flagsInPositions[lastPos-1] // match type: according to flag in last position
-             );
+  if (queriesFile != NULL){
+     /* run all queries against the dictionary */
+     queries = readFileOrExit(queriesFile, NULL);
+     runQueries(engine, words, dict, queries, best, max, flagsInPositions, nThreads);
+     munmap(queries, strlen(queries));
   } else {
-     // ***************
-     //  Output matches that are inside given maximum edit distance threshold
-     // ***************
-     findDistances(words, wSearch, wlen, max, 
-                   flagsInPositions  // for every match: output all scores of different types
-                  );
+     searchDictionary(engine, words, wSearch, wlen, best, max, flagsInPositions, dict, nThreads);
   }
   
   
   /* release used memory */
 
-  if (changeSearchStringWithEd_pen != NULL){
-     free(changeSearchStringWithEd_pen);
-  }
-
-  if (changeSearchStringWithGenEd_pen != NULL){
-     free(changeSearchStringWithGenEd_pen);
-  }
-  
-  if (wSearch != NULL){
-     free(wSearch);
-  }
-  if (ignoreCase != NULL){
-     freeIgnoreCaseList();
-  }
-  if (words != NULL){
+  if (image != NULL){
+     freeDecodedDictionary(dict);
+     munmap(image, wordsSize);
+  } else if (words != NULL){
      munmap(words, strlen(words));
   }
 
-  // Searching tries
-  if (t != NULL){
-     freeTrie(t);
-  }
-  if (addT != NULL){
-     freeARTrie(addT);
-  }
-  if (addT != NULL){
-     freeARTrie(remT);
-  }
-  // Backtracing tries
-  if (traceT != NULL){
-     freeTrie(traceT);
-  }
-  if (traceAddT != NULL){
-     freeARTrie(traceAddT);
-  }
-  if (traceRemT != NULL){
-     freeARTrie(traceRemT);
-  }
+  freeDefaultWorkspaces();
+  freeGedEngine(engine);
   return 0;
 
 }
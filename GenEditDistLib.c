@@ -0,0 +1,643 @@
+/*
+*    Copyright (C) 2010 University of Tartu
+*    Authors: Reina Krik, Siim Orasmaa, Kristo Tammeoja, Jaak Vilo
+*    Contact:  siim . orasmaa {at} ut . ee
+*
+*    This file is part of Generalized Edit Distance Tool.
+*
+*    Generalized Edit Distance Tool is free software: you can redistribute 
+*    it and/or modify it under the terms of the GNU General Public License 
+*    as published by the Free Software Foundation, either version 3 of the
+*    License, or (at your option) any later version.
+*
+*    Generalized Edit Distance Tool is distributed in the hope that it will 
+*    be useful, but WITHOUT ANY WARRANTY; without even the implied warranty 
+*    of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*    GNU General Public License for more details.
+*
+*    You should have received a copy of the GNU General Public License
+*    along with Generalized Edit Distance Tool. 
+*    If not, see <http://www.gnu.org/licenses/>.
+*
+*/
+
+#include <unistd.h>
+#include <time.h>
+#include <sys/mman.h>
+#include "GenEditDistLib.h"
+#include "GedEngine.h"
+#include "FileToTrie.h"
+#include "FindEditDistanceMod.h"
+#include "BatchEditDistance.h"
+#include "Dictionary.h"
+
+struct GedRuleSet {
+    GedEngine *engine;
+};
+
+struct GedDictionary {
+    GedEngine *engine;
+    char *file;
+    size_t fileLen;
+    char *text;
+    DecodedDictionary *dict;
+};
+
+struct GedSearch {
+    GedQuery *query;
+    GedQuery *mirrored;  // the query mirrored for suffix matches, compiled on first use (see trieQuery())
+    BatchProfile *batch;
+    TrieWorkspace trie;  // work buffers of the searches in the tries of dictionaries
+    int hasDeadline;
+    struct timespec deadline;
+    volatile int *cancel;
+};
+
+/* Texts given to the scoring methods are decoded into workspaces of the 
+   calling thread, which are reused between calls (see gedReleaseThread()). */
+
+// Decoded characters of the texts
+static __thread wchar_t *textChars = NULL;
+static __thread size_t textCap = 0;
+
+// Makes room for at least n characters in the text workspace
+static void ensureTextChars(size_t n){
+    if(n > textCap){
+        if(textCap == 0) textCap = 256;
+        while(textCap < n) textCap *= 2;
+        textChars = (wchar_t *)realloc(textChars, textCap * sizeof(wchar_t));
+        if(textChars == NULL){
+            puts("Error: Could not allocate memory");
+            exit(1);
+        }
+    }
+}
+
+/*
+*   Decodes \a text into the text workspace from the position \a at onwards
+*  (made case insensitive, if \a e requires and \a fold is set). Returns the 
+*  length of the decoded string, or -1 if \a text cannot be converted.
+*/
+static int decodeText(GedEngine *e, const char *text, size_t at, int fold){
+    size_t len = mbstowcs(NULL, text, 0);
+    if(len == (size_t)-1)
+        return -1;
+    ensureTextChars(at + len + 1);
+    mbstowcs(textChars + at, text, len + 1);
+    if(fold && e->caseInsensitive)
+        makeStringToIgnoreCase(e, textChars + at, len);
+    return len;
+}
+
+// Tells whether the match type is known
+static int isMatchType(int mode){
+    return mode == GED_MATCH_FULL || mode == GED_MATCH_PREFIX || 
+           mode == GED_MATCH_INFIX || mode == GED_MATCH_SUFFIX;
+}
+
+/*
+*   Finds the scores of the match type \a mode between the search string and 
+*  \a n decoded texts, giving up on scores above \a limit ( \c DBL_MAX is 
+*  stored instead, unless scores are exact anyway).
+*/
+static void scoreMode(GedSearch *search, wchar_t **words, int *lens, int n, int mode, double limit, double *scores){
+    scoreWords(words, lens, n, search->batch, search->query, limit,
+               (mode == GED_MATCH_FULL)   ? scores : NULL,
+               (mode == GED_MATCH_PREFIX) ? scores : NULL,
+               (mode == GED_MATCH_SUFFIX) ? scores : NULL,
+               (mode == GED_MATCH_INFIX)  ? scores : NULL);
+}
+
+// Loads transformations and the ignore case list into a new rule set
+GedRuleSet *gedLoadRuleSet(const char *rulesFile, const char *ignoreCaseFile){
+    GedRuleSet *rules;
+    char *data;
+
+    if(rulesFile == NULL || access(rulesFile, R_OK) != 0)
+        return NULL;
+    if(ignoreCaseFile != NULL && access(ignoreCaseFile, R_OK) != 0)
+        return NULL;
+    rules = (GedRuleSet *)malloc(sizeof(GedRuleSet));
+    if(rules == NULL)
+        abort();
+    rules->engine = createGedEngine(0);
+    if(ignoreCaseFile != NULL){
+        rules->engine->caseInsensitive = 1;
+        data = readFile((char *)ignoreCaseFile);
+        if(data == NULL){
+            gedFreeRuleSet(rules);
+            return NULL;
+        }
+        if(ignoreCaseListFromFile(rules->engine, data) != 0){
+            gedFreeRuleSet(rules);
+            return NULL;
+        }
+    }
+    if(loadTransformations(rules->engine, (char *)rulesFile) != 0){
+        gedFreeRuleSet(rules);
+        return NULL;
+    }
+    return rules;
+}
+
+// Releases memory under the rule set
+void gedFreeRuleSet(GedRuleSet *rules){
+    freeGedEngine(rules->engine);
+    free(rules);
+}
+
+// Loads and decodes the dictionary file
+GedDictionary *gedLoadDictionary(GedRuleSet *rules, const char *file){
+    GedDictionary *dict;
+    long long fileLen;
+
+    if(file == NULL || access(file, R_OK) != 0)
+        return NULL;
+    dict = (GedDictionary *)malloc(sizeof(GedDictionary));
+    if(dict == NULL)
+        abort();
+    dict->engine  = rules->engine;
+    dict->file    = readFileSize((char *)file, &fileLen);
+    if(dict->file == NULL){
+        free(dict);
+        return NULL;
+    }
+    dict->fileLen = fileLen;
+    if(isDictionaryImage(dict->file, fileLen)){
+        dict->dict    = dictionaryFromImage(rules->engine, dict->file, fileLen, &dict->text);
+        if(dict->dict == NULL){
+            munmap(dict->file, dict->fileLen);
+            free(dict);
+            return NULL;
+        }
+        return dict;
+    }
+    dict->text    = dict->file;
+    dict->dict    = decodeDictionary(rules->engine, dict->file);
+    // a line that cannot be converted makes the dictionary unusable
+    if(dict->dict->bad >= 0){
+        gedFreeDictionary(dict);
+        return NULL;
+    }
+    return dict;
+}
+
+// Returns the number of lines in the dictionary
+int gedDictionarySize(GedDictionary *dict){
+    return dict->dict->n;
+}
+
+// Returns the line of the dictionary file as it is in the file
+const char *gedDictionaryLine(GedDictionary *dict, int line, int *len){
+    if(line < 0 || line >= dict->dict->n)
+        return NULL;
+    if(len != NULL)
+        *len = dict->dict->end[line] - dict->dict->start[line];
+    return dict->text + dict->dict->start[line];
+}
+
+// Releases memory under the dictionary
+void gedFreeDictionary(GedDictionary *dict){
+    freeDecodedDictionary(dict->dict);
+    munmap(dict->file, dict->fileLen);
+    free(dict);
+}
+
+// Compiles the search string for the rule set
+GedSearch *gedCompileSearch(GedRuleSet *rules, const char *query, int blockChanges){
+    GedSearch *search;
+    int len;
+
+    // blocked regions are extracted before the string is made case insensitive
+    len = decodeText(rules->engine, query, 0, 0);
+    if(len < 0)
+        return NULL;
+    search = (GedSearch *)malloc(sizeof(GedSearch));
+    if(search == NULL)
+        abort();
+    search->query = createGedQuery(rules->engine, textChars, len, blockChanges);
+    search->mirrored = NULL;
+    search->batch = NULL;
+    initTrieWorkspace(&search->trie);
+    search->hasDeadline = 0;
+    search->cancel = NULL;
+    if(!isUnitCostSearch(search->query, 1))
+        search->batch = createBatchProfile(search->query);
+    return search;
+}
+
+// Releases memory under the compiled search string
+void gedFreeSearch(GedSearch *search){
+    if(search->batch != NULL)
+        freeBatchProfile(search->batch);
+    freeGedQuery(search->query);
+    if(search->mirrored != NULL)
+        freeGedQuery(search->mirrored);
+    freeTrieWorkspace(&search->trie);
+    free(search);
+}
+
+// Sets the deadline of the dictionary searches
+void gedSetDeadline(GedSearch *search, long ms){
+    search->hasDeadline = (ms > 0);
+    if(ms <= 0)
+        return;
+    clock_gettime(CLOCK_MONOTONIC, &search->deadline);
+    search->deadline.tv_sec  += ms / 1000;
+    search->deadline.tv_nsec += (ms % 1000) * 1000000L;
+    if(search->deadline.tv_nsec >= 1000000000L){
+        search->deadline.tv_sec++;
+        search->deadline.tv_nsec -= 1000000000L;
+    }
+}
+
+// Sets the flag that cancels the dictionary searches
+void gedSetCancelFlag(GedSearch *search, volatile int *cancel){
+    search->cancel = cancel;
+}
+
+// Checks, whether the dictionary search must be stopped; returns GED_TIMEOUT, GED_CANCELLED or 0
+static int searchStopped(GedSearch *search){
+    struct timespec now;
+
+    if(search->cancel != NULL && *search->cancel)
+        return GED_CANCELLED;
+    if(search->hasDeadline){
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        if(now.tv_sec > search->deadline.tv_sec || 
+           (now.tv_sec == search->deadline.tv_sec && now.tv_nsec >= search->deadline.tv_nsec))
+            return GED_TIMEOUT;
+    }
+    return 0;
+}
+
+// Finds the distance between the search string and a single text
+double gedScore(GedSearch *search, const char *text, int mode){
+    int len;
+
+    if(!isMatchType(mode))
+        return -1.0;
+    len = decodeText(search->query->engine, text, 0, 1);
+    if(len < 0)
+        return -1.0;
+    return genEditDistance_mod(search->query, textChars, len, 
+                               (mode == GED_MATCH_FULL || mode == GED_MATCH_PREFIX),
+                               (mode == GED_MATCH_FULL || mode == GED_MATCH_SUFFIX));
+}
+
+// Finds the distances between the search string and each of the texts
+int gedScoreTexts(GedSearch *search, const char **texts, int n, int mode, double *scores){
+    wchar_t *words[LINE_BLOCK_SIZE];
+    int lens[LINE_BLOCK_SIZE];
+    int index[LINE_BLOCK_SIZE];
+    double blockScores[LINE_BLOCK_SIZE];
+    size_t at;
+    int from, k, m, len;
+
+    if(!isMatchType(mode))
+        return -1;
+    for(from = 0; from < n; from += LINE_BLOCK_SIZE){
+        // decode a block of texts (the workspace may move while growing: take pointers afterwards)
+        at = 0;
+        m = 0;
+        for(k = from; k < n && k < from + LINE_BLOCK_SIZE; k++){
+            len = decodeText(search->query->engine, texts[k], at, 1);
+            if(len < 0){
+                scores[k] = -1.0;
+                continue;
+            }
+            lens[m] = len;
+            index[m++] = k;
+            at += len + 1;
+        }
+        at = 0;
+        for(k = 0; k < m; k++){
+            words[k] = textChars + at;
+            at += lens[k] + 1;
+        }
+        scoreMode(search, words, lens, m, mode, DBL_MAX, blockScores);
+        for(k = 0; k < m; k++)
+            scores[index[k]] = blockScores[k];
+    }
+    return 0;
+}
+
+// Finds the distances between pairs of strings
+int gedScorePairs(GedRuleSet *rules, const char **queries, const char **texts, int n, 
+                  int mode, int blockChanges, double *scores){
+    GedSearch *search = NULL;
+    int k;
+
+    if(!isMatchType(mode))
+        return -1;
+    for(k = 0; k < n; k++){
+        // consecutive pairs with the same query share the compiled search string
+        if(k == 0 || strcmp(queries[k], queries[k-1]) != 0){
+            if(search != NULL)
+                gedFreeSearch(search);
+            search = gedCompileSearch(rules, queries[k], blockChanges);
+        }
+        scores[k] = (search != NULL) ? gedScore(search, texts[k], mode) : -1.0;
+    }
+    if(search != NULL)
+        gedFreeSearch(search);
+    return 0;
+}
+
+// Tells whether the result a is worse than b: has a greater distance, or an equal distance and a greater line
+static inline int isWorseResult(GedResult *a, GedResult *b){
+    return a->score > b->score || (a->score == b->score && a->line > b->line);
+}
+
+// Tells whether the result a comes after b in the order of the lines
+static inline int isLaterResult(GedResult *a, GedResult *b){
+    return a->line > b->line;
+}
+
+// Compares results by distance and line number (for qsort)
+static int compareResults(const void *a, const void *b){
+    GedResult *x = (GedResult *)a;
+    GedResult *y = (GedResult *)b;
+    if(isWorseResult(x, y)) return 1;
+    if(isWorseResult(y, x)) return -1;
+    return 0;
+}
+
+// Compares results by line number (for qsort)
+static int compareResultLines(const void *a, const void *b){
+    return ((GedResult *)a)->line - ((GedResult *)b)->line;
+}
+
+/*
+*   Restores the order of the max-heap \a heap[0..n-1] (the last result by the order 
+*  \a after on the top), after the result at the position \a i has been replaced with
+*  one coming before it.
+*/
+static void siftDownResult(GedResult *heap, int n, int i, int (*after)(GedResult *, GedResult *)){
+    GedResult tmp;
+    int child;
+
+    while((child = 2 * i + 1) < n){
+        if(child + 1 < n && after(&heap[child + 1], &heap[child]))
+            child++;
+        if(!after(&heap[child], &heap[i]))
+            break;
+        tmp = heap[i]; heap[i] = heap[child]; heap[child] = tmp;
+        i = child;
+    }
+}
+
+// Restores the order of the max-heap after a result has been appended at the position i
+static void siftUpResult(GedResult *heap, int i, int (*after)(GedResult *, GedResult *)){
+    GedResult tmp;
+    int parent;
+
+    while(i > 0 && after(&heap[i], &heap[parent = (i - 1) / 2])){
+        tmp = heap[i]; heap[i] = heap[parent]; heap[parent] = tmp;
+        i = parent;
+    }
+}
+
+/*
+*   Results of a search in a trie of the dictionary \a dict (see searchDictionaryTrie()):
+*  scores of the match type \a mode are collected into the buffer \a results of the
+*  caller (room for \a cap of them), which holds a max-heap: for the search within the
+*  maximum distance \a limit , of the first lines by number ( \a n counts all the 
+*  lines found, also the ones that do not fit); for the search of the best results, 
+*  of the best ones ( \a n of them), \a limit being the distance of the worst one, 
+*  once the heap is full.
+*  Suffix matches are searched in the trie of the reversed lines within \a mirrorLimit
+*  (see mirroredLimit()).
+*/
+typedef struct TrieResults {
+    GedSearch *search;
+    DecodedDictionary *dict;
+    int mode;
+    double limit;
+    double mirrorLimit;
+    GedResult *results;
+    int n;
+    int cap;
+} TrieResults;
+
+/*
+*   Returns the query to be searched for in a trie of the dictionary for the match 
+*  type: the search string itself for full and prefix matches, the mirrored search
+*  string for suffix matches (in the trie of the reversed lines, see 
+*  createMirroredQuery()). Returns NULL, if the lines must be scanned instead.
+*/
+static GedQuery *trieQuery(GedSearch *search, int mode){
+    if(mode == GED_MATCH_FULL || mode == GED_MATCH_PREFIX)
+        return isTrieSearchable(search->query) ? search->query : NULL;
+    if(mode == GED_MATCH_SUFFIX){
+        if(search->mirrored == NULL)
+            search->mirrored = createMirroredQuery(search->query);
+        if(search->mirrored != NULL && isTrieSearchable(search->mirrored))
+            return search->mirrored;
+    }
+    return NULL;
+}
+
+/*
+*   Returns the score of the match type of \a r for the line found in a trie with the
+*  scores \a full and \a prefix . The prefix score of a reversed line is its suffix
+*  score up to rounding (an empty line has its full score only), so lines that can 
+*  be within the limit are scored again with the search string.
+*/
+static double trieResultScore(TrieResults *r, int line, double full, double prefix){
+    double score = DBL_MAX;
+
+    if(r->mode == GED_MATCH_FULL)
+        return full;
+    if(r->mode == GED_MATCH_PREFIX)
+        return prefix;
+    if(((r->dict->lens[line] == 0) ? full : prefix) <= r->mirrorLimit)
+        scoreMode(r->search, r->dict->words + line, r->dict->lens + line, 1, GED_MATCH_SUFFIX, r->limit, &score);
+    return score;
+}
+
+// Checks, whether the search of the trie must be stopped (see searchStopped())
+static int trieSearchStopped(void *arg){
+    return searchStopped(((TrieResults *)arg)->search);
+}
+
+/*
+*   Collects the line \a line with the distance \a score into \a results (room for 
+*  \a cap of them), a max-heap of the first lines by number, if the line is among
+*  them: lines do not come in order, so the line replaces the last one that fits. 
+*  \a *n counts all the lines collected, also the ones that do not fit.
+*/
+static void collectFirstLine(GedResult *results, int cap, int *n, int line, double score){
+    if(*n < cap){
+        results[*n].line  = line;
+        results[*n].score = score;
+        siftUpResult(results, *n, isLaterResult);
+    } else if(cap > 0 && line < results[0].line){
+        results[0].line  = line;
+        results[0].score = score;
+        siftDownResult(results, cap, 0, isLaterResult);
+    }
+    (*n)++;
+}
+
+// Collects a line within the maximum distance, found in the trie
+static void trieThresholdResult(void *arg, int line, double full, double prefix){
+    TrieResults *r = (TrieResults *)arg;
+    double score = trieResultScore(r, line, full, prefix);
+
+    if(score <= r->limit)
+        collectFirstLine(r->results, r->cap, &r->n, line, score);
+}
+
+// Finds all lines of the dictionary within the maximum distance
+int gedSearchThreshold(GedSearch *search, GedDictionary *dict, int mode, double max,
+                       GedResult *results, int capacity){
+    double scores[LINE_BLOCK_SIZE];
+    wchar_t *words[LINE_BLOCK_SIZE];
+    int lens[LINE_BLOCK_SIZE];
+    DecodedDictionary *d = dict->dict;
+    int *lines = NULL;  // lines of suitable length, if not all of them are scored
+    int nLines = d->n;
+    int cap = (capacity > 0) ? capacity : 0;
+    int minLen, maxLen, first, end;
+    int from, k, n, stop;
+    int count = 0;
+    GedQuery *tq;
+    DictionaryTrie *t;
+
+    if(!isMatchType(mode) || dict->engine != search->query->engine)
+        return -1;
+    // full and prefix matches are searched in the trie, the lines sharing a prefix together (suffix matches backwards)
+    if((tq = trieQuery(search, mode)) != NULL){
+        TrieResults r = { search, d, mode, max, mirroredLimit(max), results, 0, cap };
+        t = (mode == GED_MATCH_SUFFIX) ? d->reversedTrie : d->trie;
+        if((stop = searchDictionaryTrie(t, 0, t->nNodes, tq, (mode == GED_MATCH_SUFFIX) ? &r.mirrorLimit : &r.limit, 
+                                        mode != GED_MATCH_FULL, trieThresholdResult, trieSearchStopped, &r, 
+                                        &search->trie)) != 0)
+            return stop;
+        qsort(results, (r.n < r.cap) ? r.n : r.cap, sizeof(GedResult), compareResultLines);
+        return r.n;
+    }
+    // full matches are only searched among the lines of suitable length, in the order of the length index
+    if(mode == GED_MATCH_FULL){
+        fullMatchLengths(search->query, max, &minLen, &maxLen);
+        lengthIndexRange(d, minLen, maxLen, &first, &end);
+        if(end - first < d->n){
+            lines  = d->byLength + first;
+            nLines = end - first;
+        }
+    }
+    for(from = 0; from < nLines; from += LINE_BLOCK_SIZE){
+        if((stop = searchStopped(search)) != 0)
+            return stop;
+        n = (nLines - from < LINE_BLOCK_SIZE) ? nLines - from : LINE_BLOCK_SIZE;
+        if(lines != NULL){
+            for(k = 0; k < n; k++){
+                words[k] = d->words[lines[from + k]];
+                lens[k]  = d->lens[lines[from + k]];
+            }
+            scoreMode(search, words, lens, n, mode, max, scores);
+        } else
+            scoreMode(search, d->words + from, d->lens + from, n, mode, max, scores);
+        for(k = 0; k < n; k++){
+            if(scores[k] > max)
+                continue;
+            if(lines != NULL)
+                collectFirstLine(results, cap, &count, lines[from + k], scores[k]);
+            else {
+                if(count < cap){
+                    results[count].line  = from + k;
+                    results[count].score = scores[k];
+                }
+                count++;
+            }
+        }
+    }
+    if(lines != NULL)
+        qsort(results, (count < cap) ? count : cap, sizeof(GedResult), compareResultLines);
+    return count;
+}
+
+// Collects a line into the heap of the best results, if it is better than the worst of them
+static void trieBestResult(void *arg, int line, double full, double prefix){
+    TrieResults *r = (TrieResults *)arg;
+    GedResult result;
+
+    result.line  = line;
+    result.score = trieResultScore(r, line, full, prefix);
+    if(result.score == DBL_MAX)
+        return;
+    if(r->n < r->cap){
+        r->results[r->n] = result;
+        siftUpResult(r->results, r->n++, isWorseResult);
+    } else if(isWorseResult(&r->results[0], &result)){
+        // lines do not come in order: an equal distance and a smaller line make a line better
+        r->results[0] = result;
+        siftDownResult(r->results, r->cap, 0, isWorseResult);
+    }
+    if(r->n == r->cap){
+        r->limit = r->results[0].score;
+        r->mirrorLimit = mirroredLimit(r->limit);
+    }
+}
+
+// Finds N lines of the dictionary with the smallest distances
+int gedSearchBest(GedSearch *search, GedDictionary *dict, int mode, int n, GedResult *results){
+    double scores[LINE_BLOCK_SIZE];
+    DecodedDictionary *d = dict->dict;
+    double limit = DBL_MAX;
+    int from, k, m, stop;
+    int count = 0;
+    GedQuery *tq;
+    DictionaryTrie *t;
+
+    if(!isMatchType(mode) || dict->engine != search->query->engine)
+        return -1;
+    if(n <= 0)
+        return 0;
+    // the results buffer holds a max-heap of the best results found so far
+    if((tq = trieQuery(search, mode)) != NULL){
+        TrieResults r = { search, d, mode, DBL_MAX, DBL_MAX, results, 0, n };
+        t = (mode == GED_MATCH_SUFFIX) ? d->reversedTrie : d->trie;
+        if((stop = searchDictionaryTrie(t, 0, t->nNodes, tq, (mode == GED_MATCH_SUFFIX) ? &r.mirrorLimit : &r.limit, 
+                                        mode != GED_MATCH_FULL, trieBestResult, trieSearchStopped, &r,
+                                        &search->trie)) != 0)
+            return stop;
+        qsort(results, r.n, sizeof(GedResult), compareResults);
+        return r.n;
+    }
+    for(from = 0; from < d->n; from += LINE_BLOCK_SIZE){
+        if((stop = searchStopped(search)) != 0)
+            return stop;
+        m = (d->n - from < LINE_BLOCK_SIZE) ? d->n - from : LINE_BLOCK_SIZE;
+        scoreMode(search, d->words + from, d->lens + from, m, mode, limit, scores);
+        for(k = 0; k < m; k++){
+            if(scores[k] == DBL_MAX)
+                continue;
+            if(count < n){
+                results[count].line  = from + k;
+                results[count].score = scores[k];
+                siftUpResult(results, count++, isWorseResult);
+            } else if(scores[k] < results[0].score){
+                // lines come in increasing order: an equal distance does not make a line better
+                results[0].line  = from + k;
+                results[0].score = scores[k];
+                siftDownResult(results, n, 0, isWorseResult);
+            }
+            if(count == n)
+                limit = results[0].score;
+        }
+    }
+    qsort(results, count, sizeof(GedResult), compareResults);
+    return count;
+}
+
+// Releases the workspaces of the calling thread
+void gedReleaseThread(){
+    freeDefaultWorkspaces();
+    if(textChars != NULL){
+        free(textChars);
+        textChars = NULL;
+        textCap = 0;
+    }
+}
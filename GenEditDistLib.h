@@ -0,0 +1,220 @@
+/*
+*    Copyright (C) 2010 University of Tartu
+*    Authors: Reina Krik, Siim Orasmaa, Kristo Tammeoja, Jaak Vilo
+*    Contact:  siim . orasmaa {at} ut . ee
+*
+*    This file is part of Generalized Edit Distance Tool.
+*
+*    Generalized Edit Distance Tool is free software: you can redistribute 
+*    it and/or modify it under the terms of the GNU General Public License 
+*    as published by the Free Software Foundation, either version 3 of the
+*    License, or (at your option) any later version.
+*
+*    Generalized Edit Distance Tool is distributed in the hope that it will 
+*    be useful, but WITHOUT ANY WARRANTY; without even the implied warranty 
+*    of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*    GNU General Public License for more details.
+*
+*    You should have received a copy of the GNU General Public License
+*    along with Generalized Edit Distance Tool. 
+*    If not, see <http://www.gnu.org/licenses/>.
+*
+*/
+
+#ifndef GENEDITDISTLIB_H
+#define GENEDITDISTLIB_H
+
+/*
+*   C interface of the generalized edit distance library ( libgeneditdist.a ,
+*   libgeneditdist.so ): the same searches as the command line tool 
+*   genEditDist , without spawning a process and parsing its output.
+*
+*   Rule sets (transformations and the 'ignore case' list) and dictionaries
+*   are loaded once into handles; a search string is compiled into a 
+*   \c GedSearch handle, which can then be scored against single texts, 
+*   arrays of texts or a whole dictionary. Results are written into buffers
+*   given by the caller, and the workspaces of the calculation are reused 
+*   between calls, so that scoring does not allocate memory per call.
+*
+*   Strings are converted into wide-character strings according to the 
+*   current locale ( \c LC_CTYPE ), which must be set by the caller, e.g.
+*   with \c setlocale(LC_CTYPE,"") , just as the command line tool does.
+*   Files that cannot be loaded (e.g. malformed rule files) do not stop the
+*   process: the loading functions return \c NULL instead.
+*
+*   Threads: rule sets and dictionaries are read-only once loaded and can
+*   be used by several threads at once; a \c GedSearch handle must be used 
+*   by one thread at a time. A thread that has used the library should call
+*   \c gedReleaseThread() before it ends.
+*/
+
+/**
+*   Match types: the search string must match the full text, a prefix, an
+*   infix or a suffix of it (flags "-f", "-p", "-i" and "-s" of the command
+*   line tool).
+*/
+#define GED_MATCH_FULL    1
+#define GED_MATCH_PREFIX  2
+#define GED_MATCH_INFIX   3
+#define GED_MATCH_SUFFIX  4
+
+/**
+*   Return values of the dictionary searches that have been stopped: the
+*   deadline of the search has passed ( \c GED_TIMEOUT ) or the search has
+*   been cancelled ( \c GED_CANCELLED ). See \a gedSetDeadline() and 
+*   \a gedSetCancelFlag() .
+*/
+#define GED_TIMEOUT    -2
+#define GED_CANCELLED  -3
+
+/** Transformations, costs of default operations and the 'ignore case' list. */
+typedef struct GedRuleSet GedRuleSet;
+
+/** Dictionary file decoded for searching with a rule set. */
+typedef struct GedDictionary GedDictionary;
+
+/** Search string compiled for a rule set. */
+typedef struct GedSearch GedSearch;
+
+/**
+*   A match found in a dictionary: the line number \a line (counted from 0)
+*   and the generalized edit distance \a score .
+*/
+typedef struct GedResult {
+    int line;
+    double score;
+} GedResult;
+
+/**
+*   Loads transformations from the file \a rulesFile (format of the command 
+*   line tool). If \a ignoreCaseFile is not \c NULL , the search is made case
+*   insensitive with the list of transformations in the file. \a rulesFile 
+*   can also be a rule set compiled with "genEditDist --compile-rules" (with
+*   the same ignore case file). Returns \c NULL , if a file cannot be read,
+*   the transformations file has a malformed line or the compiled rule set 
+*   does not suit \a ignoreCaseFile (the reason is printed to \c stderr ).
+*   The rule set must be released with \a gedFreeRuleSet() .
+*/
+GedRuleSet *gedLoadRuleSet(const char *rulesFile, const char *ignoreCaseFile);
+
+/**
+*   Releases memory under \a rules . Dictionaries and searches of the rule 
+*   set must be released before.
+*/
+void gedFreeRuleSet(GedRuleSet *rules);
+
+/**
+*   Loads the dictionary file \a file (one entry per line) for searching with
+*   \a rules . The file can also be a dictionary image built with 
+*   "genEditDist --build-dict" (with the ignore case file of \a rules ): it
+*   is only mapped into memory. Returns \c NULL , if the file cannot be read,
+*   one of its lines cannot be converted into a wide-character string or the
+*   image does not suit \a rules . The dictionary must be released with 
+*   \a gedFreeDictionary() .
+*/
+GedDictionary *gedLoadDictionary(GedRuleSet *rules, const char *file);
+
+/**
+*   Returns the number of lines in \a dict .
+*/
+int gedDictionarySize(GedDictionary *dict);
+
+/**
+*   Returns the line \a line of \a dict as it is in the file (not terminated
+*   with \c '\0' ), and stores its length in bytes into \a *len . Returns 
+*   \c NULL , if there is no such line.
+*/
+const char *gedDictionaryLine(GedDictionary *dict, int line, int *len);
+
+/**
+*   Releases memory under \a dict .
+*/
+void gedFreeDictionary(GedDictionary *dict);
+
+/**
+*   Compiles the search string \a query for \a rules . If \a blockChanges is 
+*   set, characters '(', ')', '<' and '>' surround the regions of the string 
+*   that cannot be changed (flag "-e" of the command line tool). Returns
+*   \c NULL , if \a query cannot be converted into a wide-character string.
+*   The search must be released with \a gedFreeSearch() .
+*/
+GedSearch *gedCompileSearch(GedRuleSet *rules, const char *query, int blockChanges);
+
+/**
+*   Releases memory under \a search .
+*/
+void gedFreeSearch(GedSearch *search);
+
+/**
+*   Sets the deadline of the dictionary searches with \a search : searches
+*   give up \a ms milliseconds from now and return \c GED_TIMEOUT . No 
+*   deadline is set, if \a ms \c <= \c 0 .
+*/
+void gedSetDeadline(GedSearch *search, long ms);
+
+/**
+*   Sets the flag that cancels the dictionary searches with \a search : as
+*   soon as \a *cancel is set to non-zero (e.g. from another thread), the
+*   searches give up and return \c GED_CANCELLED . \c NULL removes the flag.
+*/
+void gedSetCancelFlag(GedSearch *search, volatile int *cancel);
+
+/**
+*   Returns the generalized edit distance between the search string of 
+*   \a search and \a text , for the match type \a mode ( \c GED_MATCH_* ).
+*   Returns a negative value, if \a mode is unknown or \a text cannot be 
+*   converted into a wide-character string.
+*/
+double gedScore(GedSearch *search, const char *text, int mode);
+
+/**
+*   Finds the generalized edit distances between the search string of 
+*   \a search and each of the \a n texts \a texts , for the match type
+*   \a mode , and stores them into \a scores[0..n-1] (negative values for 
+*   texts that cannot be converted). Texts are scored several at a time,
+*   if the transformations allow it. Returns 0 on success and -1 if 
+*   \a mode is unknown.
+*/
+int gedScoreTexts(GedSearch *search, const char **texts, int n, int mode, double *scores);
+
+/**
+*   Finds the generalized edit distances between \a n pairs of strings 
+*   \a queries[k] and \a texts[k] , for the match type \a mode , and stores 
+*   them into \a scores[0..n-1] (negative values for strings that cannot be
+*   converted). A search string is compiled only once for consecutive pairs
+*   with the same query, so pairs should be grouped by query. Returns 0 on
+*   success and -1 if \a mode is unknown.
+*/
+int gedScorePairs(GedRuleSet *rules, const char **queries, const char **texts, int n, 
+                  int mode, int blockChanges, double *scores);
+
+/**
+*   Finds all lines of \a dict whose generalized edit distance from the 
+*   search string of \a search (match type \a mode ) is less than or equal
+*   to \a max . Up to \a capacity matches are stored into \a results , in 
+*   the order of the lines. Returns the number of all matches (may exceed 
+*   \a capacity ), -1 if \a mode is unknown or \a dict was loaded for
+*   another rule set, or \c GED_TIMEOUT / \c GED_CANCELLED if the search 
+*   has been stopped.
+*/
+int gedSearchThreshold(GedSearch *search, GedDictionary *dict, int mode, double max,
+                       GedResult *results, int capacity);
+
+/**
+*   Finds \a n lines of \a dict with the smallest generalized edit distances
+*   from the search string of \a search (match type \a mode ), and stores them
+*   into \a results , ordered by the distance (and by the line number, among
+*   equal distances; lines beyond the \a n -th are left out even if their 
+*   distance is equal to it). Returns the number of matches stored (less 
+*   than \a n , if the dictionary is smaller), -1 if \a mode is unknown
+*   or \a dict was loaded for another rule set, or \c GED_TIMEOUT / 
+*   \c GED_CANCELLED if the search has been stopped.
+*/
+int gedSearchBest(GedSearch *search, GedDictionary *dict, int mode, int n, GedResult *results);
+
+/**
+*   Releases the workspaces the calling thread has used for scoring.
+*/
+void gedReleaseThread();
+
+#endif
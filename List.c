@@ -52,41 +52,21 @@ int wchar_len(wchar_t *str){
     return len;
 }
 
-// creates new list
-List *createList(){
-  List *list;
-  list = (List*)malloc(sizeof(List));
-  if(list == NULL)
-    abort();
-  list->firstItem = NULL;
-  return list;
-}
-
-// creates new index
-Index *createIndex(int i, int j){
-    Index *index;
-
-    index = (Index*)malloc(sizeof(Index));
-    if(index == NULL)
+// creates new collector of best matches
+TopList *createTopList(int capacity){
+    TopList *list;
+    list = (TopList*)malloc(sizeof(TopList));
+    if(list == NULL)
         abort();
-
-    index->i = i;
-    index->j = j;
-    index->nextIndex = NULL;
-    return index;
-}
-
-// creates new list item
-ListItem *createListItem(double v, int i, int j){
-	ListItem *item;
-	item = (ListItem *)malloc(sizeof(ListItem));
-	if(item == NULL)
-		abort();
-
-	item->value = v;
-	item->index = createIndex(i, j);
-	item->nextItem = NULL;
-	return item;
+    list->capacity = capacity;
+    list->n = 0;
+    list->itemCap = 0;
+    list->items = NULL;
+    list->nTies = 0;
+    list->tieCap = 0;
+    list->ties = NULL;
+    list->cutoff = (capacity > 0) ? DBL_MAX : 0.0;
+    return list;
 }
 
 // creates new upper-case to lower-case transformation
@@ -102,148 +82,122 @@ IgnoreCaseListElement *createIgnoreCaseElement(wchar_t *l, wchar_t *r){
     return e;
 }
 
-// removes last element, the first element will never be removed
-int removeLastItem(ListItem *li){
-    ListItem *nextItem;
-    Index *index;
-    Index *nextI;
-    int find = 1;
-
-    while( find && li->nextItem != NULL ){
-        if(li->nextItem->nextItem == NULL){ // this is the item that should be removed
-            nextItem = li->nextItem;
-            li->nextItem = NULL;
-            lastBest = li->value;
-
-            index = nextItem->index;
-            nextItem->index = NULL;
-            while(index != NULL){
-                nextI = index->nextIndex;
-                index->nextIndex = NULL;
-                free(index);
-                index = nextI;
-            }
-            free(nextItem);
-            return 0;
-        }
-        li = li->nextItem;
+// appends an item to the array, growing it when needed
+static TopItem *appendTopItem(TopItem *items, int *n, int *cap, TopItem item){
+    if(*n == *cap){
+        *cap = (*cap == 0) ? 64 : 2 * (*cap);
+        items = (TopItem *)realloc(items, (*cap) * sizeof(TopItem));
+        if(items == NULL)
+            abort();
     }
-    return 0;
+    items[(*n)++] = item;
+    return items;
 }
 
-// Adds position indexes to given list item
-int insertValues(ListItem * li, int i, int j){
-    Index *index;
-    index = li->index;
-
-    while(index->nextIndex != NULL){
-        index = index->nextIndex;
+// moves the last item of the heap up to its place
+static void siftUpTopItem(TopItem *heap, int k){
+    TopItem item = heap[k];
+    while(k > 0 && heap[(k - 1) / 2].value < item.value){
+        heap[k] = heap[(k - 1) / 2];
+        k = (k - 1) / 2;
     }
-    index->nextIndex = createIndex(i, j);
-    return 0;
+    heap[k] = item;
 }
 
+// moves the first item of the heap down to its place
+static void siftDownTopItem(TopItem *heap, int n){
+    TopItem item = heap[0];
+    int k = 0;
+    int child;
+    while((child = 2*k + 1) < n){
+        if(child + 1 < n && heap[child + 1].value > heap[child].value)
+            child++;
+        if(heap[child].value <= item.value)
+            break;
+        heap[k] = heap[child];
+        k = child;
+    }
+    heap[k] = item;
+}
 
-// insert new item into the list
-int insertListItem(List *list, double value, int i, int j, int isFull, int inserted){
-    ListItem *item;
-    ListItem *nextItem;
-    ListItem *newFirst;
-    int searchPlace = 1;
-    double v;
-
-    item = list->firstItem;
+// inserts new item into the collector of best matches
+int insertTopItem(TopList *list, double value, int i, int j){
+    TopItem item;
+    TopItem worst;
 
-    // the list is empty
-    if(item == NULL){
-        list->firstItem = createListItem(value, i, j);
-        lastBest = value;
-        inserted--;
-        return inserted;
+    if(value > list->cutoff)
+        return 0;
+    item.value = value;
+    item.i = i;
+    item.j = j;
+
+    // there's room in the heap
+    if(list->n < list->capacity){
+        list->items = appendTopItem(list->items, &list->n, &list->itemCap, item);
+        siftUpTopItem(list->items, list->n - 1);
+        if(list->n == list->capacity)
+            list->cutoff = list->items[0].value;
+        return 1;
     }
-
-    // this listItem should be the first?
-    if(value < item->value){
-        newFirst = createListItem(value, i, j);
-        newFirst->nextItem = item;
-        list->firstItem = newFirst;
-         if(isFull){
-            removeLastItem(list->firstItem);
-        }
-        inserted--;
-        return inserted;
+    // a tie with the worst item
+    if(value == list->cutoff || list->capacity == 0){
+        list->ties = appendTopItem(list->ties, &list->nTies, &list->tieCap, item);
+        return 1;
     }
+    /* the worst item is replaced; it stays as a tie only if some other
+       item still has the same value */
+    worst = list->items[0];
+    list->items[0] = item;
+    siftDownTopItem(list->items, list->n);
+    if(list->items[0].value == worst.value)
+        list->ties = appendTopItem(list->ties, &list->nTies, &list->tieCap, worst);
+    else
+        list->nTies = 0;
+    list->cutoff = list->items[0].value;
+    return 1;
+}
 
-    /* search the right place */
-    while(searchPlace){
-        // insert in the same list item
-        v = item->value;
-
-        if(item->value == value){
-             insertValues(item, i, j);
-             return inserted;
-        }
-        nextItem = item->nextItem;
+// orders items by value, then by position
+static int compareTopItems(const void *a, const void *b){
+    const TopItem *x = (const TopItem *)a;
+    const TopItem *y = (const TopItem *)b;
+    if(x->value != y->value)
+        return (x->value < y->value) ? -1 : 1;
+    return (x->i > y->i) - (x->i < y->i);
+}
 
-        // there is no next item
-        if(nextItem == NULL){
-            item->nextItem = createListItem(value, i, j);
-            lastBest = value;
-            inserted--;
-            return inserted;
-        }
-        // should we add a new list item between two existing items?
-        if(nextItem->value > value){
-            item->nextItem = createListItem(value, i, j);
-            item->nextItem->nextItem = nextItem;
-            if(isFull){
-                removeLastItem(list->firstItem);
-            }
-            inserted--;
-            return inserted;
-        }
-        item = item->nextItem;
-    }
+// sorts all collected items
+int sortTopList(TopList *list){
+    int k;
+    for(k = 0; k < list->nTies; k++)
+        list->items = appendTopItem(list->items, &list->n, &list->itemCap, list->ties[k]);
+    list->nTies = 0;
+    if(list->n > 1)
+        qsort(list->items, list->n, sizeof(TopItem), compareTopItems);
     return 0;
 }
 
-// Releases memory under the list
-void freeList(List *list){
-    ListItem *item;
-    item = list->firstItem;
-
-    // until the list is empty
-    while(item != NULL){
-        Index *index;
-        index = item->index;
-        while(index != NULL){
-            Index *nextIndex;
-            nextIndex = index->nextIndex;
-            free(index);
-            index = nextIndex;
-        }
-        ListItem *nextItem;
-        nextItem = item->nextItem;
-        free(item);
-        item = nextItem;
-    }
+// Releases memory under the collector of best matches
+void freeTopList(TopList *list){
+    free(list->items);
+    free(list->ties);
     free(list);
 }
 
 // adds new upper-case to lower-case transformation into the ignore case list
-int insertIgnoreCaseElement(wchar_t *l, wchar_t *r){
+int insertIgnoreCaseElement(IgnoreCaseListElement **list, wchar_t *l, wchar_t *r){
     IgnoreCaseListElement *current;
 
     // add as first element
-    if(ignoreCase == NULL){
+    if(*list == NULL){
         if(debug)
             puts("Inserting first element to ignore case list");
-        ignoreCase = createIgnoreCaseElement(l, r);
+        *list = createIgnoreCaseElement(l, r);
         return 0;
     }
     // first element already exists, add to the end
     else{
-        current = ignoreCase;
+        current = *list;
         while(current->next != NULL)
             current = current->next;
         // current->next == NULL
@@ -254,10 +208,89 @@ int insertIgnoreCaseElement(wchar_t *l, wchar_t *r){
     }
 }
 
-// frees memory under the list ignoreCase
-void freeIgnoreCaseList(){
+// compiles the ignore case list into tables of the transformed characters
+CaseTable *createCaseTable(IgnoreCaseListElement *list){
+    CaseTable *table;
+    IgnoreCaseListElement *el;
+    IgnoreCaseListElement **els;
+    unsigned int c, page;
+    int n = 0;
+    int k;
+
+    table = (CaseTable *)malloc(sizeof(CaseTable));
+    if(table == NULL)
+       abort();
+    table->list  = list;
+    table->bmp   = (wchar_t *)malloc(0x10000 * sizeof(wchar_t));
+    table->pages = (wchar_t **)calloc(CASE_TABLE_PAGES, sizeof(wchar_t *));
+    if(table->bmp == NULL || table->pages == NULL)
+       abort();
+    for(c = 0; c < 0x10000; c++)
+        table->bmp[c] = (wchar_t)c;
+
+    for(el = list; el != NULL; el = el->next)
+        n++;
+    els = (IgnoreCaseListElement **)malloc((n + 1) * sizeof(IgnoreCaseListElement *));
+    if(els == NULL)
+       abort();
+    for(el = list, k = 0; el != NULL; el = el->next, k++)
+        els[k] = el;
+    // the list is applied backwards, so the first transformation of a character overrides the others
+    for(k = n - 1; k >= 0; k--){
+        c = (unsigned int)els[k]->left[0];
+        if(c < 0x10000)
+            table->bmp[c] = els[k]->right[0];
+        else if(c < CASE_TABLE_PAGES * 256){
+            page = c >> 8;
+            if(table->pages[page] == NULL){
+                table->pages[page] = (wchar_t *)malloc(256 * sizeof(wchar_t));
+                if(table->pages[page] == NULL)
+                   abort();
+                for(c = 0; c < 256; c++)
+                    table->pages[page][c] = (wchar_t)((page << 8) | c);
+                c = (unsigned int)els[k]->left[0];
+            }
+            table->pages[page][c & 0xFF] = els[k]->right[0];
+        }
+    }
+    free(els);
+    return table;
+}
+
+// transforms a character with the compiled ignore case list
+wchar_t caseTableLookup(CaseTable *table, wchar_t c){
+    IgnoreCaseListElement *el;
+    wchar_t *page;
+
+    if((unsigned int)c < 0x10000)
+        return table->bmp[c];
+    if((unsigned int)c < CASE_TABLE_PAGES * 256){
+        page = table->pages[(unsigned int)c >> 8];
+        return (page != NULL) ? page[c & 0xFF] : c;
+    }
+    for(el = table->list; el != NULL; el = el->next)
+        if(c == el->left[0])
+            return el->right[0];
+    return c;
+}
+
+// frees memory under the compiled ignore case list
+void freeCaseTable(CaseTable *table){
+    int k;
+
+    if(table == NULL)
+        return;
+    for(k = 0; k < CASE_TABLE_PAGES; k++)
+        free(table->pages[k]);
+    free(table->pages);
+    free(table->bmp);
+    free(table);
+}
+
+// frees memory under the ignore case list
+void freeIgnoreCaseList(IgnoreCaseListElement *list){
    IgnoreCaseListElement *current;
-   current = ignoreCase;
+   current = list;
    while (current != NULL){
        IgnoreCaseListElement *next;
        next = current -> next;
@@ -270,24 +303,4 @@ void freeIgnoreCaseList(){
        free(current);
        current = next;
    }
-   ignoreCase = NULL;
-}
-
-// prints given list
-int printList(List *list){
-    ListItem *item;
-    Index *index;
-
-    item = list->firstItem;
-    while(item != NULL){
-        printf("\n %f \n", item->value);
-        index = item->index;
-        while(index != NULL){
-            printf("     i: %i  j: %i\n", index->i, index->j);
-            index = index->nextIndex;
-        }
-        puts("------------------------\n");
-        item = item->nextItem;
-    }
-    return 0;
 }
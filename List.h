@@ -30,43 +30,40 @@
 #include <stdio.h>
 #include <float.h>
 
-extern double lastBest;
 extern int debug;
 
 /**
-*  An element of the \a List . Holds \a value (which is usually edit 
-*  distance cost) and might hold several strings (given as a list of
-*  string positions \a index in a text) having that \a value. \a nextItem
-*  points to next element in \a List .
+*  An element of the \a TopList : a string at positions \a i (beginning
+*  index) and \a j (ending index) of a text, with edit distance \a value .
 */
-typedef struct ListItem{
-      double value;
-      struct Index *index;
-      struct ListItem *nextItem;
-} ListItem;
-
-/**
-*   A linked list for storing string positions grouped by values.
-*  Each element of the list may hold several strings (string positions) 
-*  which all have the same value. The structure is used in TOP N search 
-*  mode, for storing candidates for best matches.
-*/
-typedef struct List{
-    struct ListItem *firstItem;
-} List;
-
-/**
-*   A linked list of string positions. \a i is the beginning index and 
-*  \a j is ending index of the string in a text. The structure is used 
-*  in \c ListItem for storing strings (string positions) with the same 
-*  edit distance (\c value).
-*/
-typedef struct Index{
+typedef struct TopItem{
+    double value;
     int i;
     int j;
-    struct Index *nextIndex;
-} Index;
-
+} TopItem;
+
+/**
+*   Collector of the best matches for the TOP N search mode. Holds the
+*  \a capacity strings with the smallest values, and additionally all
+*  strings having the same value as the worst of them (ties with the last
+*  position are never dropped). Strings with values below the worst one
+*  are kept in a binary max-heap \a items ( \a n elements, the worst one
+*  first), ties of the worst value are appended into \a ties ( \a nTies
+*  elements). \a cutoff is the largest value that can still enter the
+*  collector: \c DBL_MAX until \a capacity strings have been collected,
+*  then the value of the worst string. Strings with a value exceeding
+*  \a cutoff need not be calculated to the end.
+*/
+typedef struct TopList{
+    int capacity;
+    int n;
+    int itemCap;
+    TopItem *items;
+    int nTies;
+    int tieCap;
+    TopItem *ties;
+    double cutoff;
+} TopList;
 
 /**
 *  A linked list for storing 'ignore case' transformations. The 
@@ -81,27 +78,34 @@ typedef struct IgnoreCaseListElement{
     struct IgnoreCaseListElement *next;
 } IgnoreCaseListElement;
 
-
 /**
-*   Creates new \a List. Returns pointer to aquired memory, which must
-*   freed afterwards. \a firstItem of the list will be set to NULL.
+*  The number of pages of 256 characters covered by \a CaseTable , up to
+*  U+10FFFF.
 */
-List *createList();
-
+#define CASE_TABLE_PAGES 0x1100
 
 /**
-*   Creates new \a Index. Returns pointer to aquired memory, which 
-*   must be freed afterwards. \a nextIndex of the list will be set to NULL.
+*  The 'ignore case' list compiled for look-ups in constant time: \a bmp 
+*  holds the transformed character of each character of the Basic 
+*  Multilingual Plane (U+0000 ... U+FFFF), and \a pages those of the 
+*  characters above it, in pages of 256 characters ( \c pages[c>>8] , \c NULL 
+*  if no character of the page is transformed). Characters beyond U+10FFFF 
+*  are looked up from the \a list itself.
 */
-Index *createIndex(int i, int j);
+typedef struct CaseTable{
+    wchar_t *bmp;
+    wchar_t **pages;
+    IgnoreCaseListElement *list;
+} CaseTable;
+
 
 /**
-*   Creates new \a ListItem. Returns pointer to aquired memory, 
-*   which must be freed afterwards. \a nextItem of the list will be set 
-*   to NULL.
+*   Creates new \a TopList for collecting \a capacity best strings. Returns
+*   pointer to aquired memory, which must be freed afterwards (via 
+*   \c freeTopList() ). If \a capacity is 0, only strings with value 0 
+*   (exact matches) are collected.
 */
-ListItem *createListItem(double v, int i, int j);
-
+TopList *createTopList(int capacity);
 
 /**
 *  Creates new \a IgnoreCaseListElement. Returns pointer to aquired memory, 
@@ -112,43 +116,54 @@ ListItem *createListItem(double v, int i, int j);
 IgnoreCaseListElement *createIgnoreCaseElement(wchar_t *l, wchar_t *r);
 
 /**
-*  Removes last item of the list \a *li . If there is only one element in
-*  given list, it won't be removed.
+*   Inserts positions \a i and \a j with given \a value into \a *list , if
+*   \a value does not exceed \c list->cutoff , and updates the cutoff. Takes
+*   O(log N) time. Returns 1 if the string was inserted, 0 otherwise.
 */
-int removeLastItem(ListItem *li);
+int insertTopItem(TopList *list, double value, int i, int j);
 
 /**
-*   Creates new \a Index and adds to given list item \a *li .
+*   Moves the ties into \a list->items and sorts all \a list->n strings in 
+*   ascending order of \c value ; strings with equal values are ordered by 
+*   their positions \c i . No insertions can be made after calling this.
 */
-int insertValues(ListItem * li, int i, int j);
+int sortTopList(TopList *list);
 
 /**
-*   Inserts positions \a i and \a j with given \a value to \a *list in a way
-*   that \a *list is sorted in ascending order of \c value . Returns 
-*   \a inserted \c - \c numberOfInsertionsMade . If \a isFull is set, removes
-*   last element (via \c removeLastItem() ) after insertion.
+*   Inserts new 'ignore case' transformation to the end of the list 
+*  \c **list ; an empty list is given as a pointer to \c NULL .
 */
-int insertListItem(List *list, double value, int i, int j, int isFull, int inserted);
+int insertIgnoreCaseElement(IgnoreCaseListElement **list, wchar_t *l, wchar_t *r);
 
 /**
-*   Inserts new 'ignore case' transformation into the list \c *ignoreCase .
+*   Releases memory under \c *list and all of its subelements.
 */
-int insertIgnoreCaseElement(wchar_t *l, wchar_t *r);
+void freeIgnoreCaseList(IgnoreCaseListElement *list);
 
 /**
-*   Releases memory under \c *ignoreCase and all of its subelements.
+*   Compiles the 'ignore case' list \c *list into a new \a CaseTable . As in
+*  the list, only the first transformation of a character counts. The list
+*  must not be changed nor released while the table is used. Memory under
+*  the table must be released with \c freeCaseTable() .
 */
-void freeIgnoreCaseList();
+CaseTable *createCaseTable(IgnoreCaseListElement *list);
 
 /**
-*   Releases memory under \c *list and all of its subelements.
+*   Transforms the character \a c with the table \a *table (see 
+*  \a CaseTable ): returns the right side of the first transformation of
+*  \a c in the list, or \a c itself if there is none.
 */
-void freeList(List *list);
+wchar_t caseTableLookup(CaseTable *table, wchar_t c);
 
 /**
-*   A debug method for printing given list.
-*/  
-int printList(List *list);
+*   Releases memory under \c *table (but not under its list).
+*/
+void freeCaseTable(CaseTable *table);
+
+/**
+*   Releases memory under \c *list and all of its elements.
+*/
+void freeTopList(TopList *list);
 
 /**
 *   Measures length of given wide-char string \a str . Expects that the string is 
@@ -163,7 +178,5 @@ int wchar_len(wchar_t *str);
 wchar_t *copy_wchar_t(wchar_t *str, int strLen);
 
 
-extern IgnoreCaseListElement *ignoreCase;
-
 #endif
 
@@ -0,0 +1,230 @@
+/*
+*    Copyright (C) 2010 University of Tartu
+*    Authors: Reina Krik, Siim Orasmaa, Kristo Tammeoja, Jaak Vilo
+*    Contact:  siim . orasmaa {at} ut . ee
+*
+*    This file is part of Generalized Edit Distance Tool.
+*
+*    Generalized Edit Distance Tool is free software: you can redistribute 
+*    it and/or modify it under the terms of the GNU General Public License 
+*    as published by the Free Software Foundation, either version 3 of the
+*    License, or (at your option) any later version.
+*
+*    Generalized Edit Distance Tool is distributed in the hope that it will 
+*    be useful, but WITHOUT ANY WARRANTY; without even the implied warranty 
+*    of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*    GNU General Public License for more details.
+*
+*    You should have received a copy of the GNU General Public License
+*    along with Generalized Edit Distance Tool. 
+*    If not, see <http://www.gnu.org/licenses/>.
+*
+*/
+
+#include "MyersEditDistance.h"
+
+// Finds the index of character c in the pattern, -1 if it does not occur
+static inline int patternCharIndex(MyersPattern *p, wchar_t c){
+    unsigned int h;
+    int k;
+    if((unsigned int)c < 256)
+        return p->byteIndex[(unsigned int)c];
+    h = ((unsigned int)c * 2654435761u) & (p->hashSize - 1);
+    while((k = p->hashIndex[h]) >= 0){
+        if(p->chars[k] == c)
+            return k;
+        h = (h + 1) & (p->hashSize - 1);
+    }
+    return -1;
+}
+
+// Compiles the search string for the bit-parallel calculation
+MyersPattern *createMyersPattern(wchar_t *a, int aLen){
+    MyersPattern *p;
+    int i, k;
+    unsigned int h;
+
+    p = (MyersPattern *)malloc(sizeof(MyersPattern));
+    if(p == NULL)
+        abort();
+    p->len = aLen;
+    p->words = (aLen + MYERS_WORD_BITS - 1) / MYERS_WORD_BITS;
+    p->string = (wchar_t *)malloc((aLen + 1) * sizeof(wchar_t));
+    p->chars  = (wchar_t *)malloc(aLen * sizeof(wchar_t));
+    // one extra all-zero mask for characters that do not occur in the search string
+    p->masks  = (uint64_t *)calloc((size_t)(aLen + 1) * p->words, sizeof(uint64_t));
+    // working vectors for both start variants of the match
+    p->Pv     = (uint64_t *)malloc(2 * p->words * sizeof(uint64_t));
+    p->Mv     = (uint64_t *)malloc(2 * p->words * sizeof(uint64_t));
+    p->hashSize = 16;
+    while(p->hashSize < 2 * aLen)
+        p->hashSize *= 2;
+    p->hashIndex = (int *)malloc(p->hashSize * sizeof(int));
+    if(p->string == NULL || p->chars == NULL || p->masks == NULL || 
+       p->Pv == NULL || p->Mv == NULL || p->hashIndex == NULL){
+        puts("Error: Could not allocate memory");
+        exit(1);
+    }
+    wmemcpy(p->string, a, aLen);
+    p->string[aLen] = L'\0';
+    for(k = 0; k < 256; k++)
+        p->byteIndex[k] = -1;
+    for(k = 0; k < p->hashSize; k++)
+        p->hashIndex[k] = -1;
+
+    p->nChars = 0;
+    for(i = 0; i < aLen; i++){
+        k = patternCharIndex(p, a[i]);
+        if(k < 0){
+            // a new distinct character
+            k = p->nChars++;
+            p->chars[k] = a[i];
+            if((unsigned int)a[i] < 256){
+                p->byteIndex[(unsigned int)a[i]] = k;
+            } else {
+                h = ((unsigned int)a[i] * 2654435761u) & (p->hashSize - 1);
+                while(p->hashIndex[h] >= 0)
+                    h = (h + 1) & (p->hashSize - 1);
+                p->hashIndex[h] = k;
+            }
+        }
+        p->masks[k * p->words + i / MYERS_WORD_BITS] |= (uint64_t)1 << (i % MYERS_WORD_BITS);
+    }
+    return p;
+}
+
+// Checks whether the pattern has been compiled from given search string
+int isMyersPatternOf(MyersPattern *p, wchar_t *a, int aLen){
+    return p->len == aLen && wmemcmp(p->string, a, aLen) == 0;
+}
+
+// Releases memory under the pattern
+void freeMyersPattern(MyersPattern *p){
+    free(p->string);
+    free(p->chars);
+    free(p->masks);
+    free(p->Pv);
+    free(p->Mv);
+    free(p->hashIndex);
+    free(p);
+}
+
+// Returns match mask of given text character
+static inline uint64_t *patternMasks(MyersPattern *p, wchar_t c){
+    int k = patternCharIndex(p, c);
+    if(k < 0)
+        k = p->len;   // the all-zero mask
+    return p->masks + k * p->words;
+}
+
+// Calculates edit distances with a search string fitting into a single word, for
+// the start variants v = vFrom..vTo (0: the match starts at the beginning of the text)
+static void myersDistancesSingle(MyersPattern *p, wchar_t *b, int bLen, int vFrom, int vTo, int *score, int *best){
+    uint64_t Pv[2], Mv[2];
+    uint64_t Eq, Xv, Xh, Ph, Mh;
+    uint64_t last = (uint64_t)1 << (p->len - 1);
+    int j, v;
+
+    for(v = vFrom; v <= vTo; v++){
+        Pv[v] = ~(uint64_t)0;
+        Mv[v] = 0;
+        score[v] = p->len;
+        best[v]  = INT32_MAX;
+    }
+    for(j = 0; j < bLen; j++){
+        Eq = *patternMasks(p, b[j]);
+        for(v = vFrom; v <= vTo; v++){
+            Xv = Eq | Mv[v];
+            Xh = (((Eq & Pv[v]) + Pv[v]) ^ Pv[v]) | Eq;
+            Ph = Mv[v] | ~(Xh | Pv[v]);
+            Mh = Pv[v] & Xh;
+            if(Ph & last) score[v]++;
+            else if(Mh & last) score[v]--;
+            // the first row of the table grows by 1 in each column only if the match 
+            // must start at the beginning of the text
+            Ph = (Ph << 1) | ((v == 0) ? 1 : 0);
+            Mh = Mh << 1;
+            Pv[v] = Mh | ~(Xv | Ph);
+            Mv[v] = Ph & Xv;
+            if(score[v] < best[v]) best[v] = score[v];
+        }
+    }
+}
+
+// Calculates edit distances with a search string split into blocks of words, for
+// the start variants v = vFrom..vTo (0: the match starts at the beginning of the text)
+static void myersDistancesBlocks(MyersPattern *p, wchar_t *b, int bLen, int vFrom, int vTo, int *score, int *best){
+    uint64_t *Pv, *Mv;
+    uint64_t *eqs;
+    uint64_t Eq, Xv, Xh, Ph, Mh, high;
+    int hin, hout;
+    int lastBits = p->len - (p->words - 1) * MYERS_WORD_BITS;
+    int j, w, v;
+
+    for(v = vFrom; v <= vTo; v++){
+        for(w = 0; w < p->words; w++){
+            p->Pv[v * p->words + w] = ~(uint64_t)0;
+            p->Mv[v * p->words + w] = 0;
+        }
+        score[v] = p->len;
+        best[v]  = INT32_MAX;
+    }
+    for(j = 0; j < bLen; j++){
+        eqs = patternMasks(p, b[j]);
+        for(v = vFrom; v <= vTo; v++){
+            Pv = p->Pv + v * p->words;
+            Mv = p->Mv + v * p->words;
+            // horizontal difference entering the first block: from the first row of the table
+            hin = (v == 0) ? 1 : 0;
+            for(w = 0; w < p->words; w++){
+                high = (uint64_t)1 << ((w == p->words - 1) ? lastBits - 1 : MYERS_WORD_BITS - 1);
+                Eq = eqs[w];
+                Xv = Eq | Mv[w];
+                if(hin < 0) Eq |= 1;
+                Xh = (((Eq & Pv[w]) + Pv[w]) ^ Pv[w]) | Eq;
+                Ph = Mv[w] | ~(Xh | Pv[w]);
+                Mh = Pv[w] & Xh;
+                hout = (Ph & high) ? 1 : ((Mh & high) ? -1 : 0);
+                Ph <<= 1;
+                Mh <<= 1;
+                if(hin < 0) Mh |= 1;
+                else if(hin > 0) Ph |= 1;
+                Pv[w] = Mh | ~(Xv | Ph);
+                Mv[w] = Ph & Xv;
+                hin = hout;
+            }
+            score[v] += hin;
+            if(score[v] < best[v]) best[v] = score[v];
+        }
+    }
+}
+
+// Calculates edit distances of the start variants vFrom..vTo side by side
+static void myersStartVariants(MyersPattern *p, wchar_t *b, int bLen, int vFrom, int vTo, int *score, int *best){
+    if(p->words == 1)
+        myersDistancesSingle(p, b, bLen, vFrom, vTo, score, best);
+    else
+        myersDistancesBlocks(p, b, bLen, vFrom, vTo, score, best);
+}
+
+// Calculates regular edit distance between the compiled search string and the text
+int myersDistance(MyersPattern *p, wchar_t *b, int bLen, short isPrefix, short isSuffix){
+    int score[2], best[2];
+    int v = (isPrefix) ? 0 : 1;
+    myersStartVariants(p, b, bLen, v, v, score, best);
+    return (isSuffix) ? score[v] : best[v];
+}
+
+// Calculates regular edit distances of several match types in a single pass over the text
+void myersDistances(MyersPattern *p, wchar_t *b, int bLen, int *full, int *prefix, int *suffix, int *infix){
+    int score[2], best[2];
+    int vFrom = (full != NULL || prefix != NULL) ? 0 : 1;
+    int vTo   = (suffix != NULL || infix != NULL) ? 1 : 0;
+    if(vFrom > vTo)
+        return;
+    myersStartVariants(p, b, bLen, vFrom, vTo, score, best);
+    if(full != NULL)   *full   = score[0];
+    if(prefix != NULL) *prefix = best[0];
+    if(suffix != NULL) *suffix = score[1];
+    if(infix != NULL)  *infix  = best[1];
+}
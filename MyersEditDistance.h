@@ -0,0 +1,115 @@
+/*
+*    Copyright (C) 2010 University of Tartu
+*    Authors: Reina Krik, Siim Orasmaa, Kristo Tammeoja, Jaak Vilo
+*    Contact:  siim . orasmaa {at} ut . ee
+*
+*    This file is part of Generalized Edit Distance Tool.
+*
+*    Generalized Edit Distance Tool is free software: you can redistribute 
+*    it and/or modify it under the terms of the GNU General Public License 
+*    as published by the Free Software Foundation, either version 3 of the
+*    License, or (at your option) any later version.
+*
+*    Generalized Edit Distance Tool is distributed in the hope that it will 
+*    be useful, but WITHOUT ANY WARRANTY; without even the implied warranty 
+*    of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*    GNU General Public License for more details.
+*
+*    You should have received a copy of the GNU General Public License
+*    along with Generalized Edit Distance Tool. 
+*    If not, see <http://www.gnu.org/licenses/>.
+*
+*/
+
+#ifndef MYERSEDITDISTANCE_H
+#define MYERSEDITDISTANCE_H
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <wchar.h>
+
+/**
+*   Number of bits in a word of the bit-parallel calculation.
+*/
+#define MYERS_WORD_BITS  64
+
+/**
+*   Search string compiled for the bit-parallel (Myers/Hyyr) calculation
+*  of regular edit distance, where cost of every operation is 1.
+*
+*   For each distinct character of the search string, a bit-vector of 
+*  \a words words shows the positions where the character occurs in the 
+*  search string ( \a masks \c + \c k \c * \a words for the k-th character 
+*  in \a chars ). Characters below 256 are looked up via \a byteIndex , 
+*  other characters via the hash table \a hashIndex ; both hold the index
+*  of the character in \a chars , or -1 if the character does not occur in
+*  the search string.
+*
+*   \a Pv and \a Mv are working vectors of the calculation (positive and 
+*  negative vertical differences in the edit distance table): \a words words
+*  for the match starting at the beginning of the text, followed by \a words
+*  words for the match starting anywhere in the text.
+*/
+typedef struct MyersPattern {
+    wchar_t *string;
+    int len;
+    int words;
+    int nChars;
+    wchar_t *chars;
+    uint64_t *masks;
+    int byteIndex[256];
+    int *hashIndex;
+    int hashSize;
+    uint64_t *Pv;
+    uint64_t *Mv;
+} MyersPattern;
+
+/**
+*   Compiles search string \a *a of length \a aLen ( \a aLen \c > \c 0 ) for the 
+*   bit-parallel calculation. Contents of \a *a is copied. Memory under the
+*   pattern must be released with \a freeMyersPattern() .
+*/
+MyersPattern *createMyersPattern(wchar_t *a, int aLen);
+
+/**
+*   Checks, whether \a *p has been compiled from the search string \a *a of 
+*   length \a aLen .
+*/
+int isMyersPatternOf(MyersPattern *p, wchar_t *a, int aLen);
+
+/**
+*   Releases memory under \a *p .
+*/
+void freeMyersPattern(MyersPattern *p);
+
+/**
+*   Calculates regular edit distance (cost of every operation is 1) between 
+*   the compiled search string \a *p and text \a *b , allowing only a partial 
+*   match with \a b in the same way as \a genEditDistance_mod() does. 
+*   Search strings longer than \c MYERS_WORD_BITS characters are handled 
+*   in blocks of \c MYERS_WORD_BITS rows.
+*
+*  \param p compiled search string
+*  \param b text
+*  \param bLen length of b ( \a bLen \c > \c 0 )
+*  \param isPrefix 1 if prefix cannot be skipped, 0 if it can be skipped
+*  \param isSuffix 1 if suffix cannot be skipped, 0 if it can be skipped
+*/
+int myersDistance(MyersPattern *p, wchar_t *b, int bLen, short isPrefix, short isSuffix);
+
+/**
+*   Calculates regular edit distances of full, prefix, suffix and infix matches 
+*   (see \a myersDistance() ) between the compiled search string \a *p and text 
+*   \a *b in a single pass over the text: matches starting at the beginning of
+*   the text (full, prefix) and matches starting anywhere (suffix, infix) are 
+*   calculated side by side, and both yield two scores (the last column and the 
+*   best column). Scores are stored only for match types whose pointer is not NULL.
+*
+*  \param p compiled search string
+*  \param b text
+*  \param bLen length of b ( \a bLen \c > \c 0 )
+*/
+void myersDistances(MyersPattern *p, wchar_t *b, int bLen, int *full, int *prefix, int *suffix, int *infix);
+
+#endif
@@ -0,0 +1,732 @@
+/*
+*    Copyright (C) 2010 University of Tartu
+*    Authors: Reina Krik, Siim Orasmaa, Kristo Tammeoja, Jaak Vilo
+*    Contact:  siim . orasmaa {at} ut . ee
+*
+*    This file is part of Generalized Edit Distance Tool.
+*
+*    Generalized Edit Distance Tool is free software: you can redistribute 
+*    it and/or modify it under the terms of the GNU General Public License 
+*    as published by the Free Software Foundation, either version 3 of the
+*    License, or (at your option) any later version.
+*
+*    Generalized Edit Distance Tool is distributed in the hope that it will 
+*    be useful, but WITHOUT ANY WARRANTY; without even the implied warranty 
+*    of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*    GNU General Public License for more details.
+*
+*    You should have received a copy of the GNU General Public License
+*    along with Generalized Edit Distance Tool. 
+*    If not, see <http://www.gnu.org/licenses/>.
+*
+*/
+
+#include "RuleMatches.h"
+#include "FileToTrie.h"
+
+// Creates an empty alphabet for up to nChars characters
+Alphabet *createAlphabet(int nChars){
+    Alphabet *s;
+    int i;
+
+    s = (Alphabet *)malloc(sizeof(Alphabet));
+    if(s == NULL)
+        abort();
+    s->hashSize = 16;
+    while(s->hashSize < 2 * nChars)
+        s->hashSize *= 2;
+    s->hashChars   = (wchar_t *)malloc(s->hashSize * sizeof(wchar_t));
+    s->hashSymbols = (int *)malloc(s->hashSize * sizeof(int));
+    if(s->hashChars == NULL || s->hashSymbols == NULL)
+        abort();
+    for(i = 0; i < 256; i++)
+        s->byteSymbol[i] = 0;
+    for(i = 0; i < s->hashSize; i++)
+        s->hashSymbols[i] = -1;
+    s->nSymbols = 1;
+    return s;
+}
+
+// Adds character c to the alphabet (if it is not there yet)
+void addAlphabetSymbol(Alphabet *s, wchar_t c){
+    unsigned int h;
+    if(alphabetSymbol(s, c) != 0)
+        return;
+    if((unsigned int)c < 256){
+        s->byteSymbol[(unsigned int)c] = s->nSymbols++;
+        return;
+    }
+    h = ((unsigned int)c * 2654435761u) & (s->hashSize - 1);
+    while(s->hashSymbols[h] >= 0)
+        h = (h + 1) & (s->hashSize - 1);
+    s->hashChars[h]   = c;
+    s->hashSymbols[h] = s->nSymbols++;
+}
+
+// Releases memory under the alphabet
+void freeAlphabet(Alphabet *s){
+    free(s->hashChars);
+    free(s->hashSymbols);
+    free(s);
+}
+
+// Appends a match to the array, growing it if necessary
+static QueryMatch *appendQueryMatch(QueryMatch *matches, int *n, int *cap, int span, double cost, EndNode *replacement){
+    if(*n == *cap){
+        *cap = (*cap > 0) ? 2 * (*cap) : 16;
+        matches = (QueryMatch *)realloc(matches, *cap * sizeof(QueryMatch));
+        if(matches == NULL){
+            puts("Error: Could not allocate memory");
+            exit(1);
+        }
+    }
+    matches[*n].span = span;
+    matches[*n].cost = cost;
+    matches[*n].replacement = replacement;
+    matches[*n].firstRight = 0;
+    matches[*n].nRights = 0;
+    (*n)++;
+    return matches;
+}
+
+// Tells whether the right side of a 'replace' operation of given span goes to the dense tables
+static inline int isSingleRight(EndNode *n, int span){
+    return span == 1 && n->edit[0] != L'\0' && n->edit[1] == L'\0';
+}
+
+// Finds matches of transformations at every position of the search string
+QueryMatches *createQueryMatches(wchar_t *a, int aLen, Trie *repT, ARTrie *addT, ARTrie *remT, TextMatcher *m){
+    QueryMatches *q;
+    FrozenTrie *rem = frozenARTrie(remT);
+    FrozenTrie *repl = frozenTrie(repT);
+    FrozenTrie *add = frozenARTrie(addT);
+    int node;
+    EndNode *n;
+    int remCap = 0, repCap = 0, rightCap = 0;
+    int nRem = 0, nRep = 0, nRight = 0;
+    int rows = aLen + 1;
+    int i, r, k, s, nChars, listed;
+
+    q = (QueryMatches *)malloc(sizeof(QueryMatches));
+    if(q == NULL)
+        abort();
+    q->len = aLen;
+    q->string   = (wchar_t *)malloc((aLen + 1) * sizeof(wchar_t));
+    q->remStart = (int *)malloc((aLen + 1) * sizeof(int));
+    q->repStart = (int *)malloc((aLen + 1) * sizeof(int));
+    if(q->string == NULL || q->remStart == NULL || q->repStart == NULL){
+        puts("Error: Could not allocate memory");
+        exit(1);
+    }
+    wmemcpy(q->string, a, aLen);
+    q->string[aLen] = L'\0';
+    q->remMatches = NULL;
+    q->repMatches = NULL;
+    q->rights = NULL;
+
+    // alphabet of the dense tables: characters produced by single-character transformations
+    nChars = add->nodes[0].endChild - add->nodes[0].firstChild;
+    for(i = 0; i < aLen; i++){
+        node = frozenChild(repl, 0, a[i]);
+        for(n = (node >= 0) ? repl->nodes[node].replacement : NULL; n != NULL; n = n->nextEN)
+            nChars++;
+    }
+    q->alphabet = createAlphabet(nChars);
+    for(node = add->nodes[0].firstChild; node < add->nodes[0].endChild; node++)
+        if(add->nodes[node].value != DBL_MAX && add->nodes[node].label != L'\0')
+            addAlphabetSymbol(q->alphabet, add->nodes[node].label);
+    for(i = 0; i < aLen; i++){
+        node = frozenChild(repl, 0, a[i]);
+        for(n = (node >= 0) ? repl->nodes[node].replacement : NULL; n != NULL; n = n->nextEN)
+            if(isSingleRight(n, 1))
+                addAlphabetSymbol(q->alphabet, n->edit[0]);
+    }
+    q->repCost = (double *)malloc((size_t)q->alphabet->nSymbols * rows * sizeof(double));
+    q->addCost = (double *)malloc(q->alphabet->nSymbols * sizeof(double));
+    q->remCost = (double *)malloc(rows * sizeof(double));
+    if(q->repCost == NULL || q->addCost == NULL || q->remCost == NULL){
+        puts("Error: Could not allocate memory");
+        exit(1);
+    }
+    for(k = 0; k < q->alphabet->nSymbols * rows; k++)
+        q->repCost[k] = INFINITY;
+    for(s = 0; s < q->alphabet->nSymbols; s++)
+        q->addCost[s] = INFINITY;
+    for(i = 0; i < rows; i++)
+        q->remCost[i] = INFINITY;
+    q->singleRep = q->singleAdd = q->singleRem = 0;
+    for(node = add->nodes[0].firstChild; node < add->nodes[0].endChild; node++){
+        s = alphabetSymbol(q->alphabet, add->nodes[node].label);
+        if(s != 0 && add->nodes[node].value != DBL_MAX && add->nodes[node].value < q->addCost[s]){
+            q->addCost[s] = add->nodes[node].value;
+            q->singleAdd = 1;
+        }
+    }
+
+    for(i = 0; i < aLen; i++){
+        // 'remove' operations: removing a[i..i+r-1]
+        q->remStart[i] = nRem;
+        node = 0;
+        for(r = 1; i + r - 1 < aLen && (node = frozenChild(rem, node, a[i + r - 1])) >= 0; r++){
+            if(rem->nodes[node].value == DBL_MAX)
+                continue;
+            if(r == 1){
+                q->remCost[i + 1] = rem->nodes[node].value;
+                q->singleRem = 1;
+            }
+            else
+                q->remMatches = appendQueryMatch(q->remMatches, &nRem, &remCap, r, rem->nodes[node].value, NULL);
+        }
+        // 'replace' operations: left side a[i..i+r-1]
+        q->repStart[i] = nRep;
+        node = 0;
+        for(r = 1; i + r - 1 < aLen && (node = frozenChild(repl, node, a[i + r - 1])) >= 0; r++){
+            if(repl->nodes[node].replacement == NULL)
+                continue;
+            listed = 0;
+            for(n = repl->nodes[node].replacement; n != NULL; n = n->nextEN){
+                if(!isSingleRight(n, r)){
+                    listed = 1;
+                    continue;
+                }
+                s = alphabetSymbol(q->alphabet, n->edit[0]);
+                if(n->value < q->repCost[s * rows + i + 1])
+                    q->repCost[s * rows + i + 1] = n->value;
+                q->singleRep = 1;
+            }
+            // the match is listed only for the right sides that are not in the dense tables
+            if(listed)
+                q->repMatches = appendQueryMatch(q->repMatches, &nRep, &repCap, r, 0.0, repl->nodes[node].replacement);
+        }
+    }
+    q->remStart[aLen] = nRem;
+    q->repStart[aLen] = nRep;
+
+    // right sides of the 'replace' matches, identified by their patterns in the text
+    for(k = 0; k < nRep; k++){
+        q->repMatches[k].firstRight = nRight;
+        for(n = q->repMatches[k].replacement; n != NULL; n = n->nextEN){
+            if(isSingleRight(n, q->repMatches[k].span))
+                continue;
+            if(nRight == rightCap){
+                rightCap = (rightCap > 0) ? 2 * rightCap : 16;
+                q->rights = (QueryRight *)realloc(q->rights, rightCap * sizeof(QueryRight));
+                if(q->rights == NULL){
+                    puts("Error: Could not allocate memory");
+                    exit(1);
+                }
+            }
+            q->rights[nRight].len = wchar_len(n->edit);
+            q->rights[nRight].first = n->edit[0];
+            q->rights[nRight].pattern = (q->rights[nRight].len > 1) ? findTextPattern(m, n->edit) : -1;
+            q->rights[nRight].cost = n->value;
+            nRight++;
+        }
+        q->repMatches[k].nRights = nRight - q->repMatches[k].firstRight;
+    }
+    return q;
+}
+
+// Checks whether the matches have been compiled from given search string
+int isQueryMatchesOf(QueryMatches *q, wchar_t *a, int aLen){
+    return q->len == aLen && wmemcmp(q->string, a, aLen) == 0;
+}
+
+// Releases memory under the matches
+void freeQueryMatches(QueryMatches *q){
+    free(q->string);
+    free(q->remStart);
+    free(q->remMatches);
+    free(q->repStart);
+    free(q->repMatches);
+    free(q->rights);
+    freeAlphabet(q->alphabet);
+    free(q->repCost);
+    free(q->addCost);
+    free(q->remCost);
+    free(q);
+}
+
+// -----------------------------------------------------------------------------
+//    Matches of transformations in the text
+// -----------------------------------------------------------------------------
+
+// Finds the transition from state s with character c, -1 if there is none
+static inline int matcherGoto(TextMatcher *m, int s, wchar_t c){
+    unsigned int h = ((unsigned int)s * 2654435761u ^ (unsigned int)c * 40503u) & (m->hashSize - 1);
+    while(m->hashState[h] >= 0){
+        if(m->hashState[h] == s && m->hashChar[h] == c)
+            return m->hashTarget[h];
+        h = (h + 1) & (m->hashSize - 1);
+    }
+    return -1;
+}
+
+// Adds a transition into the hash table (the table must have room for it)
+static void matcherAddTransition(TextMatcher *m, int s, wchar_t c, int target){
+    unsigned int h = ((unsigned int)s * 2654435761u ^ (unsigned int)c * 40503u) & (m->hashSize - 1);
+    while(m->hashState[h] >= 0)
+        h = (h + 1) & (m->hashSize - 1);
+    m->hashState[h]  = s;
+    m->hashChar[h]   = c;
+    m->hashTarget[h] = target;
+}
+
+// Makes sure that the hash table is at most half full after adding a transition
+static void matcherGrowHash(TextMatcher *m){
+    int oldSize = m->hashSize;
+    int *oldState = m->hashState;
+    wchar_t *oldChar = m->hashChar;
+    int *oldTarget = m->hashTarget;
+    int k;
+
+    if(2 * m->nStates < m->hashSize)
+        return;
+    m->hashSize   = (oldSize > 0) ? 2 * oldSize : 64;
+    m->hashState  = (int *)malloc(m->hashSize * sizeof(int));
+    m->hashChar   = (wchar_t *)malloc(m->hashSize * sizeof(wchar_t));
+    m->hashTarget = (int *)malloc(m->hashSize * sizeof(int));
+    if(m->hashState == NULL || m->hashChar == NULL || m->hashTarget == NULL){
+        puts("Error: Could not allocate memory");
+        exit(1);
+    }
+    for(k = 0; k < m->hashSize; k++)
+        m->hashState[k] = -1;
+    for(k = 0; k < oldSize; k++)
+        if(oldState[k] >= 0)
+            matcherAddTransition(m, oldState[k], oldChar[k], oldTarget[k]);
+    free(oldState);
+    free(oldChar);
+    free(oldTarget);
+}
+
+// Creates a new state reached from state s with character c
+static int matcherNewState(TextMatcher *m, int s, wchar_t c){
+    int n = m->nStates;
+    if(n == m->stateCap){
+        m->stateCap = (m->stateCap > 0) ? 2 * m->stateCap : 64;
+        m->parent  = (int *)realloc(m->parent, m->stateCap * sizeof(int));
+        m->label   = (wchar_t *)realloc(m->label, m->stateCap * sizeof(wchar_t));
+        m->fail    = (int *)realloc(m->fail, m->stateCap * sizeof(int));
+        m->pattern = (int *)realloc(m->pattern, m->stateCap * sizeof(int));
+        m->outLink = (int *)realloc(m->outLink, m->stateCap * sizeof(int));
+        if(m->parent == NULL || m->label == NULL || m->fail == NULL || 
+           m->pattern == NULL || m->outLink == NULL){
+            puts("Error: Could not allocate memory");
+            exit(1);
+        }
+    }
+    m->parent[n]  = s;
+    m->label[n]   = c;
+    m->fail[n]    = 0;
+    m->pattern[n] = -1;
+    m->outLink[n] = -1;
+    m->nStates++;
+    if(s >= 0){
+        matcherGrowHash(m);
+        matcherAddTransition(m, s, c, n);
+    }
+    return n;
+}
+
+// Adds string s of length len as a pattern (if it is not there yet), returns its id
+static int matcherAddPattern(TextMatcher *m, wchar_t *s, int len){
+    int state = 0;
+    int next, k;
+
+    for(k = 0; k < len; k++){
+        next = matcherGoto(m, state, s[k]);
+        if(next < 0)
+            next = matcherNewState(m, state, s[k]);
+        state = next;
+    }
+    if(m->pattern[state] < 0){
+        if(m->nPatterns == m->patternCap){
+            m->patternCap = (m->patternCap > 0) ? 2 * m->patternCap : 16;
+            m->patternLen = (int *)realloc(m->patternLen, m->patternCap * sizeof(int));
+            m->addCost    = (double *)realloc(m->addCost, m->patternCap * sizeof(double));
+            if(m->patternLen == NULL || m->addCost == NULL){
+                puts("Error: Could not allocate memory");
+                exit(1);
+            }
+        }
+        m->patternLen[m->nPatterns] = len;
+        if(len > m->maxLen) m->maxLen = len;
+        m->addCost[m->nPatterns] = DBL_MAX;
+        m->pattern[state] = m->nPatterns++;
+    }
+    return m->pattern[state];
+}
+
+// Adds strings of 'add' operations as patterns
+static void matcherAddARTStrings(TextMatcher *m, FrozenTrie *f){
+    wchar_t *s, *reversed;
+    int node, len, k, id;
+
+    s = (wchar_t *)malloc((f->maxDepth + 1) * sizeof(wchar_t));
+    reversed = (wchar_t *)malloc((f->maxDepth + 1) * sizeof(wchar_t));
+    if(s == NULL || reversed == NULL){
+        puts("Error: Could not allocate memory");
+        exit(1);
+    }
+    for(node = 1; node < f->nNodes; node++){
+        if(f->nodes[node].value == DBL_MAX)
+            continue;
+        len = frozenReversedString(f, node, reversed);
+        // a character that cannot occur in the text ends the string
+        for(k = 0; k < len && reversed[k] != L'\0'; k++)
+            s[len - 1 - k] = reversed[k];
+        if(k < len)
+            continue;
+        id = matcherAddPattern(m, s, len);
+        if(f->nodes[node].value < m->addCost[id])
+            m->addCost[id] = f->nodes[node].value;
+        if(len > m->maxAddLen) m->maxAddLen = len;
+    }
+    free(s);
+    free(reversed);
+}
+
+// Adds right sides of 'replace' operations as patterns
+static void matcherAddReplacements(TextMatcher *m, FrozenTrie *f){
+    EndNode *n;
+    int node;
+    for(node = 1; node < f->nNodes; node++){
+        // right sides of a single character are compared to the text directly
+        for(n = f->nodes[node].replacement; n != NULL; n = n->nextEN)
+            if(n->edit[0] != L'\0' && n->edit[1] != L'\0')
+                matcherAddPattern(m, n->edit, wchar_len(n->edit));
+    }
+}
+
+// Builds the automaton of the strings produced by transformations
+TextMatcher *createTextMatcher(Trie *repT, ARTrie *addT){
+    TextMatcher *m;
+    int *depth, *order, *count;
+    int maxDepth = 0;
+    int s, f, k, next;
+
+    m = (TextMatcher *)calloc(1, sizeof(TextMatcher));
+    if(m == NULL)
+        abort();
+    matcherNewState(m, -1, L'\0');
+    matcherGrowHash(m);
+    matcherAddARTStrings(m, frozenARTrie(addT));
+    matcherAddReplacements(m, frozenTrie(repT));
+
+    // failure links are found in the order of depth; as a parent is always 
+    // created before its children, depths can be found in a single pass
+    depth = (int *)malloc(m->nStates * sizeof(int));
+    order = (int *)malloc(m->nStates * sizeof(int));
+    count = (int *)calloc(m->nStates + 1, sizeof(int));
+    if(depth == NULL || order == NULL || count == NULL){
+        puts("Error: Could not allocate memory");
+        exit(1);
+    }
+    depth[0] = 0;
+    for(s = 1; s < m->nStates; s++){
+        depth[s] = depth[m->parent[s]] + 1;
+        if(depth[s] > maxDepth) maxDepth = depth[s];
+    }
+    for(s = 0; s < m->nStates; s++)
+        count[depth[s] + 1]++;
+    for(k = 1; k <= maxDepth; k++)
+        count[k] += count[k-1];
+    for(s = 0; s < m->nStates; s++)
+        order[count[depth[s]]++] = s;
+
+    for(k = 1; k < m->nStates; k++){
+        s = order[k];
+        if(m->parent[s] != 0){
+            f = m->fail[m->parent[s]];
+            while((next = matcherGoto(m, f, m->label[s])) < 0 && f != 0)
+                f = m->fail[f];
+            m->fail[s] = (next >= 0) ? next : 0;
+        }
+        f = m->fail[s];
+        m->outLink[s] = (m->pattern[f] >= 0) ? f : m->outLink[f];
+    }
+    for(k = 0; k < TEXT_MATCHER_ROOT_CHARS; k++)
+        m->rootNext[k] = matcherGoto(m, 0, (wchar_t)k);
+    free(depth);
+    free(order);
+    free(count);
+    return m;
+}
+
+// Releases memory under the automaton
+void freeTextMatcher(TextMatcher *m){
+    if(!m->image){
+        free(m->parent);
+        free(m->label);
+        free(m->fail);
+        free(m->pattern);
+        free(m->outLink);
+        free(m->hashState);
+        free(m->hashChar);
+        free(m->hashTarget);
+        free(m->patternLen);
+        free(m->addCost);
+    }
+    free(m);
+}
+
+// Writes the automaton into the compiled rule set file
+long long writeTextMatcher(FILE *out, TextMatcher *m){
+    TextMatcherImage h;
+    long long at = ftello(out);
+    long long states = (long long)m->nStates;
+    long long hash = (long long)m->hashSize;
+    long long patterns = (long long)m->nPatterns;
+
+    memset(&h, 0, sizeof(h));
+    h.nStates   = m->nStates;
+    h.hashSize  = m->hashSize;
+    h.nPatterns = m->nPatterns;
+    h.maxLen    = m->maxLen;
+    memcpy(h.rootNext, m->rootNext, sizeof(h.rootNext));
+    h.parent     = at + alignFilePart(sizeof(h));
+    h.label      = h.parent + alignFilePart(states * sizeof(int));
+    h.fail       = h.label + alignFilePart(states * sizeof(wchar_t));
+    h.pattern    = h.fail + alignFilePart(states * sizeof(int));
+    h.outLink    = h.pattern + alignFilePart(states * sizeof(int));
+    h.hashState  = h.outLink + alignFilePart(states * sizeof(int));
+    h.hashChar   = h.hashState + alignFilePart(hash * sizeof(int));
+    h.hashTarget = h.hashChar + alignFilePart(hash * sizeof(wchar_t));
+    h.patternLen = h.hashTarget + alignFilePart(hash * sizeof(int));
+    h.addCost    = h.patternLen + alignFilePart(patterns * sizeof(int));
+    if(writeFilePart(out, &h, sizeof(h)) != 0 ||
+       writeFilePart(out, m->parent, states * sizeof(int)) != 0 ||
+       writeFilePart(out, m->label, states * sizeof(wchar_t)) != 0 ||
+       writeFilePart(out, m->fail, states * sizeof(int)) != 0 ||
+       writeFilePart(out, m->pattern, states * sizeof(int)) != 0 ||
+       writeFilePart(out, m->outLink, states * sizeof(int)) != 0 ||
+       writeFilePart(out, m->hashState, hash * sizeof(int)) != 0 ||
+       writeFilePart(out, m->hashChar, hash * sizeof(wchar_t)) != 0 ||
+       writeFilePart(out, m->hashTarget, hash * sizeof(int)) != 0 ||
+       writeFilePart(out, m->patternLen, patterns * sizeof(int)) != 0 ||
+       writeFilePart(out, m->addCost, patterns * sizeof(double)) != 0)
+        return -1;
+    return at;
+}
+
+// Tells whether the arrays of the automaton are consistent with each other: transitions and links lead within them, failure and output links to shallower states
+static int isTextMatcherValid(TextMatcher *m){
+    int *depth;
+    int s, k, t, maxLen = 0, empty = 0, valid = 1;
+
+    // the hash table is probed until an empty slot
+    if(m->hashSize < 1 || (m->hashSize & (m->hashSize - 1)) != 0 || m->parent[0] != -1 || m->pattern[0] != -1)
+        return 0;
+    depth = (int *)malloc(m->nStates * sizeof(int));
+    if(depth == NULL){
+        puts("Error: Could not allocate memory");
+        exit(1);
+    }
+    depth[0] = 0;
+    for(s = 1; valid && s < m->nStates; s++){
+        valid = (m->parent[s] >= 0 && m->parent[s] < s);
+        if(valid)
+            depth[s] = depth[m->parent[s]] + 1;
+    }
+    for(s = 0; valid && s < m->nStates; s++){
+        k = m->pattern[s];
+        valid = (k >= -1 && k < m->nPatterns && (k < 0 || m->patternLen[k] == depth[s])) &&
+                (s == 0 || (m->fail[s] >= 0 && m->fail[s] < m->nStates && depth[m->fail[s]] < depth[s])) &&
+                (m->outLink[s] == -1 || (m->outLink[s] >= 0 && m->outLink[s] < m->nStates && 
+                                         depth[m->outLink[s]] < depth[s] && m->pattern[m->outLink[s]] >= 0));
+    }
+    for(k = 0; valid && k < m->hashSize; k++){
+        s = m->hashState[k];
+        t = m->hashTarget[k];
+        if(s == -1)
+            empty++;
+        else
+            valid = (s >= 0 && s < m->nStates && t > 0 && t < m->nStates && m->parent[t] == s && m->label[t] == m->hashChar[k]);
+    }
+    for(k = 0; valid && k < TEXT_MATCHER_ROOT_CHARS; k++){
+        t = m->rootNext[k];
+        valid = (t == -1 || (t > 0 && t < m->nStates && m->parent[t] == 0 && m->label[t] == (wchar_t)k));
+    }
+    for(k = 0; valid && k < m->nPatterns; k++)
+        if(m->patternLen[k] > maxLen)
+            maxLen = m->patternLen[k];
+    free(depth);
+    return valid && empty > 0 && maxLen == m->maxLen;
+}
+
+// Creates the automaton from the compiled rule set
+TextMatcher *textMatcherFromImage(char *data, long long at, long long from, long long size){
+    TextMatcherImage *h = (TextMatcherImage *)(data + at);
+    long long states, hash, patterns;
+    TextMatcher *m;
+    int k;
+
+    // the parts follow one another, after the ones checked before
+    if(!isFilePart(at, 1, sizeof(TextMatcherImage), from, size) || h->nStates < 1 || h->hashSize < 1 || h->nPatterns < 0)
+        return NULL;
+    states   = h->nStates;
+    hash     = h->hashSize;
+    patterns = h->nPatterns;
+    if(!isFilePart(h->parent, states, sizeof(int), at + sizeof(TextMatcherImage), size) ||
+       !isFilePart(h->label, states, sizeof(wchar_t), h->parent + states * sizeof(int), size) ||
+       !isFilePart(h->fail, states, sizeof(int), h->label + states * sizeof(wchar_t), size) ||
+       !isFilePart(h->pattern, states, sizeof(int), h->fail + states * sizeof(int), size) ||
+       !isFilePart(h->outLink, states, sizeof(int), h->pattern + states * sizeof(int), size) ||
+       !isFilePart(h->hashState, hash, sizeof(int), h->outLink + states * sizeof(int), size) ||
+       !isFilePart(h->hashChar, hash, sizeof(wchar_t), h->hashState + hash * sizeof(int), size) ||
+       !isFilePart(h->hashTarget, hash, sizeof(int), h->hashChar + hash * sizeof(wchar_t), size) ||
+       !isFilePart(h->patternLen, patterns, sizeof(int), h->hashTarget + hash * sizeof(int), size) ||
+       !isFilePart(h->addCost, patterns, sizeof(double), h->patternLen + patterns * sizeof(int), size))
+        return NULL;
+
+    m = (TextMatcher *)calloc(1, sizeof(TextMatcher));
+    if(m == NULL)
+        abort();
+    m->image      = 1;
+    m->nStates    = m->stateCap = h->nStates;
+    m->hashSize   = h->hashSize;
+    m->nPatterns  = m->patternCap = h->nPatterns;
+    m->maxLen     = h->maxLen;
+    memcpy(m->rootNext, h->rootNext, sizeof(m->rootNext));
+    m->parent     = (int *)(data + h->parent);
+    m->label      = (wchar_t *)(data + h->label);
+    m->fail       = (int *)(data + h->fail);
+    m->pattern    = (int *)(data + h->pattern);
+    m->outLink    = (int *)(data + h->outLink);
+    m->hashState  = (int *)(data + h->hashState);
+    m->hashChar   = (wchar_t *)(data + h->hashChar);
+    m->hashTarget = (int *)(data + h->hashTarget);
+    m->patternLen = (int *)(data + h->patternLen);
+    m->addCost    = (double *)(data + h->addCost);
+    if(!isTextMatcherValid(m)){
+        free(m);
+        return NULL;
+    }
+    for(k = 0; k < m->nPatterns; k++)
+        if(m->addCost[k] != DBL_MAX && m->patternLen[k] > m->maxAddLen)
+            m->maxAddLen = m->patternLen[k];
+    return m;
+}
+
+// Finds the id of given pattern
+int findTextPattern(TextMatcher *m, wchar_t *s){
+    int state = 0;
+    while(*s != L'\0' && state >= 0){
+        state = matcherGoto(m, state, *s);
+        s++;
+    }
+    return (state >= 0) ? m->pattern[state] : -1;
+}
+
+// Creates an empty set of text matches
+TextMatches *createTextMatches(){
+    TextMatches *tm = (TextMatches *)calloc(1, sizeof(TextMatches));
+    if(tm == NULL)
+        abort();
+    return tm;
+}
+
+// Releases memory under the text matches
+void freeTextMatches(TextMatches *tm){
+    free(tm->addFirst);
+    free(tm->patternFirst);
+    free(tm->matchPattern);
+    free(tm->matchNext);
+    free(tm->stamp);
+    free(tm);
+}
+
+// Starts finding the matches in a new text
+void startTextMatches(TextMatches *tm, TextMatcher *m, wchar_t *b, int bLen){
+    tm->matcher = m;
+    tm->text = b;
+    tm->len = bLen;
+    tm->scanned = 0;
+    tm->state = 0;
+    tm->nMatches = 0;
+    tm->marked = -1;
+    if(bLen > tm->posCap){
+        tm->posCap = 2 * bLen;
+        free(tm->addFirst);
+        free(tm->patternFirst);
+        tm->addFirst     = (int *)malloc(tm->posCap * sizeof(int));
+        tm->patternFirst = (int *)malloc(tm->posCap * sizeof(int));
+        if(tm->addFirst == NULL || tm->patternFirst == NULL){
+            puts("Error: Could not allocate memory");
+            exit(1);
+        }
+    }
+    if(m->nPatterns > tm->stampCap){
+        free(tm->stamp);
+        tm->stampCap = m->nPatterns;
+        tm->stamp = (unsigned int *)calloc(tm->stampCap, sizeof(unsigned int));
+        if(tm->stamp == NULL){
+            puts("Error: Could not allocate memory");
+            exit(1);
+        }
+    }
+}
+
+// Adds a match of pattern id to the list starting with *first
+static void appendTextMatch(TextMatches *tm, int *first, int id){
+    if(tm->nMatches == tm->matchCap){
+        tm->matchCap = (tm->matchCap > 0) ? 2 * tm->matchCap : 64;
+        tm->matchPattern = (int *)realloc(tm->matchPattern, tm->matchCap * sizeof(int));
+        tm->matchNext    = (int *)realloc(tm->matchNext, tm->matchCap * sizeof(int));
+        if(tm->matchPattern == NULL || tm->matchNext == NULL){
+            puts("Error: Could not allocate memory");
+            exit(1);
+        }
+    }
+    tm->matchPattern[tm->nMatches] = id;
+    tm->matchNext[tm->nMatches] = *first;
+    *first = tm->nMatches++;
+}
+
+// Follows the transitions (and failure links) of the automaton from the state s by the character c
+static inline int matcherNext(TextMatcher *m, int s, wchar_t c){
+    int next = -1;
+    while(s != 0 && (next = matcherGoto(m, s, c)) < 0)
+        s = m->fail[s];
+    if(s == 0)
+        next = (c >= 0 && c < TEXT_MATCHER_ROOT_CHARS) ? m->rootNext[c] : matcherGoto(m, 0, c);
+    return (next >= 0) ? next : 0;
+}
+
+// Returns the state of the automaton after the character c has been passed to it in the state s
+int textMatcherNext(TextMatcher *m, int s, wchar_t c){
+    return matcherNext(m, s, c);
+}
+
+// Scans the text further, collecting matches by their start position
+void scanTextMatches(TextMatches *tm, int end){
+    TextMatcher *m = tm->matcher;
+    int state = tm->state;
+    int e, s, id, start;
+    wchar_t c;
+
+    if(end > tm->len)
+        end = tm->len;
+    for(e = tm->scanned; e < end; e++){
+        // matches found from now on can start at e at the latest
+        tm->addFirst[e] = -1;
+        tm->patternFirst[e] = -1;
+        if(m->nPatterns == 0)
+            continue;
+        c = tm->text[e];
+        state = matcherNext(m, state, c);
+        for(s = (m->pattern[state] >= 0) ? state : m->outLink[state]; s >= 0; s = m->outLink[s]){
+            id = m->pattern[s];
+            start = e - m->patternLen[id] + 1;
+            appendTextMatch(tm, &tm->patternFirst[start], id);
+            // single characters are added via the dense tables of QueryMatches
+            if(m->addCost[id] != DBL_MAX && m->patternLen[id] > 1)
+                appendTextMatch(tm, &tm->addFirst[start], id);
+        }
+    }
+    if(end > tm->scanned){
+        tm->scanned = end;
+        tm->state = state;
+    }
+}
@@ -0,0 +1,391 @@
+/*
+*    Copyright (C) 2010 University of Tartu
+*    Authors: Reina Krik, Siim Orasmaa, Kristo Tammeoja, Jaak Vilo
+*    Contact:  siim . orasmaa {at} ut . ee
+*
+*    This file is part of Generalized Edit Distance Tool.
+*
+*    Generalized Edit Distance Tool is free software: you can redistribute 
+*    it and/or modify it under the terms of the GNU General Public License 
+*    as published by the Free Software Foundation, either version 3 of the
+*    License, or (at your option) any later version.
+*
+*    Generalized Edit Distance Tool is distributed in the hope that it will 
+*    be useful, but WITHOUT ANY WARRANTY; without even the implied warranty 
+*    of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*    GNU General Public License for more details.
+*
+*    You should have received a copy of the GNU General Public License
+*    along with Generalized Edit Distance Tool. 
+*    If not, see <http://www.gnu.org/licenses/>.
+*
+*/
+
+#ifndef RULEMATCHES_H
+#define RULEMATCHES_H
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <float.h>
+#include <wchar.h>
+#include "Trie.h"
+#include "ARTrie.h"
+#include "FrozenTrie.h"
+
+/**
+*   A left side of a generalized edit distance transformation that matches 
+*  the search string at some position, covering \a span characters. For a 
+*  'remove' operation, \a cost is the cost of the removal; for a 'replace' 
+*  operation, \a replacement lists the possible right sides (with costs), 
+*  which are also stored as \c QueryRight -s from \a firstRight (\a nRights
+*  of them).
+*/
+typedef struct QueryMatch {
+    int span;
+    double cost;
+    EndNode *replacement;
+    int firstRight;
+    int nRights;
+} QueryMatch;
+
+/**
+*   A right side of a 'replace' operation: its length, first character, 
+*  the id of the string in \c TextMatcher ( \a pattern , only for strings 
+*  longer than one character, \c -1 otherwise) and the cost of the operation.
+*/
+typedef struct QueryRight {
+    int len;
+    wchar_t first;
+    int pattern;
+    double cost;
+} QueryRight;
+
+/**
+*   Number of characters, for which transitions from the root of 
+*  \c TextMatcher are also kept in a plain array.
+*/
+#define TEXT_MATCHER_ROOT_CHARS 256
+
+/**
+*   Aho-Corasick automaton of the strings that generalized edit distance
+*  transformations produce in the text: strings of 'add' operations and 
+*  right sides of 'replace' operations longer than one character (shorter
+*  ones are simply compared to the text). Each distinct string is a pattern
+*  with an id ( \c 0 .. \a nPatterns-1 ); a string that is both added and 
+*  used as a right side is a single pattern.
+*
+*   States are numbered from \c 0 (the root); for state \c s , \a parent[s] 
+*  and \a label[s] give the transition leading to it, \a fail[s] is the 
+*  failure link, \a pattern[s] is the id of the pattern ending at \c s 
+*  (\c -1 if none) and \a outLink[s] is the nearest state on the failure 
+*  chain where a pattern ends (\c -1 if none). Transitions are kept in an
+*  open-addressing hash table keyed by state and character; as the text 
+*  mostly passes through the root, transitions from it are also in 
+*  \a rootNext ( \c -1 for none).
+*
+*   For pattern \c k , \a patternLen[k] is its length and \a addCost[k] the
+*  cost of adding it (\c DBL_MAX if it is not an 'add' operation); 
+*  \a maxLen is the length of the longest pattern and \a maxAddLen the 
+*  length of the longest 'add' operation (\c 0 if there are none). If the
+*  automaton has 
+*  been loaded from a compiled rule set, \a image is set: the arrays are 
+*  parts of the rule set.
+*/
+typedef struct TextMatcher {
+    int nStates;
+    int stateCap;
+    int *parent;
+    wchar_t *label;
+    int *fail;
+    int *pattern;
+    int *outLink;
+    int hashSize;
+    int *hashState;
+    wchar_t *hashChar;
+    int *hashTarget;
+    int rootNext[TEXT_MATCHER_ROOT_CHARS];
+    int nPatterns;
+    int patternCap;
+    int *patternLen;
+    double *addCost;
+    int maxLen;
+    int maxAddLen;
+    int image;
+} TextMatcher;
+
+/**
+*   A \c TextMatcher stored in a compiled rule set file: its sizes and byte
+*  offsets of its arrays from the beginning of the file (see 
+*  \a writeTextMatcher() ).
+*/
+typedef struct TextMatcherImage {
+    int nStates;
+    int hashSize;
+    int nPatterns;
+    int maxLen;
+    int rootNext[TEXT_MATCHER_ROOT_CHARS];
+    long long parent;
+    long long label;
+    long long fail;
+    long long pattern;
+    long long outLink;
+    long long hashState;
+    long long hashChar;
+    long long hashTarget;
+    long long patternLen;
+    long long addCost;
+} TextMatcherImage;
+
+/**
+*   Matches of \c TextMatcher patterns in a single text (candidate word). 
+*  The text is scanned lazily, only as far as the calculation needs it: 
+*  \a scanned characters of it have been passed to the automaton, which is 
+*  now in \a state . Matches are kept in lists by their start position: for
+*  position \c j of the text, \a addFirst[j] is the first match of an 'add' 
+*  operation longer than one character (costs of shorter ones are in 
+*  \c QueryMatches ) and \a patternFirst[j] the first match of any pattern
+*  starting there (\c -1 for none); for match \c k , \a matchPattern[k] is
+*  its pattern and \a matchNext[k] the next match in the same list.
+*
+*   To check whether the right side of a 'replace' operation matches at 
+*  a position in constant time, patterns starting at the position \a marked
+*  are stamped with \a epoch : \a stamp[k] \c == \a epoch if pattern \c k 
+*  matches there.
+*
+*   Arrays are reused from one text to another and grown when needed.
+*/
+typedef struct TextMatches {
+    TextMatcher *matcher;
+    wchar_t *text;
+    int len;
+    int scanned;
+    int state;
+    int posCap;
+    int *addFirst;
+    int *patternFirst;
+    int nMatches;
+    int matchCap;
+    int *matchPattern;
+    int *matchNext;
+    unsigned int *stamp;
+    int stampCap;
+    unsigned int epoch;
+    int marked;
+} TextMatches;
+
+/**
+*   Builds the automaton of the strings of 'add' operations in the trie 
+*   \a *addT and of the right sides of 'replace' operations in the trie 
+*   \a *repT . Memory under the automaton must be released with 
+*   \a freeTextMatcher() .
+*/
+TextMatcher *createTextMatcher(Trie *repT, ARTrie *addT);
+
+/**
+*   Releases memory under \a *m .
+*/
+void freeTextMatcher(TextMatcher *m);
+
+/**
+*   Writes \a *m into the compiled rule set file \a *out at its current 
+*   position: a \c TextMatcherImage followed by the arrays. Returns the byte
+*   offset of the \c TextMatcherImage in the file, or \c -1 on error.
+*/
+long long writeTextMatcher(FILE *out, TextMatcher *m);
+
+/**
+*   Creates a \c TextMatcher from the compiled rule set \a *data ( \a size 
+*   bytes), where its \c TextMatcherImage is at the byte offset \a at . The
+*   arrays are used as they are in \a *data , so \a *data must stay mapped 
+*   until the automaton is released. Returns \c NULL , if the automaton and
+*   its arrays do not lie within the bytes \a from .. \a size-1 , one after
+*   another, or they are not consistent with each other (transitions, 
+*   failure and output links and patterns must be those of an automaton).
+*/
+TextMatcher *textMatcherFromImage(char *data, long long at, long long from, long long size);
+
+/**
+*   Returns the id of the pattern \a *s in the automaton \a *m , or -1 if
+*   \a *s is not a pattern.
+*/
+int findTextPattern(TextMatcher *m, wchar_t *s);
+
+/**
+*   Returns the state of the automaton \a *m after the character \a c has 
+*   been passed to it in the state \a s (patterns ending at the new state 
+*   are \a pattern and the \a outLink chain of it).
+*/
+int textMatcherNext(TextMatcher *m, int s, wchar_t c);
+
+/**
+*   Creates an empty \c TextMatches . Memory under it must be released with
+*   \a freeTextMatches() .
+*/
+TextMatches *createTextMatches();
+
+/**
+*   Releases memory under \a *tm .
+*/
+void freeTextMatches(TextMatches *tm);
+
+/**
+*   Starts finding the matches of the patterns of \a *m in text \a *b of 
+*   length \a bLen (replacing previous contents of \a *tm ). The text is not
+*   copied, it must not change while \a *tm is in use.
+*/
+void startTextMatches(TextMatches *tm, TextMatcher *m, wchar_t *b, int bLen);
+
+/**
+*   Scans the text of \a *tm up to (not including) position \a end , 
+*   collecting the matches ending there.
+*/
+void scanTextMatches(TextMatches *tm, int end);
+
+/**
+*   Makes sure that all matches starting at position \a j of the text have 
+*   been found.
+*/
+static inline void findTextMatchesAt(TextMatches *tm, int j){
+    if(tm->scanned < tm->len && tm->scanned < j + tm->matcher->maxLen)
+        scanTextMatches(tm, j + tm->matcher->maxLen);
+}
+
+/**
+*   Stamps the patterns starting at position \a j of the text (see 
+*   \c TextMatches ).
+*/
+static inline void markTextPosition(TextMatches *tm, int j){
+    int k;
+    findTextMatchesAt(tm, j);
+    if(++tm->epoch == 0){
+        // the stamps have wrapped around: start again
+        for(k = 0; k < tm->stampCap; k++)
+            tm->stamp[k] = 0;
+        tm->epoch = 1;
+    }
+    for(k = tm->patternFirst[j]; k >= 0; k = tm->matchNext[k])
+        tm->stamp[tm->matchPattern[k]] = tm->epoch;
+    tm->marked = j;
+}
+
+/**
+*   Checks, whether pattern \a id starts at position \a j of the text.
+*   Consecutive checks at the same position take constant time.
+*/
+static inline int isPatternAt(TextMatches *tm, int j, int id){
+    if(tm->marked != j)
+        markTextPosition(tm, j);
+    return tm->stamp[id] == tm->epoch;
+}
+
+/**
+*   Characters mapped into small integer symbols, for indexing dense tables 
+*  of costs: symbol 0 stands for all other characters, the characters added
+*  to the alphabet get symbols \c 1 .. \a nSymbols-1 . Characters below 256 
+*  are mapped via \a byteSymbol , other characters via the open-addressing 
+*  hash table \a hashChars / \a hashSymbols .
+*/
+typedef struct Alphabet {
+    int nSymbols;
+    int byteSymbol[256];
+    wchar_t *hashChars;
+    int *hashSymbols;
+    int hashSize;
+} Alphabet;
+
+/**
+*   Creates an empty alphabet, that can hold up to \a nChars characters. 
+*   Memory under the alphabet must be released with \a freeAlphabet() .
+*/
+Alphabet *createAlphabet(int nChars);
+
+/**
+*   Adds character \a c to the alphabet \a *s (if it is not there yet).
+*/
+void addAlphabetSymbol(Alphabet *s, wchar_t c);
+
+/**
+*   Releases memory under \a *s .
+*/
+void freeAlphabet(Alphabet *s);
+
+/**
+*   Returns the symbol of character \a c , 0 if it is not in the alphabet.
+*/
+static inline int alphabetSymbol(Alphabet *s, wchar_t c){
+    unsigned int h;
+    int k;
+    if((unsigned int)c < 256)
+        return s->byteSymbol[(unsigned int)c];
+    h = ((unsigned int)c * 2654435761u) & (s->hashSize - 1);
+    while((k = s->hashSymbols[h]) >= 0){
+        if(s->hashChars[h] == c)
+            return k;
+        h = (h + 1) & (s->hashSize - 1);
+    }
+    return 0;
+}
+
+/**
+*   Search string compiled for generalized edit distance: which left sides 
+*  of 'remove' and 'replace' operations match the search string depends only 
+*  on the search string, so the matches are found once, instead of walking
+*  the tries again in every cell of the table.
+*
+*   Matches starting at position \c i of the search string are
+*  \a remMatches[remStart[i] .. remStart[i+1]-1] and 
+*  \a repMatches[repStart[i] .. repStart[i+1]-1] , both sorted by span (in
+*  the order in which walking the trie finds them). Right sides of all 
+*  'replace' matches are in \a rights .
+*
+*   Single-character transformations, which are most of the usual rule sets,
+*  are not in the lists: their costs are kept in dense tables, indexed by
+*  the row \c i of the table (row \c i corresponds to the search string 
+*  character \c a[i-1] ) and by the symbols of the text characters in 
+*  \a alphabet (the characters that single-character 'add' and 'replace'
+*  transformations produce): \a repCost[s*(len+1)+i] is the cost of 
+*  replacing \c a[i-1] with symbol \c s , \a addCost[s] the cost of adding
+*  symbol \c s and \a remCost[i] the cost of removing \c a[i-1] ( \c INFINITY
+*  if there is no such transformation). \a singleRep , \a singleAdd and 
+*  \a singleRem tell whether the tables have any costs at all.
+*/
+typedef struct QueryMatches {
+    wchar_t *string;
+    int len;
+    int *remStart;
+    QueryMatch *remMatches;
+    int *repStart;
+    QueryMatch *repMatches;
+    QueryRight *rights;
+    Alphabet *alphabet;
+    double *repCost;
+    double *addCost;
+    double *remCost;
+    int singleRep;
+    int singleAdd;
+    int singleRem;
+} QueryMatches;
+
+/**
+*   Finds the matches of 'remove' operations in the trie \a *remT and of 
+*   'replace' operations in the trie \a *repT at every position of the search
+*   string \a *a of length \a aLen ; right sides of 'replace' operations are
+*   identified by their patterns in \a *m . Costs of single-character 
+*   transformations (also of 'add' operations in the trie \a *addT ) go to 
+*   the dense tables instead. Contents of \a *a is copied. Memory under the
+*   result must be released with \a freeQueryMatches() .
+*/
+QueryMatches *createQueryMatches(wchar_t *a, int aLen, Trie *repT, ARTrie *addT, ARTrie *remT, TextMatcher *m);
+
+/**
+*   Checks, whether \a *q has been compiled from the search string \a *a of 
+*   length \a aLen .
+*/
+int isQueryMatchesOf(QueryMatches *q, wchar_t *a, int aLen);
+
+/**
+*   Releases memory under \a *q .
+*/
+void freeQueryMatches(QueryMatches *q);
+
+#endif
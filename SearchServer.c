@@ -0,0 +1,398 @@
+/*
+*    Copyright (C) 2010 University of Tartu
+*    Authors: Reina Krik, Siim Orasmaa, Kristo Tammeoja, Jaak Vilo
+*    Contact:  siim . orasmaa {at} ut . ee
+*
+*    This file is part of Generalized Edit Distance Tool.
+*
+*    Generalized Edit Distance Tool is free software: you can redistribute 
+*    it and/or modify it under the terms of the GNU General Public License 
+*    as published by the Free Software Foundation, either version 3 of the
+*    License, or (at your option) any later version.
+*
+*    Generalized Edit Distance Tool is distributed in the hope that it will 
+*    be useful, but WITHOUT ANY WARRANTY; without even the implied warranty 
+*    of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*    GNU General Public License for more details.
+*
+*    You should have received a copy of the GNU General Public License
+*    along with Generalized Edit Distance Tool. 
+*    If not, see <http://www.gnu.org/licenses/>.
+*
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include "SearchServer.h"
+
+/**
+*   A search that is currently running: its identifier \a id (given by the
+*  client) and the flag \a cancel that stops it. Running searches are kept 
+*  in the list \c running , so that they can be cancelled from any connection.
+*/
+typedef struct RunningSearch {
+    char *id;
+    volatile int cancel;
+    struct RunningSearch *next;
+} RunningSearch;
+
+static RunningSearch *running = NULL;
+static pthread_mutex_t runningLock = PTHREAD_MUTEX_INITIALIZER;
+
+/**
+*   A client connection: the stream \a out for responses (written by one 
+*  request at a time, under \a outLock ), the loaded rule set and dictionary,
+*  and the number of \a users : the thread reading the requests and the 
+*  searches still running. The last user closes the connection.
+*/
+typedef struct Connection {
+    int fd;
+    FILE *out;
+    pthread_mutex_t outLock;
+    int users;
+    GedRuleSet *rules;
+    GedDictionary *dict;
+} Connection;
+
+/**
+*   A search request of the connection \a c : its \a line split into 
+*  \a fields , its entry \a self in the list of running searches, and the
+*  buffer for its results.
+*/
+typedef struct Request {
+    Connection *c;
+    char *line;
+    char *fields[5];
+    RunningSearch self;
+    GedResult *results;
+    int capacity;
+} Request;
+
+// Adds the search to the list of running searches
+static void startRunning(RunningSearch *r, char *id){
+    r->id = id;
+    r->cancel = 0;
+    pthread_mutex_lock(&runningLock);
+    r->next = running;
+    running = r;
+    pthread_mutex_unlock(&runningLock);
+}
+
+// Removes the search from the list of running searches
+static void stopRunning(RunningSearch *r){
+    RunningSearch **p;
+    pthread_mutex_lock(&runningLock);
+    for(p = &running; *p != NULL; p = &(*p)->next){
+        if(*p == r){
+            *p = r->next;
+            break;
+        }
+    }
+    pthread_mutex_unlock(&runningLock);
+}
+
+// Cancels all running searches with the given identifier; returns the number of searches cancelled
+static int cancelRunning(char *id){
+    RunningSearch *r;
+    int k = 0;
+    pthread_mutex_lock(&runningLock);
+    for(r = running; r != NULL; r = r->next){
+        if(strcmp(r->id, id) == 0){
+            r->cancel = 1;
+            k++;
+        }
+    }
+    pthread_mutex_unlock(&runningLock);
+    return k;
+}
+
+// Makes sure that the results buffer of the request holds at least n results
+static void ensureResults(Request *r, int n){
+    if(n > r->capacity){
+        r->capacity = (n > 2 * r->capacity) ? n : 2 * r->capacity;
+        r->results = (GedResult *)realloc(r->results, r->capacity * sizeof(GedResult));
+        if(r->results == NULL){
+            puts("Error: Could not allocate memory");
+            exit(1);
+        }
+    }
+}
+
+// Drops a user of the connection; the last one closes it
+static void releaseConnection(Connection *c){
+    int last;
+    pthread_mutex_lock(&c->outLock);
+    last = (--c->users == 0);
+    pthread_mutex_unlock(&c->outLock);
+    if(last){
+        fclose(c->out);
+        pthread_mutex_destroy(&c->outLock);
+        free(c);
+    }
+}
+
+/*
+*   Splits the request line into tab-separated fields: stores pointers to 
+*  at most \a max fields into \a fields (the last field takes the rest of
+*  the line) and returns the number of fields.
+*/
+static int splitFields(char *line, char **fields, int max){
+    int n = 0;
+    fields[n++] = line;
+    while(n < max && (line = strchr(line, '\t')) != NULL){
+        *line++ = '\0';
+        fields[n++] = line;
+    }
+    return n;
+}
+
+/*
+*   Runs the search of the request: returns the number of results (stored
+*  in the buffer of the request), \c GED_TIMEOUT , \c GED_CANCELLED or -1 
+*  with the error message in \a *error .
+*/
+static int runSearch(Request *r, const char **error){
+    Connection *c = r->c;
+    GedSearch *search;
+    char *op = r->fields[1];
+    char *err;
+    double value;
+    long deadline, n = 0;
+    int mode, blockChanges, count;
+
+    switch(op[1]){
+        case 'f': mode = GED_MATCH_FULL;   break;
+        case 'p': mode = GED_MATCH_PREFIX; break;
+        case 'i': mode = GED_MATCH_INFIX;  break;
+        case 's': mode = GED_MATCH_SUFFIX; break;
+        default:
+            *error = "unknown match type";
+            return -1;
+    }
+    blockChanges = (op[2] == 'e');
+    // the number of best matches must be a whole number
+    if(op[0] == 'b'){
+        n = strtol(r->fields[2], &err, 10);
+        value = (double)n;
+    } else
+        value = strtod(r->fields[2], &err);
+    if(*err != '\0' || value < 0.0){
+        *error = "bad value";
+        return -1;
+    }
+    deadline = strtol(r->fields[3], &err, 10);
+    if(*err != '\0'){
+        *error = "bad deadline";
+        return -1;
+    }
+    search = gedCompileSearch(c->rules, r->fields[4], blockChanges);
+    if(search == NULL){
+        *error = "query cannot be converted";
+        return -1;
+    }
+    gedSetDeadline(search, deadline);
+    gedSetCancelFlag(search, &r->self.cancel);
+    if(op[0] == 'b'){
+        // no more results than lines in the dictionary
+        if(n > gedDictionarySize(c->dict))
+            n = gedDictionarySize(c->dict);
+        ensureResults(r, (int)n);
+        count = gedSearchBest(search, c->dict, mode, (int)n, r->results);
+    } else {
+        ensureResults(r, 1024);
+        count = gedSearchThreshold(search, c->dict, mode, value, r->results, r->capacity);
+        // the buffer was too small: search again with a buffer large enough (within the same deadline)
+        if(count > r->capacity){
+            ensureResults(r, count);
+            count = gedSearchThreshold(search, c->dict, mode, value, r->results, r->capacity);
+        }
+    }
+    gedFreeSearch(search);
+    if(count < 0 && count != GED_TIMEOUT && count != GED_CANCELLED)
+        *error = "search failed";
+    return count;
+}
+
+// Runs a search request on its own thread and writes the response
+static void *serveSearch(void *arg){
+    Request *r = (Request *)arg;
+    Connection *c = r->c;
+    const char *error = NULL;
+    const char *word;
+    int count, k, len;
+
+    count = runSearch(r, &error);
+    stopRunning(&r->self);
+
+    pthread_mutex_lock(&c->outLock);
+    fputs(r->fields[0], c->out);
+    if(count == GED_TIMEOUT)
+        fprintf(c->out, "\tTIMEOUT\n");
+    else if(count == GED_CANCELLED)
+        fprintf(c->out, "\tCANCELLED\n");
+    else if(count < 0)
+        fprintf(c->out, "\tERR\t%s\n", error);
+    else {
+        fprintf(c->out, "\t%i\n", count);
+        for(k = 0; k < count; k++){
+            word = gedDictionaryLine(c->dict, r->results[k].line, &len);
+            fprintf(c->out, "%i\t%f\t%.*s\n", r->results[k].line, r->results[k].score, len, word);
+        }
+    }
+    fflush(c->out);
+    pthread_mutex_unlock(&c->outLock);
+
+    free(r->results);
+    free(r->line);
+    free(r);
+    releaseConnection(c);
+    gedReleaseThread();
+    return NULL;
+}
+
+// Writes a one-line response to the connection
+static void answer(Connection *c, const char *id, const char *format, int k){
+    pthread_mutex_lock(&c->outLock);
+    fputs(id, c->out);
+    fprintf(c->out, format, k);
+    fflush(c->out);
+    pthread_mutex_unlock(&c->outLock);
+}
+
+/*
+*   Starts the search request on its own thread: \a line (of \a lineLen 
+*  bytes) has been split into \a fields , and is copied with them. The 
+*  search is added to the running searches before the thread starts, so 
+*  that a cancel request read right after it finds it.
+*/
+static void startSearch(Connection *c, char *line, ssize_t lineLen, char **fields){
+    Request *r;
+    pthread_t thread;
+    int k;
+
+    r = (Request *)calloc(1, sizeof(Request));
+    if(r == NULL || (r->line = (char *)malloc(lineLen + 1)) == NULL){
+        puts("Error: Could not allocate memory");
+        exit(1);
+    }
+    memcpy(r->line, line, lineLen + 1);
+    for(k = 0; k < 5; k++)
+        r->fields[k] = r->line + (fields[k] - line);
+    r->c = c;
+    pthread_mutex_lock(&c->outLock);
+    c->users++;
+    pthread_mutex_unlock(&c->outLock);
+    startRunning(&r->self, r->fields[0]);
+    if(pthread_create(&thread, NULL, serveSearch, r) != 0){
+        perror("Error on creating thread");
+        exit(1);
+    }
+    pthread_detach(thread);
+}
+
+/*
+*   Reads the requests of a single client, until it closes the connection.
+*  Cancel requests are answered right away, and every search runs on its own
+*  thread, so searches of the same connection run concurrently and can be
+*  cancelled from it.
+*/
+static void *serveConnection(void *arg){
+    Connection *c = (Connection *)arg;
+    char *fields[5];
+    char *line = NULL;
+    size_t lineCap = 0;
+    ssize_t lineLen;
+    FILE *in;
+    int n;
+
+    in     = fdopen(c->fd, "r");
+    c->out = fdopen(dup(c->fd), "w");
+    if(in == NULL || c->out == NULL){
+        perror("Error on opening connection");
+        exit(1);
+    }
+    while((lineLen = getline(&line, &lineCap, in)) > 0){
+        if(line[lineLen - 1] == '\n')
+            line[--lineLen] = '\0';
+        if(lineLen > 0 && line[lineLen - 1] == '\r')
+            line[--lineLen] = '\0';
+        if(lineLen == 0)
+            continue;
+        n = splitFields(line, fields, 5);
+        if(n == 3 && strcmp(fields[1], "c") == 0)
+            answer(c, fields[0], "\tOK\t%i\n", cancelRunning(fields[2]));
+        else if(n == 5 && (fields[1][0] == 'm' || fields[1][0] == 'b'))
+            startSearch(c, line, lineLen, fields);
+        else
+            answer(c, fields[0], "\tERR\tbad request\n", 0);
+    }
+    free(line);
+    fclose(in);
+    releaseConnection(c);
+    return NULL;
+}
+
+// Loads the files and serves searches on the socket
+int serveSearches(const char *socketPath, const char *rulesFile, const char *dictFile,
+                  const char *ignoreCaseFile){
+    struct sockaddr_un addr;
+    GedRuleSet *rules;
+    GedDictionary *dict;
+    Connection *c;
+    pthread_t thread;
+    int fd, client;
+
+    rules = gedLoadRuleSet(rulesFile, ignoreCaseFile);
+    if(rules == NULL){
+        fprintf(stderr, "Could not load the transformations file\n");
+        return 1;
+    }
+    dict = gedLoadDictionary(rules, dictFile);
+    if(dict == NULL){
+        fprintf(stderr, "Could not load the dictionary file\n");
+        return 1;
+    }
+    if(strlen(socketPath) >= sizeof(addr.sun_path)){
+        fprintf(stderr, "The socket path is too long\n");
+        return 1;
+    }
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strcpy(addr.sun_path, socketPath);
+    unlink(socketPath);
+    if((fd = socket(AF_UNIX, SOCK_STREAM, 0)) == -1 ||
+       bind(fd, (struct sockaddr *)&addr, sizeof(addr)) == -1 ||
+       listen(fd, 64) == -1){
+        perror("Error on creating socket");
+        return 1;
+    }
+    // a client closing its connection must not stop the server
+    signal(SIGPIPE, SIG_IGN);
+
+    while(1){
+        if((client = accept(fd, NULL, NULL)) == -1){
+            perror("Error on accepting connection");
+            continue;
+        }
+        c = (Connection *)calloc(1, sizeof(Connection));
+        if(c == NULL)
+            abort();
+        c->fd = client;
+        c->users = 1;
+        pthread_mutex_init(&c->outLock, NULL);
+        c->rules = rules;
+        c->dict = dict;
+        if(pthread_create(&thread, NULL, serveConnection, c) != 0){
+            perror("Error on creating thread");
+            exit(1);
+        }
+        pthread_detach(thread);
+    }
+    return 0;
+}
@@ -0,0 +1,72 @@
+/*
+*    Copyright (C) 2010 University of Tartu
+*    Authors: Reina Krik, Siim Orasmaa, Kristo Tammeoja, Jaak Vilo
+*    Contact:  siim . orasmaa {at} ut . ee
+*
+*    This file is part of Generalized Edit Distance Tool.
+*
+*    Generalized Edit Distance Tool is free software: you can redistribute 
+*    it and/or modify it under the terms of the GNU General Public License 
+*    as published by the Free Software Foundation, either version 3 of the
+*    License, or (at your option) any later version.
+*
+*    Generalized Edit Distance Tool is distributed in the hope that it will 
+*    be useful, but WITHOUT ANY WARRANTY; without even the implied warranty 
+*    of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*    GNU General Public License for more details.
+*
+*    You should have received a copy of the GNU General Public License
+*    along with Generalized Edit Distance Tool. 
+*    If not, see <http://www.gnu.org/licenses/>.
+*
+*/
+
+#ifndef SEARCHSERVER_H
+#define SEARCHSERVER_H
+
+#include "GenEditDistLib.h"
+
+/**
+*   Daemon mode of the tool (flag "-d"): the rule set and the dictionary are
+*   loaded once and kept in memory, and searches are served to clients over
+*   a local Unix domain socket. The requests of every client connection are
+*   read by its own thread, and every search runs on a thread of its own, so
+*   searches are served concurrently, also the ones of a single connection.
+*   The responses of a connection are written in the order the searches end,
+*   not in the order of the requests: clients tell them apart by \c id .
+*
+*   The protocol is line based. A request is a line of tab-separated fields:
+*   <br>
+*   \c id \c TAB \c op \c TAB \c value \c TAB \c deadline \c TAB \c query
+*   <br>
+*   where \c id is an identifier chosen by the client (without tabs), \c op is
+*   \c 'm' (all matches with distance \c <= \c value ) or \c 'b' ( \c value 
+*   best matches, ties broken by the line number; \c value must be a whole
+*   number) followed by the match type 
+*   \c 'f' , \c 'p' , \c 'i' or \c 's' and optionally by \c 'e' (blocked 
+*   regions are marked in the query, see flag "-e"), \c deadline is the time
+*   limit of the search in milliseconds ( \c 0 for none) and \c query is the 
+*   search string (the rest of the line).
+*   The response starts with the line \c id \c TAB \c n , followed by \c n
+*   lines \c line \c TAB \c distance \c TAB \c word (line numbers are counted
+*   from 0). If the search cannot be made, the response is a single line 
+*   \c id \c TAB \c ERR \c TAB \c message , \c id \c TAB \c TIMEOUT or 
+*   \c id \c TAB \c CANCELLED .
+*   <br>
+*   The request \c id \c TAB \c c \c TAB \c target cancels all running 
+*   searches with the identifier \c target (sent from any connection, also
+*   the one the searches came from), and is answered with \c id \c TAB \c OK \c TAB \c k , where \c k is the 
+*   number of searches cancelled.
+*/
+
+/**
+*   Loads transformations from \a rulesFile , the dictionary \a dictFile and
+*   the 'ignore case' list \a ignoreCaseFile (can be \c NULL ), and serves 
+*   searches on the socket \a socketPath until the process is killed. An 
+*   existing file at \a socketPath is removed. Returns 1, if the files cannot
+*   be loaded or the socket cannot be created.
+*/
+int serveSearches(const char *socketPath, const char *rulesFile, const char *dictFile,
+                  const char *ignoreCaseFile);
+
+#endif
@@ -44,50 +44,40 @@ int equalWeights(double a, double b){
 
 // Search for best paths leading to the given table cell (i, j) via (generalized edit distance) remove operations
 double searchPathFromRemTrie(int cols, double table[][cols], Transformation *transForm, double value, wchar_t* string, int i, int j, int first, Transformations *transF, ARTrie *remTrie){
-    ARTNode *tmp;
+    FrozenTrie *f;
+    FrozenNode *n;
+    int node = 0;
     int i1, j1;
     int c = 1;
-    int t;
-    // Start from the first node of remove operations, seek for remove operations
+    // Start from the root of remove operations, seek for remove operations
     // that could have led to the position ( i, j ) in the table;
-    tmp = remTrie->firstNode;
+    f = frozenARTrie(remTrie);
     i1 = i; j1 = j;
-    while(tmp != NULL && i > 0){
-        if(tmp->label == string[i-1]){
-            c++;
-            //  If the end of trie has been reached ...
-            if(tmp->value != DBL_MAX){
-                // If we have found a legitimate transformation (tmp->value != DBL_MAX),
-                // check whether it could have been used for reaching the given cell:
-                if( equalWeights( table[i-1][j] + tmp->value, value) ){
-                    // We have found a removing transformation that can be used for reaching the given cell
-                    // in the table: 
-                    //    now, construct the transformation string and add it to the list of 
-                    //    transformations
-                    wchar_t *s;
-                    s = (wchar_t *)malloc(sizeof(wchar_t)*c);
-                    s[c-1] = L'\0';
-                    t = 0;
-                    ARTNode *prev;
-                    prev = tmp;
-                    while(t < c-1){
-                        s[t] = prev->label;
-                        prev = prev->prevNode;
-                        t++;
-                    }
-                    if(first == 0)
-                        // add as a first transformation of *transF
-                        insertFirstTransformationToList(i1, j1, i-1, j, s, NULL, tmp->value, 1, transForm, transF);
-                    else
-                        // add as a next transformation of given *transForm
-                        insertTransformationToList(i1, j1, i-1, j, s, NULL, tmp->value, 1, transForm);
-                    free(s);
-                }
+    while(i > 0 && (node = frozenChild(f, node, string[i-1])) >= 0){
+        n = f->nodes + node;
+        c++;
+        //  If the end of trie has been reached ...
+        if(n->value != DBL_MAX){
+            // If we have found a legitimate transformation (n->value != DBL_MAX),
+            // check whether it could have been used for reaching the given cell:
+            if( equalWeights( table[i-1][j] + n->value, value) ){
+                // We have found a removing transformation that can be used for reaching the given cell
+                // in the table: 
+                //    now, construct the transformation string (the trie holds it reversed) and add 
+                //    it to the list of transformations
+                wchar_t *s;
+                s = (wchar_t *)malloc(sizeof(wchar_t)*c);
+                s[frozenReversedString(f, node, s)] = L'\0';
+                if(first == 0)
+                    // add as a first transformation of *transF
+                    insertFirstTransformationToList(i1, j1, i-1, j, s, NULL, n->value, 1, transForm, transF);
+                else
+                    // add as a next transformation of given *transForm
+                    insertTransformationToList(i1, j1, i-1, j, s, NULL, n->value, 1, transForm);
+                free(s);
             }
-            tmp = tmp->nextNode;
-            i--;
         }
-        else tmp = tmp->rightNode;
+        i--;
     }
     return 0;
 }
@@ -95,147 +85,114 @@ double searchPathFromRemTrie(int cols, double table[][cols], Transformation *tra
 
 // Search for best paths leading to the given table cell (i, j) via (generalized edit distance) add operations
 double searchPathFromAddTrie(int cols, double table[][cols], Transformation *transForm, double value, wchar_t* string, int i, int j, int first, Transformations *transF, ARTrie *addTrie){
-    ARTNode *tmp;
+    FrozenTrie *f;
+    FrozenNode *n;
+    int node = 0;
     int c = 1;
-    int t;
     int i1, j1;
-    // Start from the first node of add operations, seek for add operations
+    // Start from the root of add operations, seek for add operations
     // that could have led to the position ( i, j ) in the table;
-    tmp = addTrie->firstNode;
+    f = frozenARTrie(addTrie);
     i1 = i; j1 = j;
-    while(tmp != NULL && j > 0){
-        if(tmp->label == string[j-1]){
-            c++;
-            if(tmp->value != DBL_MAX){
-                // If we have found a legitimate transformation (tmp->value != DBL_MAX),
-                // check whether it could have been used for reaching the given cell:
-                if( equalWeights( table[i][j-1]+ tmp->value, value) ) {
-                    // We have found an adding transformation that can be used for reaching the given cell
-                    // in the table: 
-                    //    now, construct the transformation string and add it to the list of 
-                    //    transformations
-                    wchar_t *s;
-                    s = (wchar_t *)malloc(sizeof(wchar_t)*c);
-                    s[c-1] = L'\0';
-                    t = 0;
-                    ARTNode *prev;
-                    prev = tmp;
-                    while(t < c-1){
-                        s[t] = prev->label;
-                        prev = prev->prevNode;
-                        t++;
-                    }
-                    if(first == 0)
-                        // add as a first transformation of *transF
-                        insertFirstTransformationToList(i1, j1, i, j-1, NULL, s, tmp->value, 1, transForm, transF);
-                    else
-                        // add as a next transformation of given *transForm
-                        insertTransformationToList(i1, j1, i, j-1, NULL, s, tmp->value, 1, transForm);
-                    free(s);
-                }
+    while(j > 0 && (node = frozenChild(f, node, string[j-1])) >= 0){
+        n = f->nodes + node;
+        c++;
+        if(n->value != DBL_MAX){
+            // If we have found a legitimate transformation (n->value != DBL_MAX),
+            // check whether it could have been used for reaching the given cell:
+            if( equalWeights( table[i][j-1]+ n->value, value) ) {
+                // We have found an adding transformation that can be used for reaching the given cell
+                // in the table: 
+                //    now, construct the transformation string (the trie holds it reversed) and add 
+                //    it to the list of transformations
+                wchar_t *s;
+                s = (wchar_t *)malloc(sizeof(wchar_t)*c);
+                s[frozenReversedString(f, node, s)] = L'\0';
+                if(first == 0)
+                    // add as a first transformation of *transF
+                    insertFirstTransformationToList(i1, j1, i, j-1, NULL, s, n->value, 1, transForm, transF);
+                else
+                    // add as a next transformation of given *transForm
+                    insertTransformationToList(i1, j1, i, j-1, NULL, s, n->value, 1, transForm);
+                free(s);
             }
-            tmp = tmp->nextNode;
-            j--;
         }
-        else tmp = tmp->rightNode; // labels did not match: check for the next node at the same level
+        j--;
     }
     return 0;
 }
 
 // Search for best paths leading to the given table cell (i, j) via (generalized edit distance) replace operations
 double searchPathFromRepTrie(int cols, double table[][cols], double value, Transformation *transForm, wchar_t *string1, wchar_t *string2, int i, int j, int first, Transformations *transF, Trie *repTrie){
-    TrieNode *tmp;
-    int t1;
+    FrozenTrie *f;
+    FrozenNode *n;
+    int node = 0;
     int c = 1;
     int i_start = i;
-    // Start from the first node of replace operations trie, seek for replace operations
+    // Start from the root of replace operations trie, seek for replace operations
     // that could have led to the position ( i, j ) in the table;
-    tmp = repTrie->firstNode;
-    while(tmp != NULL){
-        if(tmp->label == string1[i-1]){
-            c++;
-            if(tmp->replacement != NULL){
-                // If we have found a legitimate transformation (tmp->replacement != NULL),
-                // reconstruct the left side of the transformation and then seek for matching 
-                // right sides 
-                wchar_t *left;
-                left = (wchar_t *)malloc(sizeof(wchar_t)*c);
-                left[c-1] = L'\0';
-                t1 = 0;
-                TrieNode *prev;
-                prev = tmp;
-                while(t1 < c-1){
-                   left[t1] = prev->label;
-                   prev = prev->prevNode;
-                   t1++;
-                }
-                EndNode *repl;
-                repl = tmp->replacement;
-                // seek for matching right sides of the transformation, and insert found
-                // right sides into the list of transformations
-                findReplacementPath(cols, table, value, transForm, string2, left, c-1, repl, i_start, i-1, j, first, transF);
-                free(left);
-            }
-            tmp = tmp->nextNode;
-            i--;
+    f = frozenTrie(repTrie);
+    while(i > 0 && (node = frozenChild(f, node, string1[i-1])) >= 0){
+        n = f->nodes + node;
+        c++;
+        if(n->replacement != NULL){
+            // If we have found a legitimate transformation (n->replacement != NULL),
+            // reconstruct the left side of the transformation (the trie holds it reversed) and 
+            // then seek for matching right sides 
+            wchar_t *left;
+            left = (wchar_t *)malloc(sizeof(wchar_t)*c);
+            left[frozenReversedString(f, node, left)] = L'\0';
+            // seek for matching right sides of the transformation, and insert found
+            // right sides into the list of transformations
+            findReplacementPath(cols, table, value, transForm, string2, left, c-1, f, n->rights, i_start, i-1, j, first, transF);
+            free(left);
         }
-        else tmp = tmp->rightNode;  // labels did not match: check for the next node at the same level
+        i--;
     }
     return 0;
 }
 
 
 // Finds concrete replacements that can lead to the given table cell (i, j) via (generalized edit distance) replace
-double findReplacementPath(int cols, double table[][cols], double value, Transformation *transForm, wchar_t *string2, wchar_t *left, int leftLen, EndNode *n, int i_start, int i, int j, int first, Transformations *transF){
-    wchar_t *repl;
-    int j1;
-    int t1;
-    while(n != NULL){
-        // Take the right side string from the EndNode
-        repl = n->edit;
-        j1 = j;
-        int c = 0;
-        // Find length of the right side string
-        while(repl[c] != L'\0')
-            c++;
-        int sLen = c;
-        while(1){
-            // Attempt to match string2 with the right side string
-            if(n != NULL && c > 0 && j1 > 0 && string2[j1 - 1] == repl[c - 1]){
-                if(c == 1){ 
-                    // If the right side string matches string2, then check whether it could 
-                    // have been used for reaching the given cell:
-                    if( equalWeights( table[i][j1-1] + n->value, value ) ){
-                        // We have found a replace transformation that can be used for reaching the given 
-                        // cell in the table: 
-                        //    now, re-construct the right side of transformation, and add the transformation
-                        //    to the list of transformations
-                        wchar_t *s;
-                        s = (wchar_t *)malloc(sizeof(wchar_t)*(sLen+1));
-                        s[sLen] = L'\0';
-                        t1 = sLen-1;
-                        while(t1 >= 0){
-                            s[t1] = repl[t1];
-                            t1--;
-                        }
-                        if(first == 0)
-                            // add as a first transformation of *transF
-                            insertFirstTransformationToList(i_start, j, i, j1-1, left, s, n->value, 1, transForm, transF);
-                        else
-                            // add as a next transformation of given *transForm
-                            insertTransformationToList(i_start, j, i, j1-1, left, s, n->value, 1, transForm);
-                        free(s);
-                    }
-                    // goto checking the next EndNode (the next right side string)
-                    goto nextRepl;
-                }
-                c--;
-                j1--;
-            }
-            else break;
+double findReplacementPath(int cols, double table[][cols], double value, Transformation *transForm, wchar_t *string2, wchar_t *left, int leftLen, FrozenTrie *f, int rights, int i_start, int i, int j, int first, Transformations *transF){
+    int *found;
+    int nFound = 0;
+    int node = rights;
+    int j1 = j;
+    int k, l, tmp;
+    // Walk the sub-trie of (reversed) right sides backwards along string2, collecting
+    // right sides which could have been used for reaching the given cell
+    found = (int *)malloc(sizeof(int)*(j+1));
+    while(j1 > 0 && (node = frozenRightChild(f, node, string2[j1 - 1])) >= 0){
+        j1--;
+        if(f->rights[node].value != DBL_MAX && 
+           equalWeights( table[i][j1] + f->rights[node].value, value )){
+            // insertion sort: keep the order of the right sides in the transformations file
+            for(k = nFound; k > 0 && f->rights[found[k-1]].order > f->rights[node].order; k--)
+                found[k] = found[k-1];
+            found[k] = node;
+            nFound++;
         }
-        nextRepl: n = n->nextEN;
     }
+    for(k = 0; k < nFound; k++){
+        // We have found a replace transformation that can be used for reaching the given 
+        // cell in the table: 
+        //    now, re-construct the right side of transformation, and add the transformation
+        //    to the list of transformations
+        wchar_t *s;
+        s = (wchar_t *)malloc(sizeof(wchar_t)*(j+1));
+        l = frozenReversedRight(f, found[k], s);
+        s[l] = L'\0';
+        tmp = j - l;
+        if(first == 0)
+            // add as a first transformation of *transF
+            insertFirstTransformationToList(i_start, j, i, tmp, left, s, f->rights[found[k]].value, 1, transForm, transF);
+        else
+            // add as a next transformation of given *transForm
+            insertTransformationToList(i_start, j, i, tmp, left, s, f->rights[found[k]].value, 1, transForm);
+        free(s);
+    }
+    free(found);
     return 0;
 }
 
@@ -247,11 +204,10 @@ double findReplacementPath(int cols, double table[][cols], double value, Transfo
 // -----------------------------------------------------------------------------
 
 // Backtraces (generalized) edit distance operations and finds best edit paths between strings a and b
-int findBestPaths(int cols, double table[][cols], 
+int findBestPaths(GedEngine *e, int cols, double table[][cols], 
                   wchar_t *a, wchar_t *b, 
                   int aLen, int bLen, 
-                  Transformations *transF, 
-                  ARTrie *remTrie, ARTrie *addTrie, Trie *repTrie){
+                  Transformations *transF){
     
     if (transF == NULL || transF->firstTransformation != NULL){
         // The given list of transformations must be initialised and empty,
@@ -259,6 +215,13 @@ int findBestPaths(int cols, double table[][cols],
         abort();
     }
     
+    // tries for backtracing hold the transformations reversed
+    ARTrie *remTrie = e->traceRemT;
+    ARTrie *addTrie = e->traceAddT;
+    Trie *repTrie   = e->traceT;
+    double rep = e->rep;
+    double rem = e->rem;
+    double add = e->add;
     double value;
     int i;
     int j;
@@ -28,16 +28,13 @@
 #include <string.h>
 #include "Trie.h"
 #include "ARTrie.h"
+#include "FrozenTrie.h"
 #include "FileToTrie.h"
+#include "GedEngine.h"
 #include "Transformation.h"
 #include <float.h>
 #include <locale.h>
 
-// Default values for add, replace and remove operations
-extern double rep;
-extern double rem;
-extern double add;
-
 // -----------------------------------------------------------------------------
 //    Util(s)
 // -----------------------------------------------------------------------------
@@ -86,16 +83,17 @@ double searchPathFromAddTrie(int cols, double table[][cols], Transformation *tra
 double searchPathFromRepTrie(int cols, double table[][cols], double value, Transformation *transForm, wchar_t *string1, wchar_t *string2, int i, int j, int first, Transformations *transF, Trie *repTrie);
 
 /**
-*     Searches a replacement from list \a *n , which matches a prefix of 
-*    \a *string2 , and can be applied for reaching the \a table position 
-*    \c [i][j] .
+*     Walks the sub-trie of right sides \a rights of \a *f (right sides are 
+*    reversed in the backtracing trie) backwards along \a *string2 from 
+*    position \a j , seeking for replacements which can be applied for 
+*    reaching the \a table position \c [i][j] .
 *     For each found suitable replacement, inserts the transformation into
 *    the \a *transF : if \a first==0 then transformations are added to the 
 *    first/root position of \a *transF , or to the positions parallel to 
 *    the root; otherwise transformatons are added as neighbours of the given 
 *    transformation \a *transForm .
 */
-double findReplacementPath(int cols, double table[][cols], double value, Transformation *transForm, wchar_t *string2, wchar_t *left, int leftLen, EndNode *n, int i_start, int i, int j, int first, Transformations *transF);
+double findReplacementPath(int cols, double table[][cols], double value, Transformation *transForm, wchar_t *string2, wchar_t *left, int leftLen, FrozenTrie *f, int rights, int i_start, int i, int j, int first, Transformations *transF);
 
 // -----------------------------------------------------------------------------
 //    Backtracing the (generalized) edit distance table for transformations
@@ -108,6 +106,8 @@ double findReplacementPath(int cols, double table[][cols], double value, Transfo
 *    constructs best paths ( series of transformations from string \a a to 
 *    string \a b ). Transformations are inserted into \a *transF ;
 *
+*    \param e engine holding the costs of operations and the tries for 
+*             backtracing ( \a traceRemT , \a traceAddT , \a traceT )
 *    \param table prefilled edit distance table
 *    \param cols number of columns in the table
 *    \param a search string
@@ -115,11 +115,8 @@ double findReplacementPath(int cols, double table[][cols], double value, Transfo
 *    \param aLen length of a
 *    \param bLen length of b
 *    \param transF object for storing series of transformations
-*    \param remTrie trie with generalized edit distance remove operations
-*    \param addTrie trie with generalized edit distance add operations
-*    \param repTrie trie with generalized edit distance replace operations
 */
-int findBestPaths(int cols, double table[][cols], wchar_t *a, wchar_t *b, int aLen, int bLen, Transformations *transF, ARTrie *remTrie, ARTrie *addTrie, Trie *repTrie);
+int findBestPaths(GedEngine *e, int cols, double table[][cols], wchar_t *a, wchar_t *b, int aLen, int bLen, Transformations *transF);
 
 // -----------------------------------------------------------------------------
 //    Printing transformations / alignments
@@ -22,6 +22,7 @@
 */
 
 #include "Trie.h"
+#include "FrozenTrie.h"
 
 // create new TrieNode
 TrieNode *newTrieNode(wchar_t a){
@@ -44,6 +45,7 @@ Trie *createTrie(){
     if(trieRoot == NULL)
         abort();
     trieRoot->firstNode = NULL;
+    trieRoot->frozen = NULL;
     return trieRoot;
 }
 
@@ -118,6 +120,11 @@ int addToTrieDepth(TrieNode *node, wchar_t *string1, int strLen1, wchar_t *strin
 // Adds transformation (string1 => string2 : value) to the trie t
 int addToTrie(Trie *t, wchar_t *string1, int strLen1, wchar_t *string2, double value){
     TrieNode *tmp;
+    /* the frozen form does not hold the new transformation */
+    if(t->frozen != NULL){
+        freeFrozenTrie(t->frozen);
+        t->frozen = NULL;
+    }
     /* if the trie is empty ... */
     if(t->firstNode == NULL){
         t->firstNode = newTrieNode(*string1);
@@ -205,5 +212,8 @@ void freeTrie(Trie *trie){
    if (trie->firstNode != NULL){
        freeTrieNode(trie->firstNode);
    }
+   if (trie->frozen != NULL){
+       freeFrozenTrie(trie->frozen);
+   }
    free(trie);
 }
@@ -36,10 +36,13 @@
 *   where the left side \c a is the string which can be transformed with cost
 *   \c d and the right side \c b is result of the transformation (replacement).
 *   
-*   This structure holds pointer to first node in trie.
+*   This structure holds pointer to first node in trie, and the compact 
+*   read-only form of the trie used for searching ( \c FrozenTrie , \c NULL
+*   if it has not been built yet).
 */
 typedef struct Trie {
     struct TrieNode *firstNode;
+    struct FrozenTrie *frozen;
 } Trie;
 
 
@@ -0,0 +1,262 @@
+/*
+*    Copyright (C) 2010 University of Tartu
+*    Authors: Reina Krik, Siim Orasmaa, Kristo Tammeoja, Jaak Vilo
+*    Contact:  siim . orasmaa {at} ut . ee
+*
+*    This file is part of Generalized Edit Distance Tool.
+*
+*    Generalized Edit Distance Tool is free software: you can redistribute 
+*    it and/or modify it under the terms of the GNU General Public License 
+*    as published by the Free Software Foundation, either version 3 of the
+*    License, or (at your option) any later version.
+*
+*    Generalized Edit Distance Tool is distributed in the hope that it will 
+*    be useful, but WITHOUT ANY WARRANTY; without even the implied warranty 
+*    of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*    GNU General Public License for more details.
+*
+*    You should have received a copy of the GNU General Public License
+*    along with Generalized Edit Distance Tool. 
+*    If not, see <http://www.gnu.org/licenses/>.
+*
+*/
+
+/*
+*   Template of the window kernel of FindEditDistanceMod.c (see windowDistances()
+*  there). The file is included once for each specialized variant of the kernel,
+*  with WK_FLAGS defined as a combination of the WINDOW_KERNEL_* flags:
+*    -- WINDOW_KERNEL_ADD : the engine has 'add' transformations;
+*    -- WINDOW_KERNEL_REM : 'remove' transformations match the search string;
+*    -- WINDOW_KERNEL_REP : 'replace' transformations match the search string;
+*       (single-character ones are looked up from the dense tables of 
+*       QueryMatches, the others are applied from the lists of matches)
+*    -- WINDOW_KERNEL_PEN : changes of the search string are penalized ( edPen 
+*       is not NULL);
+*    -- WINDOW_KERNEL_PAIR : two variants of the table are calculated side by
+*       side, otherwise one.
+*   The kernel is defined as windowKernel<WK_FLAGS>(). The flags are constants
+*  in it, so the checks of transformations and penalties that do not apply to 
+*  the variant are left out by the compiler. WK_FLAGS is undefined at the end.
+*/
+
+#define WK_PASTE(name, flags) name ## flags
+#define WK_NAME_OF(flags) WK_PASTE(windowKernel, flags)
+#define WK_NAME WK_NAME_OF(WK_FLAGS)
+
+#define WK_ADD ((WK_FLAGS & WINDOW_KERNEL_ADD) != 0)
+#define WK_REM ((WK_FLAGS & WINDOW_KERNEL_REM) != 0)
+#define WK_REP ((WK_FLAGS & WINDOW_KERNEL_REP) != 0)
+#define WK_PEN ((WK_FLAGS & WINDOW_KERNEL_PEN) != 0)
+
+// value of the cell with the penalty of a generalized edit distance operation at row k added
+#define WK_GEN(cell, k) ((WK_PEN) ? (cell) + genPen[k] : (cell))
+
+#if (WK_FLAGS & WINDOW_KERNEL_PAIR)
+#define WK_VARIANTS 2
+#define WK_WITHIN(cell) ((cell)[0] <= limit || (cell)[1] <= limit)
+#else
+#define WK_VARIANTS 1
+#define WK_WITHIN(cell) ((cell)[0] <= limit)
+#endif
+
+static void WK_NAME(DistWindow *w, GedQuery *q, wchar_t *b, int bLen,
+                    double **start_pen, double* end_pen, double *edPen, double *genPen, double limit,
+                    double *lastScores, double *endScores){
+  GedEngine *e = q->engine;
+  wchar_t *a = q->string;
+  QueryMatches *qm = q->matches;
+  double rep = e->rep;
+  double rem = e->rem;
+  double add = e->add;
+  int i, j, k, v;
+  int rows = q->len +1;  // search string
+  double *cur;         // current column of the table
+  double *prev;        // previous column of the table
+  double *up, *left, *diag, *cell;
+  double value;
+  int last;      // deepest row of the current column having a value within the limit
+  int prevLast;  // the same for the previous column
+  int anchored = 1;  // none of the variants can start at an arbitrary position of the text
+  int addLists = WK_ADD && e->matcher->maxAddLen > 1;  // 'add' operations longer than a character
+  double addCost = INFINITY;  // cost of adding the text character at the current column
+  double *repRow = NULL;      // costs of replacing search string characters with it
+  int s;
+  TextMatches *tm;
+
+  if(defaultTextMatches == NULL)
+     defaultTextMatches = createTextMatches();
+  tm = defaultTextMatches;
+  startTextMatches(tm, e->matcher, b, bLen);
+
+  w->variants = WK_VARIANTS;
+  ensureDistWindowRows(w, rows * WK_VARIANTS);
+  for(k = 0; k < w->depth; k++)
+     clearWindowColumn(w, k);
+  w->limit = limit;
+  w->lastPushCol = -1;
+
+  cur = windowColumn(w, 0);
+  for(v = 0; v < WK_VARIANTS; v++){
+     endScores[v] = DBL_MAX;
+     if(start_pen[v] != NULL)
+        anchored = 0;
+     cur[v] = (start_pen[v] != NULL && bLen > 0) ? start_pen[v][0] : 0;
+     for(k = 1; k < w->depth && k < bLen; k++){
+        if(start_pen[v] != NULL){
+           windowColumn(w, k)[v] = start_pen[v][k];
+           markWindowRows(w, k, v);
+        }
+     }
+  }
+  markWindowRows(w, 0, WK_VARIANTS - 1);
+
+  // fill the first column, as long as values within the limit can be reached
+  last = (WK_WITHIN(cur)) ? 0 : -1;
+  for(i = 1; i < rows && (i <= last + 1 || i <= w->pushDeep[0] / WK_VARIANTS); i++){
+     up   = cur + (i-1) * WK_VARIANTS;
+     cell = cur + i * WK_VARIANTS;
+     if(WK_REM && qm->remStart[i-1] < qm->remStart[i] && WK_WITHIN(up))
+         windowFromRemMatches(w, qm, genPen, up, i-1, 0);
+     for(v = 0; v < WK_VARIANTS; v++){
+        if(up[v] <= limit){
+           value = up[v] + rem;                            // regular deletion at the search string pos i.
+           if(WK_PEN) value += edPen[i];
+           if(value < cell[v]) cell[v] = value;
+           if(WK_REM){
+              value = WK_GEN(up[v], i) + qm->remCost[i];    // single-character removal
+              if(value < cell[v]) cell[v] = value;
+           }
+        }
+     }
+     if(WK_WITHIN(cell)) last = i;
+  }
+  markWindowRows(w, 0, i * WK_VARIANTS - 1);
+
+  for(j = 1; j <= bLen; j++){
+    if(j >= 2){
+       // the column j-2 is not needed anymore: reuse it for the farthest column reachable from j-1
+       clearWindowColumn(w, j-1 + w->maxSpan);
+       for(v = 0; v < WK_VARIANTS; v++){
+          if(start_pen[v] != NULL && j-1 + w->maxSpan < bLen){
+             windowColumn(w, j-1 + w->maxSpan)[v] = start_pen[v][j-1 + w->maxSpan];
+             markWindowRows(w, j-1 + w->maxSpan, v);
+          }
+       }
+    }
+    prev = windowColumn(w, j-1);
+    cur  = windowColumn(w, j);
+    prevLast = last;
+    if(WK_ADD || WK_REP){
+       s = alphabetSymbol(qm->alphabet, b[j-1]);
+       addCost = qm->addCost[s];
+       repRow  = qm->repCost + s * rows;
+    }
+    if(addLists)
+       findTextMatchesAt(tm, j-1);
+    if(addLists && tm->addFirst[j-1] >= 0 && WK_WITHIN(prev))
+       windowFromAddMatches(w, tm, genPen, prev, 0, j-1);
+    for(v = 0; v < WK_VARIANTS; v++){
+       if(prev[v] <= limit){
+          value = prev[v] + add;                          // adding at the beginning of the search string
+          if(WK_PEN) value += edPen[0];
+          if(value < cur[v]) cur[v] = value;
+          if(WK_ADD){
+             value = WK_GEN(prev[v], 1) + addCost;         // single-character addition
+             if(value < cur[v]) cur[v] = value;
+          }
+       }
+    }
+    last = (WK_WITHIN(cur)) ? 0 : -1;
+    /*
+    *  (Ukkonen's cut-off) Below the row prevLast+1, cells of the current column can 
+    *  only be reached within the limit by removals from the cells above or by 
+    *  values already pushed into the column by generalized edit distance operations;
+    */
+    for(i = 1; i < rows && (i <= prevLast + 1 || i <= last + 1 || i <= w->pushDeep[j % w->depth] / WK_VARIANTS); i++){
+        up   = cur + (i-1) * WK_VARIANTS;
+        left = prev + i * WK_VARIANTS;
+        diag = prev + (i-1) * WK_VARIANTS;
+        cell = cur + i * WK_VARIANTS;
+        if(WK_REM && qm->remStart[i-1] < qm->remStart[i] && WK_WITHIN(up))
+           windowFromRemMatches(w, qm, genPen, up, i-1, j);
+        if(addLists && tm->addFirst[j-1] >= 0 && WK_WITHIN(left))
+           windowFromAddMatches(w, tm, genPen, left, i, j-1);
+        if(WK_REP && qm->repStart[i-1] < qm->repStart[i] && WK_WITHIN(diag))
+           windowFromRepMatches(w, qm, tm, genPen, diag, i-1, j-1);
+        for(v = 0; v < WK_VARIANTS; v++){
+           if(up[v] <= limit){
+              value = up[v] + rem;                            // delete from search string pos i.
+              if(WK_PEN) value += edPen[i];
+              if(value < cell[v]) cell[v] = value;
+              if(WK_REM){
+                 value = WK_GEN(up[v], i) + qm->remCost[i];
+                 if(value < cell[v]) cell[v] = value;
+              }
+           }
+           if(left[v] <= limit){
+              value = left[v] + add;                          // insert after search string pos i.
+              if(WK_PEN) value += edPen[i+1];
+              if(value < cell[v]) cell[v] = value;
+              if(WK_ADD){
+                 value = WK_GEN(left[v], i+1) + addCost;
+                 if(value < cell[v]) cell[v] = value;
+              }
+           }
+           if(diag[v] <= limit){
+              if(a[i-1] == b[j-1])
+                 value = diag[v];                                // identity at search string pos i.
+              else{
+                 value = diag[v] + rep;                          // replace at search string pos i.
+                 if(WK_PEN) value += edPen[i];
+              }
+              if(value < cell[v]) cell[v] = value;
+              if(WK_REP){
+                 value = WK_GEN(diag[v], i) + repRow[i];
+                 if(value < cell[v]) cell[v] = value;
+              }
+           }
+        }
+        if(WK_WITHIN(cell)) last = i;
+    }
+    markWindowRows(w, j, i * WK_VARIANTS - 1);
+
+    // the last row of the column is final: take the score of ending the match here
+    if(end_pen != NULL){
+        for(v = 0; v < WK_VARIANTS; v++){
+           value = cur[(rows-1) * WK_VARIANTS + v] + end_pen[j-1];
+           if(value < endScores[v]) endScores[v] = value;
+        }
+    }
+    /*
+    *  If no cell of the current column is within the limit, and no generalized edit
+    *  distance operation has pushed a value within the limit into the following 
+    *  columns, the rest of the table cannot come under the limit either; 
+    *  (holds only if the match cannot start at an arbitrary position of the text)
+    */
+    if(last < 0 && w->lastPushCol <= j && anchored){
+        for(v = 0; v < WK_VARIANTS; v++){
+           lastScores[v] = DBL_MAX;
+           if(endScores[v] > limit) endScores[v] = DBL_MAX;
+        }
+        return;
+    }
+  }
+
+  cur = windowColumn(w, bLen);
+  for(v = 0; v < WK_VARIANTS; v++){
+     lastScores[v] = (cur[(rows-1) * WK_VARIANTS + v] <= limit) ? cur[(rows-1) * WK_VARIANTS + v] : DBL_MAX;
+     if(endScores[v] > limit) endScores[v] = DBL_MAX;
+  }
+}
+
+#undef WK_PASTE
+#undef WK_NAME_OF
+#undef WK_NAME
+#undef WK_ADD
+#undef WK_REM
+#undef WK_REP
+#undef WK_PEN
+#undef WK_GEN
+#undef WK_VARIANTS
+#undef WK_WITHIN
+#undef WK_FLAGS
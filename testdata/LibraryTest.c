@@ -0,0 +1,118 @@
+/*
+*    Copyright (C) 2010 University of Tartu
+*    Authors: Reina Käärik, Siim Orasmaa, Kristo Tammeoja, Jaak Vilo
+*    Contact:  siim . orasmaa {at} ut . ee
+*
+*    This file is part of Generalized Edit Distance Tool.
+*
+*    Generalized Edit Distance Tool is free software: you can redistribute 
+*    it and/or modify it under the terms of the GNU General Public License 
+*    as published by the Free Software Foundation, either version 3 of the
+*    License, or (at your option) any later version.
+*
+*    Generalized Edit Distance Tool is distributed in the hope that it will 
+*    be useful, but WITHOUT ANY WARRANTY; without even the implied warranty 
+*    of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*    GNU General Public License for more details.
+*
+*    You should have received a copy of the GNU General Public License
+*    along with Generalized Edit Distance Tool. 
+*    If not, see <http://www.gnu.org/licenses/>.
+*
+*/
+
+/*
+*   Test of the library interface (see GenEditDistLib.h), run by 
+*   "make test" from the top directory: loads the test data, scores texts,
+*   searches the dictionary and tries to load files that are not usable
+*   (the images test_*.img and the compiled rule sets test_*.grs are made 
+*   by "make test" before).
+*   The output is compared with testdata/library_expected.txt .
+*/
+
+#include <stdio.h>
+#include <locale.h>
+#include "../GenEditDistLib.h"
+
+// Prints the results of a dictionary search
+static void printResults(GedDictionary *dict, GedResult *results, int count, int stored){
+    const char *word;
+    int k, len;
+
+    printf("%i\n", count);
+    for(k = 0; k < count && k < stored; k++){
+        word = gedDictionaryLine(dict, results[k].line, &len);
+        printf("%i\t%f\t%.*s\n", results[k].line, results[k].score, len, word);
+    }
+}
+
+// Tries to load the rule set and a dictionary with it, telling whether they could be loaded
+static void tryLoading(const char *rulesFile, const char *dictFile){
+    GedRuleSet *rules;
+    GedDictionary *dict = NULL;
+
+    rules = gedLoadRuleSet(rulesFile, NULL);
+    if(rules != NULL && dictFile != NULL)
+        dict = gedLoadDictionary(rules, dictFile);
+    printf("%s %s: %s\n", rulesFile, (dictFile != NULL) ? dictFile : "-",
+           (rules == NULL) ? "no rule set" : (dictFile != NULL && dict == NULL) ? "no dictionary" : "loaded");
+    if(dict != NULL)
+        gedFreeDictionary(dict);
+    if(rules != NULL)
+        gedFreeRuleSet(rules);
+}
+
+int main(){
+    const char *texts[] = { "kuk", "Kook", "kock", "cook" };
+    GedRuleSet *rules;
+    GedDictionary *dict;
+    GedSearch *search;
+    GedResult results[4];
+    double scores[4];
+    int k, count;
+
+    setlocale(LC_CTYPE, "");
+    rules = gedLoadRuleSet("testdata/transformations.txt", "testdata/upperLowerCase.txt");
+    if(rules == NULL)
+        return 1;
+    dict = gedLoadDictionary(rules, "testdata/pidgin_words.txt");
+    if(dict == NULL)
+        return 1;
+    printf("lines: %i\n", gedDictionarySize(dict));
+    search = gedCompileSearch(rules, "cook", 0);
+
+    puts("== scores");
+    printf("%f %f %f %f\n", gedScore(search, "kuk", GED_MATCH_FULL), gedScore(search, "kuk", GED_MATCH_PREFIX),
+           gedScore(search, "kuk", GED_MATCH_INFIX), gedScore(search, "kuk", GED_MATCH_SUFFIX));
+    gedScoreTexts(search, texts, 4, GED_MATCH_FULL, scores);
+    for(k = 0; k < 4; k++)
+        printf("%s %f\n", texts[k], scores[k]);
+
+    puts("== threshold");
+    count = gedSearchThreshold(search, dict, GED_MATCH_FULL, 2.0, results, 3);
+    printResults(dict, results, count, 3);
+    puts("== best");
+    count = gedSearchBest(search, dict, GED_MATCH_PREFIX, 4, results);
+    printResults(dict, results, count, 4);
+    gedFreeSearch(search);
+    gedFreeDictionary(dict);
+    gedFreeRuleSet(rules);
+
+    puts("== loading");
+    tryLoading("testdata/missing.txt", NULL);
+    tryLoading("testdata", NULL);
+    tryLoading("testdata/empty.txt", "testdata/pidgin_words.txt");
+    tryLoading("testdata/transformations.txt", "testdata/empty.txt");
+    tryLoading("testdata/transformations.txt", "testdata");
+    tryLoading("testdata/transformations.txt", "test_words.img");
+    tryLoading("testdata/transformations.txt", "test_truncated.img");
+    tryLoading("test_rules.grs", "testdata/negative_words.txt");
+    tryLoading("test_truncated.grs", NULL);
+    // a dictionary given as the ignore case file
+    rules = gedLoadRuleSet("testdata/transformations.txt", "testdata/pidgin_words.txt");
+    printf("ignore case testdata/pidgin_words.txt: %s\n", (rules == NULL) ? "no rule set" : "loaded");
+    if(rules != NULL)
+        gedFreeRuleSet(rules);
+    gedReleaseThread();
+    return 0;
+}